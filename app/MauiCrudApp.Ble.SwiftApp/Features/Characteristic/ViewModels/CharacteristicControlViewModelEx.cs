@@ -74,10 +74,18 @@ public partial class CharacteristicControlViewModelEx : CharacteristicControlVie
 
             await MainThread.InvokeOnMainThreadAsync(() =>
             {
-                // 10 bytes dummy data
+                // 10-byte frame: sequence, type (0: data), payload length, timestamp (ms), payload
+                // (same layout as the firmware's main/frame.h)
                 byte[] data = new byte[10];
                 data[0] = (byte)(counter & 0xFF);
                 data[1] = (byte)((counter >> 8) & 0xFF);
+                data[2] = 0;
+                data[3] = 0;
+                uint timestamp = (uint)Environment.TickCount;
+                data[4] = (byte)(timestamp & 0xFF);
+                data[5] = (byte)((timestamp >> 8) & 0xFF);
+                data[6] = (byte)((timestamp >> 16) & 0xFF);
+                data[7] = (byte)((timestamp >> 24) & 0xFF);
                 counter++;
 
                 try
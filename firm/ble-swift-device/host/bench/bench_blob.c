@@ -0,0 +1,356 @@
+// Blob upload benchmark for main/blob_rx.c and the blob characteristic.
+//
+// Engine: streams --size byte blobs through blob_rx_append() in MTU-sized
+// pieces and reports the host cost per byte (copy + CRC-32), then checks
+// offset, size, ownership and stale-takeover handling.
+//
+// Transfer: uploads the same blob over the simulated link both ways a
+// central can, and compares the virtual time each takes:
+//   - long write: Prepare Write requests of MTU - 5 bytes, then Execute
+//     Write. The central speaks first in every connection event, so each
+//     request waits for the previous response: two connection intervals
+//     per request/response round trip.
+//   - chunked Write Commands of MTU - 3 bytes (4-byte chunk header), as many
+//     per connection event as the air time and the central's per-event limit
+//     (--central-packets) allow.
+// The device's status record must report the blob's length and CRC-32.
+//
+// Errors: out-of-order pieces, oversize blobs, long writes to other
+// characteristics, cancel, a broken chunk stream and a disconnect mid-upload
+// must all be refused or dropped without completing a blob.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "blob_rx.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#define EVENT_GUARD_US 500 // connection event time the controller leaves unused
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fill_blob(uint8_t *blob, uint32_t size, uint32_t seed)
+{
+    uint32_t x = seed * 2654435761u + 1;
+    for (uint32_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        blob[i] = (uint8_t)(x >> 16);
+    }
+}
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-48s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Engine
+static bool engine(uint32_t size, uint32_t iterations)
+{
+    uint8_t *arena = malloc(size);
+    uint8_t *blob = malloc(size);
+    if (arena == NULL || blob == NULL) {
+        free(arena);
+        free(blob);
+        return false;
+    }
+    fill_blob(blob, size, 1);
+    uint32_t expected_crc = blob_crc32_update(0, blob, size);
+
+    blob_rx_t rx;
+    blob_rx_init(&rx, arena, size);
+    const uint16_t piece = 512;
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t it = 0; it < iterations; it++) {
+        blob_rx_begin(&rx, 0, it);
+        for (uint32_t off = 0; off < size; off += piece) {
+            uint32_t n = size - off < piece ? size - off : piece;
+            blob_rx_append(&rx, 0, off, blob + off, n, it);
+        }
+        blob_rx_finish(&rx, 0, it);
+    }
+    uint64_t t1 = sim_host_ns();
+
+    printf("== Engine: %u-byte blob in %u-byte pieces, %u times ==\n", size, piece, iterations);
+    printf("  %.2f ns/byte (copy + CRC-32), %.1f us per blob\n",
+           (double)(t1 - t0) / ((double)size * iterations), (double)(t1 - t0) / iterations / 1000.0);
+
+    static const uint8_t check_vector[] = "123456789";
+    bool ok = check("CRC-32 check value", blob_crc32_update(0, check_vector, 9) == 0xCBF43926);
+    ok &= check("every blob completed with the right CRC",
+                rx.completed == iterations && rx.done_len == size && rx.done_crc == expected_crc
+                && memcmp(arena, blob, size) == 0);
+
+    blob_rx_init(&rx, arena, size);
+    blob_rx_begin(&rx, 1, 0);
+    ok &= check("piece at the wrong offset refused", blob_rx_append(&rx, 1, 10, blob, 10, 0) == BLOB_RX_ERR_OFFSET);
+    ok &= check("piece past the arena refused", blob_rx_append(&rx, 1, 0, blob, size, 0) == BLOB_RX_OK
+                && blob_rx_append(&rx, 1, size, blob, 1, 0) == BLOB_RX_ERR_OVERFLOW);
+    ok &= check("other connection busy while the owner is active", blob_rx_begin(&rx, 2, 100) == BLOB_RX_ERR_BUSY);
+    ok &= check("other connection takes over a stale transfer", blob_rx_begin(&rx, 2, BLOB_RX_STALE_MS) == BLOB_RX_OK
+                && rx.aborted == 1);
+    ok &= check("old owner's pieces refused after takeover", blob_rx_append(&rx, 1, size, blob, 1, BLOB_RX_STALE_MS) == BLOB_RX_ERR_BUSY);
+    ok &= check("finish without a transfer refused", blob_rx_finish(&rx, 1, 0) == BLOB_RX_ERR_IDLE);
+    ok &= check("rejected pieces counted", rx.rejected == 4);
+
+    free(arena);
+    free(blob);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Transfer
+typedef struct {
+    uint32_t len;
+    uint32_t crc;
+    uint32_t completed;
+    uint32_t rejected;
+    uint32_t in_progress;
+} blob_status_t;
+
+static bool read_status(uint16_t conn_id, uint16_t handle, blob_status_t *st)
+{
+    uint8_t buf[BLOB_RX_STATUS_LEN + 8];
+    if (sim_read(conn_id, handle, buf, sizeof(buf)) != BLOB_RX_STATUS_LEN) {
+        return false;
+    }
+    st->len = get_u32(buf);
+    st->crc = get_u32(buf + 4);
+    st->completed = get_u32(buf + 8);
+    st->rejected = get_u32(buf + 12);
+    st->in_progress = get_u32(buf + 16);
+    return true;
+}
+
+static uint64_t interval_us(uint16_t conn_id)
+{
+    sim_link_t link;
+    sim_link(conn_id, &link);
+    return (uint64_t)link.params.interval * 1250;
+}
+
+// Long write: Prepare Write requests, then Execute Write. Returns false on an error response.
+static bool upload_prepared(uint16_t conn_id, uint16_t handle, const uint8_t *blob, uint32_t size, uint16_t mtu)
+{
+    uint64_t round_trip = 2 * interval_us(conn_id);
+    uint16_t piece = (uint16_t)(mtu - 5);
+    for (uint32_t off = 0; off < size; off += piece) {
+        uint16_t n = (uint16_t)(size - off < piece ? size - off : piece);
+        if (sim_prepare_write(conn_id, handle, (uint16_t)off, blob + off, n) != ESP_GATT_OK) {
+            return false;
+        }
+        sim_advance_us(round_trip);
+    }
+    bool ok = sim_execute_write(conn_id, true) == ESP_GATT_OK;
+    sim_advance_us(round_trip);
+    return ok;
+}
+
+// Chunked Write Commands, packed into connection events.
+static void upload_chunked(uint16_t conn_id, uint16_t handle, const uint8_t *blob, uint32_t size, uint16_t mtu,
+                           uint16_t central_packets)
+{
+    uint64_t interval = interval_us(conn_id);
+    uint32_t budget = (uint32_t)(interval - EVENT_GUARD_US);
+    uint16_t piece = (uint16_t)(mtu - 3 - BLOB_CHUNK_HEADER_LEN);
+    uint8_t chunk[ESP_GATT_MAX_ATTR_LEN];
+    uint32_t off = 0;
+    while (off < size) {
+        uint32_t used = 0;
+        for (uint16_t k = 0; k < central_packets && off < size; k++) {
+            uint16_t n = (uint16_t)(size - off < piece ? size - off : piece);
+            uint32_t air = sim_att_air_us(conn_id, (uint16_t)(3 + BLOB_CHUNK_HEADER_LEN + n));
+            // the event always carries at least one packet
+            if (k > 0 && used + air > budget) {
+                break;
+            }
+            used += air;
+            uint8_t flags = (off == 0 ? BLOB_CHUNK_FIRST : 0) | (off + n == size ? BLOB_CHUNK_LAST : 0);
+            blob_chunk_encode_header(flags, off, chunk);
+            memcpy(chunk + BLOB_CHUNK_HEADER_LEN, blob + off, n);
+            sim_write(conn_id, handle, chunk, (uint16_t)(BLOB_CHUNK_HEADER_LEN + n), false);
+            off += n;
+        }
+        sim_advance_us(interval);
+    }
+}
+
+static void connect(uint16_t conn_id, uint16_t mtu)
+{
+    esp_bd_addr_t bda;
+    bench_bda(bda, conn_id);
+    sim_connect(conn_id, bda);
+    sim_set_mtu(conn_id, mtu);
+    // let the connection parameters, data length and PHY settle
+    sim_advance_ms(3000);
+}
+
+static bool transfer(uint16_t conn_id, uint32_t size, uint16_t mtu, uint16_t central_packets)
+{
+    bench_handles_t h = bench_lookup_handles();
+    connect(conn_id, mtu);
+    sim_link_t link;
+    sim_link(conn_id, &link);
+
+    uint8_t *blob = malloc(size);
+    if (blob == NULL) {
+        return false;
+    }
+    printf("== Transfer: %u bytes, MTU %u, interval %.2f ms, %s, LL data length %u ==\n", size, mtu,
+           link.params.interval * 1.25, link.phy == ESP_BLE_GAP_PHY_2M ? "2M" : "1M", link.tx_octets);
+
+    blob_status_t st;
+    bool ok = read_status(conn_id, h.blob_char, &st);
+    uint32_t completed_before = st.completed;
+    double secs[2] = { 0 };
+    for (int mode = 0; mode < 2; mode++) {
+        fill_blob(blob, size, (uint32_t)mode + 7);
+        uint32_t crc = blob_crc32_update(0, blob, size);
+        sim_stats_reset();
+        uint64_t t0 = sim_now_us();
+        uint64_t h0 = sim_host_ns();
+        bool sent = true;
+        if (mode == 0) {
+            sent = upload_prepared(conn_id, h.blob_char, blob, size, mtu);
+        } else {
+            upload_chunked(conn_id, h.blob_char, blob, size, mtu, central_packets);
+        }
+        uint64_t h1 = sim_host_ns();
+        uint64_t t1 = sim_now_us();
+        const sim_stats_t s = *sim_stats();
+        blob_status_t st;
+        bool read = read_status(conn_id, h.blob_char, &st);
+
+        secs[mode] = (double)(t1 - t0) / 1e6;
+        const sim_cost_t *c = &s.gatts[ESP_GATTS_WRITE_EVT];
+        printf("  %-16s %6llu ATT writes  %7.1f ms  %8.0f B/s  device %5.0f ns/write  host %6.1f us total\n",
+               mode == 0 ? "long write" : "write commands", (unsigned long long)s.writes_delivered,
+               secs[mode] * 1000.0, size / secs[mode], c->count ? (double)c->total_ns / c->count : 0.0,
+               (double)(h1 - h0) / 1000.0);
+        bool match = sent && read && st.len == size && st.crc == crc && st.completed == completed_before + 1
+            && st.rejected == 0 && st.in_progress == 0;
+        completed_before = st.completed;
+        ok &= match;
+        if (!match) {
+            printf("  %-16s MISMATCH: len %u/%u crc 0x%08x/0x%08x completed %u rejected %u\n", "",
+                   st.len, size, st.crc, crc, st.completed, st.rejected);
+        }
+    }
+    printf("  write commands are %.1fx faster\n", secs[0] / secs[1]);
+
+    sim_disconnect(conn_id);
+    free(blob);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Errors, from connections first and first + 1
+static bool errors(uint16_t first, uint16_t mtu)
+{
+    bench_handles_t h = bench_lookup_handles();
+    uint16_t a = first;
+    uint16_t b = (uint16_t)(first + 1);
+    connect(a, mtu);
+    connect(b, mtu);
+
+    uint8_t blob[CONFIG_SWIFT_BLOB_MAX_LEN + 512];
+    fill_blob(blob, sizeof(blob), 3);
+    uint16_t piece = (uint16_t)(mtu - 5);
+    blob_status_t st, start;
+    bool ok = read_status(a, h.blob_char, &start);
+
+    printf("== Errors ==\n");
+    ok &= check("long write to the write characteristic", sim_prepare_write(a, h.write_char, 0, blob, 10) == ESP_GATT_NOT_LONG);
+
+    ok &= check("piece that skips ahead", sim_prepare_write(a, h.blob_char, 0, blob, piece) == ESP_GATT_OK
+                && sim_prepare_write(a, h.blob_char, (uint16_t)(2 * piece), blob, piece) == ESP_GATT_INVALID_OFFSET);
+    ok &= check("cancelled long write completes nothing", sim_execute_write(a, false) == ESP_GATT_OK
+                && read_status(a, h.blob_char, &st) && st.completed == start.completed && st.in_progress == 0);
+
+    esp_gatt_status_t status = ESP_GATT_OK;
+    uint32_t off = 0;
+    while (status == ESP_GATT_OK && off < sizeof(blob)) {
+        uint16_t n = (uint16_t)(sizeof(blob) - off < piece ? sizeof(blob) - off : piece);
+        status = sim_prepare_write(a, h.blob_char, (uint16_t)off, blob + off, n);
+        off += n;
+    }
+    ok &= check("blob larger than the arena", status == ESP_GATT_PREPARE_Q_FULL && off > CONFIG_SWIFT_BLOB_MAX_LEN);
+    sim_execute_write(a, false);
+
+    ok &= check("other client busy during an upload", sim_prepare_write(a, h.blob_char, 0, blob, piece) == ESP_GATT_OK
+                && sim_prepare_write(b, h.blob_char, 0, blob, piece) == ESP_GATT_BUSY);
+    sim_disconnect(a);
+    ok &= check("disconnect drops the upload", read_status(b, h.blob_char, &st) && st.in_progress == 0
+                && sim_prepare_write(b, h.blob_char, 0, blob, piece) == ESP_GATT_OK);
+    sim_execute_write(b, false);
+
+    // a chunk stream with a lost chunk: the rest is refused until the next FIRST
+    uint8_t chunk[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t n = (uint16_t)(mtu - 3 - BLOB_CHUNK_HEADER_LEN);
+    blob_chunk_encode_header(BLOB_CHUNK_FIRST, 0, chunk);
+    memcpy(chunk + BLOB_CHUNK_HEADER_LEN, blob, n);
+    sim_write(b, h.blob_char, chunk, (uint16_t)(BLOB_CHUNK_HEADER_LEN + n), false);
+    blob_chunk_encode_header(BLOB_CHUNK_LAST, 2u * n, chunk);
+    sim_write(b, h.blob_char, chunk, (uint16_t)(BLOB_CHUNK_HEADER_LEN + n), true);
+    ok &= check("chunk after a lost chunk", sim_last_response_status() == ESP_GATT_INVALID_OFFSET
+                && read_status(b, h.blob_char, &st) && st.completed == start.completed && st.in_progress == 0);
+    sim_write(b, h.blob_char, chunk, 2, true);
+    ok &= check("chunk shorter than its header", sim_last_response_status() == ESP_GATT_INVALID_ATTR_LEN);
+    // skipped ahead, too large, busy, after the lost chunk; a malformed chunk never reaches the engine
+    ok &= check("rejected pieces reported", read_status(b, h.blob_char, &st) && st.rejected - start.rejected == 4);
+
+    sim_disconnect(b);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t size = CONFIG_SWIFT_BLOB_MAX_LEN;
+    uint16_t central_packets = 6;
+
+    static const struct option options[] = {
+        { "size", required_argument, NULL, 's' },
+        { "central-packets", required_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:p:", options, NULL)) != -1) {
+        switch (opt) {
+            case 's': size = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': central_packets = (uint16_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--size BYTES] [--central-packets N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (size == 0 || size > CONFIG_SWIFT_BLOB_MAX_LEN || central_packets == 0) {
+        fprintf(stderr, "size must be in [1, %d], central-packets at least 1\n", CONFIG_SWIFT_BLOB_MAX_LEN);
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_ERROR);
+    sim_set_link_model(10, 0);
+    bool ok = engine(size, 20000);
+
+    sim_boot();
+    if (bench_lookup_handles().blob_char == 0) {
+        printf("blob characteristic not found\nFAILED\n");
+        return 1;
+    }
+    ok &= transfer(0, size, 247, central_packets);
+    ok &= transfer(1, size, 23, central_packets);
+    ok &= errors(2, 185);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+// Boot benchmark: app_main to advertising.
+//
+// Boots the device with the stack answering every setup call --reply-us
+// later (the trip through the Bluetooth task and, for GAP, the controller;
+// a range of values by default) and reports the setup events dispatched, the
+// virtual time from app_main to ESP_GAP_BLE_ADV_START_COMPLETE_EVT and the
+// host time the boot took. Built twice: bench_boot creates the service from
+// one attribute table (CONFIG_SWIFT_GATTS_ATTR_TABLE), bench_boot_chain one
+// create/add call at a time. Advertising must start after exactly the
+// build's number of round trips: 4 with the table, 10 with the chain.
+//
+// Service: the characteristics must get the handles the chain gives them
+// (the CCCD right after the notify value, each further value two handles on)
+// and a central must be able to subscribe, get notified, write and read.
+//
+// Each boot runs in a forked process with a device of its own.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sdkconfig.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#if CONFIG_SWIFT_GATTS_ATTR_TABLE
+#define SETUP_NAME      "attribute table"
+#define SETUP_TRIPS     4       // REG, CREAT_ATTR_TAB, START, ADV_START
+#else
+#define SETUP_NAME      "create/add chain"
+#define SETUP_TRIPS     10      // REG, CREATE, 5 ADD_CHAR, ADD_CHAR_DESCR, START, ADV_START
+#endif
+
+#define SERVICE_REPLY_US        1000
+#define FIRST_NOTIFY_TIMEOUT_MS 2000
+
+static const uint32_t default_reply_us[] = { 0, 250, 1000, 2500, 5000 };
+
+static uint32_t s_notify_count;
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    s_notify_count++;
+}
+
+//-----------------------------------------------------------------------------
+// Boot to advertising
+
+// Written by the child that boots, read by the parent ( shared mapping ).
+typedef struct {
+    uint32_t reply_us;
+    bool advertising;
+    uint32_t events;        // GATTS and GAP events up to and including ADV_START
+    uint64_t adv_us;        // app_main to ADV_START_COMPLETE, virtual clock
+    uint64_t host_ns;       // sim_boot() on the host
+} boot_result_t;
+
+static sim_event_action_t boot_filter(bool is_gap, int event, void *param, void *ctx)
+{
+    boot_result_t *r = ctx;
+    if (r->advertising) {
+        return SIM_EVENT_DELIVER;
+    }
+    r->events++;
+    if (is_gap && event == ESP_GAP_BLE_ADV_START_COMPLETE_EVT
+        && ((esp_ble_gap_cb_param_t *)param)->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+        r->advertising = true;
+        r->adv_us = sim_now_us();
+    }
+    return SIM_EVENT_DELIVER;
+}
+
+static int boot_run(void *arg)
+{
+    boot_result_t *r = arg;
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_stack_reply_us(r->reply_us);
+    sim_set_event_filter(boot_filter, r);
+    uint64_t start_us = sim_now_us();
+    uint64_t t0 = sim_host_ns();
+    sim_boot();
+    r->host_ns = sim_host_ns() - t0;
+    r->adv_us -= start_us;
+    return r->advertising && sim_is_advertising() ? 0 : 1;
+}
+
+static bool boot_sweep(const uint32_t *reply_us, int count, int runs)
+{
+    printf("== Boot to advertising: %s, %d boots per reply latency ==\n", SETUP_NAME, runs);
+    printf("  %-10s %8s %8s %12s %12s\n", "reply us", "events", "trips", "adv ms", "host us");
+    boot_result_t *results = mmap(NULL, sizeof(boot_result_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        uint64_t host_ns = 0;
+        bool same = true;
+        boot_result_t first = { 0 };
+        for (int run = 0; run < runs; run++) {
+            memset(results, 0, sizeof(*results));
+            results->reply_us = reply_us[i];
+            same &= bench_run_isolated(boot_run, results) == 0;
+            if (run == 0) {
+                first = *results;
+            }
+            // the virtual clock gives the same boot every time
+            same &= results->events == first.events && results->adv_us == first.adv_us;
+            host_ns += results->host_ns;
+        }
+        bool trips_ok = first.adv_us == (uint64_t)SETUP_TRIPS * reply_us[i];
+        char trips[16] = "-";
+        if (reply_us[i] > 0) {
+            snprintf(trips, sizeof(trips), "%.1f", (double)first.adv_us / reply_us[i]);
+        }
+        printf("  %-10u %8u %8s %12.3f %12.1f%s\n", reply_us[i], first.events, trips, first.adv_us / 1000.0,
+               (double)host_ns / runs / 1000.0, same && trips_ok ? "" : "  MISMATCH");
+        ok &= same && trips_ok;
+    }
+    munmap(results, sizeof(boot_result_t));
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Service
+static int service_run(void *arg)
+{
+    printf("== Service: handles and a central's first session ==\n");
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_notify_hook(on_notify, NULL);
+    sim_set_stack_reply_us(SERVICE_REPLY_US);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    bool ok = check("advertising", sim_is_advertising());
+    ok &= check("handles laid out as by the chain",
+                h.notify_char != 0 && h.cccd == h.notify_char + 1 && h.write_char == h.notify_char + 3
+                && h.config_char == h.notify_char + 5 && h.telemetry_char == h.notify_char + 7
+                && h.blob_char == h.notify_char + 9);
+
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    ok &= check("central connects", sim_connect(0, bda));
+    sim_set_mtu(0, 247);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    ok &= check("CCCD write accepted", sim_last_response_status() == ESP_GATT_OK);
+    uint64_t start = sim_now_us();
+    while (s_notify_count == 0 && sim_now_us() - start < FIRST_NOTIFY_TIMEOUT_MS * 1000ull) {
+        sim_advance_us(250);
+    }
+    ok &= check("notified", s_notify_count > 0);
+
+    const uint8_t value[4] = { 1, 2, 3, 4 };
+    sim_write(0, h.write_char, value, sizeof(value), true);
+    ok &= check("write characteristic accepts a write", sim_last_response_status() == ESP_GATT_OK);
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 16];
+    ok &= check("config and telemetry read",
+                sim_read(0, h.config_char, buf, sizeof(buf)) > 0 && sim_read(0, h.telemetry_char, buf, sizeof(buf)) > 0);
+    sim_disconnect(0);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    long reply_us = -1;
+    int runs = 20;
+
+    static const struct option options[] = {
+        { "reply-us", required_argument, NULL, 'r' },
+        { "runs", required_argument, NULL, 'n' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:n:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'r': reply_us = strtol(optarg, NULL, 0); break;
+            case 'n': runs = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [--reply-us US] [--runs N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (runs < 1 || reply_us < -1 || reply_us > 1000000) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    bool ok = bench_run_isolated(service_run, NULL) == 0;
+    if (reply_us >= 0) {
+        uint32_t one = (uint32_t)reply_us;
+        ok &= boot_sweep(&one, 1, runs);
+    } else {
+        ok &= boot_sweep(default_reply_us, sizeof(default_reply_us) / sizeof(default_reply_us[0]), runs);
+    }
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+// Helpers shared by the host benchmarks.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+
+#include "sim.h"
+
+// Mirrors the UUIDs in main/ble-swift-device.c
+static const uint8_t BENCH_NOTIFY_CHAR_UUID[16] = { 0x9E,0xCA,0xDC,0x24,0x0E,0xE5, 0xA9,0xE0,0xF3,0x93,0xA3,0xB5, 0x02, 0x00,0x40,0x6E };
+static const uint8_t BENCH_WRITE_CHAR_UUID[16]  = { 0x9E,0xCA,0xDC,0x24,0x0E,0xE5, 0xA9,0xE0,0xF3,0x93,0xA3,0xB5, 0x03, 0x00,0x40,0x6E };
+static const uint8_t BENCH_CONFIG_CHAR_UUID[16] = { 0x9E,0xCA,0xDC,0x24,0x0E,0xE5, 0xA9,0xE0,0xF3,0x93,0xA3,0xB5, 0x04, 0x00,0x40,0x6E };
+static const uint8_t BENCH_TELEMETRY_CHAR_UUID[16] = { 0x9E,0xCA,0xDC,0x24,0x0E,0xE5, 0xA9,0xE0,0xF3,0x93,0xA3,0xB5, 0x05, 0x00,0x40,0x6E };
+static const uint8_t BENCH_BLOB_CHAR_UUID[16] = { 0x9E,0xCA,0xDC,0x24,0x0E,0xE5, 0xA9,0xE0,0xF3,0x93,0xA3,0xB5, 0x06, 0x00,0x40,0x6E };
+
+static const uint8_t BENCH_CCCD_ENABLE[2] = { 0x01, 0x00 };
+static const uint8_t BENCH_CCCD_DISABLE[2] = { 0x00, 0x00 };
+
+typedef struct {
+    uint16_t notify_char;
+    uint16_t cccd;
+    uint16_t write_char;
+    uint16_t config_char;
+    uint16_t telemetry_char;
+    uint16_t blob_char;
+} bench_handles_t;
+
+static inline bench_handles_t bench_lookup_handles(void)
+{
+    bench_handles_t h;
+    h.notify_char = sim_find_char(BENCH_NOTIFY_CHAR_UUID);
+    h.cccd = sim_find_descr(h.notify_char, ESP_GATT_UUID_CHAR_CLIENT_CONFIG);
+    h.write_char = sim_find_char(BENCH_WRITE_CHAR_UUID);
+    h.config_char = sim_find_char(BENCH_CONFIG_CHAR_UUID);
+    h.telemetry_char = sim_find_char(BENCH_TELEMETRY_CHAR_UUID);
+    h.blob_char = sim_find_char(BENCH_BLOB_CHAR_UUID);
+    return h;
+}
+
+static inline void bench_bda(esp_bd_addr_t bda, uint16_t conn_id)
+{
+    bda[0] = 0x24; bda[1] = 0x0A; bda[2] = 0xC4;
+    bda[3] = 0x00; bda[4] = (uint8_t)(conn_id >> 8); bda[5] = (uint8_t)conn_id;
+}
+
+// Runs fn in a child process, which boots a device of its own; returns fn's
+// result, -1 when the child crashed.
+static inline int bench_run_isolated(int (*fn)(void *), void *arg)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int result = fn(arg);
+        fflush(stdout);
+        _exit(result);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static inline const char *bench_gatts_event_name(int event)
+{
+    switch (event) {
+        case ESP_GATTS_REG_EVT: return "GATTS REG";
+        case ESP_GATTS_READ_EVT: return "GATTS READ";
+        case ESP_GATTS_WRITE_EVT: return "GATTS WRITE";
+        case ESP_GATTS_EXEC_WRITE_EVT: return "GATTS EXEC_WRITE";
+        case ESP_GATTS_MTU_EVT: return "GATTS MTU";
+        case ESP_GATTS_CONF_EVT: return "GATTS CONF";
+        case ESP_GATTS_CREATE_EVT: return "GATTS CREATE";
+        case ESP_GATTS_ADD_CHAR_EVT: return "GATTS ADD_CHAR";
+        case ESP_GATTS_ADD_CHAR_DESCR_EVT: return "GATTS ADD_CHAR_DESCR";
+        case ESP_GATTS_START_EVT: return "GATTS START";
+        case ESP_GATTS_CONNECT_EVT: return "GATTS CONNECT";
+        case ESP_GATTS_DISCONNECT_EVT: return "GATTS DISCONNECT";
+        case ESP_GATTS_CONGEST_EVT: return "GATTS CONGEST";
+        case ESP_GATTS_RESPONSE_EVT: return "GATTS RESPONSE";
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT: return "GATTS CREAT_ATTR_TAB";
+        default: return "GATTS ?";
+    }
+}
+
+static inline const char *bench_gap_event_name(int event)
+{
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT: return "GAP ADV_DATA_RAW_SET";
+        case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT: return "GAP SCAN_RSP_RAW_SET";
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT: return "GAP ADV_START";
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT: return "GAP ADV_STOP";
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: return "GAP UPDATE_CONN_PARAMS";
+        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT: return "GAP SET_PKT_LENGTH";
+        case ESP_GAP_BLE_SET_PREFERRED_PHY_COMPLETE_EVT: return "GAP SET_PREFERRED_PHY";
+        case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT: return "GAP PHY_UPDATE";
+        default: return "GAP ?";
+    }
+}
+
+static inline void bench_print_cost_row(const char *name, const sim_cost_t *c)
+{
+    if (c->count == 0) {
+        return;
+    }
+    printf("  %-26s %10llu calls  %9.0f ns avg  %9llu ns max\n", name,
+           (unsigned long long)c->count, (double)c->total_ns / (double)c->count,
+           (unsigned long long)c->max_ns);
+}
+
+static inline void bench_print_costs(const sim_stats_t *s)
+{
+    printf("Per-event handler cost (host time):\n");
+    for (int i = 0; i < SIM_GATTS_EVT_MAX; i++) {
+        bench_print_cost_row(bench_gatts_event_name(i), &s->gatts[i]);
+    }
+    for (int i = 0; i < SIM_GAP_EVT_MAX; i++) {
+        bench_print_cost_row(bench_gap_event_name(i), &s->gap[i]);
+    }
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (s->timer_name[i] != NULL) {
+            char name[40];
+            snprintf(name, sizeof(name), "timer %s", s->timer_name[i]);
+            bench_print_cost_row(name, &s->timer[i]);
+        }
+    }
+}
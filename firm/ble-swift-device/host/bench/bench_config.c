@@ -0,0 +1,226 @@
+// Runtime configuration benchmark.
+//
+// Live reconfiguration: connects a central, measures the notification rate
+// with the compile-time defaults, then writes a new notify period, payload
+// size, connection interval and PHY through the config characteristic and
+// measures again. Rejected writes (out of range, truncated) must leave the
+// configuration untouched; the read-back must match what was written.
+//
+// Parser sweep: feeds --iterations randomly mutated config writes straight to
+// swift_config_parse() and reports the parse cost and how many were accepted.
+// Every accepted write must produce a configuration that re-encodes and
+// re-parses to itself.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swift_config.h"
+
+#include "bench_common.h"
+
+static void measure(const char *label, uint32_t duration_s)
+{
+    sim_stats_reset();
+    sim_advance_ms(duration_s * 1000);
+    const sim_stats_t *s = sim_stats();
+    double secs = (double)duration_s;
+    sim_link_t link = { 0 };
+    sim_link(0, &link);
+    printf("  %-10s %9.1f notify/s %9.0f bytes/s %7.1f bytes avg   interval %5.2f ms   PHY %s\n",
+           label, (double)s->notify_sent / secs, (double)s->notify_bytes / secs,
+           s->notify_sent ? (double)s->notify_bytes / (double)s->notify_sent : 0.0,
+           link.params.interval * 1.25, link.phy == ESP_BLE_GAP_PHY_2M ? "2M" : link.phy == ESP_BLE_GAP_PHY_CODED ? "Coded" : "1M");
+}
+
+static uint8_t *put_record(uint8_t *p, uint8_t type, const uint16_t *values, int count)
+{
+    *p++ = type;
+    *p++ = (uint8_t)(count * 2);
+    for (int i = 0; i < count; i++) {
+        *p++ = (uint8_t)(values[i] & 0xFF);
+        *p++ = (uint8_t)(values[i] >> 8);
+    }
+    return p;
+}
+
+static bool expect_status(const char *what, esp_gatt_status_t expected)
+{
+    esp_gatt_status_t got = sim_last_response_status();
+    printf("  %-34s status 0x%02x %s\n", what, got, got == expected ? "(expected)" : "(UNEXPECTED)");
+    return got == expected;
+}
+
+//-----------------------------------------------------------------------------
+// Parser sweep
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 32);
+}
+
+static bool parser_sweep(uint32_t iterations)
+{
+    swift_config_t base;
+    swift_config_defaults(&base);
+    uint8_t valid[SWIFT_CONFIG_ENCODED_LEN];
+    uint16_t valid_len = swift_config_encode(&base, valid, sizeof(valid));
+
+    uint64_t accepted = 0, by_status[5] = { 0 };
+    uint64_t total_ns = 0;
+    bool ok = true;
+    uint8_t buf[64];
+    for (uint32_t i = 0; i < iterations; i++) {
+        // start from a valid write (or random bytes), then flip, truncate or extend it
+        uint16_t len;
+        if (rng_next() % 8 == 0) {
+            len = (uint16_t)(rng_next() % sizeof(buf));
+            for (uint16_t k = 0; k < len; k++) {
+                buf[k] = (uint8_t)rng_next();
+            }
+        } else {
+            memcpy(buf, valid, valid_len);
+            len = valid_len;
+            int edits = 1 + (int)(rng_next() % 3);
+            for (int e = 0; e < edits; e++) {
+                switch (rng_next() % 3) {
+                    case 0: buf[rng_next() % len] = (uint8_t)rng_next(); break;
+                    case 1: len = (uint16_t)(rng_next() % (len + 1)); break;
+                    case 2: if (len < sizeof(buf)) { buf[len++] = (uint8_t)rng_next(); } break;
+                }
+                if (len == 0) {
+                    break;
+                }
+            }
+        }
+
+        swift_config_t cfg = base;
+        uint32_t changed = 0;
+        uint64_t start = sim_host_ns();
+        swift_config_status_t status = swift_config_parse(buf, len, &cfg, &changed);
+        total_ns += sim_host_ns() - start;
+        by_status[status < 5 ? status : 0]++;
+
+        if (status != SWIFT_CONFIG_OK) {
+            if (memcmp(&cfg, &base, sizeof(cfg)) != 0) {
+                printf("  rejected write modified the config (iteration %u)\n", i);
+                ok = false;
+            }
+            continue;
+        }
+        accepted++;
+        // accepted configs must round-trip
+        uint8_t again[SWIFT_CONFIG_ENCODED_LEN];
+        uint16_t again_len = swift_config_encode(&cfg, again, sizeof(again));
+        swift_config_t reparsed = base;
+        if (swift_config_parse(again, again_len, &reparsed, NULL) != SWIFT_CONFIG_OK
+            || memcmp(&reparsed, &cfg, sizeof(cfg)) != 0) {
+            printf("  accepted config does not round-trip (iteration %u)\n", i);
+            ok = false;
+        }
+    }
+
+    printf("== Config parser sweep: %u mutated writes ==\n", iterations);
+    printf("  parse cost                 %8.1f ns avg\n", iterations ? (double)total_ns / iterations : 0.0);
+    printf("  accepted                   %8llu\n", (unsigned long long)accepted);
+    for (int st = SWIFT_CONFIG_ERR_TRUNCATED; st <= SWIFT_CONFIG_ERR_RANGE; st++) {
+        printf("  %-26s %8llu\n", swift_config_status_str((swift_config_status_t)st), (unsigned long long)by_status[st]);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration_s = 5;
+    uint32_t iterations = 1000000;
+    uint32_t mtu = 247;
+
+    static const struct option options[] = {
+        { "duration-s", required_argument, NULL, 'd' },
+        { "iterations", required_argument, NULL, 'n' },
+        { "mtu", required_argument, NULL, 'm' },
+        { "seed", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:n:m:s:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': s_rng = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage: %s [--duration-s N] [--iterations N] [--mtu N] [--seed N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    if (h.config_char == 0) {
+        printf("config characteristic not found\nFAILED\n");
+        return 1;
+    }
+
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+
+    bool ok = true;
+    printf("== Live reconfiguration: MTU %u, %u s virtual per phase ==\n", mtu, duration_s);
+    measure("defaults", duration_s);
+
+    // 10ms tick, MTU-sized payloads, 15ms interval, 2M PHY
+    uint8_t write[32];
+    uint8_t *p = write;
+    p = put_record(p, SWIFT_CONFIG_NOTIFY_PERIOD, (const uint16_t[]){ 10 }, 1);
+    p = put_record(p, SWIFT_CONFIG_PAYLOAD_LEN, (const uint16_t[]){ 0 }, 1);
+    p = put_record(p, SWIFT_CONFIG_CONN_INTERVAL, (const uint16_t[]){ 12, 12 }, 2);
+    *p++ = SWIFT_CONFIG_PHY; *p++ = 1; *p++ = 0x02;
+    uint16_t write_len = (uint16_t)(p - write);
+    sim_write(0, h.config_char, write, write_len, true);
+    ok &= expect_status("write period/payload/interval/PHY", ESP_GATT_OK);
+    measure("updated", duration_s);
+
+    uint8_t before[64], after[64];
+    uint16_t before_len = sim_read(0, h.config_char, before, sizeof(before));
+
+    const uint8_t too_fast[] = { SWIFT_CONFIG_NOTIFY_PERIOD, 2, 1, 0 };
+    sim_write(0, h.config_char, too_fast, sizeof(too_fast), true);
+    ok &= expect_status("write period=1ms", ESP_GATT_OUT_OF_RANGE);
+
+    const uint8_t truncated[] = { SWIFT_CONFIG_CONN_INTERVAL, 4, 6, 0 };
+    sim_write(0, h.config_char, truncated, sizeof(truncated), true);
+    ok &= expect_status("write truncated record", ESP_GATT_INVALID_ATTR_LEN);
+
+    uint16_t after_len = sim_read(0, h.config_char, after, sizeof(after));
+    bool unchanged = before_len == after_len && memcmp(before, after, before_len) == 0;
+    printf("  config after rejected writes %s\n", unchanged ? "unchanged" : "CHANGED");
+    ok &= unchanged;
+
+    swift_config_t readback;
+    swift_config_defaults(&readback);
+    bool readback_ok = swift_config_parse(after, after_len, &readback, NULL) == SWIFT_CONFIG_OK
+        && readback.notify_period_ms == 10 && readback.payload_len == 0
+        && readback.conn_int_min == 12 && readback.conn_int_max == 12 && readback.phy_mask == 0x02;
+    printf("  read-back (%u bytes)          %s\n", after_len, readback_ok ? "matches" : "MISMATCH");
+    ok &= readback_ok;
+
+    // back to the defaults
+    sim_write(0, h.config_char, (const uint8_t[]){ SWIFT_CONFIG_NOTIFY_PERIOD, 2, 30, 0 }, 4, true);
+    measure("30ms again", duration_s);
+
+    ok &= parser_sweep(iterations);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
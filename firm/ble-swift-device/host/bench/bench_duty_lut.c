@@ -0,0 +1,162 @@
+// Counter-to-duty table benchmark for main/duty_lut.c.
+//
+// Equivalence: for every 16-bit write counter, every step count up to
+// DUTY_LUT_STEPS_MAX and every LEDC resolution, a linear table must give
+// exactly what the old per-write formula did (reflection, scale, division,
+// active-low inversion). Gamma tables must keep the endpoints, rise
+// monotonically and stay symmetric.
+//
+// Speed: maps a stream of --counters counters through the old formula (with
+// steps and resolution as runtime values, as for a configurable channel) and
+// through the table, and reports ns per counter.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "duty_lut.h"
+
+#include "bench_common.h"
+
+#define MAX_DUTY        34  // mirrors main/ble-swift-device.c
+#define LEDC_DUTY_BITS  13
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+// The mapping apply_write_frame and blink_led used before the table.
+static uint32_t formula_duty(uint16_t counter, uint32_t steps, uint32_t duty_max)
+{
+    uint32_t level = counter % (2 * steps);
+    if (level >= steps) {
+        level = 2 * steps - level - 1;
+    }
+    uint32_t scaled_duty = (level * duty_max) / steps;
+    return duty_max - scaled_duty;
+}
+
+static bool equivalence(void)
+{
+    printf("== Equivalence: every counter, steps 1..%d, 1..16 bit duty ==\n", DUTY_LUT_STEPS_MAX);
+    static duty_lut_t lut;
+    uint32_t mismatches = 0;
+    uint64_t checked = 0;
+    for (uint32_t bits = 1; bits <= 16; bits++) {
+        uint32_t duty_max = (1u << bits) - 1;
+        for (uint32_t steps = 1; steps <= DUTY_LUT_STEPS_MAX; steps++) {
+            if (!duty_lut_init(&lut, steps, bits, DUTY_LUT_GAMMA_LINEAR, true)) {
+                mismatches++;
+                continue;
+            }
+            for (uint32_t c = 0; c <= UINT16_MAX; c++) {
+                mismatches += duty_lut_get(&lut, (uint16_t)c) != formula_duty((uint16_t)c, steps, duty_max);
+            }
+            checked += UINT16_MAX + 1;
+        }
+    }
+    printf("  %llu counters checked\n", (unsigned long long)checked);
+    bool ok = check("linear table matches the formula", mismatches == 0);
+
+    duty_lut_init(&lut, MAX_DUTY, LEDC_DUTY_BITS, DUTY_LUT_GAMMA_LINEAR, false);
+    ok &= check("active high is the inverse", duty_lut_get(&lut, 0) == 0
+                && duty_lut_get(&lut, MAX_DUTY - 1) == (MAX_DUTY - 1) * 8191u / MAX_DUTY);
+    ok &= check("out of range arguments refused", !duty_lut_init(&lut, 0, 13, 10, true)
+                && !duty_lut_init(&lut, DUTY_LUT_STEPS_MAX + 1, 13, 10, true)
+                && !duty_lut_init(&lut, 34, 17, 10, true) && !duty_lut_init(&lut, 34, 13, 0, true));
+
+    for (uint32_t gamma = 15; gamma <= 30; gamma += 5) {
+        duty_lut_init(&lut, MAX_DUTY, LEDC_DUTY_BITS, gamma, false);
+        bool shape = lut.duty[0] == 0;
+        for (uint32_t i = 1; i < MAX_DUTY; i++) {
+            shape &= lut.duty[i] >= lut.duty[i - 1]
+                && lut.duty[2 * MAX_DUTY - 1 - i] == lut.duty[i];
+        }
+        // below the linear curve everywhere but the ends
+        for (uint32_t i = 1; i < MAX_DUTY; i++) {
+            shape &= lut.duty[i] <= (i * 8191u) / MAX_DUTY + 1;
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "gamma %.1f: rising, symmetric, below linear", gamma / 10.0);
+        ok &= check(what, shape);
+    }
+    return ok;
+}
+
+static void speed(uint32_t counters)
+{
+    printf("== Speed: %u counters, %d steps, %d-bit duty ==\n", counters, MAX_DUTY, LEDC_DUTY_BITS);
+    // runtime values, so the compiler cannot turn the divisions into multiplies
+    volatile uint32_t steps_v = MAX_DUTY;
+    volatile uint32_t bits_v = LEDC_DUTY_BITS;
+    uint32_t steps = steps_v;
+    uint32_t duty_max = (1u << bits_v) - 1;
+    static duty_lut_t lut;
+    duty_lut_init(&lut, steps, bits_v, DUTY_LUT_GAMMA_LINEAR, true);
+
+    uint16_t *stream = malloc(counters * sizeof(uint16_t));
+    uint32_t x = 1;
+    for (uint32_t i = 0; i < counters; i++) {
+        x = x * 1103515245u + 12345u;
+        stream[i] = (uint16_t)(x >> 16);
+    }
+
+    volatile uint32_t sink = 0;
+    uint32_t sum = 0;
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t i = 0; i < counters; i++) {
+        sum += formula_duty(stream[i], steps, duty_max);
+    }
+    uint64_t t1 = sim_host_ns();
+    sink = sum;
+    sum = 0;
+    uint64_t t2 = sim_host_ns();
+    for (uint32_t i = 0; i < counters; i++) {
+        sum += duty_lut_get(&lut, stream[i]);
+    }
+    uint64_t t3 = sim_host_ns();
+    sink = sum;
+    (void)sink;
+
+    uint64_t t4 = sim_host_ns();
+    for (int i = 0; i < 1000; i++) {
+        duty_lut_init(&lut, steps, bits_v, 22, true);
+    }
+    uint64_t t5 = sim_host_ns();
+
+    printf("  %-26s %6.2f ns/counter\n", "formula (2 divisions)", (double)(t1 - t0) / counters);
+    printf("  %-26s %6.2f ns/counter\n", "table", (double)(t3 - t2) / counters);
+    printf("  %-26s %6.2f us\n", "build, gamma 2.2", (double)(t5 - t4) / 1000 / 1000.0);
+    free(stream);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t counters = 50000000;
+
+    static const struct option options[] = {
+        { "counters", required_argument, NULL, 'n' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': counters = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--counters N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (counters == 0) {
+        fprintf(stderr, "counters must be at least 1\n");
+        return 2;
+    }
+
+    bool ok = equivalence();
+    speed(counters);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Notification fan-out benchmark for the multi-connection GATT server.
+//
+// Connects up to --clients centrals one by one (each must find the device
+// still advertising), subscribes each to notifications and measures, for every
+// client count, the aggregate and per-client notification rate and the host
+// cost of one NotifyTimer tick. Each client must read back its own CCCD, and
+// a read of the notify value must be refused. Finally client 0 disconnects
+// and the remaining clients must keep receiving while advertising resumes.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_common.h"
+
+#define MAX_CLIENTS 9
+
+static uint64_t s_received[MAX_CLIENTS];
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    if (conn_id < MAX_CLIENTS) {
+        s_received[conn_id]++;
+    }
+}
+
+static const sim_cost_t *notify_timer_cost(const sim_stats_t *s)
+{
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (s->timer_name[i] != NULL && strcmp(s->timer_name[i], "NotifyTimer") == 0) {
+            return &s->timer[i];
+        }
+    }
+    return NULL;
+}
+
+// Reads the client's CCCD; -1 when the read failed.
+static int read_cccd(uint16_t conn_id, uint16_t cccd)
+{
+    uint8_t value[2];
+    if (sim_read(conn_id, cccd, value, sizeof(value)) != sizeof(value)) {
+        return -1;
+    }
+    return value[0] | (value[1] << 8);
+}
+
+static void measure(const char *label, int first, int last, uint32_t duration_s)
+{
+    memset(s_received, 0, sizeof(s_received));
+    sim_stats_reset();
+    sim_advance_ms(duration_s * 1000);
+
+    const sim_stats_t *s = sim_stats();
+    double secs = (double)duration_s;
+    double min_rate = 1e18, max_rate = 0;
+    for (int i = first; i <= last; i++) {
+        double rate = (double)s_received[i] / secs;
+        min_rate = rate < min_rate ? rate : min_rate;
+        max_rate = rate > max_rate ? rate : max_rate;
+    }
+    const sim_cost_t *tick = notify_timer_cost(s);
+    printf("  %-12s %8.1f notify/s total  %7.1f..%-7.1f per client  %8.0f ns/tick  %9.0f notify/s host\n",
+           label, (double)s->notify_sent / secs, min_rate, max_rate,
+           tick && tick->count ? (double)tick->total_ns / (double)tick->count : 0.0,
+           tick && tick->total_ns ? (double)s->notify_sent * 1e9 / (double)tick->total_ns : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    int clients = 4;
+    uint32_t duration_s = 10;
+    uint32_t mtu = 247;
+
+    static const struct option options[] = {
+        { "clients", required_argument, NULL, 'c' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { "mtu", required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:d:m:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': clients = atoi(optarg); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--clients N<=%d] [--duration-s N] [--mtu N]\n", argv[0], MAX_CLIENTS);
+                return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_boot();
+    sim_set_notify_hook(on_notify, NULL);
+    bench_handles_t h = bench_lookup_handles();
+
+    printf("== Notification fan-out: up to %d clients, %u s virtual each, MTU %u ==\n", clients, duration_s, mtu);
+    bool ok = true;
+    int connected = 0;
+    for (int i = 0; i < clients; i++) {
+        esp_bd_addr_t bda;
+        bench_bda(bda, (uint16_t)i);
+        if (!sim_connect((uint16_t)i, bda)) {
+            printf("  client %d: device not advertising (connection table full)\n", i);
+            break;
+        }
+        sim_set_mtu((uint16_t)i, (uint16_t)mtu);
+        int before = read_cccd((uint16_t)i, h.cccd);
+        sim_write((uint16_t)i, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+        int after = read_cccd((uint16_t)i, h.cccd);
+        if (before != 0x0000 || after != 0x0001) {
+            printf("  client %d: CCCD reads 0x%04x before subscribing, 0x%04x after\n", i, (unsigned)before, (unsigned)after);
+            ok = false;
+        }
+        uint8_t value[16];
+        if (sim_read((uint16_t)i, h.notify_char, value, sizeof(value)) != 0 || sim_last_response_status() != ESP_GATT_READ_NOT_PERMIT) {
+            printf("  client %d: notify value read not refused (status 0x%02x)\n", i, sim_last_response_status());
+            ok = false;
+        }
+        connected++;
+
+        char label[16];
+        snprintf(label, sizeof(label), "%d client%s", connected, connected == 1 ? "" : "s");
+        measure(label, 0, connected - 1, duration_s);
+    }
+
+    if (connected > 1) {
+        sim_disconnect(0);
+        measure("after drop", 1, connected - 1, duration_s);
+        for (int i = 1; i < connected; i++) {
+            if (s_received[i] == 0) {
+                printf("  client %d stopped receiving after client 0 disconnected\n", i);
+                ok = false;
+            }
+        }
+        if (s_received[0] != 0) {
+            printf("  client 0 still received notifications after disconnecting\n");
+            ok = false;
+        }
+    }
+    printf("  advertising: %s\n", sim_is_advertising() ? "on" : "off");
+    if (!sim_is_advertising()) {
+        ok = false;
+    }
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
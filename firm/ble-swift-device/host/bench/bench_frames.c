@@ -0,0 +1,313 @@
+// Frame header and sequence tracking benchmark.
+//
+// Codec: encodes and decodes --iterations frames, checking the round trip,
+// and reports the per-frame cost.
+//
+// Tracker: feeds a synthetic 16-bit sequence stream (wrapping several times)
+// with injected loss, duplicates and short-range reordering to
+// seq_tracker_on_frame(), and checks its counts against the injected ones.
+//
+// End to end: a central writes sequenced frames every 30 ms with the same
+// kinds of impairment (skipped, repeated and swapped sequences) while
+// receiving notifications. The device's telemetry must report exactly the
+// injected write impairments, and the central-side tracker must see every
+// notification frame in order.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "seq_tracker.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#define WRITE_INTERVAL_MS 30
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 32);
+}
+
+// true with probability permille/1000
+static bool chance(uint32_t permille)
+{
+    return rng_next() % 1000 < permille;
+}
+
+typedef struct {
+    uint32_t lost;
+    uint32_t duplicates;
+    uint32_t reordered;
+    uint32_t delivered;     // distinct
+} injected_t;
+
+// Builds the delivery order for seqs [0, count) into out (room for
+// 2 * count): drops, then swaps of neighbours, then repeats right after the
+// original. The last sequence is always delivered so every loss is followed
+// by a later arrival.
+static uint32_t make_stream(uint32_t count, uint32_t loss, uint32_t dup, uint32_t reorder,
+                            uint32_t *out, injected_t *inj)
+{
+    memset(inj, 0, sizeof(*inj));
+    uint32_t *kept = malloc(sizeof(uint32_t) * count);
+    if (kept == NULL) {
+        return 0;
+    }
+    uint32_t n = 0;
+    for (uint32_t s = 0; s < count; s++) {
+        if (s + 1 < count && chance(loss)) {
+            inj->lost++;
+            continue;
+        }
+        kept[n++] = s;
+    }
+    inj->delivered = n;
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        if (chance(reorder)) {
+            uint32_t t = kept[i];
+            kept[i] = kept[i + 1];
+            kept[i + 1] = t;
+            inj->reordered++;
+            i++; // keep swaps disjoint
+        }
+    }
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        out[m++] = kept[i];
+        if (chance(dup)) {
+            out[m++] = kept[i];
+            inj->duplicates++;
+        }
+    }
+    free(kept);
+    return m;
+}
+
+static bool tracker_sweep(uint32_t count)
+{
+    uint32_t *stream = malloc(sizeof(uint32_t) * count * 2);
+    if (stream == NULL) {
+        return false;
+    }
+    injected_t inj;
+    uint32_t n = make_stream(count, 20, 10, 10, stream, &inj);
+
+    seq_tracker_t tracker;
+    seq_tracker_init(&tracker);
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        seq_tracker_on_frame(&tracker, (uint16_t)stream[i], stream[i] * 30 + 1, stream[i] * 30 + 5);
+    }
+    uint64_t t1 = sim_host_ns();
+    free(stream);
+
+    bool ok = tracker.received == inj.delivered && seq_tracker_lost(&tracker) == inj.lost
+        && tracker.duplicates == inj.duplicates && tracker.reordered == inj.reordered
+        && tracker.stale == 0 && tracker.resyncs == 0;
+    printf("== Tracker: %u sequences (%.1f wraps), 2%% loss, 1%% duplicates, 1%% swapped ==\n",
+           count, count / 65536.0);
+    printf("  %-12s %10s %10s\n", "", "injected", "tracked");
+    printf("  %-12s %10u %10u\n", "delivered", inj.delivered, tracker.received);
+    printf("  %-12s %10u %10u\n", "lost", inj.lost, seq_tracker_lost(&tracker));
+    printf("  %-12s %10u %10u\n", "duplicates", inj.duplicates, tracker.duplicates);
+    printf("  %-12s %10u %10u\n", "reordered", inj.reordered, tracker.reordered);
+    printf("  loss rate    %u.%u%%   jitter %u ms   cost %.1f ns/frame   %s\n",
+           seq_tracker_loss_permille(&tracker) / 10, seq_tracker_loss_permille(&tracker) % 10,
+           seq_tracker_jitter_ms(&tracker), n ? (double)(t1 - t0) / n : 0.0, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static bool codec(uint32_t iterations)
+{
+    uint8_t buf[FRAME_LEN];
+    frame_t in = { .type = FRAME_TYPE_DATA, .payload_len = 2 };
+    frame_t out;
+    uint32_t errors = 0;
+    volatile uint32_t sink = 0;
+
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        in.seq = (uint16_t)i;
+        in.timestamp_ms = i * 30;
+        in.payload[0] = (uint8_t)i;
+        frame_encode(&in, buf);
+        sink += buf[0];
+    }
+    uint64_t t1 = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        buf[0] = (uint8_t)i;
+        if (!frame_decode(buf, sizeof(buf), &out)) {
+            errors++;
+        }
+        sink += out.seq;
+    }
+    uint64_t t2 = sim_host_ns();
+    (void)sink;
+
+    // round trip, and what an old sender (counter only) decodes to
+    frame_encode(&in, buf);
+    bool round_trip = frame_decode(buf, sizeof(buf), &out) && out.seq == in.seq && out.type == in.type
+        && out.payload_len == in.payload_len && out.timestamp_ms == in.timestamp_ms && out.payload[0] == in.payload[0];
+    const uint8_t legacy[FRAME_LEN] = { 0x34, 0x12 };
+    bool legacy_ok = frame_decode(legacy, sizeof(legacy), &out) && out.seq == 0x1234 && out.timestamp_ms == 0;
+    const uint8_t bad_type[FRAME_LEN] = { 0, 0, 0x7F };
+    const uint8_t bad_len[FRAME_LEN] = { 0, 0, 0, FRAME_PAYLOAD_MAX + 1 };
+    bool rejects = !frame_decode(bad_type, sizeof(bad_type), &out) && !frame_decode(bad_len, sizeof(bad_len), &out)
+        && !frame_decode(legacy, FRAME_LEN - 1, &out);
+
+    printf("== Codec: %u frames ==\n", iterations);
+    printf("  frame_encode   %6.2f ns/frame\n", iterations ? (double)(t1 - t0) / iterations : 0.0);
+    printf("  frame_decode   %6.2f ns/frame\n", iterations ? (double)(t2 - t1) / iterations : 0.0);
+    printf("  round trip %s, counter-only frame %s, malformed frames %s\n",
+           round_trip ? "ok" : "FAILED", legacy_ok ? "ok" : "FAILED", rejects ? "rejected" : "ACCEPTED");
+    return errors == 0 && round_trip && legacy_ok && rejects;
+}
+
+//-----------------------------------------------------------------------------
+// End to end
+static seq_tracker_t s_notify_seq;
+static uint32_t s_notify_invalid;
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    for (uint16_t off = 0; off + FRAME_LEN <= len; off += FRAME_LEN) {
+        frame_t frame;
+        if (!frame_decode(value + off, FRAME_LEN, &frame)) {
+            s_notify_invalid++;
+            continue;
+        }
+        seq_tracker_on_frame(&s_notify_seq, frame.seq, frame.timestamp_ms, (uint32_t)(sim_now_us() / 1000));
+    }
+}
+
+static bool read_counters(uint16_t handle, uint32_t *counters)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 64];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len < TELEMETRY_HEADER_LEN || buf[0] != TELEMETRY_VERSION || buf[1] < TELEMETRY_COUNTER_MAX
+        || len < TELEMETRY_HEADER_LEN + 4 * buf[1]) {
+        return false;
+    }
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        const uint8_t *p = buf + TELEMETRY_HEADER_LEN + 4 * i;
+        counters[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return true;
+}
+
+static void write_frame(uint16_t handle, uint32_t seq)
+{
+    frame_t frame = {
+        .seq = (uint16_t)seq,
+        .type = FRAME_TYPE_DATA,
+        .timestamp_ms = (uint32_t)(sim_now_us() / 1000) + 1,
+    };
+    uint8_t buf[FRAME_LEN];
+    frame_encode(&frame, buf);
+    sim_write(0, handle, buf, sizeof(buf), false);
+    sim_advance_ms(WRITE_INTERVAL_MS);
+}
+
+static bool end_to_end(uint32_t duration_s, uint32_t mtu)
+{
+    sim_boot();
+    sim_set_notify_hook(on_notify, NULL);
+    bench_handles_t h = bench_lookup_handles();
+    if (h.telemetry_char == 0) {
+        printf("telemetry characteristic not found\n");
+        return false;
+    }
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    seq_tracker_init(&s_notify_seq);
+
+    uint32_t count = duration_s * 1000 / WRITE_INTERVAL_MS;
+    uint32_t *stream = malloc(sizeof(uint32_t) * count * 2);
+    if (stream == NULL) {
+        return false;
+    }
+    injected_t inj;
+    uint32_t n = make_stream(count, 20, 10, 10, stream, &inj);
+
+    uint32_t before[TELEMETRY_COUNTER_MAX], after[TELEMETRY_COUNTER_MAX];
+    bool ok = read_counters(h.telemetry_char, before);
+    for (uint32_t i = 0; i < n; i++) {
+        write_frame(h.write_char, stream[i]);
+    }
+    free(stream);
+    ok &= read_counters(h.telemetry_char, after);
+
+    uint32_t gaps = after[TELEMETRY_WRITE_SEQ_GAPS] - before[TELEMETRY_WRITE_SEQ_GAPS];
+    uint32_t reordered = after[TELEMETRY_WRITES_REORDERED] - before[TELEMETRY_WRITES_REORDERED];
+    uint32_t duplicates = after[TELEMETRY_WRITES_DUPLICATE] - before[TELEMETRY_WRITES_DUPLICATE];
+    uint32_t invalid = after[TELEMETRY_WRITES_INVALID] - before[TELEMETRY_WRITES_INVALID];
+    uint32_t received = after[TELEMETRY_WRITES_RECEIVED] - before[TELEMETRY_WRITES_RECEIVED];
+    bool writes_ok = gaps - reordered == inj.lost && duplicates == inj.duplicates && reordered == inj.reordered
+        && invalid == 0 && received == n;
+
+    printf("== End to end: %u s virtual, write every %d ms, MTU %u ==\n", duration_s, WRITE_INTERVAL_MS, mtu);
+    printf("  writes       sent %u   lost %u/%u   duplicates %u/%u   reordered %u/%u (device/injected)   %s\n",
+           n, gaps - reordered, inj.lost, duplicates, inj.duplicates, reordered, inj.reordered,
+           writes_ok ? "ok" : "MISMATCH");
+    bool notify_ok = s_notify_seq.received > 0 && seq_tracker_lost(&s_notify_seq) == 0
+        && s_notify_seq.duplicates == 0 && s_notify_seq.reordered == 0 && s_notify_invalid == 0;
+    printf("  notify       frames %u   lost %u   duplicates %u   reordered %u   invalid %u   jitter %u ms   %s\n",
+           s_notify_seq.received, seq_tracker_lost(&s_notify_seq), s_notify_seq.duplicates,
+           s_notify_seq.reordered, s_notify_invalid, seq_tracker_jitter_ms(&s_notify_seq), notify_ok ? "ok" : "MISMATCH");
+
+    // the device's own summary
+    sim_set_log_level(ESP_LOG_INFO);
+    sim_disconnect(0);
+    sim_set_log_level(ESP_LOG_WARN);
+    return ok && writes_ok && notify_ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 10000000;
+    uint32_t sequences = 1000000;
+    uint32_t duration_s = 60;
+    uint32_t mtu = 247;
+
+    static const struct option options[] = {
+        { "iterations", required_argument, NULL, 'n' },
+        { "sequences", required_argument, NULL, 'q' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { "mtu", required_argument, NULL, 'm' },
+        { "seed", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:q:d:m:s:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'q': sequences = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': s_rng = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage: %s [--iterations N] [--sequences N] [--duration-s N] [--mtu N] [--seed N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (sequences < 2 || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    bool ok = codec(iterations);
+    ok &= tracker_sweep(sequences);
+    ok &= end_to_end(duration_s, mtu);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
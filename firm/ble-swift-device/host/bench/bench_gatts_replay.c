@@ -0,0 +1,670 @@
+// GATTS state machine benchmark: setup chain faults, stray events, reconnect
+// storms and record/replay.
+//
+// Setup chain: boots the device once per setup event (REG, CREAT_ATTR_TAB or,
+// in bench_gatts_replay_chain, CREATE, each ADD_CHAR and ADD_CHAR_DESCR, then
+// START and the GAP advertising events) with that
+// event failed, delivered twice, or held back until the rest of the boot has
+// run. A central then connects, subscribes and reads config and telemetry.
+// A repeated or late event must still give a working service; a failed one
+// may leave the device silent, but it must never advertise a service that
+// does not work.
+//
+// Stray events: with a client subscribed, the device gets events the stack
+// should not send: a second CONNECT for the live connection; MTU, WRITE,
+// READ, EXEC_WRITE, CONF, CONGEST and DISCONNECT for a connection that does
+// not exist; GAP updates for an unknown peer. The client must keep getting
+// notifications and the device must keep advertising.
+//
+// Reconnect storm: a phone reconnects --cycles times while one client stays
+// subscribed and another churns at random. Each cycle the phone connects,
+// exchanges MTU, discovers the service, subscribes and waits for its first
+// notification, one connection interval per ATT request; every fourth
+// DISCONNECT reaches the device only once the phone is back, and every
+// eighth CONNECT arrives twice. Reports reconnect-to-first-notification time
+// on the virtual clock. Every cycle must get its notification, the steady
+// client must never stall, and the telemetry connect and disconnect counts
+// must agree with the clients still connected.
+//
+// Replay: the storm is recorded as a trace and replayed in a fresh device,
+// which must reproduce it line for line. --record FILE keeps the trace;
+// --replay FILE replays one saved earlier, by another build say, and shows
+// the first line where this build differs.
+//
+// Each scenario runs in a forked process with a device of its own.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#define FIRST_NOTIFY_TIMEOUT_MS 2000
+#define PHONE_CONN_IDS          64      // the phone's conn_id is the cycle modulo this
+#define STEADY_CONN_ID          100
+#define CHURN_CONN_ID           101
+#define PROBE_CONN_ID           120
+#define GHOST_CONN_ID           121     // never connects
+
+static bench_handles_t s_h;
+static uint32_t s_notify_count[256];
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 32);
+}
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    if (handle == s_h.notify_char && conn_id < 256) {
+        s_notify_count[conn_id]++;
+    }
+}
+
+static void boot(void)
+{
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_notify_hook(on_notify, NULL);
+    sim_boot();
+    s_h = bench_lookup_handles();
+}
+
+//-----------------------------------------------------------------------------
+// Central
+
+// One ATT request and its response, a connection interval apart.
+static void att_round_trip(uint16_t conn_id)
+{
+    sim_link_t link;
+    sim_advance_us(sim_link(conn_id, &link) ? link.params.interval * 1250u : 7500);
+}
+
+// What a central does once connected: MTU exchange, service, characteristic
+// and descriptor discovery, then the CCCD write.
+static bool subscribe(uint16_t conn_id)
+{
+    sim_set_mtu(conn_id, 247);
+    att_round_trip(conn_id);
+    for (int i = 0; i < 3; i++) {
+        att_round_trip(conn_id);
+    }
+    sim_write(conn_id, s_h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    bool ok = sim_last_response_status() == ESP_GATT_OK;
+    att_round_trip(conn_id);
+    return ok;
+}
+
+// Virtual time until conn_id's next notification; UINT64_MAX when none comes
+// within timeout_ms.
+static uint64_t wait_notify(uint16_t conn_id, uint32_t timeout_ms)
+{
+    uint32_t before = s_notify_count[conn_id];
+    uint64_t start = sim_now_us();
+    while (s_notify_count[conn_id] == before) {
+        if (sim_now_us() - start >= (uint64_t)timeout_ms * 1000) {
+            return UINT64_MAX;
+        }
+        sim_advance_us(250);
+    }
+    return sim_now_us() - start;
+}
+
+enum { OUTCOME_WORKS, OUTCOME_SILENT, OUTCOME_BROKEN };
+
+static const char *outcome_str(int outcome)
+{
+    switch (outcome) {
+        case OUTCOME_WORKS:     return "works";
+        case OUTCOME_SILENT:    return "silent";
+        case OUTCOME_BROKEN:    return "BROKEN";
+        default:                return "CRASHED";
+    }
+}
+
+// Whether a central that finds the device gets the whole service.
+static int probe(uint16_t conn_id)
+{
+    if (!sim_is_advertising()) {
+        return OUTCOME_SILENT;
+    }
+    esp_bd_addr_t bda;
+    bench_bda(bda, conn_id);
+    if (!sim_connect(conn_id, bda)) {
+        return OUTCOME_BROKEN;
+    }
+    s_h = bench_lookup_handles();
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 16];
+    bool ok = s_h.notify_char != 0 && s_h.cccd != 0 && s_h.config_char != 0 && s_h.telemetry_char != 0
+        && subscribe(conn_id)
+        && wait_notify(conn_id, FIRST_NOTIFY_TIMEOUT_MS) != UINT64_MAX
+        && sim_read(conn_id, s_h.config_char, buf, sizeof(buf)) > 0
+        && sim_read(conn_id, s_h.telemetry_char, buf, sizeof(buf)) > 0;
+    sim_disconnect(conn_id);
+    return ok ? OUTCOME_WORKS : OUTCOME_BROKEN;
+}
+
+//-----------------------------------------------------------------------------
+// Setup chain
+typedef enum { FAULT_FAIL, FAULT_REPEAT, FAULT_HOLD, FAULT_MAX } fault_t;
+
+static const char *const fault_names[FAULT_MAX] = { "failed", "repeated", "held back" };
+
+typedef struct {
+    int target;         // boot event to fault, counted from 0
+    fault_t fault;
+    int seen;
+    bool booting;
+} setup_fault_t;
+
+static void fail_status(bool is_gap, int event, void *param)
+{
+    if (is_gap) {
+        esp_ble_gap_cb_param_t *p = param;
+        switch (event) {
+            case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT: p->adv_data_raw_cmpl.status = ESP_BT_STATUS_FAIL; break;
+            case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT: p->scan_rsp_data_raw_cmpl.status = ESP_BT_STATUS_FAIL; break;
+            case ESP_GAP_BLE_ADV_START_COMPLETE_EVT: p->adv_start_cmpl.status = ESP_BT_STATUS_FAIL; break;
+            default: break;
+        }
+        return;
+    }
+    esp_ble_gatts_cb_param_t *p = param;
+    switch (event) {
+        case ESP_GATTS_REG_EVT: p->reg.status = ESP_GATT_ERROR; break;
+        case ESP_GATTS_CREATE_EVT: p->create.status = ESP_GATT_ERROR; break;
+        case ESP_GATTS_ADD_CHAR_EVT: p->add_char.status = ESP_GATT_ERROR; break;
+        case ESP_GATTS_ADD_CHAR_DESCR_EVT: p->add_char_descr.status = ESP_GATT_ERROR; break;
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT: p->add_attr_tab.status = ESP_GATT_ERROR; break;
+        case ESP_GATTS_START_EVT: p->start.status = ESP_GATT_ERROR; break;
+        default: break;
+    }
+}
+
+static sim_event_action_t setup_filter(bool is_gap, int event, void *param, void *ctx)
+{
+    setup_fault_t *f = ctx;
+    if (!f->booting || f->seen++ != f->target) {
+        return SIM_EVENT_DELIVER;
+    }
+    switch (f->fault) {
+        case FAULT_FAIL:
+            fail_status(is_gap, event, param);
+            return SIM_EVENT_DELIVER;
+        case FAULT_REPEAT:
+            return SIM_EVENT_DUPLICATE;
+        default:
+            return SIM_EVENT_HOLD;
+    }
+}
+
+static int setup_record(void *arg)
+{
+    sim_trace_t *trace = sim_trace_new();
+    sim_trace_record(trace);
+    boot();
+    sim_trace_record(NULL);
+    sim_advance_ms(100);
+    int outcome = probe(PROBE_CONN_ID);
+    return sim_trace_save(trace, arg) ? outcome : OUTCOME_BROKEN;
+}
+
+static int setup_run(void *arg)
+{
+    setup_fault_t *f = arg;
+    sim_set_event_filter(setup_filter, f);
+    f->booting = true;
+    boot();
+    f->booting = false;
+    sim_release_held();
+    sim_run_pending();
+    sim_advance_ms(100);
+    return probe(PROBE_CONN_ID);
+}
+
+// "GATTS ADD_CHAR notify" for "<t> GATTS ADD_CHAR status=0 handle=42 uuid=...".
+static void event_label(const char *line, char *out, size_t cap)
+{
+    static const struct { const uint8_t *uuid; const char *name; } chars[] = {
+        { BENCH_NOTIFY_CHAR_UUID, "notify" }, { BENCH_WRITE_CHAR_UUID, "write" },
+        { BENCH_CONFIG_CHAR_UUID, "config" }, { BENCH_TELEMETRY_CHAR_UUID, "telemetry" },
+        { BENCH_BLOB_CHAR_UUID, "blob" },
+    };
+    const char *name = strchr(line, ' ') + 1;
+    int len = (int)strcspn(name, " ");
+    len += (int)strcspn(name + len + 1, " ") + 1;
+    const char *uuid = strstr(line, " uuid=");
+    const char *what = "";
+    for (size_t i = 0; uuid != NULL && i < sizeof(chars) / sizeof(chars[0]); i++) {
+        char hex[33];
+        for (int b = 0; b < 16; b++) {
+            snprintf(hex + 2 * b, 3, "%02x", chars[i].uuid[b]);
+        }
+        if (strncmp(uuid + 6, hex, 32) == 0 && strcspn(uuid + 6, " ") == 32) {
+            what = chars[i].name;
+        }
+    }
+    snprintf(out, cap, "%.*s %s", len, name, what);
+}
+
+static bool setup_chain(const char *path)
+{
+    int baseline = bench_run_isolated(setup_record, (void *)path);
+    sim_trace_t *trace = sim_trace_load(path);
+    if (trace == NULL) {
+        printf("== Setup chain ==\n");
+        return check("boot trace recorded", false);
+    }
+    const char *events[64];
+    int count = 0;
+    for (size_t i = 0; i < sim_trace_len(trace) && count < 64; i++) {
+        const char *rest = strchr(sim_trace_line(trace, i), ' ') + 1;
+        if (strncmp(rest, "GATTS ", 6) == 0 || strncmp(rest, "GAP ", 4) == 0) {
+            events[count++] = sim_trace_line(trace, i);
+        }
+    }
+
+    printf("== Setup chain: %d boot events, each failed, repeated and held back ==\n", count);
+    bool ok = check("normal boot gives a working service", baseline == OUTCOME_WORKS);
+    printf("  %-36s %-10s %-10s %s\n", "event", fault_names[0], fault_names[1], fault_names[2]);
+    for (int e = 0; e < count; e++) {
+        char label[64];
+        event_label(events[e], label, sizeof(label));
+        const char *cells[FAULT_MAX];
+        bool row_ok = true;
+        for (int fault = 0; fault < FAULT_MAX; fault++) {
+            if (fault == FAULT_FAIL && strstr(events[e], " status=") == NULL) {
+                cells[fault] = "-";
+                continue;
+            }
+            setup_fault_t f = { .target = e, .fault = (fault_t)fault };
+            int outcome = bench_run_isolated(setup_run, &f);
+            cells[fault] = outcome_str(outcome);
+            // failing may stop the device, but nothing else may
+            row_ok &= outcome == OUTCOME_WORKS || (fault == FAULT_FAIL && outcome == OUTCOME_SILENT);
+        }
+        printf("  %-36s %-10s %-10s %-10s %s\n", label, cells[0], cells[1], cells[2], row_ok ? "ok" : "MISMATCH");
+        ok &= row_ok;
+    }
+    sim_trace_free(trace);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Stray events
+static int stray_run(void *arg)
+{
+    printf("== Stray events: a subscribed client, then events the stack should not send ==\n");
+    boot();
+    esp_bd_addr_t bda, ghost_bda;
+    bench_bda(bda, 0);
+    bench_bda(ghost_bda, GHOST_CONN_ID);
+    bool ok = check("client subscribed",
+                    sim_connect(0, bda) && subscribe(0) && wait_notify(0, FIRST_NOTIFY_TIMEOUT_MS) != UINT64_MAX);
+
+    static const char *const strays[] = {
+        "GATTS CONNECT again for the live connection",
+        "GATTS MTU for an unknown connection",
+        "GATTS WRITE to the CCCD for an unknown connection",
+        "GATTS READ for an unknown connection",
+        "GATTS EXEC_WRITE for an unknown connection",
+        "GATTS CONF for an unknown connection",
+        "GATTS CONGEST for an unknown connection",
+        "GATTS DISCONNECT for an unknown connection",
+        "GAP UPDATE_CONN_PARAMS for an unknown peer",
+        "GAP PHY_UPDATE_COMPLETE for an unknown peer",
+        "GAP SET_PKT_LENGTH_COMPLETE nobody asked for",
+    };
+    for (size_t i = 0; i < sizeof(strays) / sizeof(strays[0]); i++) {
+        esp_ble_gatts_cb_param_t p = { 0 };
+        esp_ble_gap_cb_param_t g = { 0 };
+        switch (i) {
+            case 0:
+                p.connect.conn_id = 0;
+                memcpy(p.connect.remote_bda, bda, sizeof(esp_bd_addr_t));
+                p.connect.conn_params.interval = 6;
+                p.connect.conn_params.timeout = 400;
+                sim_inject_gatts(ESP_GATTS_CONNECT_EVT, &p, NULL, 0);
+                break;
+            case 1:
+                p.mtu.conn_id = GHOST_CONN_ID;
+                p.mtu.mtu = 185;
+                sim_inject_gatts(ESP_GATTS_MTU_EVT, &p, NULL, 0);
+                break;
+            case 2:
+                p.write.conn_id = GHOST_CONN_ID;
+                p.write.handle = s_h.cccd;
+                p.write.need_rsp = true;
+                sim_inject_gatts(ESP_GATTS_WRITE_EVT, &p, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE));
+                break;
+            case 3:
+                p.read.conn_id = GHOST_CONN_ID;
+                p.read.handle = s_h.telemetry_char;
+                p.read.need_rsp = true;
+                sim_inject_gatts(ESP_GATTS_READ_EVT, &p, NULL, 0);
+                break;
+            case 4:
+                p.exec_write.conn_id = GHOST_CONN_ID;
+                p.exec_write.exec_write_flag = ESP_GATT_PREP_WRITE_EXEC;
+                sim_inject_gatts(ESP_GATTS_EXEC_WRITE_EVT, &p, NULL, 0);
+                break;
+            case 5:
+                p.conf.conn_id = GHOST_CONN_ID;
+                p.conf.handle = s_h.notify_char;
+                sim_inject_gatts(ESP_GATTS_CONF_EVT, &p, NULL, 0);
+                break;
+            case 6:
+                p.congest.conn_id = GHOST_CONN_ID;
+                p.congest.congested = true;
+                sim_inject_gatts(ESP_GATTS_CONGEST_EVT, &p, NULL, 0);
+                break;
+            case 7:
+                p.disconnect.conn_id = GHOST_CONN_ID;
+                p.disconnect.reason = ESP_GATT_CONN_TERMINATE_PEER_USER;
+                sim_inject_gatts(ESP_GATTS_DISCONNECT_EVT, &p, NULL, 0);
+                break;
+            case 8:
+                memcpy(g.update_conn_params.bda, ghost_bda, sizeof(esp_bd_addr_t));
+                g.update_conn_params.conn_int = 80;
+                g.update_conn_params.timeout = 400;
+                sim_inject_gap(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &g);
+                break;
+            case 9:
+                memcpy(g.phy_update.bda, ghost_bda, sizeof(esp_bd_addr_t));
+                g.phy_update.tx_phy = ESP_BLE_GAP_PHY_2M;
+                g.phy_update.rx_phy = ESP_BLE_GAP_PHY_2M;
+                sim_inject_gap(ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT, &g);
+                break;
+            default:
+                g.pkt_data_length_cmpl.params.tx_len = 251;
+                g.pkt_data_length_cmpl.params.rx_len = 251;
+                sim_inject_gap(ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT, &g);
+                break;
+        }
+        sim_run_pending();
+        ok &= check(strays[i], wait_notify(0, 500) != UINT64_MAX && sim_is_advertising());
+    }
+
+    sim_disconnect(0);
+    sim_advance_ms(100);
+    uint64_t failed = sim_stats()->notify_failed;
+    sim_advance_ms(500);
+    ok &= check("client's own DISCONNECT still ends its notifications", sim_stats()->notify_failed == failed);
+    ok &= check("a new client gets the service", probe(PROBE_CONN_ID) == OUTCOME_WORKS);
+    return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Reconnect storm
+typedef struct {
+    bool held[256];     // DISCONNECTs already held once, by conn_id
+} storm_filter_t;
+
+// Holds every fourth phone DISCONNECT until the harness releases it and
+// delivers every eighth phone CONNECT twice. Decided from the events alone,
+// so a replay under this filter does the same.
+static sim_event_action_t storm_filter(bool is_gap, int event, void *param, void *ctx)
+{
+    storm_filter_t *f = ctx;
+    if (is_gap) {
+        return SIM_EVENT_DELIVER;
+    }
+    const esp_ble_gatts_cb_param_t *p = param;
+    if (event == ESP_GATTS_CONNECT_EVT && p->connect.conn_id < PHONE_CONN_IDS) {
+        f->held[p->connect.conn_id] = false;
+        return p->connect.conn_id % 8 == 5 ? SIM_EVENT_DUPLICATE : SIM_EVENT_DELIVER;
+    }
+    if (event == ESP_GATTS_DISCONNECT_EVT && p->disconnect.conn_id < PHONE_CONN_IDS
+        && p->disconnect.conn_id % 4 == 3 && !f->held[p->disconnect.conn_id]) {
+        f->held[p->disconnect.conn_id] = true;
+        return SIM_EVENT_HOLD;
+    }
+    return SIM_EVENT_DELIVER;
+}
+
+typedef struct {
+    uint64_t sum;
+    uint64_t max;
+} span_t;
+
+static void span_add(span_t *s, uint64_t us)
+{
+    s->sum += us;
+    if (us > s->max) {
+        s->max = us;
+    }
+}
+
+typedef struct {
+    uint32_t cycles;
+    const char *trace_path;
+} storm_args_t;
+
+// One random step of the churning client.
+static void churn_step(bool *connected)
+{
+    if (!*connected) {
+        esp_bd_addr_t bda;
+        bench_bda(bda, CHURN_CONN_ID);
+        *connected = sim_connect(CHURN_CONN_ID, bda);   // refused while the device is full
+        if (*connected) {
+            subscribe(CHURN_CONN_ID);
+        }
+        return;
+    }
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 16];
+    switch (rng_next() % 3) {
+        case 0:
+            sim_disconnect(CHURN_CONN_ID);
+            *connected = false;
+            break;
+        case 1:
+            sim_read(CHURN_CONN_ID, s_h.telemetry_char, buf, sizeof(buf));
+            break;
+        default:
+            sim_write(CHURN_CONN_ID, s_h.cccd, rng_next() % 2 ? BENCH_CCCD_ENABLE : BENCH_CCCD_DISABLE, 2, true);
+            break;
+    }
+}
+
+static uint32_t telemetry_counter(uint16_t conn_id, int counter)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 16];
+    uint16_t len = sim_read(conn_id, s_h.telemetry_char, buf, sizeof(buf));
+    const uint8_t *p = buf + TELEMETRY_HEADER_LEN + 4 * counter;
+    if (len < TELEMETRY_HEADER_LEN + 4 * (counter + 1)) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int storm_run(void *arg)
+{
+    const storm_args_t *args = arg;
+    static storm_filter_t filter;
+    sim_trace_t *trace = sim_trace_new();
+    sim_set_event_filter(storm_filter, &filter);
+    sim_trace_record(trace);
+    boot();
+
+    esp_bd_addr_t steady_bda, phone_bda;
+    bench_bda(steady_bda, STEADY_CONN_ID);
+    bench_bda(phone_bda, 0xF0F0);   // one phone, a new conn_id each time
+    bool ok = sim_connect(STEADY_CONN_ID, steady_bda) && subscribe(STEADY_CONN_ID);
+
+    span_t connect = { 0 }, first = { 0 }, total = { 0 };
+    uint32_t misses = 0, stalls = 0, late_disconnects = 0;
+    bool churn_connected = false;
+    uint64_t storm_start = sim_now_us();
+    for (uint32_t cycle = 0; cycle < args->cycles; cycle++) {
+        uint16_t phone = (uint16_t)(cycle % PHONE_CONN_IDS);
+        uint32_t steady_before = s_notify_count[STEADY_CONN_ID];
+
+        uint64_t t0 = sim_now_us();
+        uint64_t wait = UINT64_MAX;
+        if (sim_connect(phone, phone_bda) && subscribe(phone)) {
+            uint64_t t1 = sim_now_us();
+            wait = wait_notify(phone, FIRST_NOTIFY_TIMEOUT_MS);
+            if (wait != UINT64_MAX) {
+                span_add(&connect, t1 - t0);
+                span_add(&first, wait);
+                span_add(&total, t1 - t0 + wait);
+            }
+        }
+        misses += wait == UINT64_MAX;
+        // a DISCONNECT held last cycle arrives now that the phone is back
+        late_disconnects += sim_release_held();
+        sim_run_pending();
+
+        uint32_t stay_ms = 50 + rng_next() % 250;
+        uint64_t leave_at = sim_now_us() + (uint64_t)stay_ms * 1000;
+        while (sim_now_us() < leave_at) {
+            churn_step(&churn_connected);
+            sim_advance_ms(10 + rng_next() % 40);
+        }
+        sim_disconnect(phone);
+        stalls += s_notify_count[STEADY_CONN_ID] == steady_before;
+    }
+    uint64_t storm_us = sim_now_us() - storm_start;
+    late_disconnects += sim_release_held();
+    sim_run_pending();
+    sim_advance_ms(100);
+
+    uint32_t connects = telemetry_counter(STEADY_CONN_ID, TELEMETRY_CONNECTS);
+    uint32_t disconnects = telemetry_counter(STEADY_CONN_ID, TELEMETRY_DISCONNECTS);
+    uint32_t live = 1 + churn_connected;
+    if (churn_connected) {
+        sim_disconnect(CHURN_CONN_ID);
+    }
+    sim_disconnect(STEADY_CONN_ID);
+    sim_advance_ms(100);
+    int after = probe(PROBE_CONN_ID);
+    sim_trace_record(NULL);
+    sim_set_event_filter(NULL, NULL);
+
+    uint32_t got = args->cycles - misses;
+    printf("== Reconnect storm: %u cycles, %.1f s virtual, 1 steady and 1 churning client ==\n",
+           args->cycles, storm_us / 1e6);
+    printf("  %-34s %10s %10s\n", "reconnect (virtual clock)", "avg ms", "max ms");
+    printf("  %-34s %10.2f %10.2f\n", "connect to subscribed", got ? connect.sum / 1e3 / got : 0.0, connect.max / 1e3);
+    printf("  %-34s %10.2f %10.2f\n", "subscribed to first notification", got ? first.sum / 1e3 / got : 0.0, first.max / 1e3);
+    printf("  %-34s %10.2f %10.2f\n", "connect to first notification", got ? total.sum / 1e3 / got : 0.0, total.max / 1e3);
+    printf("  %u DISCONNECTs delivered after the reconnect, %u trace lines\n", late_disconnects, (unsigned)sim_trace_len(trace));
+
+    char what[64];
+    snprintf(what, sizeof(what), "steady client subscribed");
+    ok = check(what, ok);
+    snprintf(what, sizeof(what), "first notification every cycle (%u missed)", misses);
+    ok &= check(what, misses == 0);
+    snprintf(what, sizeof(what), "steady client never stalls (%u stalls)", stalls);
+    ok &= check(what, stalls == 0);
+    snprintf(what, sizeof(what), "telemetry: %u connects - %u disconnects = %u live", connects, disconnects, live);
+    ok &= check(what, connects != UINT32_MAX && connects - disconnects == live);
+    ok &= check("a new client gets the service after the storm", after == OUTCOME_WORKS);
+    ok &= check("trace saved", sim_trace_save(trace, args->trace_path));
+    sim_trace_free(trace);
+    return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Replay
+static int replay_run(void *arg)
+{
+    const char *path = arg;
+    printf("== Replay: %s ==\n", path);
+    sim_trace_t *want = sim_trace_load(path);
+    if (want == NULL) {
+        return check("trace readable", false) ? 0 : 1;
+    }
+    static storm_filter_t filter;
+    sim_set_event_filter(storm_filter, &filter);
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_trace_t *got = sim_trace_new();
+    sim_trace_record(got);
+    uint64_t t0 = sim_host_ns();
+    bool ran = sim_trace_replay(want);
+    uint64_t t1 = sim_host_ns();
+    sim_trace_record(NULL);
+
+    size_t peers = 0;
+    for (size_t i = 0; i < sim_trace_len(want); i++) {
+        peers += strstr(sim_trace_line(want, i), " PEER ") != NULL;
+    }
+    size_t diff = 0;
+    while (diff < sim_trace_len(want) && diff < sim_trace_len(got)
+           && strcmp(sim_trace_line(want, diff), sim_trace_line(got, diff)) == 0) {
+        diff++;
+    }
+    bool same = ran && diff == sim_trace_len(want) && diff == sim_trace_len(got);
+    printf("  %zu lines, %zu peer actions, replayed in %.1f ms host time\n", sim_trace_len(want), peers, (t1 - t0) / 1e6);
+    bool ok = check("trace runs", ran);
+    ok &= check("replay reproduces every line", same);
+    if (ran && !same) {
+        const char *a = sim_trace_line(want, diff), *b = sim_trace_line(got, diff);
+        printf("  first difference, line %zu\n    recorded: %s\n    replayed: %s\n", diff + 1,
+               a != NULL ? a : "(end)", b != NULL ? b : "(end)");
+    }
+    sim_trace_free(want);
+    sim_trace_free(got);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cycles = 200;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+
+    static const struct option options[] = {
+        { "cycles", required_argument, NULL, 'c' },
+        { "record", required_argument, NULL, 'r' },
+        { "replay", required_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:r:p:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': cycles = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': record_path = optarg; break;
+            case 'p': replay_path = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [--cycles N] [--record FILE] [--replay FILE]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (cycles == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    char tmp[] = "/tmp/bench_gatts_replay.XXXXXX";
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    bool ok = setup_chain(tmp);
+    ok &= bench_run_isolated(stray_run, NULL) == 0;
+    storm_args_t storm = { cycles, record_path != NULL ? record_path : tmp };
+    ok &= bench_run_isolated(storm_run, &storm) == 0;
+    ok &= bench_run_isolated(replay_run, (void *)(replay_path != NULL ? replay_path : storm.trace_path)) == 0;
+    unlink(tmp);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+// Hot-path logging benchmark (main/hot_log.c).
+//
+// Log layer: checks the per-site rate limit (bursts, steady rate, a clock
+// that wraps, a site quiet for longer than half of it), that a full ring
+// drops and the site's next line reports what it did not log, and the line
+// format. --producers threads then write --iterations records between them
+// into the ring while the bench drains it, trying again while it is full: every record must come out once, in each
+// producer's order. Times a record write, a rate-limited one and a direct
+// ESP_LOG call (formatting only).
+//
+// Handlers: the console UART is modeled at --baud. A central writes with
+// response every --write-interval-ms and rewrites the CCCD every 50 ms for
+// --duration-s; it reports the cost of the GATTS WRITE handler (host time
+// plus the UART time of its log lines), the lines printed and the UART load.
+// bench_hot_log runs the default build (rate-limited ring): handlers must not
+// wait for the UART and each site must stay within its rate.
+// bench_hot_log_direct (ESP_LOG in the handler, as before) must print every
+// line; bench_hot_log_strip must print none.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hot_log.h"
+
+#include "bench_common.h"
+
+#define INTERVAL_MS (1000u / CONFIG_SWIFT_HOT_LOG_RATE)
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static const char *mode_str(void)
+{
+#if CONFIG_SWIFT_HOT_LOG_STRIP
+    return "strip";
+#elif CONFIG_SWIFT_HOT_LOG_RING
+    return "ring";
+#else
+    return "direct";
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Log layer
+static hot_log_ring_t s_ring;
+static const uint32_t NO_ARGS[HOT_LOG_MAX_ARGS] = { 0 };
+
+static uint32_t allowed_in(hot_log_site_t *site, uint32_t from_ms, uint32_t step_ms, uint32_t count)
+{
+    uint32_t allowed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        allowed += hot_log_allow(site, from_ms + i * step_ms);
+    }
+    return allowed;
+}
+
+static bool layer_checks(void)
+{
+    bool ok = true;
+    printf("== Log layer: %d lines/s per site, bursts of %d, ring of %d ==\n"
+        , CONFIG_SWIFT_HOT_LOG_RATE, CONFIG_SWIFT_HOT_LOG_BURST, CONFIG_SWIFT_HOT_LOG_RING_LEN);
+
+    hot_log_site_t site = HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "x");
+    ok &= check("burst: BURST lines in the same ms", allowed_in(&site, 5000, 0, 100) == CONFIG_SWIFT_HOT_LOG_BURST);
+    // a line every ms for 10 s: the burst, then RATE per second
+    site = (hot_log_site_t)HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "x");
+    uint32_t steady = allowed_in(&site, 5000, 1, 10000);
+    uint32_t expected = CONFIG_SWIFT_HOT_LOG_BURST - 1 + 10000 / INTERVAL_MS;
+    ok &= check("steady: BURST + RATE per second", steady >= expected && steady <= expected + 1);
+    // as many lines as the rate: none held back
+    site = (hot_log_site_t)HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "x");
+    ok &= check("at the rate: every line", allowed_in(&site, 5000, INTERVAL_MS, 1000) == 1000);
+
+    site = (hot_log_site_t)HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "x");
+    uint32_t wrap = allowed_in(&site, UINT32_MAX - 5000, 1, 10000);
+    ok &= check("across the 32-bit ms wrap: same as steady", wrap == steady);
+    site = (hot_log_site_t)HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "x");
+    allowed_in(&site, 1000, 0, 100);
+    ok &= check("quiet for 2^31 ms: a fresh burst", allowed_in(&site, 1000 + 0x80000000u, 0, 100) == CONFIG_SWIFT_HOT_LOG_BURST);
+
+    // full ring: what did not fit is reported by the site's next line
+    hot_log_ring_init(&s_ring);
+    site = (hot_log_site_t)HOT_LOG_SITE_INIT(ESP_LOG_WARN, "bench", "GATT: conn_id=%d status=0x%x");
+    uint32_t now = 1000;
+    for (int i = 0; i < CONFIG_SWIFT_HOT_LOG_RING_LEN + 5; i++, now += INTERVAL_MS) {
+        hot_log_write(&s_ring, &site, now, (const uint32_t[HOT_LOG_MAX_ARGS]){ 1, (uint32_t)i });
+    }
+    ok &= check("full ring: dropped and counted", atomic_load(&s_ring.dropped) == 5
+        && atomic_load(&s_ring.written) == CONFIG_SWIFT_HOT_LOG_RING_LEN);
+    hot_log_record_t record;
+    uint32_t popped = 0;
+    bool in_order = true;
+    while (hot_log_pop(&s_ring, &record)) {
+        in_order &= record.args[1] == popped++;
+    }
+    ok &= check("drained in order", in_order && popped == CONFIG_SWIFT_HOT_LOG_RING_LEN);
+    hot_log_write(&s_ring, &site, now, (const uint32_t[HOT_LOG_MAX_ARGS]){ 1, 0 });
+    ok &= check("next line reports the dropped ones", hot_log_pop(&s_ring, &record) && record.suppressed == 5);
+
+    // lines the rate limit held back, then a line after a quiet spell
+    for (int i = 0; i < CONFIG_SWIFT_HOT_LOG_BURST + 3; i++) {
+        hot_log_write(&s_ring, &site, now, (const uint32_t[HOT_LOG_MAX_ARGS]){ 1, 0 });
+    }
+    while (hot_log_pop(&s_ring, &record)) {
+    }
+    uint32_t held = atomic_load(&s_ring.suppressed);
+    hot_log_write(&s_ring, &site, now + 60000, (const uint32_t[HOT_LOG_MAX_ARGS]){ 2, 0x85 });
+    ok &= check("next line reports the held back ones", held > 0 && hot_log_pop(&s_ring, &record) && record.suppressed == held);
+    char line[160];
+    hot_log_format(&record, line, sizeof(line));
+    char want[160];
+    snprintf(want, sizeof(want), "GATT: conn_id=2 status=0x85 [at %u ms] (+%u not logged)", now + 60000, held);
+    printf("  \"%s\"\n", line);
+    ok &= check("format", strcmp(line, want) == 0);
+    ok &= check("format: truncated to the buffer", hot_log_format(&record, line, 12) == 11 && strlen(line) == 11);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Producers against the drain
+typedef struct {
+    int id;
+    uint32_t iterations;
+    _Atomic uint32_t written;
+    uint32_t full;
+} producer_t;
+
+static atomic_bool s_producing;
+
+static void *producer(void *p)
+{
+    producer_t *prod = p;
+    hot_log_site_t site = HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "%d %d");
+    while (!atomic_load(&s_producing)) {
+        sched_yield();
+    }
+    // a line per interval ( never rate limited ), tried again while the ring is full
+    uint32_t now = 0, i = 0;
+    while (i < prod->iterations) {
+        if (hot_log_write(&s_ring, &site, now, (const uint32_t[HOT_LOG_MAX_ARGS]){ (uint32_t)prod->id, i })) {
+            atomic_store_explicit(&prod->written, ++i, memory_order_release);
+        } else {
+            prod->full++;
+            sched_yield();
+        }
+        now += INTERVAL_MS;
+    }
+    return NULL;
+}
+
+static bool mpsc_stress(int producers, uint32_t iterations)
+{
+    printf("== Ring: %d producers x %u records, one consumer ==\n", producers, iterations);
+    hot_log_ring_init(&s_ring);
+    producer_t prods[8];
+    pthread_t threads[8];
+    int64_t last[8];
+    uint32_t got[8] = { 0 };
+    for (int p = 0; p < producers; p++) {
+        prods[p].id = p;
+        prods[p].iterations = iterations;
+        atomic_init(&prods[p].written, 0);
+        prods[p].full = 0;
+        last[p] = -1;
+        pthread_create(&threads[p], NULL, producer, &prods[p]);
+    }
+    bool in_order = true;
+    uint64_t start = sim_host_ns();
+    atomic_store(&s_producing, true);
+    int running = producers;
+    hot_log_record_t record;
+    while (running > 0) {
+        while (hot_log_pop(&s_ring, &record)) {
+            uint32_t p = record.args[0];
+            in_order &= p < (uint32_t)producers && (int64_t)record.args[1] > last[p];
+            if (p < (uint32_t)producers) {
+                last[p] = record.args[1];
+                got[p]++;
+            }
+        }
+        sched_yield();
+        running = 0;
+        for (int p = 0; p < producers; p++) {
+            running += atomic_load_explicit(&prods[p].written, memory_order_acquire) < iterations;
+        }
+    }
+    uint64_t ns = sim_host_ns() - start;
+    for (int p = 0; p < producers; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    while (hot_log_pop(&s_ring, &record)) {
+        uint32_t p = record.args[0];
+        in_order &= p < (uint32_t)producers && (int64_t)record.args[1] > last[p];
+        if (p < (uint32_t)producers) {
+            last[p] = record.args[1];
+            got[p]++;
+        }
+    }
+    uint64_t written = 0, full = 0;
+    bool all = true;
+    for (int p = 0; p < producers; p++) {
+        written += prods[p].written;
+        full += prods[p].full;
+        all &= got[p] == prods[p].written;
+    }
+    printf("  %llu written, %llu tries found the ring full, %.1f ns per record\n"
+        , (unsigned long long)written, (unsigned long long)full, (double)ns / (double)(producers * (uint64_t)iterations));
+    bool ok = check("every record out once, in producer order", in_order && all && written == producers * (uint64_t)iterations);
+    ok &= check("counters match", atomic_load(&s_ring.written) == written && atomic_load(&s_ring.dropped) == full);
+    return ok;
+}
+
+static void costs(uint32_t iterations)
+{
+    printf("== Cost per call ==\n");
+    hot_log_ring_init(&s_ring);
+    hot_log_site_t site = HOT_LOG_SITE_INIT(ESP_LOG_INFO, "bench", "GATT: Write Send Response, conn_id=%d");
+    hot_log_record_t record;
+    uint64_t write_ns = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint64_t start = sim_host_ns();
+        hot_log_write(&s_ring, &site, i * INTERVAL_MS, (const uint32_t[HOT_LOG_MAX_ARGS]){ 1 });
+        write_ns += sim_host_ns() - start;
+        hot_log_pop(&s_ring, &record);
+    }
+    uint64_t start = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        hot_log_write(&s_ring, &site, 0, NO_ARGS);    // same ms: held back
+    }
+    uint64_t held_ns = sim_host_ns() - start;
+    start = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ESP_LOGI("bench", "GATT: Write Send Response, conn_id=%d", 1);
+    }
+    uint64_t direct_ns = sim_host_ns() - start;
+    printf("  ring record written        %8.1f ns\n", (double)write_ns / iterations);
+    printf("  rate limited               %8.1f ns\n", (double)held_ns / iterations);
+    printf("  ESP_LOGI, formatting only  %8.1f ns (the UART comes on top)\n", (double)direct_ns / iterations);
+}
+
+//-----------------------------------------------------------------------------
+// Handlers
+static bool handlers(uint32_t baud, uint32_t write_interval_ms, uint32_t duration_s)
+{
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_log_uart_baud(baud);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, 247);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    sim_advance_ms(1000);   // boot and connect lines drained
+
+    sim_stats_reset();
+    uint32_t writes = 0, cccd_writes = 0;
+    uint32_t elapsed_ms = 0;
+    uint16_t seq = 0;
+    while (elapsed_ms < duration_s * 1000) {
+        uint8_t frame[10] = { (uint8_t)seq, (uint8_t)(seq >> 8) };
+        seq++;
+        sim_write(0, h.write_char, frame, sizeof(frame), true);
+        writes++;
+        if (elapsed_ms % 50 < write_interval_ms) {
+            sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+            cccd_writes++;
+        }
+        sim_advance_ms(write_interval_ms);
+        elapsed_ms += write_interval_ms;
+    }
+    sim_advance_ms(2 * HOT_LOG_DRAIN_MS);
+    const sim_stats_t *s = sim_stats();
+    const sim_cost_t *w = &s->gatts[ESP_GATTS_WRITE_EVT];
+    double secs = (double)duration_s;
+    double avg_us = w->count ? (double)w->total_ns / (double)w->count / 1000.0 : 0.0;
+    printf("== Handlers (%s): UART %u baud, write with response every %u ms + CCCD every 50 ms, %u s ==\n"
+        , mode_str(), baud, write_interval_ms, duration_s);
+    printf("  GATTS WRITE                %8.1f us avg %8.1f us max  (%llu events)\n"
+        , avg_us, (double)w->max_ns / 1000.0, (unsigned long long)w->count);
+    printf("  lines printed              %8llu  (%.1f/s)\n", (unsigned long long)s->log_lines, (double)s->log_lines / secs);
+    printf("  UART                       %8.1f %% busy, %llu bytes\n"
+        , (double)s->log_uart_ns / (secs * 1e7), (unsigned long long)s->log_uart_bytes);
+    printf("  ring                       %8u written %u held back %u dropped\n"
+        , atomic_load(&hot_log_ring.written), atomic_load(&hot_log_ring.suppressed), atomic_load(&hot_log_ring.dropped));
+
+    bool ok = check("every write answered", s->responses_sent >= writes + cccd_writes);
+#if CONFIG_SWIFT_HOT_LOG_STRIP
+    ok &= check("strip: nothing printed", s->log_lines == 0 && s->log_uart_bytes == 0);
+#elif CONFIG_SWIFT_HOT_LOG_RING
+    // 3 sites: Write Send Response, Notify enabled, Notify Send Response
+    uint32_t per_site = CONFIG_SWIFT_HOT_LOG_BURST + (duration_s * 1000 + 2 * HOT_LOG_DRAIN_MS) / INTERVAL_MS + 1;
+    ok &= check("ring: each site within its rate", s->log_lines <= 3 * per_site);
+    ok &= check("ring: lines held back, none dropped", atomic_load(&hot_log_ring.suppressed) > 0
+        && atomic_load(&hot_log_ring.dropped) == 0);
+    ok &= check("ring: handler does not wait for a 30-byte line /10", avg_us < 30.0 * 10 * 1e6 / baud / 10);
+#else
+    ok &= check("direct: every line printed", s->log_lines >= writes + 2 * cccd_writes);
+    ok &= check("direct: handler waits for a 30-byte line", avg_us >= 30.0 * 10 * 1e6 / baud);
+#endif
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 1000000;
+    int producers = 4;
+    uint32_t baud = 115200;
+    uint32_t write_interval_ms = 5;
+    uint32_t duration_s = 2;
+
+    static const struct option options[] = {
+        { "iterations", required_argument, NULL, 'n' },
+        { "producers", required_argument, NULL, 'p' },
+        { "baud", required_argument, NULL, 'b' },
+        { "write-interval-ms", required_argument, NULL, 'w' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:p:b:w:d:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': producers = atoi(optarg); break;
+            case 'b': baud = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': write_interval_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--iterations N] [--producers N] [--baud N] [--write-interval-ms N] [--duration-s N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (iterations == 0 || producers < 1 || producers > 8 || baud == 0 || write_interval_ms == 0 || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_NONE);
+    bool ok = layer_checks();
+    ok &= mpsc_stress(producers, iterations / (uint32_t)producers);
+    costs(iterations);
+    ok &= handlers(baud, write_interval_ms, duration_s);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+// LED pattern benchmark for main/led_pattern.c and the pattern player.
+//
+// Engine: compiles --keyframes keyframe patterns into a duty table again and
+// again and reports the cost per pattern and per tick, checks the table
+// against a straightforward per-tick reference, and checks the error paths
+// (truncated record, no duration, longer than the table).
+//
+// Device: uploads patterns through the blob characteristic and steps the
+// virtual clock tick by tick. The LED must follow the compiled table through
+// the LEDC fade calls, with no ledc_update_duty while a pattern plays; writes
+// must leave the LED alone until a stop record hands it back; a one-shot
+// pattern must hold its last level and stop its timer. Back-to-back uploads
+// within one tick must play the last one; a rejected one must leave the
+// upload before it in place. The bench compares the
+// upload with the per-tick writes the same animation would take.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "blob_rx.h"
+#include "frame.h"
+#include "led_pattern.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+// Mirror main/ble-swift-device.c
+#define DUTY_MAX    8191
+#define TICK_MS     30
+#define TABLE_LEN   1024
+#define MAX_DUTY    34
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Builds a record of count keyframes; returns its length.
+static uint32_t make_pattern(uint8_t *record, uint8_t flags, uint16_t count, uint32_t seed)
+{
+    led_pattern_encode_header(flags, count, record);
+    uint32_t x = seed * 2654435761u + 1;
+    for (uint16_t i = 0; i < count; i++) {
+        x = x * 1103515245u + 12345u;
+        uint16_t level = (uint16_t)(x >> 8);
+        x = x * 1103515245u + 12345u;
+        // mostly ramps, some jumps
+        uint16_t ramp_ms = (x >> 16) % 8 == 0 ? 0 : (uint16_t)(10 + (x >> 16) % 400);
+        led_pattern_encode_keyframe(level, ramp_ms, record + LED_PATTERN_HEADER_LEN + i * LED_PATTERN_KEYFRAME_LEN);
+    }
+    return LED_PATTERN_HEADER_LEN + (uint32_t)count * LED_PATTERN_KEYFRAME_LEN;
+}
+
+// Duty at time t, walking the keyframes from the start.
+static double reference_duty(const uint8_t *record, uint16_t count, uint32_t t, uint32_t total_ms)
+{
+    const uint8_t *kf = record + LED_PATTERN_HEADER_LEN;
+    bool loop = (record[1] & LED_PATTERN_LOOP) != 0;
+    double from = loop ? get_u16(kf + (count - 1) * LED_PATTERN_KEYFRAME_LEN) : 0.0;
+    uint32_t start = 0;
+    for (uint16_t k = 0; k < count; k++) {
+        double to = get_u16(kf + k * LED_PATTERN_KEYFRAME_LEN);
+        uint32_t ramp = get_u16(kf + k * LED_PATTERN_KEYFRAME_LEN + 2);
+        if (t < start + ramp || k == count - 1) {
+            double level = (ramp == 0 || t >= start + ramp) ? to : from + (to - from) * (t - start) / ramp;
+            return level * DUTY_MAX / LED_PATTERN_LEVEL_MAX;
+        }
+        start += ramp;
+        from = to;
+    }
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Engine
+static bool engine(uint16_t keyframes, uint32_t iterations)
+{
+    static uint16_t table[TABLE_LEN];
+    uint8_t *record = malloc(LED_PATTERN_HEADER_LEN + (size_t)keyframes * LED_PATTERN_KEYFRAME_LEN);
+    if (record == NULL) {
+        return false;
+    }
+    led_pattern_t pattern;
+    led_pattern_init(&pattern, table, TABLE_LEN, TICK_MS);
+
+    // patterns that fit the table
+    uint32_t len = 0;
+    uint32_t seed = 0;
+    led_pattern_status_t status;
+    do {
+        len = make_pattern(record, LED_PATTERN_LOOP, keyframes, ++seed);
+        status = led_pattern_compile(&pattern, record, len, DUTY_MAX);
+    } while (status == LED_PATTERN_ERR_TOO_LONG && seed < 1000);
+    if (status != LED_PATTERN_OK) {
+        printf("no %u-keyframe pattern fits %u ticks\n", keyframes, TABLE_LEN);
+        free(record);
+        return false;
+    }
+
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t it = 0; it < iterations; it++) {
+        led_pattern_compile(&pattern, record, len, DUTY_MAX);
+    }
+    uint64_t t1 = sim_host_ns();
+
+    printf("== Engine: %u keyframes, %u ticks of %u ms, %u times ==\n", keyframes, pattern.len, TICK_MS, iterations);
+    printf("  %.1f us per pattern, %.1f ns per tick\n",
+           (double)(t1 - t0) / iterations / 1000.0, (double)(t1 - t0) / ((double)iterations * pattern.len));
+
+    bool ok = true;
+    for (int mode = 0; mode < 2; mode++) {
+        uint8_t flags = mode == 0 ? LED_PATTERN_LOOP : 0;
+        uint32_t worst = 0;
+        bool match = true;
+        for (uint32_t s = 1; s <= 200; s++) {
+            len = make_pattern(record, flags, keyframes, s);
+            if (led_pattern_compile(&pattern, record, len, DUTY_MAX) != LED_PATTERN_OK) {
+                continue;
+            }
+            uint32_t total_ms = 0;
+            for (uint16_t k = 0; k < keyframes; k++) {
+                total_ms += get_u16(record + LED_PATTERN_HEADER_LEN + k * LED_PATTERN_KEYFRAME_LEN + 2);
+            }
+            match &= pattern.len == (total_ms + TICK_MS - 1) / TICK_MS && pattern.loop == (mode == 0);
+            for (uint32_t j = 0; j < pattern.len; j++) {
+                uint32_t t = (j + 1) * TICK_MS < total_ms ? (j + 1) * TICK_MS : total_ms;
+                double ref = reference_duty(record, keyframes, t, total_ms);
+                uint32_t err = (uint32_t)(ref > table[j] ? ref - table[j] : table[j] - ref);
+                worst = err > worst ? err : worst;
+            }
+        }
+        printf("  %-9s worst error against the reference: %u/%u\n", mode == 0 ? "looping" : "one-shot", worst, DUTY_MAX);
+        ok &= check(mode == 0 ? "looping table matches the keyframes" : "one-shot table matches the keyframes",
+                    match && worst <= 2);
+    }
+
+    // error paths leave the last good table alone
+    len = make_pattern(record, 0, 2, 1);
+    led_pattern_encode_keyframe(1000, 100, record + LED_PATTERN_HEADER_LEN);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX, 200, record + LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN);
+    ok &= check("two-keyframe pattern", led_pattern_compile(&pattern, record, len, DUTY_MAX) == LED_PATTERN_OK
+                && pattern.len == 10 && table[9] == DUTY_MAX);
+    ok &= check("truncated record refused", led_pattern_compile(&pattern, record, len - 1, DUTY_MAX) == LED_PATTERN_ERR_FORMAT);
+    record[0] = 0x7F;
+    ok &= check("other record type refused", led_pattern_compile(&pattern, record, len, DUTY_MAX) == LED_PATTERN_ERR_FORMAT);
+    record[0] = LED_PATTERN_RECORD_TYPE;
+    led_pattern_encode_keyframe(1000, 0, record + LED_PATTERN_HEADER_LEN);
+    led_pattern_encode_keyframe(2000, 0, record + LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN);
+    ok &= check("pattern with no duration refused", led_pattern_compile(&pattern, record, len, DUTY_MAX) == LED_PATTERN_ERR_EMPTY);
+    led_pattern_encode_keyframe(1000, 60000, record + LED_PATTERN_HEADER_LEN);
+    ok &= check("pattern longer than the table refused", led_pattern_compile(&pattern, record, len, DUTY_MAX) == LED_PATTERN_ERR_TOO_LONG);
+    ok &= check("table kept after errors", pattern.len == 10 && table[9] == DUTY_MAX);
+
+    free(record);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Device
+static bool read_counters(uint16_t handle, uint32_t *counters)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 64];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len < TELEMETRY_HEADER_LEN || buf[0] != TELEMETRY_VERSION || buf[1] < TELEMETRY_COUNTER_MAX
+        || len < TELEMETRY_HEADER_LEN + 4 * buf[1]) {
+        return false;
+    }
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        const uint8_t *p = buf + TELEMETRY_HEADER_LEN + 4 * i;
+        counters[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return true;
+}
+
+// Uploads a record as chunked Write Commands of MTU - 3 bytes; returns the writes it took.
+static uint32_t upload(uint16_t handle, const uint8_t *record, uint32_t len, uint16_t mtu)
+{
+    uint8_t chunk[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t piece = (uint16_t)(mtu - 3 - BLOB_CHUNK_HEADER_LEN);
+    uint32_t writes = 0;
+    for (uint32_t off = 0; off < len; off += piece) {
+        uint16_t n = (uint16_t)(len - off < piece ? len - off : piece);
+        uint8_t flags = (off == 0 ? BLOB_CHUNK_FIRST : 0) | (off + n == len ? BLOB_CHUNK_LAST : 0);
+        blob_chunk_encode_header(flags, off, chunk);
+        memcpy(chunk + BLOB_CHUNK_HEADER_LEN, record + off, n);
+        sim_write(0, handle, chunk, (uint16_t)(BLOB_CHUNK_HEADER_LEN + n), false);
+        writes++;
+    }
+    return writes;
+}
+
+static void write_counter(uint16_t handle, uint16_t seq)
+{
+    uint8_t frame[FRAME_LEN];
+    frame_t f = { .seq = seq, .type = FRAME_TYPE_DATA };
+    frame_encode(&f, frame);
+    sim_write(0, handle, frame, sizeof(frame), false);
+}
+
+static uint32_t counter_duty(uint16_t seq)
+{
+    uint32_t duty = seq % (2 * MAX_DUTY);
+    if (duty >= MAX_DUTY) {
+        duty = 2 * MAX_DUTY - duty - 1;
+    }
+    return DUTY_MAX - (duty * DUTY_MAX) / MAX_DUTY;
+}
+
+// Steps ticks pattern ticks from position pos; true when the LED showed each one.
+static bool follows(const led_pattern_t *pattern, uint32_t pos, uint32_t ticks, uint16_t write_handle, uint16_t *seq)
+{
+    bool ok = true;
+    for (uint32_t j = 0; j < ticks; j++) {
+        if (write_handle != 0) {
+            write_counter(write_handle, (*seq)++);
+        }
+        sim_advance_ms(TICK_MS);
+        uint32_t expected = DUTY_MAX - pattern->table[(pos + j) % pattern->len];
+        ok &= sim_led_duty(0) == expected;
+    }
+    return ok;
+}
+
+// Compiles the first pattern from seed on that fits the table; returns its length.
+static uint32_t make_fitting(led_pattern_t *pattern, uint8_t *record, uint16_t keyframes, uint32_t seed)
+{
+    uint32_t len = 0;
+    for (uint32_t s = seed; s < seed + 1000; s++) {
+        len = make_pattern(record, LED_PATTERN_LOOP, keyframes, s);
+        if (led_pattern_compile(pattern, record, len, DUTY_MAX) == LED_PATTERN_OK) {
+            break;
+        }
+    }
+    return len;
+}
+
+static bool device(uint16_t keyframes, uint16_t mtu)
+{
+    bench_handles_t h = bench_lookup_handles();
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, mtu);
+    sim_advance_ms(3000);
+
+    static uint16_t table[TABLE_LEN];
+    static uint8_t record[CONFIG_SWIFT_BLOB_MAX_LEN];
+    led_pattern_t pattern;
+    led_pattern_init(&pattern, table, TABLE_LEN, TICK_MS);
+    uint32_t len = 0;
+    for (uint32_t seed = 1; seed < 1000; seed++) {
+        len = make_pattern(record, LED_PATTERN_LOOP, keyframes, seed);
+        if (led_pattern_compile(&pattern, record, len, DUTY_MAX) == LED_PATTERN_OK && pattern.len * 2 < TABLE_LEN) {
+            break;
+        }
+    }
+
+    uint32_t before[TELEMETRY_COUNTER_MAX], after[TELEMETRY_COUNTER_MAX];
+    bool ok = read_counters(h.telemetry_char, before);
+    uint16_t seq = 0;
+
+    printf("== Device: %u keyframes (%u bytes), MTU %u ==\n", keyframes, len, mtu);
+    sim_stats_reset();
+    uint32_t writes = upload(h.blob_char, record, len, mtu);
+    ok &= check("LED follows the table for two loops", follows(&pattern, 0, 2 * pattern.len, 0, &seq));
+    const sim_stats_t s = *sim_stats();
+    printf("  %u upload writes drive %u ms per loop; per-tick duty writes: %u per loop\n",
+           writes, pattern.len * TICK_MS, pattern.len);
+    printf("  %llu fades, %llu duty updates, pattern timer %.0f ns per tick\n",
+           (unsigned long long)s.led_fades, (unsigned long long)s.led_updates,
+           s.timer[0].count ? (double)s.timer[0].total_ns / s.timer[0].count : 0.0);
+    ok &= check("one fade per tick, no duty updates", s.led_fades == 2 * pattern.len && s.led_updates == 0);
+
+    ok &= check("writes leave a playing pattern alone", follows(&pattern, 0, 20, h.write_char, &seq));
+
+    // a second upload restarts from its own first tick
+    led_pattern_t second;
+    static uint16_t second_table[TABLE_LEN];
+    led_pattern_init(&second, second_table, TABLE_LEN, TICK_MS);
+    len = make_fitting(&second, record, keyframes, 500);
+    upload(h.blob_char, record, len, mtu);
+    ok &= check("new pattern replaces the playing one", follows(&second, 0, 20, 0, &seq));
+
+    // back to back within one tick: the first is never picked up, the last plays
+    len = make_fitting(&pattern, record, keyframes, 1500);
+    upload(h.blob_char, record, len, mtu);
+    len = make_fitting(&second, record, keyframes, 2500);
+    upload(h.blob_char, record, len, mtu);
+    ok &= check("back-to-back uploads play the last one", follows(&second, 0, 2 * second.len, 0, &seq));
+
+    // a rejected upload within the same tick keeps the one before it
+    len = make_fitting(&pattern, record, keyframes, 3500);
+    upload(h.blob_char, record, len, mtu);
+    led_pattern_encode_header(0, 1, record);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX, 60000, record + LED_PATTERN_HEADER_LEN);
+    upload(h.blob_char, record, LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN, mtu);
+    ok &= check("rejected upload keeps the one before it", follows(&pattern, 0, 20, 0, &seq));
+
+    // a record with no keyframes stops the pattern
+    led_pattern_encode_header(0, 0, record);
+    upload(h.blob_char, record, LED_PATTERN_HEADER_LEN, mtu);
+    sim_advance_ms(TICK_MS);
+    sim_stats_reset();
+    write_counter(h.write_char, seq);
+    sim_advance_ms(TICK_MS);
+    ok &= check("stop hands the LED back to writes", sim_led_duty(0) == counter_duty(seq) && sim_stats()->led_fades == 0);
+    seq++;
+
+    // one-shot: ramp up, hold
+    led_pattern_encode_header(0, 2, record);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX / 2, 90, record + LED_PATTERN_HEADER_LEN);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX, 90, record + LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN);
+    upload(h.blob_char, record, LED_PATTERN_HEADER_LEN + 2 * LED_PATTERN_KEYFRAME_LEN, mtu);
+    sim_stats_reset();
+    sim_advance_ms(20 * TICK_MS);
+    ok &= check("one-shot holds its last level", sim_led_duty(0) == 0 && sim_stats()->led_fades == 6);
+    sim_stats_reset();
+    sim_advance_ms(20 * TICK_MS);
+    ok &= check("one-shot stops its timer", sim_stats()->timer[0].count == 0);
+    write_counter(h.write_char, seq);
+    sim_advance_ms(TICK_MS);
+    ok &= check("writes drive the LED after a one-shot", sim_led_duty(0) == counter_duty(seq));
+
+    // too long for the table
+    led_pattern_encode_header(0, 1, record);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX, 60000, record + LED_PATTERN_HEADER_LEN);
+    upload(h.blob_char, record, LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN, mtu);
+    sim_advance_ms(5 * TICK_MS);
+    ok &= check("rejected pattern leaves the LED alone", sim_led_duty(0) == counter_duty(seq));
+
+    ok &= read_counters(h.telemetry_char, after);
+    ok &= check("patterns loaded and rejected counted", after[TELEMETRY_LED_PATTERNS_LOADED] - before[TELEMETRY_LED_PATTERNS_LOADED] == 6
+                && after[TELEMETRY_LED_PATTERNS_REJECTED] - before[TELEMETRY_LED_PATTERNS_REJECTED] == 2);
+
+    sim_disconnect(0);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t keyframes = 32;
+
+    static const struct option options[] = {
+        { "keyframes", required_argument, NULL, 'k' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'k': keyframes = (uint16_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--keyframes N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (keyframes < 2 || keyframes > 64) {
+        fprintf(stderr, "keyframes must be in [2, 64]\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_ERROR);
+    bool ok = engine(keyframes, 20000);
+
+    sim_boot();
+    if (bench_lookup_handles().blob_char == 0) {
+        printf("blob characteristic not found\nFAILED\n");
+        return 1;
+    }
+    ok &= device(keyframes, 247);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
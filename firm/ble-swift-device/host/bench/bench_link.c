@@ -0,0 +1,173 @@
+// Link negotiation benchmark.
+//
+// Connects centrals with different capabilities (full DLE + 2M support, 1M
+// only, DLE rejected, both rejected, and one that never answers) to the
+// paced bulk firmware under the air time link model. For each it reports the
+// data length and PHY the link settled on, when it settled, what the device
+// reports in the config characteristic's link status record, and the
+// notification throughput that results. Every central must end up with a
+// working link at the best parameters it supports; the device's report must
+// match the link the central sees.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swift_config.h"
+
+#include "bench_common.h"
+
+#define NOTIFY_PERIOD_MS    10
+#define SETTLE_MS           3000 // longer than the negotiation timeout
+
+typedef struct {
+    const char *name;
+    sim_central_caps_t caps;
+    uint16_t want_octets;   // expected outcome
+    esp_ble_gap_phy_t want_phy;
+} scenario_t;
+
+static const char *phy_name(uint8_t phy)
+{
+    return phy == ESP_BLE_GAP_PHY_2M ? "2M" : phy == ESP_BLE_GAP_PHY_CODED ? "Coded" : "1M";
+}
+
+// Finds the link status record in a config read.
+static bool parse_link_status(const uint8_t *buf, uint16_t len, swift_link_status_t *link)
+{
+    uint16_t i = 0;
+    while (i + 2 <= len) {
+        uint8_t type = buf[i], rec_len = buf[i + 1];
+        if (i + 2 + rec_len > len) {
+            return false;
+        }
+        if (type == SWIFT_CONFIG_LINK_STATUS && rec_len == 10) {
+            const uint8_t *v = &buf[i + 2];
+            link->tx_phy = v[0];
+            link->rx_phy = v[1];
+            link->tx_octets = (uint16_t)(v[2] | (v[3] << 8));
+            link->rx_octets = (uint16_t)(v[4] | (v[5] << 8));
+            link->mtu = (uint16_t)(v[6] | (v[7] << 8));
+            link->conn_interval = (uint16_t)(v[8] | (v[9] << 8));
+            return true;
+        }
+        i = (uint16_t)(i + 2 + rec_len);
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration_s = 5;
+    uint32_t mtu = 247;
+
+    static const struct option options[] = {
+        { "duration-s", required_argument, NULL, 'd' },
+        { "mtu", required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:m:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--duration-s N] [--mtu N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_set_link_model(10, 0); // air time model: PHY and data length matter
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    if (h.config_char == 0) {
+        printf("config characteristic not found\nFAILED\n");
+        return 1;
+    }
+
+    const uint8_t both = ESP_BLE_GAP_PHY_1M_PREF_MASK | ESP_BLE_GAP_PHY_2M_PREF_MASK;
+    const scenario_t scenarios[] = {
+        { "DLE + 2M",       { 251, both, false },                         251, ESP_BLE_GAP_PHY_2M },
+        { "DLE 123, 2M",    { 123, both, false },                         123, ESP_BLE_GAP_PHY_2M },
+        { "DLE, 1M only",   { 251, ESP_BLE_GAP_PHY_1M_PREF_MASK, false }, 251, ESP_BLE_GAP_PHY_1M },
+        { "no DLE, 2M",     { 0, both, false },                           27,  ESP_BLE_GAP_PHY_2M },
+        { "rejects both",   { 0, 0, false },                              27,  ESP_BLE_GAP_PHY_1M },
+        { "never answers",  { 251, both, true },                          27,  ESP_BLE_GAP_PHY_1M },
+    };
+
+    printf("== Link negotiation: MTU %u, %d ms notify period, %u s virtual per central ==\n",
+           mtu, NOTIFY_PERIOD_MS, duration_s);
+    printf("  %-14s %6s %5s %10s %15s %10s %10s\n",
+           "central", "octets", "PHY", "settled", "device reports", "notify/s", "bytes/s");
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        const scenario_t *sc = &scenarios[i];
+        sim_set_central_caps(&sc->caps);
+
+        esp_bd_addr_t bda;
+        bench_bda(bda, 0);
+        if (!sim_connect(0, bda)) {
+            printf("  device not advertising\n");
+            return 1;
+        }
+        sim_set_mtu(0, (uint16_t)mtu);
+        sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+        sim_write(0, h.config_char, (const uint8_t[]){ SWIFT_CONFIG_NOTIFY_PERIOD, 2, NOTIFY_PERIOD_MS, 0 }, 4, true);
+
+        // step through the negotiation and note the last change the central saw
+        sim_link_t link = { 0 };
+        sim_link(0, &link);
+        uint64_t connected_us = sim_now_us();
+        uint64_t settled_us = connected_us;
+        for (uint32_t ms = 0; ms < SETTLE_MS; ms++) {
+            sim_advance_ms(1);
+            sim_link_t now = { 0 };
+            sim_link(0, &now);
+            if (now.tx_octets != link.tx_octets || now.phy != link.phy) {
+                settled_us = sim_now_us();
+                link = now;
+            }
+        }
+
+        uint8_t buf[64];
+        uint16_t len = sim_read(0, h.config_char, buf, sizeof(buf));
+        swift_link_status_t reported = { 0 };
+        bool have_report = parse_link_status(buf, len, &reported);
+        bool report_ok = have_report
+            && reported.tx_octets == link.tx_octets && reported.tx_phy == link.phy
+            && reported.mtu == mtu && reported.conn_interval == link.params.interval;
+
+        sim_stats_reset();
+        sim_advance_ms(duration_s * 1000);
+        const sim_stats_t *s = sim_stats();
+        double secs = (double)duration_s;
+
+        char settled[16];
+        if (settled_us == connected_us) {
+            snprintf(settled, sizeof(settled), "-");
+        } else {
+            snprintf(settled, sizeof(settled), "%.1f ms", (double)(settled_us - connected_us) / 1000.0);
+        }
+        char report[24];
+        if (have_report) {
+            snprintf(report, sizeof(report), "%u / %s%s", reported.tx_octets, phy_name(reported.tx_phy), report_ok ? "" : " (!)");
+        } else {
+            snprintf(report, sizeof(report), "missing");
+        }
+        bool link_ok = link.tx_octets == sc->want_octets && link.phy == sc->want_phy;
+        printf("  %-14s %6u %5s %10s %15s %10.1f %10.0f%s\n",
+               sc->name, link.tx_octets, phy_name(link.phy), settled, report,
+               (double)s->notify_sent / secs, (double)s->notify_bytes / secs,
+               link_ok ? "" : "  (UNEXPECTED)");
+        ok &= link_ok && report_ok && s->notify_sent > 0 && s->notify_failed == 0;
+
+        sim_disconnect(0);
+    }
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+// Event notification benchmark (main/notify_sched.c).
+//
+// Scheduler: checks each policy on the bare scheduler: LATEST keeps only the
+// newest frame, QUEUE keeps every frame in order and drops (with a sequence
+// gap) once full, IMMEDIATE asks to be sent now; packs fill the capacity and
+// no more, a partly taken pack leaves the rest, channels go out in order and
+// every packed frame decodes. Then times publish + pack + commit.
+//
+// End to end: a central subscribes, turns write acknowledgements on under
+// each policy in turn (a fresh device each) and writes a frame every
+// --write-interval-ms for --duration-s while the 30ms tick streams data.
+// Reports write-to-ack latency on air (avg / p95 / max), acks per write,
+// event notifications per second and frames per event notification. QUEUE
+// must ack every write, in order, in fewer notifications than writes; LATEST
+// must ack the last write and send no more event notifications than ticks;
+// IMMEDIATE must ack every write within two connection intervals. A rejected
+// blob chunk must raise an IMMEDIATE alert just as fast.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "blob_rx.h"
+#include "frame.h"
+#include "notify_sched.h"
+#include "swift_config.h"
+
+#include "bench_common.h"
+
+#define MAX_WRITES 4096
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Scheduler
+static bool decodes_as(const uint8_t *buf, uint16_t len, uint8_t type, const uint16_t *seqs, const uint16_t *values, int n)
+{
+    if (len != n * FRAME_LEN) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        frame_t frame;
+        if (!frame_decode(buf + i * FRAME_LEN, FRAME_LEN, &frame) || frame.type != type
+            || frame.payload_len != 2 || frame.seq != seqs[i]
+            || (uint16_t)(frame.payload[0] | frame.payload[1] << 8) != values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool scheduler_checks(uint32_t iterations)
+{
+    bool ok = true;
+    notify_sched_t s;
+    uint8_t buf[256];
+    uint16_t len;
+
+    printf("== Scheduler ==\n");
+
+    notify_sched_init(&s);
+    notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_LATEST, 10, 1);
+    notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_LATEST, 20, 2);
+    bool latest_now = notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_LATEST, 30, 3);
+    len = notify_sched_pack(&s, buf, sizeof(buf));
+    ok &= check("latest: one frame, the newest, seq 2", !latest_now && s.pending == 1 && s.coalesced == 2
+        && decodes_as(buf, len, FRAME_TYPE_LED, (const uint16_t[]){ 2 }, (const uint16_t[]){ 30 }, 1));
+
+    notify_sched_init(&s);
+    for (uint16_t i = 0; i < NOTIFY_SCHED_QUEUE_LEN + 2; i++) {
+        notify_sched_publish(&s, NOTIFY_CH_WRITE_ACK, NOTIFY_POLICY_QUEUE, (uint16_t)(100 + i), i);
+    }
+    len = notify_sched_pack(&s, buf, sizeof(buf));
+    uint16_t seqs[NOTIFY_SCHED_QUEUE_LEN], values[NOTIFY_SCHED_QUEUE_LEN];
+    for (uint16_t i = 0; i < NOTIFY_SCHED_QUEUE_LEN; i++) {
+        seqs[i] = i;
+        values[i] = (uint16_t)(100 + i);
+    }
+    ok &= check("queue: in order, full queue drops the newest", s.dropped == 2 && s.pending == NOTIFY_SCHED_QUEUE_LEN
+        && decodes_as(buf, len, FRAME_TYPE_WRITE_ACK, seqs, values, NOTIFY_SCHED_QUEUE_LEN));
+    notify_sched_commit(&s, len);
+    notify_sched_publish(&s, NOTIFY_CH_WRITE_ACK, NOTIFY_POLICY_QUEUE, 7, 0);
+    len = notify_sched_pack(&s, buf, sizeof(buf));
+    ok &= check("queue: seq gap after the drops", decodes_as(buf, len, FRAME_TYPE_WRITE_ACK
+        , (const uint16_t[]){ NOTIFY_SCHED_QUEUE_LEN + 2 }, (const uint16_t[]){ 7 }, 1));
+
+    notify_sched_init(&s);
+    notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_LATEST, 1, 0);
+    bool before = notify_sched_urgent(&s);
+    bool now = notify_sched_publish(&s, NOTIFY_CH_ALERT, NOTIFY_POLICY_IMMEDIATE, NOTIFY_ALERT_BLOB_COMPLETE, 0);
+    ok &= check("immediate: send now, urgent until committed", !before && now && notify_sched_urgent(&s));
+    len = notify_sched_pack(&s, buf, sizeof(buf));
+    frame_t first;
+    ok &= check("channels in enum order (alert before led)", len == 2 * FRAME_LEN
+        && frame_decode(buf, FRAME_LEN, &first) && first.type == FRAME_TYPE_ALERT);
+    notify_sched_commit(&s, FRAME_LEN);
+    ok &= check("partial commit: alert gone, led left", !notify_sched_urgent(&s) && s.pending == 1
+        && notify_sched_pack(&s, buf, sizeof(buf)) == FRAME_LEN);
+
+    notify_sched_init(&s);
+    for (uint16_t i = 0; i < 5; i++) {
+        notify_sched_publish(&s, NOTIFY_CH_WRITE_ACK, NOTIFY_POLICY_QUEUE, i, 0);
+    }
+    len = notify_sched_pack(&s, buf, 20);   // MTU 23
+    uint16_t len_odd = notify_sched_pack(&s, buf, 29);
+    ok &= check("pack fits the capacity (20 and 29 bytes: 2 frames)", len == 2 * FRAME_LEN && len_odd == 2 * FRAME_LEN);
+    notify_sched_commit(&s, len);
+    len = notify_sched_pack(&s, buf, sizeof(buf));
+    ok &= check("after a 2-frame commit: seq 2..4 left", decodes_as(buf, len, FRAME_TYPE_WRITE_ACK
+        , (const uint16_t[]){ 2, 3, 4 }, (const uint16_t[]){ 2, 3, 4 }, 3));
+    notify_sched_clear(&s, NOTIFY_CH_WRITE_ACK);
+    ok &= check("clear drops the channel", !notify_sched_pending(&s) && notify_sched_pack(&s, buf, sizeof(buf)) == 0);
+
+    bool off = notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_OFF, 1, 0);
+    notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_MAX, 1, 0);
+    notify_sched_publish(&s, NOTIFY_CH_COUNT, NOTIFY_POLICY_QUEUE, 1, 0);
+    ok &= check("off / invalid policy / invalid channel ignored", !off && !notify_sched_pending(&s) && s.published == 5);
+
+    // cost: a tick's worth of publishes, packed and committed
+    notify_sched_init(&s);
+    uint64_t start = sim_host_ns();
+    uint64_t frames = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        notify_sched_publish(&s, NOTIFY_CH_WRITE_ACK, NOTIFY_POLICY_QUEUE, (uint16_t)i, i);
+        notify_sched_publish(&s, NOTIFY_CH_LED, NOTIFY_POLICY_LATEST, (uint16_t)i, i);
+        if (i % 4 == 3) {
+            len = notify_sched_pack(&s, buf, 244);
+            notify_sched_commit(&s, len);
+            frames += len / FRAME_LEN;
+        }
+    }
+    uint64_t ns = sim_host_ns() - start;
+    printf("  %u x (queue + latest publish), packed every 4th: %.1f ns per publish, %llu frames\n"
+        , iterations, iterations ? (double)ns / (2.0 * iterations) : 0.0, (unsigned long long)frames);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// End to end
+typedef struct {
+    notify_policy_t policy;
+    uint32_t write_interval_ms;
+    uint32_t duration_s;
+} e2e_arg_t;
+
+typedef struct {
+    uint64_t write_us[MAX_WRITES];
+    uint32_t latency_us[MAX_WRITES];
+    uint32_t acks;
+    int32_t last_ack;       // -1 before the first
+    bool in_order;
+    uint32_t event_notifies;
+    uint32_t event_frames;
+    uint64_t alert_us;      // first BLOB_REJECTED alert on air, 0: none
+    uint8_t alert_status;
+} e2e_t;
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    (void)conn_id; (void)handle;
+    e2e_t *r = ctx;
+    uint64_t now = sim_now_us();
+    frame_t frame;
+    if (len < FRAME_LEN || len % FRAME_LEN != 0 || !frame_decode(value, FRAME_LEN, &frame)
+        || (frame.type != FRAME_TYPE_ALERT && frame.type != FRAME_TYPE_LED && frame.type != FRAME_TYPE_WRITE_ACK)) {
+        return;     // data
+    }
+    r->event_notifies++;
+    for (uint16_t off = 0; off < len; off += FRAME_LEN) {
+        if (!frame_decode(value + off, FRAME_LEN, &frame)) {
+            continue;
+        }
+        r->event_frames++;
+        uint16_t v = (uint16_t)(frame.payload[0] | frame.payload[1] << 8);
+        if (frame.type == FRAME_TYPE_WRITE_ACK && v < MAX_WRITES) {
+            r->in_order &= (int32_t)v > r->last_ack;
+            r->last_ack = v;
+            r->latency_us[r->acks++] = (uint32_t)(now - r->write_us[v]);
+        } else if (frame.type == FRAME_TYPE_ALERT && (v & 0xFF) == NOTIFY_ALERT_BLOB_REJECTED && r->alert_us == 0) {
+            r->alert_us = now;
+            r->alert_status = (uint8_t)(v >> 8);
+        }
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int run_e2e(void *p)
+{
+    const e2e_arg_t *arg = p;
+    static e2e_t r;
+    r = (e2e_t){ .last_ack = -1, .in_order = true };
+
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_notify_hook(on_notify, &r);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, 247);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    sim_advance_ms(500);    // link settles ( interval, PHY, data length )
+
+    const uint8_t policy[] = { SWIFT_CONFIG_NOTIFY_POLICY, NOTIFY_CH_COUNT
+        , NOTIFY_POLICY_IMMEDIATE, NOTIFY_POLICY_OFF, (uint8_t)arg->policy };
+    sim_write(0, h.config_char, policy, sizeof(policy), true);
+    bool ok = sim_last_response_status() == ESP_GATT_OK;
+
+    sim_link_t link = { 0 };
+    sim_link(0, &link);
+    uint32_t interval_us = link.params.interval * 1250u;
+
+    uint32_t writes = arg->duration_s * 1000 / arg->write_interval_ms;
+    writes = writes < MAX_WRITES ? writes : MAX_WRITES;
+    uint64_t start = sim_now_us();
+    for (uint32_t i = 0; i < writes; i++) {
+        frame_t frame = { .seq = (uint16_t)i, .type = FRAME_TYPE_DATA, .timestamp_ms = (uint32_t)(sim_now_us() / 1000) };
+        uint8_t buf[FRAME_LEN];
+        frame_encode(&frame, buf);
+        r.write_us[i] = sim_now_us();
+        sim_write(0, h.write_char, buf, sizeof(buf), false);
+        sim_advance_ms(arg->write_interval_ms);
+    }
+    double secs = (double)(sim_now_us() - start) / 1e6;
+    sim_advance_ms(200);    // drain
+    uint32_t ticks = (uint32_t)(secs * 1000 / 30) + 2;    // partial ones at both ends
+    uint32_t event_notifies = r.event_notifies;
+
+    // an invalid blob chunk ( no transfer started ) raises an alert
+    uint8_t chunk[BLOB_CHUNK_HEADER_LEN + 4] = { 0 };
+    blob_chunk_encode_header(0, 64, chunk);
+    uint64_t chunk_us = sim_now_us();
+    sim_write(0, h.blob_char, chunk, sizeof(chunk), false);
+    sim_advance_ms(100);
+
+    qsort(r.latency_us, r.acks, sizeof(r.latency_us[0]), cmp_u32);
+    double avg = 0;
+    for (uint32_t i = 0; i < r.acks; i++) {
+        avg += r.latency_us[i];
+    }
+    avg = r.acks ? avg / r.acks : 0;
+    uint32_t p95 = r.acks ? r.latency_us[r.acks * 95 / 100] : 0;
+    uint32_t max = r.acks ? r.latency_us[r.acks - 1] : 0;
+    uint32_t alert_ms10 = r.alert_us ? (uint32_t)((r.alert_us - chunk_us) / 100) : 0;
+    printf("  %-9s acks %4u/%-4u  latency %5.1f avg %5.1f p95 %5.1f max ms  %5.1f event notify/s  %4.1f frames each  alert %u.%u ms\n"
+        , notify_policy_str(arg->policy), r.acks, writes, avg / 1000, p95 / 1000.0, max / 1000.0
+        , event_notifies / secs, event_notifies ? (double)r.event_frames / r.event_notifies : 0.0
+        , alert_ms10 / 10, alert_ms10 % 10);
+
+    ok &= check("policy write accepted", ok);
+    ok &= check("acks in order", r.in_order);
+    ok &= check("last write acked", r.last_ack == (int32_t)writes - 1);
+    switch (arg->policy) {
+        case NOTIFY_POLICY_QUEUE:
+            ok &= check("queue: every write acked", r.acks == writes);
+            ok &= check("queue: fewer event notifications than writes", event_notifies < writes);
+            break;
+        case NOTIFY_POLICY_LATEST:
+            ok &= check("latest: at most one event notification per tick", event_notifies <= ticks);
+            ok &= check("latest: fewer acks than writes", r.acks < writes);
+            break;
+        case NOTIFY_POLICY_IMMEDIATE:
+            ok &= check("immediate: every write acked", r.acks == writes);
+            ok &= check("immediate: within two connection intervals", max <= 2 * interval_us);
+            break;
+        default:
+            break;
+    }
+    ok &= check("alert: blob chunk rejected as idle", r.alert_us != 0 && r.alert_status == BLOB_RX_ERR_IDLE);
+    ok &= check("alert: within two connection intervals", r.alert_us != 0 && r.alert_us - chunk_us <= 2 * interval_us);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 1000000;
+    uint32_t write_interval_ms = 5;
+    uint32_t duration_s = 2;
+
+    static const struct option options[] = {
+        { "iterations", required_argument, NULL, 'n' },
+        { "write-interval-ms", required_argument, NULL, 'w' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:w:d:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': write_interval_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--iterations N] [--write-interval-ms N] [--duration-s N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (write_interval_ms == 0 || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_NONE);
+    bool ok = scheduler_checks(iterations);
+
+    printf("== End to end: a write every %u ms for %u s, MTU 247, 30 ms tick ==\n", write_interval_ms, duration_s);
+    const notify_policy_t policies[] = { NOTIFY_POLICY_QUEUE, NOTIFY_POLICY_LATEST, NOTIFY_POLICY_IMMEDIATE };
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        e2e_arg_t arg = { .policy = policies[i], .write_interval_ms = write_interval_ms, .duration_s = duration_s };
+        ok &= check(notify_policy_str(policies[i]), bench_run_isolated(run_e2e, &arg) == 0);
+    }
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
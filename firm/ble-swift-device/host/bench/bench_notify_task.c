@@ -0,0 +1,211 @@
+// Notify producer benchmark: timer service task jitter against notify rate.
+//
+// Every esp_ble_gatts_send_indicate call costs --stack-call-us of virtual
+// time (sim_set_stack_call_us). --clients subscribed centrals are served at
+// notify periods from 30 ms down to 2 ms while a looping LED pattern keeps
+// LedPatternTimer running every 30 ms next to NotifyTimer, each of its ticks
+// landing 0.5 ms after a notify tick. For each period the
+// bench reports the notification rate against the target, how late each timer
+// callback started (the timer service task is busy with whatever ran before
+// it), and the device's tick-to-send lag from the telemetry characteristic.
+//
+// Built twice: bench_notify_task against the default firmware (a notify task
+// sends, the timer only signals) and bench_notify_task_timer with
+// CONFIG_SWIFT_NOTIFY_TASK=0 (the timer callback sends, as before). With the
+// task the timers must start on time and every feasible rate must be met;
+// the timer build only reports.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "blob_rx.h"
+#include "led_pattern.h"
+#include "swift_config.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#define MAX_CLIENTS 9
+
+static int timer_slot(const sim_stats_t *s, const char *name)
+{
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (s->timer_name[i] != NULL && strcmp(s->timer_name[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum_us;
+    uint32_t buckets[TELEMETRY_HIST_BUCKETS];
+} hist_t;
+
+static bool read_hist(uint16_t handle, telemetry_hist_id_t id, hist_t *hist)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 64];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len < TELEMETRY_HEADER_LEN || buf[2] <= id || buf[3] != TELEMETRY_HIST_BUCKETS) {
+        return false;
+    }
+    uint32_t off = TELEMETRY_HEADER_LEN + 4u * buf[1] + (uint32_t)id * TELEMETRY_HIST_LEN;
+    if (len < off + TELEMETRY_HIST_LEN) {
+        return false;
+    }
+    hist->count = get_u32(buf + off);
+    hist->sum_us = get_u32(buf + off + 4);
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        hist->buckets[i] = get_u32(buf + off + 12 + 4 * i);
+    }
+    return true;
+}
+
+// Upper bound of the bucket holding the percentile of the samples between two reads.
+static uint32_t hist_percentile_us(const hist_t *before, const hist_t *after, uint32_t percentile)
+{
+    uint32_t n = after->count - before->count;
+    uint32_t seen = 0;
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        seen += after->buckets[i] - before->buckets[i];
+        if (n > 0 && (uint64_t)seen * 100 >= (uint64_t)n * percentile) {
+            return i == 0 ? 0 : 1u << i;
+        }
+    }
+    return n > 0 ? UINT32_MAX : 0;
+}
+
+static void set_period(uint16_t handle, uint16_t period_ms)
+{
+    const uint8_t record[] = { SWIFT_CONFIG_NOTIFY_PERIOD, 2, (uint8_t)period_ms, (uint8_t)(period_ms >> 8) };
+    sim_write(0, handle, record, sizeof(record), true);
+}
+
+// A 1.2 s breathing pattern, looping.
+static void start_led_pattern(uint16_t handle)
+{
+    uint8_t chunk[BLOB_CHUNK_HEADER_LEN + LED_PATTERN_HEADER_LEN + 2 * LED_PATTERN_KEYFRAME_LEN];
+    uint8_t *record = chunk + BLOB_CHUNK_HEADER_LEN;
+    blob_chunk_encode_header(BLOB_CHUNK_FIRST | BLOB_CHUNK_LAST, 0, chunk);
+    led_pattern_encode_header(LED_PATTERN_LOOP, 2, record);
+    led_pattern_encode_keyframe(LED_PATTERN_LEVEL_MAX, 600, record + LED_PATTERN_HEADER_LEN);
+    led_pattern_encode_keyframe(0, 600, record + LED_PATTERN_HEADER_LEN + LED_PATTERN_KEYFRAME_LEN);
+    sim_write(0, handle, chunk, sizeof(chunk), false);
+}
+
+static void print_late(const char *name, const sim_cost_t *c)
+{
+    printf("    %-16s %6llu runs, late avg %7.1f us  max %7.1f us\n", name, (unsigned long long)c->count,
+           c->count ? (double)c->total_ns / c->count / 1000.0 : 0.0, (double)c->max_ns / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    int clients = 4;
+    uint32_t stack_call_us = 300;
+    uint32_t duration_s = 5;
+
+    static const struct option options[] = {
+        { "clients", required_argument, NULL, 'c' },
+        { "stack-call-us", required_argument, NULL, 's' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:s:d:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': clients = atoi(optarg); break;
+            case 's': stack_call_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--clients N<=%d] [--stack-call-us US] [--duration-s N]\n", argv[0], MAX_CLIENTS);
+                return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    // air time model: the link, not the controller's buffer count, sets the ceiling
+    sim_set_link_model(10, 0);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    for (int i = 0; i < clients; i++) {
+        esp_bd_addr_t bda;
+        bench_bda(bda, (uint16_t)i);
+        sim_connect((uint16_t)i, bda);
+        sim_set_mtu((uint16_t)i, 247);
+        sim_write((uint16_t)i, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    }
+    // let the links settle
+    sim_advance_ms(3000);
+    sim_set_stack_call_us(stack_call_us);
+
+    printf("== Notify %s: %d clients, %u us per stack call, %u s virtual each ==\n",
+           CONFIG_SWIFT_NOTIFY_TASK ? "task" : "timer callback", clients, stack_call_us, duration_s);
+    bool ok = true;
+    static const uint16_t periods[] = { 30, 10, 5, 2 };
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        set_period(h.config_char, periods[p]);
+        sim_advance_us(500);
+        // restarts LedPatternTimer; every period divides 30 ms
+        start_led_pattern(h.blob_char);
+        sim_advance_ms(100);
+
+        hist_t lag_before, lag_after;
+        bool read = read_hist(h.telemetry_char, TELEMETRY_HIST_NOTIFY_LAG, &lag_before);
+        sim_stats_reset();
+        sim_advance_ms(duration_s * 1000);
+        const sim_stats_t s = *sim_stats();
+        read &= read_hist(h.telemetry_char, TELEMETRY_HIST_NOTIFY_LAG, &lag_after);
+
+        double target = clients * 1000.0 * CONFIG_SWIFT_NOTIFY_BURST / periods[p];
+        double rate = (double)s.notify_sent / duration_s;
+        // the sends of one tick must fit in the tick
+        bool feasible = (uint64_t)clients * CONFIG_SWIFT_NOTIFY_BURST * stack_call_us < periods[p] * 1000u;
+        printf("  period %2u ms: %8.1f notify/s of %8.1f target (%5.1f%%)%s\n", periods[p], rate, target,
+               100.0 * rate / target, feasible ? "" : ", stack calls exceed the period");
+        int notify = timer_slot(&s, "NotifyTimer");
+        int led = timer_slot(&s, "LedPatternTimer");
+        if (notify < 0 || led < 0 || !read) {
+            printf("    timers or telemetry not found\n");
+            ok = false;
+            continue;
+        }
+        print_late("NotifyTimer", &s.timer_late[notify]);
+        print_late("LedPatternTimer", &s.timer_late[led]);
+        uint32_t n = lag_after.count - lag_before.count;
+        if (n > 0) {
+            printf("    %-16s avg %7.1f us  p99 <= %u us\n", "tick -> send",
+                   (double)(lag_after.sum_us - lag_before.sum_us) / n, hist_percentile_us(&lag_before, &lag_after, 99));
+        }
+
+        if (CONFIG_SWIFT_NOTIFY_TASK) {
+            bool on_time = s.timer_late[notify].max_ns == 0 && s.timer_late[led].max_ns == 0;
+            if (!on_time) {
+                printf("    MISMATCH: timers started late\n");
+            }
+            bool rate_met = !feasible || rate >= 0.95 * target;
+            if (!rate_met) {
+                printf("    MISMATCH: feasible rate not met\n");
+            }
+            ok &= on_time && rate_met;
+        }
+        ok &= s.notify_sent > 0;
+    }
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
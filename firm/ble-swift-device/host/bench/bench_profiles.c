@@ -0,0 +1,470 @@
+// Tuning profile benchmark (main/tuning_profile.c).
+//
+// Serialisation: every built-in profile is valid and stores as its version
+// byte alone; tweaked settings store as the records that differ and read
+// back as themselves; a record of another version, one that does not parse
+// or one that names another profile is refused and leaves the settings
+// untouched. Then times serialise + deserialise.
+//
+// NVS: against the file-backed stand-in, with no device: an erased flash
+// loads DEFAULT, a selection and saved settings come back, settings saved
+// equal to the built-in ones take no entry, and an unusable record or active
+// id falls back to the built-in settings with its error.
+//
+// Across reboots: boots a device again and again (a fresh process each) on
+// one NVS file. Each boot connects a central, checks the profile the
+// previous boot left active is in force (config read-back, connection
+// interval, notification rate) and was loaded before advertising started,
+// then selects or saves a profile over the config characteristic for the
+// next boot. Then, within one boot, read-modify-writes of the config: one
+// written back unchanged must not touch NVS or re-negotiate the link, one
+// that changes only the profile byte must load that profile's settings, and
+// one that also changes a record must keep that change. Reports boot-to-advertising time with each NVS read costing
+// --nvs-read-us and the GATTS WRITE handler cost of a selection with each
+// NVS write costing --nvs-write-us.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "nvs_flash.h"
+#include "swift_config.h"
+#include "tuning_profile.h"
+
+#include "bench_common.h"
+
+static char s_nvs_file[256];
+static uint32_t s_read_us = 100;
+static uint32_t s_write_us = 2000;
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static bool same_config(const swift_config_t *a, const swift_config_t *b)
+{
+    uint8_t ea[SWIFT_CONFIG_ENCODED_LEN], eb[SWIFT_CONFIG_ENCODED_LEN];
+    uint16_t la = swift_config_encode(a, ea, sizeof(ea));
+    uint16_t lb = swift_config_encode(b, eb, sizeof(eb));
+    return la == lb && memcmp(ea, eb, la) == 0;
+}
+
+// Low-power with a 200ms tick: the tweak saved in the checks below
+static void tweaked_low_power(swift_config_t *cfg)
+{
+    tuning_profile_builtin(SWIFT_PROFILE_LOW_POWER, cfg);
+    cfg->notify_period_ms = 200;
+}
+
+//-----------------------------------------------------------------------------
+// Serialisation
+static bool serialization_checks(uint32_t iterations)
+{
+    printf("== Serialisation ==\n");
+    bool ok = true;
+    uint8_t buf[TUNING_PROFILE_BLOB_MAX];
+    for (int p = 0; p < SWIFT_PROFILE_MAX; p++) {
+        swift_config_t cfg, back;
+        tuning_profile_builtin((swift_profile_t)p, &cfg);
+        uint8_t encoded[SWIFT_CONFIG_ENCODED_LEN];
+        uint16_t encoded_len = swift_config_encode(&cfg, encoded, sizeof(encoded));
+        swift_config_defaults(&back);
+        bool valid = swift_config_parse(encoded, encoded_len, &back, NULL) == SWIFT_CONFIG_OK && same_config(&back, &cfg);
+        uint16_t len = tuning_profile_serialize(&cfg, buf, sizeof(buf));
+        swift_config_defaults(&back);
+        bool round_trip = len == 1 && tuning_profile_deserialize((swift_profile_t)p, buf, len, &back) == ESP_OK
+            && same_config(&back, &cfg);
+        char what[64];
+        snprintf(what, sizeof(what), "%s: valid, stores as 1 byte", tuning_profile_name((swift_profile_t)p));
+        ok &= check(what, valid && round_trip);
+    }
+
+    swift_config_t cfg, back;
+    tweaked_low_power(&cfg);
+    uint16_t len = tuning_profile_serialize(&cfg, buf, sizeof(buf));
+    swift_config_defaults(&back);
+    ok &= check("tweak stores its record only, reads back", len == 1 + 4
+        && tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, buf, len, &back) == ESP_OK && same_config(&back, &cfg));
+    ok &= check("buffer too small", tuning_profile_serialize(&cfg, buf, 4) == 0);
+
+    swift_config_t untouched;
+    swift_config_defaults(&untouched);
+    back = untouched;
+    uint8_t old[8];
+    memcpy(old, buf, len);
+    old[0] = TUNING_PROFILE_VERSION + 1;
+    ok &= check("other version refused", tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, old, len, &back) == ESP_ERR_INVALID_VERSION
+        && same_config(&back, &untouched));
+    ok &= check("truncated record refused", tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, buf, len - 1, &back) == ESP_ERR_INVALID_STATE
+        && same_config(&back, &untouched));
+    const uint8_t other[] = { TUNING_PROFILE_VERSION, SWIFT_CONFIG_PROFILE, 1, SWIFT_PROFILE_LOW_LATENCY };
+    ok &= check("record naming another profile refused", tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, other, sizeof(other), &back) == ESP_ERR_INVALID_STATE
+        && same_config(&back, &untouched));
+    const uint8_t bad_range[] = { TUNING_PROFILE_VERSION, SWIFT_CONFIG_NOTIFY_PERIOD, 2, 1, 0 };
+    ok &= check("out-of-range settings refused", tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, bad_range, sizeof(bad_range), &back) == ESP_ERR_INVALID_STATE
+        && same_config(&back, &untouched));
+    ok &= check("empty record refused", tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, buf, 0, &back) == ESP_ERR_INVALID_VERSION);
+
+    uint64_t start = sim_host_ns();
+    volatile uint32_t sink = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        cfg.notify_period_ms = (uint16_t)(SWIFT_CONFIG_NOTIFY_PERIOD_MIN + i % 1000);
+        len = tuning_profile_serialize(&cfg, buf, sizeof(buf));
+        sink += tuning_profile_deserialize(SWIFT_PROFILE_LOW_POWER, buf, len, &back) == ESP_OK ? back.notify_period_ms : 0;
+    }
+    uint64_t elapsed = sim_host_ns() - start;
+    (void)sink;
+    printf("  serialise + deserialise %27.1f ns avg\n", iterations ? (double)elapsed / iterations : 0.0);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// NVS
+static bool blob_stored(swift_profile_t profile)
+{
+    nvs_handle_t nvs;
+    size_t len = 0;
+    if (nvs_open(TUNING_PROFILE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    bool stored = nvs_get_blob(nvs, tuning_profile_name(profile), NULL, &len) == ESP_OK;
+    nvs_close(nvs);
+    return stored;
+}
+
+static bool nvs_put(const char *key, const uint8_t *value, size_t len)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(TUNING_PROFILE_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return false;
+    }
+    esp_err_t err = len == 1 && strcmp(key, TUNING_PROFILE_KEY_ACTIVE) == 0
+        ? nvs_set_u8(nvs, key, value[0]) : nvs_set_blob(nvs, key, value, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err == ESP_OK;
+}
+
+static int run_nvs_checks(void *arg)
+{
+    (void)arg;
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_nvs_set_file(s_nvs_file);
+    nvs_flash_erase();
+    nvs_flash_init();
+
+    bool ok = true;
+    swift_config_t cfg, expected;
+    tuning_profile_builtin(SWIFT_PROFILE_DEFAULT, &expected);
+    ok &= check("erased flash: default", tuning_profile_load_active(&cfg) == ESP_OK && same_config(&cfg, &expected));
+
+    tuning_profile_builtin(SWIFT_PROFILE_LOW_LATENCY, &expected);
+    ok &= check("select low-latency", tuning_profile_store(&expected, false) == ESP_OK
+        && tuning_profile_load_active(&cfg) == ESP_OK && same_config(&cfg, &expected)
+        && !blob_stored(SWIFT_PROFILE_LOW_LATENCY));
+
+    tweaked_low_power(&expected);
+    ok &= check("save tweaked low-power", tuning_profile_store(&expected, true) == ESP_OK
+        && tuning_profile_load_active(&cfg) == ESP_OK && same_config(&cfg, &expected)
+        && tuning_profile_get(SWIFT_PROFILE_LOW_POWER, &cfg) == ESP_OK && same_config(&cfg, &expected));
+    return ok ? 0 : 1;
+}
+
+static int run_nvs_reload(void *arg)
+{
+    (void)arg;
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_nvs_set_file(s_nvs_file);
+    nvs_flash_init();
+
+    bool ok = true;
+    swift_config_t cfg, expected;
+    tweaked_low_power(&expected);
+    ok &= check("next boot: tweaked low-power", tuning_profile_load_active(&cfg) == ESP_OK && same_config(&cfg, &expected));
+
+    tuning_profile_builtin(SWIFT_PROFILE_LOW_POWER, &expected);
+    ok &= check("save built-in settings: entry erased", tuning_profile_store(&expected, true) == ESP_OK
+        && !blob_stored(SWIFT_PROFILE_LOW_POWER)
+        && tuning_profile_load_active(&cfg) == ESP_OK && same_config(&cfg, &expected));
+
+    const uint8_t old[] = { TUNING_PROFILE_VERSION + 1, SWIFT_CONFIG_NOTIFY_PERIOD, 2, 200, 0 };
+    ok &= check("old record: built-in, error", nvs_put(tuning_profile_name(SWIFT_PROFILE_LOW_POWER), old, sizeof(old))
+        && tuning_profile_load_active(&cfg) == ESP_ERR_INVALID_VERSION && same_config(&cfg, &expected));
+
+    const uint8_t active = SWIFT_PROFILE_MAX;
+    tuning_profile_builtin(SWIFT_PROFILE_DEFAULT, &expected);
+    ok &= check("unknown active id: default, error", nvs_put(TUNING_PROFILE_KEY_ACTIVE, &active, 1)
+        && tuning_profile_load_active(&cfg) == ESP_ERR_INVALID_STATE && same_config(&cfg, &expected));
+
+    nvs_flash_erase();
+    return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Across reboots
+typedef struct {
+    bool seen;
+    uint64_t adv_us;
+    uint64_t nvs_reads;     // by then
+} adv_probe_t;
+
+static sim_event_action_t probe_adv(bool is_gap, int event, void *param, void *ctx)
+{
+    adv_probe_t *probe = ctx;
+    if (is_gap && event == ESP_GAP_BLE_ADV_START_COMPLETE_EVT && !probe->seen) {
+        probe->seen = true;
+        probe->adv_us = sim_now_us();
+        probe->nvs_reads = sim_stats()->nvs_reads;
+    }
+    return SIM_EVENT_DELIVER;
+}
+
+typedef struct {
+    const char *label;
+    swift_profile_t expect_profile;
+    uint16_t expect_period_ms;
+    const uint8_t *write;       // config write for the next boot, NULL: none
+    uint16_t write_len;
+    esp_gatt_status_t write_status;
+} boot_step_t;
+
+static int run_boot(void *arg)
+{
+    const boot_step_t *step = arg;
+    sim_set_log_level(ESP_LOG_ERROR);
+    sim_nvs_set_file(s_nvs_file);
+    sim_set_nvs_cost_us(s_read_us, s_write_us);
+    adv_probe_t probe = { 0 };
+    sim_set_event_filter(probe_adv, &probe);
+    sim_boot();
+    uint64_t boot_reads = sim_stats()->nvs_reads;
+    bench_handles_t h = bench_lookup_handles();
+
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, 247);
+    sim_advance_ms(500);
+    uint8_t read[64];
+    uint16_t read_len = sim_read(0, h.config_char, read, sizeof(read));
+    swift_config_t cfg;
+    swift_config_defaults(&cfg);
+    bool parsed = swift_config_parse(read, read_len, &cfg, NULL) == SWIFT_CONFIG_OK;
+    sim_link_t link = { 0 };
+    sim_link(0, &link);
+
+    const uint32_t duration_ms = 2000;
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    sim_advance_ms(100);
+    sim_stats_reset();
+    sim_advance_ms(duration_ms);
+    uint64_t sent = sim_stats()->notify_sent;
+    uint64_t ticks = duration_ms / step->expect_period_ms;
+
+    printf("  %-22s adv at %7.2f ms  %-14s tick %3u ms  interval %6.2f ms  %4llu notify/s\n", step->label
+        , probe.adv_us / 1000.0, tuning_profile_name((swift_profile_t)cfg.profile), cfg.notify_period_ms
+        , link.params.interval * 1.25, (unsigned long long)(sent * 1000 / duration_ms));
+    bool ok = check("loaded before advertising", probe.seen && probe.nvs_reads == boot_reads);
+    ok &= check("in force: profile and tick", parsed && cfg.profile == step->expect_profile
+        && cfg.notify_period_ms == step->expect_period_ms);
+    ok &= check("in force: connection interval", link.params.interval >= cfg.conn_int_min
+        && link.params.interval <= cfg.conn_int_max);
+    ok &= check("in force: notification rate", sent + 1 >= ticks && sent <= ticks + 1);
+
+    if (step->write != NULL) {
+        sim_stats_reset();
+        sim_write(0, h.config_char, step->write, step->write_len, true);
+        const sim_stats_t *s = sim_stats();
+        const sim_cost_t *c = &s->gatts[ESP_GATTS_WRITE_EVT];
+        printf("  config write: handler %8.1f us, %llu NVS reads, %llu writes, %llu commits\n"
+            , c->count ? (double)c->total_ns / (double)c->count / 1000.0 : 0.0
+            , (unsigned long long)s->nvs_reads, (unsigned long long)s->nvs_writes, (unsigned long long)s->nvs_commits);
+        ok &= check("config write status", sim_last_response_status() == step->write_status);
+    }
+    return ok ? 0 : 1;
+}
+
+// Boot to first advertising, into memory shared with the parent
+static int run_boot_cost(void *arg)
+{
+    adv_probe_t *probe = arg;
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_nvs_set_file(s_nvs_file);
+    sim_set_nvs_cost_us(s_read_us, s_write_us);
+    sim_set_event_filter(probe_adv, probe);
+    sim_boot();
+    return probe->seen ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Read-modify-write
+
+// Sets the one-byte record `type` in an encoded config; false when absent.
+static bool set_record_u8(uint8_t *buf, uint16_t len, uint8_t type, uint8_t value)
+{
+    for (uint16_t pos = 0; pos + 2 <= len; pos += 2 + buf[pos + 1]) {
+        if (buf[pos] == type && buf[pos + 1] == 1) {
+            buf[pos + 2] = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_config(const bench_handles_t *h, uint8_t *buf, uint16_t *len, swift_config_t *cfg)
+{
+    *len = sim_read(0, h->config_char, buf, 64);
+    swift_config_defaults(cfg);
+    return swift_config_parse(buf, *len, cfg, NULL) == SWIFT_CONFIG_OK;
+}
+
+// Writes buf back and reports what it cost on the device.
+static bool write_back(const bench_handles_t *h, const char *label, const uint8_t *buf, uint16_t len
+    , uint64_t expect_commits, bool expect_renegotiation)
+{
+    sim_stats_reset();
+    sim_write(0, h->config_char, buf, len, true);
+    // long enough for a low-power link to finish its updates
+    sim_advance_ms(3000);
+    const sim_stats_t *s = sim_stats();
+    uint64_t updates = s->gap[ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT].count + s->gap[ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT].count;
+    printf("  %-34s %llu NVS writes, %llu commits, %llu link updates\n", label
+        , (unsigned long long)s->nvs_writes, (unsigned long long)s->nvs_commits, (unsigned long long)updates);
+    return sim_last_response_status() == ESP_GATT_OK && s->nvs_commits == expect_commits
+        && (updates > 0) == expect_renegotiation;
+}
+
+static int run_read_modify_write(void *arg)
+{
+    (void)arg;
+    sim_set_log_level(ESP_LOG_ERROR);
+    sim_nvs_set_file(s_nvs_file);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, 247);
+    sim_advance_ms(500);
+
+    uint8_t buf[64];
+    uint16_t len;
+    swift_config_t cfg, expected;
+    bool ok = read_config(&h, buf, &len, &cfg);
+    ok &= check("written back unchanged: no NVS write, no update", write_back(&h, "unchanged", buf, len, 0, false));
+    ok &= check("written back unchanged: same config", read_config(&h, buf, &len, &expected) && same_config(&cfg, &expected));
+
+    // the low-power profile's conn interval differs from the default's, so the link is updated
+    ok &= set_record_u8(buf, len, SWIFT_CONFIG_PROFILE, SWIFT_PROFILE_LOW_POWER);
+    ok &= check("profile byte changed: stored, link updated", write_back(&h, "profile -> low-power", buf, len, 1, true));
+    tuning_profile_builtin(SWIFT_PROFILE_LOW_POWER, &expected);
+    ok &= check("profile byte changed: profile's settings", read_config(&h, buf, &len, &cfg) && same_config(&cfg, &expected));
+
+    ok &= check("low-power written back: no NVS write, no update", write_back(&h, "unchanged", buf, len, 0, false));
+
+    // back to default, with the PHY record changed alongside
+    ok &= set_record_u8(buf, len, SWIFT_CONFIG_PROFILE, SWIFT_PROFILE_DEFAULT);
+    ok &= set_record_u8(buf, len, SWIFT_CONFIG_PHY, 0x03);
+    ok &= check("profile and PHY changed: stored", write_back(&h, "profile -> default, phy 1M|2M", buf, len, 1, true));
+    tuning_profile_builtin(SWIFT_PROFILE_DEFAULT, &expected);
+    expected.phy_mask = 0x03;
+    ok &= check("profile and PHY changed: PHY over profile", read_config(&h, buf, &len, &cfg) && same_config(&cfg, &expected));
+    return ok ? 0 : 1;
+}
+
+static bool reboot_checks(void)
+{
+    printf("== Across reboots: NVS read %u us, write %u us ==\n", s_read_us, s_write_us);
+    // selects low-power, then saves a 200ms tick over it
+    static const uint8_t select_low_power[] = { SWIFT_CONFIG_PROFILE, 1, SWIFT_PROFILE_LOW_POWER };
+    static const uint8_t save_slow_tick[] = { SWIFT_CONFIG_PROFILE, 1, SWIFT_PROFILE_LOW_POWER
+        , SWIFT_CONFIG_NOTIFY_PERIOD, 2, 200, 0, SWIFT_CONFIG_PROFILE_SAVE, 1, SWIFT_PROFILE_LOW_POWER };
+    static const uint8_t select_max[] = { SWIFT_CONFIG_PROFILE, 1, SWIFT_PROFILE_MAX_THROUGHPUT };
+    static const uint8_t mismatched[] = { SWIFT_CONFIG_PROFILE, 1, SWIFT_PROFILE_LOW_LATENCY
+        , SWIFT_CONFIG_PROFILE_SAVE, 1, SWIFT_PROFILE_LOW_POWER };
+    const boot_step_t steps[] = {
+        { "1 erased flash", SWIFT_PROFILE_DEFAULT, 30, select_low_power, sizeof(select_low_power), ESP_GATT_OK },
+        { "2 low-power", SWIFT_PROFILE_LOW_POWER, 100, save_slow_tick, sizeof(save_slow_tick), ESP_GATT_OK },
+        { "3 saved low-power", SWIFT_PROFILE_LOW_POWER, 200, select_max, sizeof(select_max), ESP_GATT_OK },
+        { "4 max-throughput", SWIFT_PROFILE_MAX_THROUGHPUT, 10, mismatched, sizeof(mismatched), ESP_GATT_OUT_OF_RANGE },
+        { "5 max-throughput", SWIFT_PROFILE_MAX_THROUGHPUT, 10, select_low_power, sizeof(select_low_power), ESP_GATT_OK },
+        { "6 saved low-power", SWIFT_PROFILE_LOW_POWER, 200, NULL, 0, ESP_GATT_OK },
+    };
+    remove(s_nvs_file);
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        ok &= check(steps[i].label, bench_run_isolated(run_boot, (void *)&steps[i]) == 0);
+    }
+
+    printf("== Read-modify-write ==\n");
+    remove(s_nvs_file);
+    ok &= check("read-modify-write", bench_run_isolated(run_read_modify_write, NULL) == 0);
+
+    printf("== Boot to advertising ==\n");
+    adv_probe_t *probes = mmap(NULL, 2 * sizeof(adv_probe_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (probes == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    // a stored profile, then an erased flash
+    bool booted = bench_run_isolated(run_boot_cost, &probes[0]) == 0;
+    remove(s_nvs_file);
+    booted &= bench_run_isolated(run_boot_cost, &probes[1]) == 0;
+    const char *labels[] = { "stored profile", "erased flash" };
+    for (int i = 0; i < 2; i++) {
+        printf("  %-22s adv at %7.2f ms  %llu NVS reads\n", labels[i], probes[i].adv_us / 1000.0
+            , (unsigned long long)probes[i].nvs_reads);
+    }
+    int64_t load_us = (int64_t)probes[0].adv_us - (int64_t)probes[1].adv_us;
+    printf("  profile load %38lld us\n", (long long)load_us);
+    // a stored profile reads its id and its settings; an erased flash has no namespace to read
+    ok &= check("boots, profile load costs two NVS reads", booted && probes[0].nvs_reads == 2 && probes[1].nvs_reads == 0
+        && load_us == 2 * (int64_t)s_read_us);
+    munmap(probes, 2 * sizeof(adv_probe_t));
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 1000000;
+    snprintf(s_nvs_file, sizeof(s_nvs_file), "/tmp/bench_profiles_%d.nvs", (int)getpid());
+
+    static const struct option options[] = {
+        { "iterations", required_argument, NULL, 'n' },
+        { "nvs-file", required_argument, NULL, 'f' },
+        { "nvs-read-us", required_argument, NULL, 'r' },
+        { "nvs-write-us", required_argument, NULL, 'w' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:f:r:w:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'f': snprintf(s_nvs_file, sizeof(s_nvs_file), "%s", optarg); break;
+            case 'r': s_read_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': s_write_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--iterations N] [--nvs-file PATH] [--nvs-read-us N] [--nvs-write-us N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (s_read_us > 1000) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    bool ok = serialization_checks(iterations);
+    printf("== NVS ==\n");
+    ok &= check("store and load", bench_run_isolated(run_nvs_checks, NULL) == 0);
+    ok &= check("reload, fall back", bench_run_isolated(run_nvs_reload, NULL) == 0);
+    ok &= reboot_checks();
+    remove(s_nvs_file);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
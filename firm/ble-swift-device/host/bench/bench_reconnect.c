@@ -0,0 +1,381 @@
+// Boot and reconnect benchmark: app_main to advertising, disconnect to the
+// next client's first notification.
+//
+// Timeline: the first-mark-wins, reconnect-reset and per-connection rules
+// of boot_timeline.h, and its report line.
+//
+// Boot: boots with every step costing what it does on the device (NVS,
+// controller and Bluedroid enable, the LEDC setup; --reply-us per stack
+// round trip) and reports when each finished and when advertising started.
+// LEDC is set up beside the Bluetooth bring-up, so advertising must start
+// after the Bluetooth steps and the round trips alone, however long LEDC
+// takes, at the fast interval.
+//
+// Reconnect: a central connects, subscribes, stays --session-ms, drops the
+// link and scans for the device again, --cycles times per scanner model
+// (window/interval; a scan starts at the disconnect, an advertising event
+// inside a window connects). Reports disconnect to advertising again, to
+// connected and to the first notification (avg/p95/max). Built for one
+// central, so advertising stops with every connect, and twice:
+// bench_reconnect advertises fast for CONFIG_SWIFT_ADV_FAST_WINDOW_MS after
+// each disconnect, bench_reconnect_slow at the slow interval only. Left
+// alone past the fast window, advertising must back off to the slow
+// interval, and the next disconnect must bring the fast one back.
+//
+// Each run boots a device of its own in a forked process.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sdkconfig.h"
+#include "boot_timeline.h"
+
+#include "bench_common.h"
+
+#define ADV_UNITS_US(ms)        ((ms) * 8 / 5 * 625u)   // as ADV_INTERVAL() rounds it
+#define FAST_INTERVAL_US        ADV_UNITS_US(CONFIG_SWIFT_ADV_FAST_INTERVAL_MS)
+#define SLOW_INTERVAL_US        ADV_UNITS_US(CONFIG_SWIFT_ADV_SLOW_INTERVAL_MS)
+#define BOOT_TRIPS              4       // REG, CREAT_ATTR_TAB, START, ADV_START
+#define SCAN_TIMEOUT_MS         10000
+#define FIRST_NOTIFY_TIMEOUT_MS 2000
+#define MAX_CYCLES              1000
+
+// Measured on an ESP32-S3 with a cold NVS partition; order of magnitude only.
+static const uint32_t boot_cost_us[SIM_BOOT_STEP_MAX] = {
+    [SIM_BOOT_NVS] = 12000,
+    [SIM_BOOT_CONTROLLER] = 60000,
+    [SIM_BOOT_BLUEDROID] = 90000,
+    [SIM_BOOT_LEDC] = 3000,
+};
+static const char *const boot_step_names[SIM_BOOT_STEP_MAX] = {
+    [SIM_BOOT_NVS] = "nvs",
+    [SIM_BOOT_CONTROLLER] = "controller",
+    [SIM_BOOT_BLUEDROID] = "bluedroid",
+    [SIM_BOOT_LEDC] = "ledc",
+};
+
+typedef struct {
+    const char *name;
+    uint32_t window_us;
+    uint32_t interval_us;
+} scanner_t;
+
+static const scanner_t scanners[] = {
+    { "continuous", 100000, 100000 },
+    { "30/120 ms", 30000, 120000 },
+    { "30/300 ms", 30000, 300000 },
+};
+#define SCANNER_COUNT (sizeof(scanners) / sizeof(scanners[0]))
+
+static uint32_t s_reply_us = 1000;
+static int s_cycles = 40;
+static uint32_t s_session_ms = 300;
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Timeline
+static bool timeline_checks(void)
+{
+    printf("== Timeline ==\n");
+    boot_timeline_t tl;
+    boot_timeline_init(&tl);
+    bool ok = check("unset marks", !boot_timeline_has(&tl, BOOT_MARK_APP_MAIN)
+                    && boot_timeline_between(&tl, BOOT_MARK_APP_MAIN, BOOT_MARK_ADV_STARTED) == -1);
+    ok &= check("first mark wins", boot_timeline_mark(&tl, BOOT_MARK_APP_MAIN, 1000)
+                && !boot_timeline_mark(&tl, BOOT_MARK_APP_MAIN, 2000)
+                && boot_timeline_mark(&tl, BOOT_MARK_ADV_STARTED, 165500)
+                && boot_timeline_between(&tl, BOOT_MARK_APP_MAIN, BOOT_MARK_ADV_STARTED) == 164500);
+
+    ok &= check("connection marks ignored before a connect",
+                !boot_timeline_mark_conn(&tl, BOOT_MARK_SUBSCRIBED, 0, 3000));
+    boot_timeline_disconnect(&tl, 200000);
+    ok &= check("connect marks the first client only", boot_timeline_connect(&tl, 1, 250000)
+                && !boot_timeline_connect(&tl, 2, 260000));
+    ok &= check("other connections ignored", !boot_timeline_mark_conn(&tl, BOOT_MARK_SUBSCRIBED, 2, 270000)
+                && boot_timeline_mark_conn(&tl, BOOT_MARK_SUBSCRIBED, 1, 280000)
+                && boot_timeline_mark_conn(&tl, BOOT_MARK_FIRST_NOTIFY, 1, 290500)
+                && !boot_timeline_mark_conn(&tl, BOOT_MARK_FIRST_NOTIFY, 1, 300000));
+    ok &= check("disconnect to first notify", boot_timeline_between(&tl, BOOT_MARK_DISCONNECT, BOOT_MARK_FIRST_NOTIFY) == 90500);
+
+    char line[BOOT_MARK_MAX * 32];
+    boot_timeline_format(&tl, BOOT_MARK_DISCONNECT, BOOT_MARK_FIRST_NOTIFY, line, sizeof(line));
+    ok &= check("report line", strcmp(line, "disconnect +0.0ms connect +50.0ms subscribed +80.0ms first_notify +90.5ms") == 0);
+    char small[24];
+    size_t len = boot_timeline_format(&tl, BOOT_MARK_DISCONNECT, BOOT_MARK_FIRST_NOTIFY, small, sizeof(small));
+    ok &= check("report line truncated", len == sizeof(small) - 1 && strlen(small) == len);
+
+    boot_timeline_disconnect(&tl, 400000);
+    ok &= check("disconnect starts over", !boot_timeline_has(&tl, BOOT_MARK_CONNECT)
+                && !boot_timeline_has(&tl, BOOT_MARK_FIRST_NOTIFY) && boot_timeline_has(&tl, BOOT_MARK_ADV_STARTED)
+                && boot_timeline_connect(&tl, 2, 410000));
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Boot
+
+// Written by the child that boots, read by the parent ( shared mapping ).
+typedef struct {
+    uint32_t ledc_us;
+    bool advertising;
+    uint64_t adv_us;                            // app_main to ADV_START_COMPLETE
+    uint64_t step_us[SIM_BOOT_STEP_MAX];        // app_main to the step's end
+    uint32_t interval_us;
+} boot_result_t;
+
+static sim_event_action_t boot_filter(bool is_gap, int event, void *param, void *ctx)
+{
+    boot_result_t *r = ctx;
+    if (!r->advertising && is_gap && event == ESP_GAP_BLE_ADV_START_COMPLETE_EVT
+        && ((esp_ble_gap_cb_param_t *)param)->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+        r->advertising = true;
+        r->adv_us = sim_now_us();
+    }
+    return SIM_EVENT_DELIVER;
+}
+
+static int boot_run(void *arg)
+{
+    boot_result_t *r = arg;
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_stack_reply_us(s_reply_us);
+    for (int i = 0; i < SIM_BOOT_STEP_MAX; i++) {
+        sim_set_boot_cost_us((sim_boot_step_t)i, i == SIM_BOOT_LEDC ? r->ledc_us : boot_cost_us[i]);
+    }
+    sim_set_event_filter(boot_filter, r);
+    uint64_t start_us = sim_now_us();
+    sim_boot();
+    r->interval_us = sim_adv_interval_us();
+    // the LED may come up after advertising
+    sim_advance_us(r->ledc_us + 1000);
+    r->adv_us -= start_us;
+    for (int i = 0; i < SIM_BOOT_STEP_MAX; i++) {
+        uint64_t done = sim_boot_step_done_us((sim_boot_step_t)i);
+        r->step_us[i] = done == UINT64_MAX ? UINT64_MAX : done - start_us;
+    }
+    return r->advertising ? 0 : 1;
+}
+
+static bool boot_bench(boot_result_t *r)
+{
+    printf("== Boot: reply %u us per round trip ==\n", s_reply_us);
+    uint64_t bt_us = boot_cost_us[SIM_BOOT_NVS] + boot_cost_us[SIM_BOOT_CONTROLLER] + boot_cost_us[SIM_BOOT_BLUEDROID];
+    uint64_t expect_adv_us = bt_us + (uint64_t)BOOT_TRIPS * s_reply_us;
+    bool ok = true;
+    // the LEDC setup as measured, then longer than the whole Bluetooth bring-up
+    const uint32_t ledc_us[] = { boot_cost_us[SIM_BOOT_LEDC], (uint32_t)bt_us * 2 };
+    for (size_t i = 0; i < sizeof(ledc_us) / sizeof(ledc_us[0]); i++) {
+        memset(r, 0, sizeof(*r));
+        r->ledc_us = ledc_us[i];
+        ok &= check("boots and advertises", bench_run_isolated(boot_run, r) == 0);
+        printf("  ledc %.1f ms:", ledc_us[i] / 1000.0);
+        for (int s = 0; s < SIM_BOOT_STEP_MAX; s++) {
+            printf(" %s +%.1fms", boot_step_names[s], r->step_us[s] / 1000.0);
+        }
+        printf(" adv_started +%.1fms\n", r->adv_us / 1000.0);
+        ok &= check("advertising after the Bluetooth steps and trips only", r->adv_us == expect_adv_us);
+        ok &= check("LEDC set up beside them", r->step_us[SIM_BOOT_LEDC] == ledc_us[i]);
+#if CONFIG_SWIFT_ADV_FAST_WINDOW_MS > 0
+        ok &= check("advertising fast after boot", r->interval_us == FAST_INTERVAL_US);
+#else
+        ok &= check("advertising slow after boot", r->interval_us == SLOW_INTERVAL_US);
+#endif
+    }
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Reconnect
+
+typedef struct {
+    uint32_t adv_us;        // disconnect to advertising again ( 0: it never stopped )
+    uint32_t connect_us;    // disconnect to connected
+    uint32_t notify_us;     // disconnect to the first notification
+} cycle_t;
+
+typedef struct {
+    int scanner;
+    bool ok;
+    int reconnects;
+    bool fast_after_disconnect;
+    bool slow_after_window;
+    bool fast_again;
+    cycle_t cycles[MAX_CYCLES];
+} reconnect_result_t;
+
+static uint64_t s_adv_started_us;
+static uint32_t s_notify_count;
+
+static sim_event_action_t reconnect_filter(bool is_gap, int event, void *param, void *ctx)
+{
+    if (is_gap && event == ESP_GAP_BLE_ADV_START_COMPLETE_EVT
+        && ((esp_ble_gap_cb_param_t *)param)->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+        s_adv_started_us = sim_now_us();
+    }
+    return SIM_EVENT_DELIVER;
+}
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    s_notify_count++;
+}
+
+// Connects by scanning, subscribes and waits for the first notification.
+static bool session_start(const bench_handles_t *h, uint64_t *connected_us, uint64_t *notified_us)
+{
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    if (!sim_connect_scanned(0, bda, SCAN_TIMEOUT_MS)) {
+        return false;
+    }
+    *connected_us = sim_now_us();
+    sim_set_mtu(0, 247);
+    s_notify_count = 0;
+    sim_write(0, h->cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    while (s_notify_count == 0 && sim_now_us() - *connected_us < FIRST_NOTIFY_TIMEOUT_MS * 1000ull) {
+        sim_advance_us(250);
+    }
+    *notified_us = sim_now_us();
+    return s_notify_count > 0;
+}
+
+static int reconnect_run(void *arg)
+{
+    reconnect_result_t *r = arg;
+    const scanner_t *scanner = &scanners[r->scanner];
+    sim_set_log_level(ESP_LOG_NONE);
+    sim_set_stack_reply_us(s_reply_us);
+    sim_set_notify_hook(on_notify, NULL);
+    sim_set_event_filter(reconnect_filter, NULL);
+    sim_set_scanner(scanner->window_us, scanner->interval_us);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+
+    uint64_t connected_us, notified_us;
+    r->ok = session_start(&h, &connected_us, &notified_us);
+    for (int i = 0; r->ok && i < s_cycles; i++) {
+        sim_advance_us(s_session_ms * 1000ull);
+        uint64_t disconnect_us = sim_now_us();
+        bool advertising = sim_is_advertising();
+        sim_disconnect(0);
+        if (i == 0) {
+            r->fast_after_disconnect = CONFIG_SWIFT_ADV_FAST_WINDOW_MS > 0
+                ? sim_adv_interval_us() == FAST_INTERVAL_US || !sim_is_advertising()
+                : true;
+        }
+        if (!session_start(&h, &connected_us, &notified_us)) {
+            break;
+        }
+        cycle_t *c = &r->cycles[i];
+        c->adv_us = advertising ? 0 : (uint32_t)(s_adv_started_us - disconnect_us);
+        c->connect_us = (uint32_t)(connected_us - disconnect_us);
+        c->notify_us = (uint32_t)(notified_us - disconnect_us);
+        r->reconnects++;
+    }
+
+    // nobody back within the fast window: advertising backs off, and the
+    // next disconnect brings the fast interval back
+    sim_disconnect(0);
+    sim_advance_us((CONFIG_SWIFT_ADV_FAST_WINDOW_MS + 1000) * 1000ull);
+    r->slow_after_window = sim_is_advertising() && sim_adv_interval_us() == SLOW_INTERVAL_US;
+    r->fast_again = session_start(&h, &connected_us, &notified_us);
+    sim_disconnect(0);
+    sim_advance_us(s_reply_us * 4ull);
+    r->fast_again &= sim_is_advertising()
+        && sim_adv_interval_us() == (CONFIG_SWIFT_ADV_FAST_WINDOW_MS > 0 ? FAST_INTERVAL_US : SLOW_INTERVAL_US);
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// avg / p95 / max of one cycle_t field, in ms
+static void print_stat(const char *what, const reconnect_result_t *r, size_t offset)
+{
+    static uint32_t values[MAX_CYCLES];
+    uint64_t sum = 0;
+    for (int i = 0; i < r->reconnects; i++) {
+        values[i] = *(const uint32_t *)((const uint8_t *)&r->cycles[i] + offset);
+        sum += values[i];
+    }
+    qsort(values, r->reconnects, sizeof(values[0]), cmp_u32);
+    int p95 = (r->reconnects * 95 + 99) / 100 - 1;
+    printf("  %-28s %10.1f %10.1f %10.1f\n", what, (double)sum / r->reconnects / 1000.0
+           , values[p95 < 0 ? 0 : p95] / 1000.0, values[r->reconnects - 1] / 1000.0);
+}
+
+static bool reconnect_bench(reconnect_result_t *r)
+{
+    printf("== Reconnect: %s advertising, %d cycles, %u ms sessions ==\n"
+           , CONFIG_SWIFT_ADV_FAST_WINDOW_MS > 0 ? "fast burst" : "slow only", s_cycles, s_session_ms);
+    bool ok = true;
+    for (size_t s = 0; s < SCANNER_COUNT; s++) {
+        memset(r, 0, sizeof(*r));
+        r->scanner = (int)s;
+        bool ran = bench_run_isolated(reconnect_run, r) == 0;
+        printf("-- scanner %s --\n", scanners[s].name);
+        if (r->reconnects > 0) {
+            printf("  %-28s %10s %10s %10s\n", "ms from disconnect", "avg", "p95", "max");
+            print_stat("advertising again", r, offsetof(cycle_t, adv_us));
+            print_stat("connected", r, offsetof(cycle_t, connect_us));
+            print_stat("first notification", r, offsetof(cycle_t, notify_us));
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "every cycle reconnects ( %d/%d )", r->reconnects, s_cycles);
+        ok &= check(what, ran && r->ok && r->reconnects == s_cycles);
+        ok &= check("fast after a disconnect", r->fast_after_disconnect);
+        ok &= check("slow once the fast window closes", r->slow_after_window);
+        ok &= check("next disconnect restarts the fast window", r->fast_again);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        { "reply-us", required_argument, NULL, 'r' },
+        { "cycles", required_argument, NULL, 'n' },
+        { "session-ms", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:n:s:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'r': s_reply_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': s_cycles = atoi(optarg); break;
+            case 's': s_session_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--reply-us US] [--cycles N] [--session-ms MS]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (s_cycles < 1 || s_cycles > MAX_CYCLES || s_reply_us > 1000000) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    // shared with the forked runs
+    void *shared = mmap(NULL, sizeof(reconnect_result_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    bool ok = timeline_checks();
+    ok &= boot_bench(shared);
+    ok &= reconnect_bench(shared);
+    munmap(shared, sizeof(reconnect_result_t));
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
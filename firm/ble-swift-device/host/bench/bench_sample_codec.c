@@ -0,0 +1,240 @@
+// Sample codec benchmark for main/sample_codec.c.
+//
+// Round trip: every codec encodes traces of the kind the sample sources
+// produce (sawtooth, slow sine with noise, ADC noise floor, square wave,
+// 12- and 16-bit random) into buffers of random size; whatever the encoder
+// says fit must decode back to the same samples and consume exactly the
+// bytes written. Truncated and corrupted input must be refused, never read
+// past its end.
+//
+// Speed and size: encodes and decodes each trace --samples samples at a time
+// in runs as a notification of --mtu would carry them, and reports bytes per
+// sample, the ratio against one 10-byte frame per sample and ns per sample;
+// the decoded runs must match the trace.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "sample_codec.h"
+
+#include "bench_common.h"
+
+#define TRACE_LEN   4096
+#define TRACE_COUNT 6
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 32);
+}
+
+static const char *const trace_names[TRACE_COUNT] = {
+    "sawtooth (synthetic)", "slow sine + noise", "ADC noise floor", "square", "12-bit random", "16-bit random",
+};
+
+static void make_trace(int kind, uint16_t *out, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        switch (kind) {
+            case 0: out[i] = (uint16_t)(i & 0xFFF); break;
+            case 1: out[i] = (uint16_t)(2048 + 1500 * sin(i * 0.01) + (int)(rng_next() % 9) - 4); break;
+            case 2: out[i] = (uint16_t)(1200 + (int)(rng_next() % 5) - 2); break;
+            case 3: out[i] = (i / 64) % 2 ? 3000 : 500; break;
+            case 4: out[i] = (uint16_t)(rng_next() & 0xFFF); break;
+            default: out[i] = (uint16_t)rng_next(); break;
+        }
+    }
+}
+
+static bool check(const char *what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Round trip
+static bool round_trip(uint32_t iterations)
+{
+    printf("== Round trip: %u runs per codec and trace ==\n", iterations);
+    static uint16_t trace[TRACE_LEN], decoded[TRACE_LEN];
+    uint8_t buf[600];
+    bool ok = true;
+    for (int codec = SAMPLE_CODEC_VARINT; codec < SAMPLE_CODEC_MAX; codec++) {
+        uint32_t mismatches = 0;
+        uint64_t samples = 0;
+        for (int kind = 0; kind < TRACE_COUNT; kind++) {
+            make_trace(kind, trace, TRACE_LEN);
+            for (uint32_t it = 0; it < iterations; it++) {
+                uint16_t first = (uint16_t)(rng_next() % (TRACE_LEN - 1));
+                uint16_t n = (uint16_t)(rng_next() % (TRACE_LEN - first));
+                uint16_t cap = (uint16_t)(rng_next() % sizeof(buf));
+                uint16_t prev = first > 0 ? trace[first - 1] : (uint16_t)rng_next();
+                uint16_t count;
+                uint16_t len = sample_codec_encode((sample_codec_t)codec, prev, trace + first, n, buf, cap, &count);
+                if (len > cap || count > n) {
+                    mismatches++;
+                    continue;
+                }
+                if (count == 0) {
+                    continue;
+                }
+                uint16_t used = sample_codec_decode((sample_codec_t)codec, prev, buf, len, decoded, count);
+                mismatches += used != len || memcmp(decoded, trace + first, count * sizeof(uint16_t)) != 0;
+                // one byte short is never enough
+                mismatches += sample_codec_decode((sample_codec_t)codec, prev, buf, len - 1, decoded, count) != 0;
+                samples += count;
+            }
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "%s: %llu samples", sample_codec_str((sample_codec_t)codec),
+                 (unsigned long long)samples);
+        ok &= check(what, mismatches == 0);
+    }
+
+    // edge cases: full-scale swings, nothing fits, malformed input
+    const uint16_t swing[] = { 0xFFFF, 0x0000, 0x8000, 0x7FFF, 0x0001, 0xFFFE };
+    uint16_t out[8];
+    uint16_t count;
+    bool edges = true;
+    for (int codec = SAMPLE_CODEC_VARINT; codec < SAMPLE_CODEC_MAX; codec++) {
+        uint16_t len = sample_codec_encode((sample_codec_t)codec, 0, swing, 6, buf, sizeof(buf), &count);
+        edges &= count == 6 && sample_codec_decode((sample_codec_t)codec, 0, buf, len, out, 6) == len
+            && memcmp(out, swing, sizeof(swing)) == 0;
+        edges &= sample_codec_encode((sample_codec_t)codec, 0, swing, 6, buf, 0, &count) == 0 && count == 0;
+    }
+    ok &= check("full-scale deltas round-trip, zero cap writes nothing", edges);
+
+    const uint8_t overlong[] = { 0x80, 0x80, 0x80, 0x01 };   // 22-bit varint
+    const uint8_t too_wide[] = { 17, 0xFF, 0xFF, 0xFF };      // width above 16
+    ok &= check("malformed input refused",
+                sample_codec_decode(SAMPLE_CODEC_VARINT, 0, overlong, sizeof(overlong), out, 1) == 0
+                && sample_codec_decode(SAMPLE_CODEC_BITPACK, 0, too_wide, sizeof(too_wide), out, 1) == 0
+                && sample_codec_decode(SAMPLE_CODEC_NONE, 0, too_wide, sizeof(too_wide), out, 1) == 0
+                && sample_codec_decode(SAMPLE_CODEC_VARINT, 0, NULL, 4, out, 1) == 0);
+
+    uint8_t header[SAMPLE_RUN_HEADER_LEN];
+    sample_run_t run = { .codec = SAMPLE_CODEC_BITPACK, .count = 200, .period_us = 62500 }, back;
+    sample_run_encode_header(&run, header);
+    bool headers = sample_run_decode_header(header, sizeof(header), &back)
+        && back.codec == run.codec && back.count == run.count && back.period_us == run.period_us
+        && !sample_run_decode_header(header, sizeof(header) - 1, &back);
+    header[0] = SAMPLE_CODEC_NONE;
+    headers &= !sample_run_decode_header(header, sizeof(header), &back);
+    header[0] = SAMPLE_CODEC_MAX;
+    headers &= !sample_run_decode_header(header, sizeof(header), &back);
+    ok &= check("run header round-trips, short and unknown refused", headers);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// Speed and size
+static bool speed(uint32_t samples, uint16_t mtu)
+{
+    // what a notification has left for the codec behind the frame and run header
+    uint16_t cap = (uint16_t)(mtu - 3 - FRAME_LEN - SAMPLE_RUN_HEADER_LEN);
+    printf("== Speed and size: %u samples per trace, %u-byte runs (MTU %u) ==\n", samples, cap, mtu);
+    printf("  %-22s %-14s %10s %8s %10s %10s\n", "trace", "codec", "bytes/smp", "ratio", "enc ns", "dec ns");
+
+    uint16_t *trace = malloc(samples * sizeof(uint16_t));
+    uint16_t *decoded = malloc(samples * sizeof(uint16_t));
+    uint8_t *coded = malloc((size_t)samples * 3 + 1024);
+    uint16_t *run_len = malloc(samples * sizeof(uint16_t));
+    uint16_t *run_count = malloc(samples * sizeof(uint16_t));
+    bool ok = true;
+    for (int kind = 0; kind < TRACE_COUNT; kind++) {
+        make_trace(kind, trace, samples);
+        for (int codec = SAMPLE_CODEC_VARINT; codec < SAMPLE_CODEC_MAX; codec++) {
+            // the firmware's runs: a first sample in the frame, up to 255 coded behind it
+            uint32_t runs = 0, pos = 0;
+            size_t bytes = 0;
+            uint64_t t0 = sim_host_ns();
+            while (pos < samples) {
+                uint32_t rest = samples - pos - 1;
+                if (rest > SAMPLE_RUN_COUNT_MAX) {
+                    rest = SAMPLE_RUN_COUNT_MAX;
+                }
+                uint16_t count;
+                run_len[runs] = sample_codec_encode((sample_codec_t)codec, trace[pos], trace + pos + 1, (uint16_t)rest,
+                                                    coded + bytes, cap, &count);
+                run_count[runs++] = count;
+                bytes += run_len[runs - 1];
+                pos += 1 + count;
+            }
+            uint64_t t1 = sim_host_ns();
+
+            bool same = true;
+            size_t off = 0;
+            pos = 0;
+            uint64_t t2 = sim_host_ns();
+            for (uint32_t r = 0; r < runs; r++) {
+                decoded[pos] = trace[pos];
+                if (run_count[r] > 0) {
+                    same &= sample_codec_decode((sample_codec_t)codec, decoded[pos], coded + off, run_len[r],
+                                                decoded + pos + 1, run_count[r]) == run_len[r];
+                }
+                off += run_len[r];
+                pos += 1 + run_count[r];
+            }
+            uint64_t t3 = sim_host_ns();
+            same &= memcmp(decoded, trace, samples * sizeof(uint16_t)) == 0;
+            ok &= same;
+
+            // on air: the frame and run header per run, then the codec's bytes
+            double per_sample = (double)(bytes + (size_t)runs * (FRAME_LEN + SAMPLE_RUN_HEADER_LEN)) / samples;
+            printf("  %-22s %-14s %10.2f %7.1fx %10.2f %10.2f%s\n",
+                   codec == SAMPLE_CODEC_VARINT ? trace_names[kind] : "",
+                   sample_codec_str((sample_codec_t)codec), per_sample, FRAME_LEN / per_sample,
+                   (double)(t1 - t0) / samples, (double)(t3 - t2) / samples, same ? "" : "  MISMATCH");
+        }
+    }
+    free(trace);
+    free(decoded);
+    free(coded);
+    free(run_len);
+    free(run_count);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = 4000000;
+    uint32_t iterations = 20000;
+    uint16_t mtu = 247;
+
+    static const struct option options[] = {
+        { "samples", required_argument, NULL, 'n' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "mtu", required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:i:m:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint16_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [--samples N] [--iterations N] [--mtu 23..517]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (samples == 0 || mtu < 23 || mtu > 517) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    bool ok = round_trip(iterations);
+    ok &= speed(samples, mtu);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
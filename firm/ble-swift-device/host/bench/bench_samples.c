@@ -0,0 +1,365 @@
+// Sample pipeline benchmark: sample source -> sample block -> frames -> notify.
+//
+// --clients subscribed centrals at --mtu receive the device's sample stream
+// for --duration-s of virtual time. Every frame carries one sample; the
+// central checks that each client's samples follow the source's sequence
+// and counts the ones it missed, and reports the sample rate, the age of a
+// sample when it goes on air, and the host time the device spent per
+// delivered sample.
+//
+// Built twice: bench_samples against the synthetic source (sample n is
+// n & 0xFFF) and bench_samples_replay against the replay source, which is
+// first sent a recorded sequence through the blob characteristic.
+//
+// The stream is measured once per sample codec: first one sample per frame,
+// then, after client 0 selects the codec through the config characteristic,
+// as delta coded sample runs (see sample_codec.h), which the central decodes.
+//
+// When the link carries more frames per notify tick than the source
+// produces, every sample must reach every client in order, with none dropped
+// or skipped on the device; a codec only adds samples per notification, so
+// the same holds for it. Otherwise the bench only reports.
+//
+// Last, client 0 sets the low-power profile's 100 ms notify period, longer
+// than a sample block: the device must cap it, so that no handed-over block
+// is overwritten before the notify path reads it.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "blob_rx.h"
+#include "frame.h"
+#include "notify_packer.h"
+#include "sample_codec.h"
+#include "sample_source.h"
+#include "swift_config.h"
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+#define MAX_CLIENTS 9
+#define REPLAY_LEN 100
+
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+#define SOURCE_NAME "replay"
+#else
+#define SOURCE_NAME "synthetic"
+#endif
+
+typedef struct {
+    bool started;
+    uint16_t last;          // last sample (synthetic) or its replay index
+    uint32_t last_ts_ms;
+    uint64_t samples;
+    uint64_t missed;        // sequence jumps, in samples
+    uint64_t out_of_order;  // timestamps going backwards
+    uint64_t bad_frames;
+    uint64_t runs;          // SAMPLE_RUN notifications
+    uint64_t age_ms_sum;
+    uint32_t age_ms_max;
+} client_t;
+
+static client_t s_clients[MAX_CLIENTS];
+static uint16_t s_notify_handle;
+static bool s_measuring;
+
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+static int16_t s_replay_index[SAMPLE_SYNTH_MASK + 1]; // replay value -> index, -1 when unused
+
+// Distinct 12-bit values: 37 is odd, so i -> 37 i + 11 is a permutation mod 4096.
+static uint16_t replay_value(uint16_t i)
+{
+    return (uint16_t)((i * 37u + 11u) & SAMPLE_SYNTH_MASK);
+}
+#endif
+
+// Position of a sample in the source's sequence and the sequence length;
+// false when the source never produces it.
+static bool sample_position(uint16_t value, uint16_t *pos, uint32_t *len)
+{
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+    if (value > SAMPLE_SYNTH_MASK || s_replay_index[value] < 0) {
+        return false;
+    }
+    *pos = (uint16_t)s_replay_index[value];
+    *len = REPLAY_LEN;
+#else
+    if (value > SAMPLE_SYNTH_MASK) {
+        return false;
+    }
+    *pos = value;
+    *len = SAMPLE_SYNTH_MASK + 1;
+#endif
+    return true;
+}
+
+static void on_sample(client_t *c, uint16_t value, uint32_t timestamp_ms, uint32_t now_ms)
+{
+    uint16_t pos;
+    uint32_t seq_len;
+    if (!sample_position(value, &pos, &seq_len)) {
+        c->bad_frames += s_measuring;
+        return;
+    }
+    if (s_measuring && c->started) {
+        uint32_t step = (pos + seq_len - c->last) % seq_len;
+        c->missed += step == 0 ? seq_len - 1 : step - 1;
+        c->out_of_order += timestamp_ms < c->last_ts_ms;
+        c->samples++;
+        uint32_t age = now_ms - timestamp_ms;
+        c->age_ms_sum += age;
+        if (age > c->age_ms_max) {
+            c->age_ms_max = age;
+        }
+    }
+    c->started = true;
+    c->last = pos;
+    c->last_ts_ms = timestamp_ms;
+}
+
+static void on_notify(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, void *ctx)
+{
+    if (handle != s_notify_handle || conn_id >= MAX_CLIENTS) {
+        return;
+    }
+    client_t *c = &s_clients[conn_id];
+    uint32_t now_ms = (uint32_t)(sim_now_us() / 1000);
+    frame_t frame;
+    if (len >= FRAME_LEN && value[2] == FRAME_TYPE_SAMPLE_RUN) {
+        // one run per notification: the frame's sample, then the coded ones
+        sample_run_t run;
+        uint16_t samples[SAMPLE_RUN_COUNT_MAX + 1];
+        if (!frame_decode(value, len, &frame) || frame.payload_len != 2
+            || !sample_run_decode_header(value + FRAME_LEN, len - FRAME_LEN, &run)) {
+            c->bad_frames += s_measuring;
+            return;
+        }
+        samples[0] = (uint16_t)(frame.payload[0] | (frame.payload[1] << 8));
+        uint16_t coded_len = len - FRAME_LEN - SAMPLE_RUN_HEADER_LEN;
+        if (run.count > 0 && sample_codec_decode((sample_codec_t)run.codec, samples[0], value + FRAME_LEN + SAMPLE_RUN_HEADER_LEN,
+                                                 coded_len, samples + 1, run.count) != coded_len) {
+            c->bad_frames += s_measuring;
+            return;
+        }
+        for (uint16_t i = 0; i <= run.count; i++) {
+            // sample times in ms, from the first one's and the period in us
+            on_sample(c, samples[i], frame.timestamp_ms + (uint32_t)((uint64_t)i * run.period_us / 1000), now_ms);
+        }
+        c->runs += s_measuring;
+        return;
+    }
+    for (uint16_t off = 0; off + FRAME_LEN <= len; off += FRAME_LEN) {
+        if (!frame_decode(value + off, FRAME_LEN, &frame) || frame.payload_len != 2) {
+            c->bad_frames += s_measuring;
+            continue;
+        }
+        on_sample(c, (uint16_t)(frame.payload[0] | (frame.payload[1] << 8)), frame.timestamp_ms, now_ms);
+    }
+}
+
+static bool read_counters(uint16_t handle, uint32_t *counters)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 64];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len < TELEMETRY_HEADER_LEN || buf[0] != TELEMETRY_VERSION || buf[1] < TELEMETRY_COUNTER_MAX
+        || len < TELEMETRY_HEADER_LEN + 4 * buf[1]) {
+        return false;
+    }
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        const uint8_t *p = buf + TELEMETRY_HEADER_LEN + 4 * i;
+        counters[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return true;
+}
+
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+// Sends the replay sequence as one chunked upload from client 0.
+static void upload_replay(uint16_t handle)
+{
+    uint8_t chunk[BLOB_CHUNK_HEADER_LEN + SAMPLE_REPLAY_HEADER_LEN + 2 * REPLAY_LEN];
+    uint8_t *record = chunk + BLOB_CHUNK_HEADER_LEN;
+    blob_chunk_encode_header(BLOB_CHUNK_FIRST | BLOB_CHUNK_LAST, 0, chunk);
+    sample_replay_encode_header(REPLAY_LEN, record);
+    memset(s_replay_index, 0xFF, sizeof(s_replay_index));
+    for (uint16_t i = 0; i < REPLAY_LEN; i++) {
+        uint16_t v = replay_value(i);
+        record[SAMPLE_REPLAY_HEADER_LEN + 2 * i] = (uint8_t)v;
+        record[SAMPLE_REPLAY_HEADER_LEN + 2 * i + 1] = (uint8_t)(v >> 8);
+        s_replay_index[v] = (int16_t)i;
+    }
+    sim_write(0, handle, chunk, sizeof(chunk), false);
+}
+#endif
+
+// Selects the codec from client 0 and measures every client's stream with it.
+static bool measure(sample_codec_t codec, const bench_handles_t *h, int clients, uint16_t mtu, uint32_t duration_s)
+{
+    const uint8_t select[] = { SWIFT_CONFIG_SAMPLE_CODEC, 1, (uint8_t)codec };
+    sim_write(0, h->config_char, select, sizeof(select), true);
+    if (sim_last_response_status() != ESP_GATT_OK) {
+        printf("%s: codec not accepted\nFAILED\n", sample_codec_str(codec));
+        return false;
+    }
+    // let the links settle
+    sim_advance_ms(1000);
+    memset(s_clients, 0, sizeof(s_clients));
+
+    uint32_t before[TELEMETRY_COUNTER_MAX], after[TELEMETRY_COUNTER_MAX];
+    bool ok = read_counters(h->telemetry_char, before);
+    sim_stats_reset();
+    s_measuring = true;
+    uint64_t host_start_ns = sim_host_ns();
+    sim_advance_ms(duration_s * 1000);
+    uint64_t host_ns = sim_host_ns() - host_start_ns;
+    s_measuring = false;
+    ok &= read_counters(h->telemetry_char, after);
+    const sim_stats_t s = *sim_stats();
+    if (!ok) {
+        printf("telemetry not readable\nFAILED\n");
+        return false;
+    }
+
+    uint32_t produced = after[TELEMETRY_SAMPLES_PRODUCED] - before[TELEMETRY_SAMPLES_PRODUCED];
+    uint32_t dropped = after[TELEMETRY_SAMPLES_DROPPED] - before[TELEMETRY_SAMPLES_DROPPED];
+    uint32_t skipped = after[TELEMETRY_SAMPLES_SKIPPED] - before[TELEMETRY_SAMPLES_SKIPPED];
+    // frames the link may carry per client and tick against samples produced per tick
+    uint32_t frames_per_tick = notify_frames_per_packet(mtu, FRAME_LEN) * CONFIG_SWIFT_NOTIFY_BURST;
+    swift_config_t cfg;
+    swift_config_defaults(&cfg);
+    double samples_per_tick = CONFIG_SWIFT_SAMPLE_RATE_HZ * cfg.notify_period_ms / 1000.0;
+    bool feasible = frames_per_tick > 2 * samples_per_tick;
+
+    printf("== Samples (%s source, %d Hz, %d per block, codec %s): %d clients, MTU %u, %u s virtual ==\n",
+           SOURCE_NAME, CONFIG_SWIFT_SAMPLE_RATE_HZ, CONFIG_SWIFT_SAMPLE_BLOCK_LEN,
+           sample_codec_str(codec), clients, mtu, duration_s);
+    printf("  device       produced %8.1f samples/s   dropped %u   skipped %u   (%u frames/tick/client of %.1f samples/tick)%s\n",
+           (double)produced / duration_s, dropped, skipped, frames_per_tick, samples_per_tick,
+           feasible ? "" : ", link too slow for the rate");
+    uint64_t delivered = 0;
+    bool stream_ok = true;
+    for (int i = 0; i < clients; i++) {
+        const client_t *c = &s_clients[i];
+        delivered += c->samples;
+        printf("  client %d     %8.1f samples/s   missed %llu   age avg %5.1f ms  max %u ms   bad %llu  out of order %llu\n",
+               i, (double)c->samples / duration_s, (unsigned long long)c->missed,
+               c->samples ? (double)c->age_ms_sum / c->samples : 0.0, c->age_ms_max,
+               (unsigned long long)c->bad_frames, (unsigned long long)c->out_of_order);
+        stream_ok &= c->samples > 0 && c->bad_frames == 0 && c->out_of_order == 0
+            && (codec == SAMPLE_CODEC_NONE) == (c->runs == 0);
+        if (feasible) {
+            stream_ok &= c->missed == 0 && c->samples + CONFIG_SWIFT_SAMPLE_BLOCK_LEN >= 0.95 * produced;
+        }
+    }
+    printf("  link         %8.1f notify/s   %8.1f bytes/s   %5.2f bytes/sample\n",
+           (double)s.notify_sent / duration_s, (double)s.notify_bytes / duration_s,
+           delivered ? (double)s.notify_bytes / delivered : 0.0);
+    printf("  host         %6.1f ns per delivered sample (whole simulation)\n",
+           delivered ? (double)host_ns / delivered : 0.0);
+
+    bool device_ok = produced > 0.95 * CONFIG_SWIFT_SAMPLE_RATE_HZ * duration_s;
+    if (feasible) {
+        device_ok &= dropped == 0 && skipped == 0;
+    }
+    if (!device_ok) {
+        printf("  MISMATCH: device lost samples\n");
+    }
+    if (!stream_ok) {
+        printf("  MISMATCH: client streams\n");
+    }
+    return device_ok && stream_ok;
+}
+
+// Notify period longer than a block: no block may be overwritten unread.
+static bool measure_long_period(const bench_handles_t *h)
+{
+    const uint16_t period_ms = 100;
+    const uint8_t write[] = { SWIFT_CONFIG_NOTIFY_PERIOD, 2, (uint8_t)period_ms, (uint8_t)(period_ms >> 8) };
+    sim_write(0, h->config_char, write, sizeof(write), true);
+    if (sim_last_response_status() != ESP_GATT_OK) {
+        printf("notify period not accepted\nFAILED\n");
+        return false;
+    }
+    sim_advance_ms(1000);
+    uint32_t before[TELEMETRY_COUNTER_MAX], after[TELEMETRY_COUNTER_MAX];
+    bool ok = read_counters(h->telemetry_char, before);
+    sim_advance_ms(3000);
+    ok &= read_counters(h->telemetry_char, after);
+    if (!ok) {
+        printf("telemetry not readable\nFAILED\n");
+        return false;
+    }
+    uint32_t overwritten = after[TELEMETRY_SAMPLE_BLOCKS_OVERWRITTEN] - before[TELEMETRY_SAMPLE_BLOCKS_OVERWRITTEN];
+    uint32_t dropped = after[TELEMETRY_SAMPLES_DROPPED] - before[TELEMETRY_SAMPLES_DROPPED];
+    printf("== Notify period %u ms, %d ms blocks: %u blocks overwritten, %u samples dropped ==\n",
+           period_ms, CONFIG_SWIFT_SAMPLE_BLOCK_LEN * 1000 / CONFIG_SWIFT_SAMPLE_RATE_HZ, overwritten, dropped);
+    if (overwritten != 0 || dropped != 0) {
+        printf("  MISMATCH: blocks overwritten unread\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int clients = 2;
+    uint16_t mtu = 247;
+    uint32_t duration_s = 5;
+
+    static const struct option options[] = {
+        { "clients", required_argument, NULL, 'c' },
+        { "mtu", required_argument, NULL, 'm' },
+        { "duration-s", required_argument, NULL, 'd' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:m:d:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': clients = atoi(optarg); break;
+            case 'm': mtu = (uint16_t)atoi(optarg); break;
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--clients N<=%d] [--mtu 23..517] [--duration-s N]\n", argv[0], MAX_CLIENTS);
+                return 2;
+        }
+    }
+    if (clients < 1 || clients > MAX_CLIENTS || mtu < 23 || duration_s == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    // air time model: the link, not the controller's buffer count, sets the ceiling
+    sim_set_link_model(10, 0);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    s_notify_handle = h.notify_char;
+    sim_set_notify_hook(on_notify, NULL);
+    for (int i = 0; i < clients; i++) {
+        esp_bd_addr_t bda;
+        bench_bda(bda, (uint16_t)i);
+        sim_connect((uint16_t)i, bda);
+        sim_set_mtu((uint16_t)i, mtu);
+        sim_write((uint16_t)i, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    }
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+    upload_replay(h.blob_char);
+#endif
+    if (h.config_char == 0) {
+        printf("config characteristic not found\nFAILED\n");
+        return 1;
+    }
+    // let the connections and the source start
+    sim_advance_ms(2000);
+
+    bool ok = true;
+    for (int codec = SAMPLE_CODEC_NONE; codec < SAMPLE_CODEC_MAX; codec++) {
+        ok &= measure((sample_codec_t)codec, &h, clients, mtu, duration_s);
+    }
+    ok &= measure_long_period(&h);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Producer/consumer stress benchmark for main/spsc_ring.c.
+//
+// A producer thread pushes --frames sequence-numbered write frames through the
+// ring while a consumer thread pops them and checks that every frame arrives
+// exactly once and in order. The same traffic is then pushed through a
+// lock-protected FreeRTOS queue (the simulator's xQueueSend/xQueueReceive) for
+// comparison. A final lossy run mimics the firmware: the producer never waits,
+// so a slow consumer shows up in the dropped counter instead of stalling.
+//
+// Exits non-zero if any frame is lost, duplicated or reordered.
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "spsc_ring.h"
+
+#include "bench_common.h"
+
+typedef struct {
+    uint32_t seq;
+    uint8_t payload[8];
+} frame_t;
+
+typedef struct {
+    spsc_ring_t ring;
+    QueueHandle_t queue;
+    bool use_queue;
+    bool lossy;
+    uint32_t frames;
+    atomic_bool producer_done;
+    uint32_t received;
+    uint32_t errors;
+    uint32_t consumer_delay_spins;
+} stress_t;
+
+static bool push(stress_t *st, const frame_t *f)
+{
+    return st->use_queue ? xQueueSend(st->queue, f, 0) == pdPASS : spsc_ring_push(&st->ring, f);
+}
+
+static bool pop(stress_t *st, frame_t *f)
+{
+    return st->use_queue ? xQueueReceive(st->queue, f, 0) == pdTRUE : spsc_ring_pop(&st->ring, f);
+}
+
+static void *producer(void *arg)
+{
+    stress_t *st = arg;
+    frame_t f;
+    memset(&f, 0, sizeof(f));
+    for (uint32_t i = 0; i < st->frames; i++) {
+        f.seq = i;
+        f.payload[0] = (uint8_t)i;
+        while (!push(st, &f)) {
+            if (st->lossy) {
+                break;
+            }
+            sched_yield();
+        }
+    }
+    atomic_store(&st->producer_done, true);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    stress_t *st = arg;
+    frame_t f;
+    int64_t last = -1;
+    for (;;) {
+        if (pop(st, &f)) {
+            bool ok = st->lossy ? (int64_t)f.seq > last : (int64_t)f.seq == last + 1;
+            if (!ok || f.payload[0] != (uint8_t)f.seq) {
+                st->errors++;
+            }
+            last = f.seq;
+            st->received++;
+            for (volatile uint32_t spin = 0; spin < st->consumer_delay_spins; spin++) {
+            }
+        } else if (!atomic_load(&st->producer_done)) {
+            sched_yield();
+        } else {
+            if (!pop(st, &f)) {
+                break;
+            }
+            // raced with the final push; account for it
+            st->received++;
+            if ((int64_t)f.seq <= last) {
+                st->errors++;
+            }
+            last = f.seq;
+        }
+    }
+    return NULL;
+}
+
+static bool run(const char *name, stress_t *st, uint32_t capacity)
+{
+    static frame_t storage[4096];
+    if (st->use_queue) {
+        st->queue = xQueueCreate(capacity, sizeof(frame_t));
+    } else {
+        spsc_ring_init(&st->ring, storage, sizeof(frame_t), capacity);
+    }
+    atomic_store(&st->producer_done, false);
+    st->received = 0;
+    st->errors = 0;
+
+    pthread_t prod, cons;
+    uint64_t t0 = sim_host_ns();
+    pthread_create(&cons, NULL, consumer, st);
+    pthread_create(&prod, NULL, producer, st);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    uint64_t t1 = sim_host_ns();
+
+    double secs = (double)(t1 - t0) / 1e9;
+    printf("  %-22s %10u frames  %8.2f Mframes/s  %6.1f ns/frame  errors=%u",
+           name, st->received, (double)st->received / secs / 1e6,
+           (double)(t1 - t0) / (double)(st->received ? st->received : 1), st->errors);
+    if (!st->use_queue) {
+        printf("  dropped=%u high_water=%u/%u",
+               (unsigned)atomic_load(&st->ring.dropped), (unsigned)atomic_load(&st->ring.high_water), capacity);
+    }
+    printf("\n");
+
+    bool ok = st->errors == 0
+        && (st->lossy || st->received == st->frames)
+        && (st->use_queue || st->lossy
+            || atomic_load(&st->ring.pushed) == atomic_load(&st->ring.popped));
+    if (st->lossy && !st->use_queue) {
+        ok = ok && st->received + atomic_load(&st->ring.dropped) == st->frames;
+    }
+    if (st->use_queue) {
+        vQueueDelete(st->queue);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = 10000000;
+    uint32_t capacity = 32;
+
+    static const struct option options[] = {
+        { "frames", required_argument, NULL, 'n' },
+        { "capacity", required_argument, NULL, 'c' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:c:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': frames = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'c': capacity = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--frames N] [--capacity POW2<=4096]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (capacity < 2 || capacity > 4096 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "capacity must be a power of two in [2, 4096]\n");
+        return 2;
+    }
+
+    printf("== SPSC ring stress: %u frames, capacity %u ==\n", frames, capacity);
+    bool ok = true;
+
+    stress_t st;
+    memset(&st, 0, sizeof(st));
+    st.frames = frames;
+    ok &= run("spsc_ring (lossless)", &st, capacity);
+
+    memset(&st, 0, sizeof(st));
+    st.frames = frames;
+    st.use_queue = true;
+    ok &= run("locked queue", &st, capacity);
+
+    memset(&st, 0, sizeof(st));
+    st.frames = frames / 10;
+    st.lossy = true;
+    st.consumer_delay_spins = 200;
+    ok &= run("spsc_ring (lossy)", &st, capacity);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+// Telemetry characteristic benchmark.
+//
+// Runs the app's steady state (notifications on, a write every
+// --write-interval-ms) and reads the telemetry characteristic before and
+// after, the way the app would. The device-side counter deltas must agree
+// with what the simulated central saw: notifications on air, writes delivered
+// and applied. The read is done at MTU 23 as well, which takes several ATT
+// Read Blob requests; the parts must come from one snapshot.
+//
+// Handler-time histograms are measured on the virtual clock here, where
+// handlers take no time, so only their counts are meaningful; the host cost
+// of the handlers is reported by bench_throughput. The instrumentation itself
+// is timed in a tight loop.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+#include "bench_common.h"
+
+typedef struct {
+    uint32_t uptime_ms;
+    uint32_t counters[TELEMETRY_COUNTER_MAX];
+    uint32_t hist_count[TELEMETRY_HIST_MAX];
+    uint32_t hist_sum_us[TELEMETRY_HIST_MAX];
+    uint32_t hist_max_us[TELEMETRY_HIST_MAX];
+    uint32_t buckets[TELEMETRY_HIST_MAX][TELEMETRY_HIST_BUCKETS];
+} snapshot_t;
+
+static const char *counter_names[TELEMETRY_COUNTER_MAX] = {
+    "notify sent", "notify bytes", "notify refused", "notify confirmed", "notify failed",
+    "congest events", "writes received", "write bytes", "writes dropped", "writes applied",
+    "connects", "disconnects", "write seq gaps", "writes reordered", "writes duplicate",
+    "writes invalid", "blobs completed", "blob bytes", "blob rejected", "led patterns",
+    "led pattern errors", "notify ticks dropped", "samples produced", "samples dropped",
+    "samples skipped", "blocks overwritten",
+};
+
+static const char *hist_names[TELEMETRY_HIST_MAX] = {
+    "gatts handler", "gap handler", "notify fan-out", "write latency", "notify lag",
+};
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Decodes what the app would, honouring the counts in the header.
+static bool decode(const uint8_t *buf, uint16_t len, snapshot_t *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+    if (len < TELEMETRY_HEADER_LEN || buf[0] != TELEMETRY_VERSION) {
+        return false;
+    }
+    uint8_t counters = buf[1], hists = buf[2], buckets = buf[3];
+    if (len != TELEMETRY_HEADER_LEN + 4 * counters + hists * 4 * (3 + buckets)) {
+        return false;
+    }
+    snap->uptime_ms = get_u32(buf + 4);
+    const uint8_t *p = buf + TELEMETRY_HEADER_LEN;
+    for (int i = 0; i < counters; i++, p += 4) {
+        if (i < TELEMETRY_COUNTER_MAX) {
+            snap->counters[i] = get_u32(p);
+        }
+    }
+    for (int h = 0; h < hists; h++) {
+        bool known = h < TELEMETRY_HIST_MAX;
+        if (known) {
+            snap->hist_count[h] = get_u32(p);
+            snap->hist_sum_us[h] = get_u32(p + 4);
+            snap->hist_max_us[h] = get_u32(p + 8);
+        }
+        p += 12;
+        for (int i = 0; i < buckets; i++, p += 4) {
+            if (known && i < TELEMETRY_HIST_BUCKETS) {
+                snap->buckets[h][i] = get_u32(p);
+            }
+        }
+    }
+    return true;
+}
+
+static bool read_snapshot(uint16_t handle, snapshot_t *snap, uint16_t *len_out)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 16];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len_out != NULL) {
+        *len_out = len;
+    }
+    return decode(buf, len, snap);
+}
+
+// Upper bound of the bucket holding the percentile, from bucket deltas.
+static uint32_t percentile_us(const uint32_t *buckets, uint32_t count, uint32_t percentile)
+{
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = ((uint64_t)count * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return i == 0 ? 0 : (uint32_t)1 << i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static bool check(const char *what, uint64_t device, uint64_t central)
+{
+    bool ok = device == central;
+    printf("  %-26s device %10llu   central %10llu   %s\n", what,
+           (unsigned long long)device, (unsigned long long)central, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration_s = 10;
+    uint32_t write_interval_ms = 30;
+    uint32_t mtu = 247;
+    uint32_t iterations = 10000000;
+
+    static const struct option options[] = {
+        { "duration-s", required_argument, NULL, 'd' },
+        { "write-interval-ms", required_argument, NULL, 'w' },
+        { "mtu", required_argument, NULL, 'm' },
+        { "iterations", required_argument, NULL, 'n' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:w:m:n:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': write_interval_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': iterations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--duration-s N] [--write-interval-ms N] [--mtu N] [--iterations N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (duration_s == 0 || write_interval_ms == 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+
+    sim_set_log_level(ESP_LOG_WARN);
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    if (h.telemetry_char == 0) {
+        printf("telemetry characteristic not found\nFAILED\n");
+        return 1;
+    }
+
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    sim_advance_ms(1000);
+
+    // the central's view covers the first read but not the second, like the device's deltas
+    bool ok = true;
+    snapshot_t before, after;
+    uint16_t len = 0;
+    sim_stats_reset();
+    if (!read_snapshot(h.telemetry_char, &before, &len)) {
+        printf("telemetry read failed or malformed (%u bytes)\nFAILED\n", len);
+        return 1;
+    }
+
+    uint64_t end_us = sim_now_us() + (uint64_t)duration_s * 1000000;
+    uint16_t counter = 0;
+    while (sim_now_us() < end_us) {
+        uint8_t data[10] = { (uint8_t)counter, (uint8_t)(counter >> 8) };
+        counter++;
+        sim_write(0, h.write_char, data, sizeof(data), false);
+        sim_advance_ms(write_interval_ms);
+    }
+    const sim_stats_t central = *sim_stats();
+    const sim_stats_t *s = &central;
+    ok &= read_snapshot(h.telemetry_char, &after, &len);
+
+    uint32_t d[TELEMETRY_COUNTER_MAX];
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        d[i] = after.counters[i] - before.counters[i];
+    }
+    double secs = (after.uptime_ms - before.uptime_ms) / 1000.0;
+
+    printf("== Telemetry: %u bytes per read, %.1f s between reads, MTU %u ==\n", len, secs, mtu);
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        printf("  %-18s %10u  %10.1f/s\n", counter_names[i], d[i], secs > 0 ? d[i] / secs : 0.0);
+    }
+    for (int i = 0; i < TELEMETRY_HIST_MAX; i++) {
+        uint32_t buckets[TELEMETRY_HIST_BUCKETS];
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+            buckets[b] = after.buckets[i][b] - before.buckets[i][b];
+        }
+        uint32_t n = after.hist_count[i] - before.hist_count[i];
+        uint32_t sum = after.hist_sum_us[i] - before.hist_sum_us[i];
+        printf("  %-18s n=%-8u avg=%6.1fus p50<=%uus p99<=%uus max=%uus\n", hist_names[i], n,
+               n ? (double)sum / n : 0.0, percentile_us(buckets, n, 50), percentile_us(buckets, n, 99),
+               after.hist_max_us[i]);
+    }
+
+    printf("== Device vs central ==\n");
+    ok &= check("notify confirmed", d[TELEMETRY_NOTIFY_CONFIRMED], s->notify_sent);
+    ok &= check("writes received", d[TELEMETRY_WRITES_RECEIVED], s->writes_delivered);
+    ok &= check("writes applied", d[TELEMETRY_WRITES_APPLIED], s->led_updates);
+    ok &= check("write latency samples", after.hist_count[TELEMETRY_HIST_WRITE_LATENCY] - before.hist_count[TELEMETRY_HIST_WRITE_LATENCY], s->led_updates);
+    uint64_t gatts_events = 0;
+    for (int i = 0; i < SIM_GATTS_EVT_MAX; i++) {
+        gatts_events += s->gatts[i].count;
+    }
+    ok &= check("gatts handler samples", after.hist_count[TELEMETRY_HIST_GATTS] - before.hist_count[TELEMETRY_HIST_GATTS], gatts_events);
+    ok &= d[TELEMETRY_NOTIFY_FAILED] == 0 && d[TELEMETRY_WRITES_DROPPED] == 0;
+
+    // a long read at the minimum MTU must still decode as one snapshot
+    sim_disconnect(0);
+    sim_connect(0, bda);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+    sim_advance_ms(100);
+    snapshot_t small;
+    bool small_ok = read_snapshot(h.telemetry_char, &small, &len);
+    printf("  read at MTU 23             %u bytes in %u requests   %s\n",
+           len, (len + 21) / 22, small_ok ? "ok" : "MALFORMED");
+    ok &= small_ok && small.counters[TELEMETRY_CONNECTS] == after.counters[TELEMETRY_CONNECTS] + 1;
+
+    // instrumentation cost on the host
+    static telemetry_t tel;
+    telemetry_reset(&tel);
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        telemetry_count(&tel, TELEMETRY_NOTIFY_SENT, 1);
+    }
+    uint64_t t1 = sim_host_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        telemetry_hist_add(&tel, TELEMETRY_HIST_GATTS, i & 0x3FFF);
+    }
+    uint64_t t2 = sim_host_ns();
+    uint8_t buf[TELEMETRY_ENCODED_LEN];
+    uint32_t encodes = iterations / 100 + 1;
+    for (uint32_t i = 0; i < encodes; i++) {
+        telemetry_encode(&tel, i, buf, sizeof(buf));
+    }
+    uint64_t t3 = sim_host_ns();
+    printf("== Instrumentation cost (host) ==\n");
+    printf("  telemetry_count            %8.2f ns\n", iterations ? (double)(t1 - t0) / iterations : 0.0);
+    printf("  telemetry_hist_add         %8.2f ns\n", iterations ? (double)(t2 - t1) / iterations : 0.0);
+    printf("  telemetry_encode           %8.1f ns\n", (double)(t3 - t2) / encodes);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+// Throughput benchmark for main/ble-swift-device.c on the host simulation.
+//
+// Phase 1 plays the app's steady state: one central, notifications enabled,
+// a 10-byte write every --write-interval-ms, for --duration-s of virtual time.
+// Rates are per virtual second, i.e. what the device would achieve on air.
+//
+// bench_throughput_bulk runs the same scenario against the firmware built with
+// CONFIG_SWIFT_NOTIFY_BULK, for comparison with the fixed 10-byte payload.
+//
+// Phase 2 floods the write characteristic with --flood writes without letting
+// virtual time advance, measuring how fast the GATTS handler itself runs.
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_common.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--duration-s N] [--write-interval-ms N] [--mtu N] [--flood N] [--verbose]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration_s = 10;
+    uint32_t write_interval_ms = 30;
+    uint32_t mtu = 247;
+    uint32_t flood = 1000000;
+    bool verbose = false;
+
+    static const struct option options[] = {
+        { "duration-s", required_argument, NULL, 'd' },
+        { "write-interval-ms", required_argument, NULL, 'w' },
+        { "mtu", required_argument, NULL, 'm' },
+        { "flood", required_argument, NULL, 'f' },
+        { "verbose", no_argument, NULL, 'v' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:w:m:f:v", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': write_interval_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'f': flood = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'v': verbose = true; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (duration_s == 0 || write_interval_ms == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    sim_set_log_level(verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+    sim_boot();
+
+    bench_handles_t h = bench_lookup_handles();
+    if (h.notify_char == 0 || h.cccd == 0 || h.write_char == 0) {
+        fprintf(stderr, "service setup incomplete: notify=%u cccd=%u write=%u\n",
+                h.notify_char, h.cccd, h.write_char);
+        return 1;
+    }
+
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    if (!sim_connect(0, bda)) {
+        fprintf(stderr, "device is not advertising\n");
+        return 1;
+    }
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+
+    //-------------------------------------------------------------------------
+    // Phase 1: steady state
+    sim_stats_reset();
+    uint64_t start_us = sim_now_us();
+    uint64_t end_us = start_us + (uint64_t)duration_s * 1000000;
+    uint16_t counter = 0;
+    while (sim_now_us() < end_us) {
+        uint8_t data[10] = { (uint8_t)counter, (uint8_t)(counter >> 8) };
+        counter++;
+        sim_write(0, h.write_char, data, sizeof(data), false);
+        sim_advance_ms(write_interval_ms);
+    }
+    double secs = (double)(sim_now_us() - start_us) / 1e6;
+    const sim_stats_t *s = sim_stats();
+
+    printf("== Steady state: %.1f s virtual, write every %u ms, MTU %u ==\n",
+           secs, write_interval_ms, mtu);
+    printf("  notifications/sec        %10.1f\n", (double)s->notify_sent / secs);
+    printf("  notify payload bytes/sec %10.1f\n", (double)s->notify_bytes / secs);
+    printf("  avg notify payload       %10.1f  bytes (MTU-3 = %u)\n",
+           s->notify_sent ? (double)s->notify_bytes / (double)s->notify_sent : 0.0,
+           sim_negotiated_mtu(0) - 3);
+    printf("  frames/sec               %10.1f  (10-byte frames)\n", (double)s->notify_bytes / 10.0 / secs);
+    printf("  notify failures          %10llu\n", (unsigned long long)s->notify_failed);
+    printf("  writes received/sec      %10.1f\n", (double)s->writes_delivered / secs);
+    printf("  writes applied/sec       %10.1f  (LED updates)\n", (double)s->led_updates / secs);
+    printf("  writes lost              %10lld\n", (long long)(s->writes_delivered - s->led_updates));
+    bench_print_costs(s);
+
+    // The firmware logs its write-to-actuation latency histogram on disconnect
+    printf("Device-side write latency (virtual time):\n");
+    sim_set_log_level(ESP_LOG_INFO);
+    sim_disconnect(0);
+    sim_set_log_level(verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+    sim_connect(0, bda);
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_write(0, h.cccd, BENCH_CCCD_ENABLE, sizeof(BENCH_CCCD_ENABLE), true);
+
+    //-------------------------------------------------------------------------
+    // Phase 2: write flood
+    sim_stats_reset();
+    uint64_t t0 = sim_host_ns();
+    for (uint32_t i = 0; i < flood; i++) {
+        uint8_t data[10] = { (uint8_t)i, (uint8_t)(i >> 8) };
+        sim_write(0, h.write_char, data, sizeof(data), false);
+    }
+    uint64_t t1 = sim_host_ns();
+    sim_advance_ms(100);
+    s = sim_stats();
+
+    double host_secs = (double)(t1 - t0) / 1e9;
+    printf("== Write flood: %u writes ==\n", flood);
+    printf("  writes/sec (host)        %10.0f\n", host_secs > 0 ? (double)flood / host_secs : 0.0);
+    printf("  writes applied           %10llu\n", (unsigned long long)s->led_updates);
+    bench_print_costs(s);
+
+    sim_write(0, h.cccd, BENCH_CCCD_DISABLE, sizeof(BENCH_CCCD_DISABLE), true);
+    sim_disconnect(0);
+    return 0;
+}
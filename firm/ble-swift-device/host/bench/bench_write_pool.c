@@ -0,0 +1,386 @@
+// Write buffer pool benchmark for main/write_pool.c.
+//
+// Copies: runs the write hand-off of the previous firmware (stack copy,
+// padded header copy, frame-by-value ring push and pop) and the pooled one
+// (one copy into a claimed buffer, handle through the ring, applied in place)
+// over the same writes. It counts copies and bytes moved per write, and
+// times both with a producer and a consumer thread. The old path only
+// carried a single 10-byte frame; longer writes show the pooled path alone.
+//
+// End to end: a central writes single frames, legacy counter-only values,
+// multi-frame values up to the MTU and one malformed value. Every valid write
+// must be applied frame by frame (one LED update per frame) with nothing
+// dropped, and the malformed one must be refused with an attribute length error.
+//
+// Exits non-zero on any mismatch.
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+#include "write_pool.h"
+
+#include "bench_common.h"
+
+#define RING_LEN    32
+#define BUF_LEN     512
+#define MAX_DUTY    34
+
+typedef struct {
+    uint64_t copies;        // copies of the write value
+    uint64_t bytes;         // every byte moved, handles included
+} copy_count_t;
+
+static void counted_copy(copy_count_t *c, void *dst, const void *src, size_t len)
+{
+    memcpy(dst, src, len);
+    c->copies++;
+    c->bytes += len;
+}
+
+// The ring copies an item that holds the value.
+static void counted_ring_copy(copy_count_t *c, size_t item_size)
+{
+    c->copies++;
+    c->bytes += item_size;
+}
+
+// The ring copies a handle; the value stays put.
+static void counted_handle_move(copy_count_t *c, size_t handle_size)
+{
+    c->bytes += handle_size;
+}
+
+//-----------------------------------------------------------------------------
+// Previous path: the value is copied into a frame on the stack (plus a padded
+// copy for the header check) and the frame travels through the ring by value.
+typedef struct {
+    int64_t rx_time_us;
+    uint8_t len;
+    uint8_t data[FRAME_LEN];
+} legacy_frame_t;
+
+static spsc_ring_t s_legacy_ring;
+static legacy_frame_t s_legacy_storage[RING_LEN];
+
+static bool legacy_produce(copy_count_t *c, const uint8_t *value, uint16_t len)
+{
+    if (len > FRAME_LEN) {
+        return false;
+    }
+    // counted only once the write is through, as a retry would redo it all
+    copy_count_t attempt = {0};
+    uint8_t padded[FRAME_LEN] = {0};
+    counted_copy(&attempt, padded, value, len);
+    frame_t header;
+    frame_decode(padded, FRAME_LEN, &header);
+
+    legacy_frame_t frame = {0};
+    frame.len = (uint8_t)len;
+    counted_copy(&attempt, frame.data, value, len);
+    if (!spsc_ring_push(&s_legacy_ring, &frame)) {
+        return false;
+    }
+    counted_ring_copy(&attempt, sizeof(frame));
+    c->copies += attempt.copies;
+    c->bytes += attempt.bytes;
+    return true;
+}
+
+static bool legacy_consume(copy_count_t *c, uint32_t *applied)
+{
+    legacy_frame_t frame;
+    if (!spsc_ring_pop(&s_legacy_ring, &frame)) {
+        return false;
+    }
+    counted_ring_copy(c, sizeof(frame));
+    *applied += (uint32_t)(frame.data[0] | (frame.data[1] << 8)) % MAX_DUTY;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Pooled path: what the firmware does now.
+static write_pool_t s_pool;
+static _Alignas(8) uint8_t s_pool_storage[RING_LEN * WRITE_POOL_SLOT_SIZE(BUF_LEN)];
+static write_buf_handle_t s_pool_free[RING_LEN];
+static spsc_ring_t s_handle_ring;
+static write_buf_handle_t s_handle_storage[RING_LEN];
+
+static bool pool_produce(copy_count_t *c, const uint8_t *value, uint16_t len)
+{
+    write_buf_handle_t handle = write_pool_claim(&s_pool);
+    if (handle == WRITE_BUF_NONE) {
+        return false;
+    }
+    write_buf_t *buf = write_pool_buf(&s_pool, handle);
+    counted_copy(c, buf->data, value, len);
+    buf->len = len;
+    for (uint16_t off = 0; off + FRAME_LEN <= len; off += FRAME_LEN) {
+        frame_t header;
+        frame_decode(buf->data + off, FRAME_LEN, &header);
+    }
+    spsc_ring_push(&s_handle_ring, &handle);
+    counted_handle_move(c, sizeof(handle));
+    return true;
+}
+
+static bool pool_consume(copy_count_t *c, uint32_t *applied)
+{
+    write_buf_handle_t handle;
+    if (!spsc_ring_pop(&s_handle_ring, &handle)) {
+        return false;
+    }
+    counted_handle_move(c, sizeof(handle));
+    const write_buf_t *buf = write_pool_buf(&s_pool, handle);
+    for (uint16_t off = 0; off + FRAME_LEN <= buf->len; off += FRAME_LEN) {
+        *applied += (uint32_t)(buf->data[off] | (buf->data[off + 1] << 8)) % MAX_DUTY;
+    }
+    write_pool_release(&s_pool, handle);
+    // the free ring carries the handle back (push here, pop in the next claim)
+    counted_handle_move(c, 2 * sizeof(handle));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+typedef struct {
+    bool pooled;
+    uint16_t len;
+    uint32_t writes;
+    atomic_bool producer_done;
+    copy_count_t produce_copies;
+    copy_count_t consume_copies;
+    uint32_t consumed;
+    uint32_t applied;
+} run_t;
+
+static bool produce(run_t *r, const uint8_t *value)
+{
+    return r->pooled ? pool_produce(&r->produce_copies, value, r->len) : legacy_produce(&r->produce_copies, value, r->len);
+}
+
+static bool consume(run_t *r)
+{
+    return r->pooled ? pool_consume(&r->consume_copies, &r->applied) : legacy_consume(&r->consume_copies, &r->applied);
+}
+
+static void *producer(void *arg)
+{
+    run_t *r = arg;
+    uint8_t value[BUF_LEN];
+    memset(value, 0, sizeof(value));
+    for (uint32_t i = 0; i < r->writes; i++) {
+        value[0] = (uint8_t)i;
+        value[1] = (uint8_t)(i >> 8);
+        while (!produce(r, value)) {
+            sched_yield();
+        }
+    }
+    atomic_store(&r->producer_done, true);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    run_t *r = arg;
+    for (;;) {
+        if (consume(r)) {
+            r->consumed++;
+        } else if (!atomic_load(&r->producer_done)) {
+            sched_yield();
+        } else if (consume(r)) {
+            r->consumed++;
+        } else {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static bool copies_run(bool pooled, uint16_t len, uint32_t writes)
+{
+    run_t r;
+    memset(&r, 0, sizeof(r));
+    r.pooled = pooled;
+    r.len = len;
+    r.writes = writes;
+    spsc_ring_init(&s_legacy_ring, s_legacy_storage, sizeof(legacy_frame_t), RING_LEN);
+    write_pool_init(&s_pool, s_pool_storage, BUF_LEN, s_pool_free, RING_LEN);
+    spsc_ring_init(&s_handle_ring, s_handle_storage, sizeof(write_buf_handle_t), RING_LEN);
+
+    pthread_t prod, cons;
+    uint64_t t0 = sim_host_ns();
+    pthread_create(&cons, NULL, consumer, &r);
+    pthread_create(&prod, NULL, producer, &r);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    uint64_t t1 = sim_host_ns();
+
+    double n = r.consumed ? (double)r.consumed : 1.0;
+    uint64_t copies = r.produce_copies.copies + r.consume_copies.copies;
+    uint64_t bytes = r.produce_copies.bytes + r.consume_copies.bytes;
+    printf("  %-7s %4u bytes  %4.1f value copies/write  %7.1f bytes moved/write  %6.1f ns/write\n",
+           pooled ? "pooled" : "legacy", len, (double)copies / n, (double)bytes / n, (double)(t1 - t0) / n);
+
+    bool ok = r.consumed == writes;
+    if (pooled) {
+        ok = ok && write_pool_in_use(&s_pool) == 0
+            && atomic_load(&s_pool.claimed) == writes;
+    }
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+static bool read_counters(uint16_t handle, uint32_t *counters)
+{
+    uint8_t buf[TELEMETRY_ENCODED_LEN + 64];
+    uint16_t len = sim_read(0, handle, buf, sizeof(buf));
+    if (len < TELEMETRY_HEADER_LEN || buf[0] != TELEMETRY_VERSION || buf[1] < TELEMETRY_COUNTER_MAX
+        || len < TELEMETRY_HEADER_LEN + 4 * buf[1]) {
+        return false;
+    }
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        const uint8_t *p = buf + TELEMETRY_HEADER_LEN + 4 * i;
+        counters[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return true;
+}
+
+// Writes frames_per_write frames with consecutive sequences from *seq.
+static void write_frames(uint16_t handle, uint16_t frames_per_write, uint16_t *seq)
+{
+    uint8_t value[BUF_LEN];
+    for (uint16_t i = 0; i < frames_per_write; i++) {
+        frame_t frame = {
+            .seq = (*seq)++,
+            .type = FRAME_TYPE_DATA,
+            .timestamp_ms = (uint32_t)(sim_now_us() / 1000) + 1,
+        };
+        frame_encode(&frame, value + i * FRAME_LEN);
+    }
+    sim_write(0, handle, value, (uint16_t)(frames_per_write * FRAME_LEN), false);
+    sim_advance_ms(30);
+}
+
+static bool end_to_end(uint32_t mtu)
+{
+    sim_boot();
+    bench_handles_t h = bench_lookup_handles();
+    if (h.telemetry_char == 0) {
+        printf("telemetry characteristic not found\n");
+        return false;
+    }
+    esp_bd_addr_t bda;
+    bench_bda(bda, 0);
+    sim_connect(0, bda);
+    sim_set_mtu(0, (uint16_t)mtu);
+    sim_advance_ms(100);
+
+    uint32_t before[TELEMETRY_COUNTER_MAX], after[TELEMETRY_COUNTER_MAX];
+    bool ok = read_counters(h.telemetry_char, before);
+    sim_stats_reset();
+
+    uint16_t max_frames = (uint16_t)((mtu - 3 < BUF_LEN ? mtu - 3 : BUF_LEN) / FRAME_LEN);
+    static const uint16_t sizes[] = { 1, 2, 5, 24 };
+    uint16_t seq = 0;
+    uint32_t writes = 0;
+    uint32_t frames = 0;
+    for (int round = 0; round < 50; round++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            uint16_t n = sizes[i] < max_frames ? sizes[i] : max_frames;
+            write_frames(h.write_char, n, &seq);
+            writes++;
+            frames += n;
+        }
+        write_frames(h.write_char, max_frames, &seq);
+        writes++;
+        frames += max_frames;
+
+        // a legacy client: just the counter
+        uint8_t legacy[2] = { (uint8_t)seq, (uint8_t)(seq >> 8) };
+        seq++;
+        sim_write(0, h.write_char, legacy, sizeof(legacy), false);
+        sim_advance_ms(30);
+        writes++;
+        frames++;
+    }
+    uint16_t last_seq = (uint16_t)(seq - 1);
+
+    uint8_t malformed[FRAME_LEN + 5] = {0};
+    sim_write(0, h.write_char, malformed, sizeof(malformed), true);
+    esp_gatt_status_t malformed_status = sim_last_response_status();
+    sim_advance_ms(100);
+    const sim_stats_t central = *sim_stats();
+    ok &= read_counters(h.telemetry_char, after);
+
+    uint32_t d[TELEMETRY_COUNTER_MAX];
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        d[i] = after[i] - before[i];
+    }
+    uint32_t duty = last_seq % (2 * MAX_DUTY);
+    if (duty >= MAX_DUTY) {
+        duty = 2 * MAX_DUTY - duty - 1;
+    }
+    uint32_t expected_led = 8191 - (duty * 8191) / MAX_DUTY;
+
+    printf("== End to end: MTU %u, up to %u frames (%u bytes) per write ==\n", mtu, max_frames, max_frames * FRAME_LEN);
+    printf("  writes received %u/%u  applied %u/%u  dropped %u  invalid %u/1  seq gaps %u\n",
+           d[TELEMETRY_WRITES_RECEIVED], writes + 1, d[TELEMETRY_WRITES_APPLIED], writes,
+           d[TELEMETRY_WRITES_DROPPED], d[TELEMETRY_WRITES_INVALID], d[TELEMETRY_WRITE_SEQ_GAPS]);
+    printf("  frames applied %llu/%u  LED duty %u (expected %u)  malformed write status 0x%02x\n",
+           (unsigned long long)central.led_updates, frames, sim_led_duty(0), expected_led, malformed_status);
+
+    ok &= d[TELEMETRY_WRITES_RECEIVED] == writes + 1
+        && d[TELEMETRY_WRITES_APPLIED] == writes
+        && d[TELEMETRY_WRITES_DROPPED] == 0
+        && d[TELEMETRY_WRITES_INVALID] == 1
+        && d[TELEMETRY_WRITE_SEQ_GAPS] == 0
+        && central.led_updates == frames
+        && sim_led_duty(0) == expected_led
+        && malformed_status == ESP_GATT_INVALID_ATTR_LEN;
+    sim_disconnect(0);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t writes = 2000000;
+    uint32_t mtu = 517;
+
+    static const struct option options[] = {
+        { "writes", required_argument, NULL, 'n' },
+        { "mtu", required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:m:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': writes = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': mtu = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [--writes N] [--mtu 23..517]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (mtu < 23 || mtu > 517) {
+        fprintf(stderr, "mtu must be in [23, 517]\n");
+        return 2;
+    }
+
+    bool ok = true;
+    printf("== Write hand-off: %u writes, ring %u ==\n", writes, RING_LEN);
+    ok &= copies_run(false, FRAME_LEN, writes);
+    ok &= copies_run(true, FRAME_LEN, writes);
+    ok &= copies_run(true, 100, writes);
+    ok &= copies_run(true, 510, writes / 4);
+
+    sim_set_log_level(ESP_LOG_WARN);
+    ok &= end_to_end(mtu);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
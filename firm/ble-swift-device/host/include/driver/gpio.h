@@ -0,0 +1,6 @@
+// Host stand-in for ESP-IDF driver/gpio.h
+#pragma once
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
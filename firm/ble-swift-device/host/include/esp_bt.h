@@ -0,0 +1,21 @@
+// Host stand-in for ESP-IDF esp_bt.h
+#pragma once
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+typedef enum {
+    ESP_BT_MODE_IDLE = 0x00,
+    ESP_BT_MODE_BLE = 0x01,
+    ESP_BT_MODE_CLASSIC_BT = 0x02,
+    ESP_BT_MODE_BTDM = 0x03,
+} esp_bt_mode_t;
+
+typedef struct {
+    uint16_t magic;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { .magic = 0x5A5A }
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
@@ -0,0 +1,7 @@
+// Host stand-in for ESP-IDF esp_bt_main.h
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_enable(void);
@@ -0,0 +1,7 @@
+// Host stand-in for ESP-IDF esp_timer.h
+#pragma once
+
+#include <stdint.h>
+
+// Microseconds since boot on the simulator's virtual clock
+int64_t esp_timer_get_time(void);
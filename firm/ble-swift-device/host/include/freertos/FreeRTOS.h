@@ -0,0 +1,25 @@
+// Host stand-in for the FreeRTOS kernel headers shipped with ESP-IDF
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE         ((BaseType_t)0)
+#define pdTRUE          ((BaseType_t)1)
+#define pdFAIL          pdFALSE
+#define pdPASS          pdTRUE
+#define errQUEUE_EMPTY  ((BaseType_t)0)
+#define errQUEUE_FULL   ((BaseType_t)0)
+
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+
+// The simulator runs a 1 kHz tick (CONFIG_FREERTOS_HZ=1000)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) \
+    ((TickType_t)(((uint64_t)(xTimeInMs) * (uint64_t)configTICK_RATE_HZ) / (uint64_t)1000U))
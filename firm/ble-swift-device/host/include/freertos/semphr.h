@@ -0,0 +1,11 @@
+// Host stand-in for FreeRTOS semphr.h (mutexes only)
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_mutex *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
@@ -0,0 +1,32 @@
+// Host stand-in for FreeRTOS task.h
+//
+// Tasks are host threads. They block only in the calls below, and the
+// simulator waits for every task to block before it advances virtual time,
+// so a task always finishes its work "instantly" relative to the clock.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY        ((UBaseType_t)0U)
+#define tskNO_AFFINITY          0x7FFFFFFF
+#define configMAX_PRIORITIES    25
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+// pdFALSE (no wait) when the wake time has already passed.
+BaseType_t xTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement);
+#define vTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement) ((void)xTaskDelayUntil((pxPreviousWakeTime), (xTimeIncrement)))
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
@@ -0,0 +1,25 @@
+// Host stand-in for FreeRTOS timers.h
+//
+// Timers fire on the simulator's virtual clock, from sim_advance_ms(), in the
+// calling thread; that thread plays the role of the timer service task.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+typedef struct sim_timer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriodInTicks,
+                           UBaseType_t uxAutoReload, void *pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction);
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait);
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer);
+TickType_t xTimerGetPeriod(TimerHandle_t xTimer);
+void *pvTimerGetTimerID(TimerHandle_t xTimer);
+const char *pcTimerGetName(TimerHandle_t xTimer);
@@ -0,0 +1,122 @@
+// Host stand-in for the generated sdkconfig.h
+//
+// Mirrors the defaults in main/Kconfig.projbuild; variants in CMakeLists.txt
+// override individual options with compile definitions.
+#pragma once
+
+#define CONFIG_FREERTOS_HZ 1000
+
+// ESP-IDF's default: INFO ( the console prints levels up to it )
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+
+// The simulated controller is a BLE 5.0 one (ESP32-C3/S3 class)
+#define CONFIG_BT_BLE_50_FEATURES_SUPPORTED 1
+
+// selected by every sample source, which also raises the burst default
+#if defined(CONFIG_SWIFT_SAMPLE_SOURCE_SYNTHETIC) || defined(CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY)
+#ifndef CONFIG_SWIFT_NOTIFY_BULK
+#define CONFIG_SWIFT_NOTIFY_BULK 1
+#endif
+#ifndef CONFIG_SWIFT_NOTIFY_BURST
+#define CONFIG_SWIFT_NOTIFY_BURST 4
+#endif
+#endif
+
+#ifndef CONFIG_SWIFT_NOTIFY_BULK
+#define CONFIG_SWIFT_NOTIFY_BULK 0
+#endif
+
+#ifndef CONFIG_SWIFT_NOTIFY_BURST
+#define CONFIG_SWIFT_NOTIFY_BURST 1
+#endif
+
+#ifndef CONFIG_SWIFT_NOTIFY_TASK
+#define CONFIG_SWIFT_NOTIFY_TASK 1
+#endif
+
+#ifndef CONFIG_SWIFT_NOTIFY_WINDOW_INIT
+#define CONFIG_SWIFT_NOTIFY_WINDOW_INIT 4
+#endif
+
+#ifndef CONFIG_SWIFT_NOTIFY_WINDOW_MAX
+#define CONFIG_SWIFT_NOTIFY_WINDOW_MAX 16
+#endif
+
+#ifndef CONFIG_SWIFT_DATA_LEN
+#define CONFIG_SWIFT_DATA_LEN 251
+#endif
+
+#ifndef CONFIG_SWIFT_PREFER_2M_PHY
+#define CONFIG_SWIFT_PREFER_2M_PHY 1
+#endif
+
+#ifndef CONFIG_SWIFT_MAX_CONNECTIONS
+#define CONFIG_SWIFT_MAX_CONNECTIONS 4
+#endif
+
+#ifndef CONFIG_SWIFT_LOCAL_MTU
+#define CONFIG_SWIFT_LOCAL_MTU 517
+#endif
+
+#ifndef CONFIG_SWIFT_GATTS_ATTR_TABLE
+#define CONFIG_SWIFT_GATTS_ATTR_TABLE 1
+#endif
+
+#ifndef CONFIG_SWIFT_ADV_FAST_INTERVAL_MS
+#define CONFIG_SWIFT_ADV_FAST_INTERVAL_MS 20
+#endif
+
+#ifndef CONFIG_SWIFT_ADV_FAST_WINDOW_MS
+#define CONFIG_SWIFT_ADV_FAST_WINDOW_MS 30000
+#endif
+
+#ifndef CONFIG_SWIFT_ADV_SLOW_INTERVAL_MS
+#define CONFIG_SWIFT_ADV_SLOW_INTERVAL_MS 152
+#endif
+
+#ifndef CONFIG_SWIFT_WRITE_RING_LEN
+#define CONFIG_SWIFT_WRITE_RING_LEN 32
+#endif
+
+#ifndef CONFIG_SWIFT_WRITE_LATENCY_LOG_INTERVAL
+#define CONFIG_SWIFT_WRITE_LATENCY_LOG_INTERVAL 1000
+#endif
+
+#ifndef CONFIG_SWIFT_BLOB_MAX_LEN
+#define CONFIG_SWIFT_BLOB_MAX_LEN 4096
+#endif
+
+#ifndef CONFIG_SWIFT_LED_GAMMA_X10
+#define CONFIG_SWIFT_LED_GAMMA_X10 10
+#endif
+
+// choice SWIFT_SAMPLE_SOURCE: only the selected option is defined; the ADC
+// source needs ESP-IDF
+#if !defined(CONFIG_SWIFT_SAMPLE_SOURCE_SYNTHETIC) && !defined(CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY)
+#define CONFIG_SWIFT_SAMPLE_SOURCE_NONE 1
+#endif
+
+// choice SWIFT_HOT_LOG
+#if !defined(CONFIG_SWIFT_HOT_LOG_DIRECT) && !defined(CONFIG_SWIFT_HOT_LOG_STRIP)
+#define CONFIG_SWIFT_HOT_LOG_RING 1
+#endif
+
+#ifndef CONFIG_SWIFT_HOT_LOG_RATE
+#define CONFIG_SWIFT_HOT_LOG_RATE 10
+#endif
+
+#ifndef CONFIG_SWIFT_HOT_LOG_BURST
+#define CONFIG_SWIFT_HOT_LOG_BURST 5
+#endif
+
+#ifndef CONFIG_SWIFT_HOT_LOG_RING_LEN
+#define CONFIG_SWIFT_HOT_LOG_RING_LEN 64
+#endif
+
+#ifndef CONFIG_SWIFT_SAMPLE_RATE_HZ
+#define CONFIG_SWIFT_SAMPLE_RATE_HZ 1000
+#endif
+
+#ifndef CONFIG_SWIFT_SAMPLE_BLOCK_LEN
+#define CONFIG_SWIFT_SAMPLE_BLOCK_LEN 32
+#endif
@@ -0,0 +1,280 @@
+// Host simulation of the ESP-IDF Bluedroid/FreeRTOS environment.
+//
+// The firmware in ../main is compiled unmodified against the stand-in headers
+// in ../include. Every stack call it makes (register, create service, start
+// advertising, ...) queues the event the real stack would answer with, and the
+// harness drives the device from the "client" side with sim_connect(),
+// sim_write() and friends. Time is virtual: FreeRTOS timers only fire from
+// sim_advance_ms(), so runs are repeatable and faster than real time.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "esp_bt_defs.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_defs.h"
+#include "esp_gatts_api.h"
+
+// Firmware entry point (main/ble-swift-device.c)
+void app_main(void);
+
+//-----------------------------------------------------------------------------
+// Lifecycle and clock
+
+// Calls app_main() and dispatches the resulting setup events, advancing the
+// clock while they are on their way (see sim_set_stack_reply_us).
+void sim_boot(void);
+
+// Dispatches every queued stack event.
+void sim_run_pending(void);
+
+// Advances the virtual clock, firing due timers and dispatching events.
+void sim_advance_ms(uint32_t ms);
+void sim_advance_us(uint64_t us);
+
+uint64_t sim_now_us(void);
+
+// Host monotonic clock in nanoseconds, for measuring real processing cost.
+uint64_t sim_host_ns(void);
+
+// Log messages below this level are formatted but not printed.
+void sim_set_log_level(esp_log_level_t level);
+
+// Console UART the device's log lines go out on (default 0: free). Every line
+// the device would print ( up to CONFIG_LOG_DEFAULT_LEVEL, whatever
+// sim_set_log_level shows ) keeps its caller busy for its bytes at baud, 10
+// bits each: a GATTS/GAP handler's cost in sim_stats_t grows by it, a task or
+// timer callback is kept busy as by sim_set_stack_call_us.
+void sim_set_log_uart_baud(uint32_t baud);
+
+//-----------------------------------------------------------------------------
+// Client side
+
+// Returns false when the device is not advertising.
+bool sim_connect(uint16_t conn_id, const esp_bd_addr_t bda);
+void sim_disconnect(uint16_t conn_id);
+// Requests an MTU exchange; the device answers with min(mtu, its local MTU).
+void sim_set_mtu(uint16_t conn_id, uint16_t mtu);
+uint16_t sim_negotiated_mtu(uint16_t conn_id);
+void sim_write(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, bool need_rsp);
+// Reads a characteristic, MTU-1 bytes per ATT request like a central's long
+// read; returns the value length (0 when the read failed).
+uint16_t sim_read(uint16_t conn_id, uint16_t handle, uint8_t *value, uint16_t cap);
+// One ATT Prepare Write Request (a piece of a long write); returns the
+// response status, ESP_GATT_ERROR when the response does not echo the piece.
+esp_gatt_status_t sim_prepare_write(uint16_t conn_id, uint16_t handle, uint16_t offset, const uint8_t *value, uint16_t len);
+// ATT Execute Write Request: commits (execute) or cancels the prepared pieces.
+esp_gatt_status_t sim_execute_write(uint16_t conn_id, bool execute);
+// Status the device put in its last read/write response.
+esp_gatt_status_t sim_last_response_status(void);
+// Air time of one att_len-byte ATT PDU from the central at the link's PHY and
+// data length, fragments and empty replies included. Writes are delivered
+// instantly; a harness pacing its own uplink uses this to advance the clock.
+uint32_t sim_att_air_us(uint16_t conn_id, uint16_t att_len);
+// Link state as the central sees it.
+typedef struct {
+    esp_gatt_conn_params_t params;
+    esp_ble_gap_phy_t phy;
+    uint16_t tx_octets;     // LL data length
+} sim_link_t;
+bool sim_link(uint16_t conn_id, sim_link_t *link);
+
+// What the central accepts in later data length / PHY update procedures. A
+// data length exchange completes two connection events after the request, a
+// PHY update six (its instant); a silent central never completes either.
+typedef struct {
+    uint16_t max_data_len;  // 27..251; 0: rejects data length updates
+    uint8_t phy_mask;       // ESP_BLE_GAP_PHY_*_PREF_MASK it supports; 0: rejects PHY updates
+    bool silent;            // never answers either procedure
+} sim_central_caps_t;
+// Default: 251 octets, 1M and 2M.
+void sim_set_central_caps(const sim_central_caps_t *caps);
+
+// Looks up a characteristic value handle by 128-bit UUID (0 when absent).
+uint16_t sim_find_char(const uint8_t uuid128[16]);
+// Looks up the first descriptor with the given 16-bit UUID after a characteristic.
+uint16_t sim_find_descr(uint16_t char_handle, uint16_t uuid16);
+
+bool sim_is_advertising(void);
+
+// Interval of the running advertising (adv_int_min), 0 when not advertising.
+uint32_t sim_adv_interval_us(void);
+
+// Scanner of sim_connect_scanned: the central listens window_us out of every
+// interval_us, its schedule at a random phase to the device's. Default:
+// continuously.
+void sim_set_scanner(uint32_t window_us, uint32_t interval_us);
+
+// A central that starts scanning now and connects to the first advertising
+// event it hears. Advertising events come one interval plus a random 0-10 ms
+// advDelay apart, the first one sim_set_stack_reply_us() after advertising
+// was started. Advances the clock to that event and connects; false when no
+// event falls inside a scan window within timeout_ms.
+bool sim_connect_scanned(uint16_t conn_id, const esp_bd_addr_t bda, uint32_t timeout_ms);
+
+// Link model: every connection buffers up to tx_buffers notifications in the
+// controller and sends up to packets_per_event of them per connection
+// interval; the hook runs and ESP_GATTS_CONF_EVT is posted as each one goes
+// on air. A full buffer raises ESP_GATTS_CONGEST_EVT and refuses further
+// sends until it is half empty. Defaults: 10 buffers, 4 packets per event.
+// packets_per_event 0 selects the air time model instead: each connection
+// event carries as many LL PDUs as fit the interval at the link's PHY and
+// data length, so 2M and DLE raise throughput.
+void sim_set_link_model(uint16_t tx_buffers, uint16_t packets_per_event);
+
+// Called as each notification goes on air.
+typedef void (*sim_notify_hook_t)(uint16_t conn_id, uint16_t handle,
+                                  const uint8_t *value, uint16_t len, void *ctx);
+void sim_set_notify_hook(sim_notify_hook_t hook, void *ctx);
+
+// Virtual time each esp_ble_gatts_send_indicate call keeps its caller busy
+// (default 0). A call from a timer callback holds up the timer service task:
+// no timer fires until the charged time has passed, and the delay shows in
+// sim_stats_t.timer_late; an auto-reload timer that fell behind fires back to
+// back to catch up, as in FreeRTOS. A call
+// from a task makes the task sleep that long before it next waits for a
+// notification, so ticks signalled meanwhile queue up. Calls from stack
+// callbacks are free.
+void sim_set_stack_call_us(uint32_t us);
+
+// Virtual time from a setup call (app register, create service or attribute
+// table, add characteristic or descriptor, start service, advertising data,
+// start and stop advertising) to the event that answers it (default 0): the
+// trip through the Bluetooth task and, for GAP, the controller. Events queued
+// behind a late answer wait for it.
+void sim_set_stack_reply_us(uint32_t us);
+
+// Boot steps that take the device real time. Each costs its caller
+// sim_set_boot_cost_us() (default 0): called from app_main it advances the
+// clock, and tasks, timers and stack events run meanwhile; a task sleeps
+// that long.
+typedef enum {
+    SIM_BOOT_NVS,           // nvs_flash_init
+    SIM_BOOT_CONTROLLER,    // esp_bt_controller_enable
+    SIM_BOOT_BLUEDROID,     // esp_bluedroid_enable
+    SIM_BOOT_LEDC,          // ledc_fade_func_install
+    SIM_BOOT_STEP_MAX,
+} sim_boot_step_t;
+void sim_set_boot_cost_us(sim_boot_step_t step, uint32_t us);
+// Virtual time the step last finished, UINT64_MAX when it has not run.
+uint64_t sim_boot_step_done_us(sim_boot_step_t step);
+
+// NVS (nvs.h) keeps its entries in memory. With a backing file, the first
+// nvs_flash_init loads them from it and every nvs_commit writes them all
+// back, so the next boot, in another process (bench_run_isolated), finds
+// what this one stored; a file that does not exist yet is an erased flash.
+// NULL (default): memory only.
+void sim_nvs_set_file(const char *path);
+// Virtual time each nvs_get_* call, and each nvs_set_*, nvs_erase_key or
+// nvs_commit call, keeps its caller busy (default 0): app_main advances the
+// clock, a task sleeps, a GATTS/GAP handler's cost in sim_stats_t grows.
+void sim_set_nvs_cost_us(uint32_t read_us, uint32_t write_us);
+
+//-----------------------------------------------------------------------------
+// Fault injection
+
+// Sees every stack event just before it is dispatched. It may change the
+// event through param (esp_ble_gap_cb_param_t or esp_ble_gatts_cb_param_t),
+// a failed status say, and decides what happens to it.
+typedef enum {
+    SIM_EVENT_DELIVER,      // dispatch it
+    SIM_EVENT_DROP,         // the firmware never sees it
+    SIM_EVENT_DUPLICATE,    // dispatch it twice
+    SIM_EVENT_HOLD,         // keep it until sim_release_held()
+} sim_event_action_t;
+typedef sim_event_action_t (*sim_event_filter_t)(bool is_gap, int event, void *param, void *ctx);
+void sim_set_event_filter(sim_event_filter_t filter, void *ctx);
+
+// Queues the held events, oldest first, behind the ones already queued; the
+// filter sees them again. Returns how many. A replay dispatches them right
+// away: call sim_run_pending() next for the trace to replay the same.
+int sim_release_held(void);
+
+// Queues an event the stack did not send, a DISCONNECT for a connection that
+// never existed say, for the next sim_run_pending(); value is copied for
+// write events. Injected events are not part of a trace's replay.
+void sim_inject_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param,
+                      const uint8_t *value, uint16_t len);
+void sim_inject_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param);
+
+//-----------------------------------------------------------------------------
+// Event trace and replay
+//
+// A trace is text, one line per entry, with the virtual time in us first:
+//
+//   <t_us> BOOT                          sim_boot()
+//   <t_us> PEER <action> key=value ...   what the central did: CONNECT,
+//                                        DISCONNECT, MTU, WRITE, READ,
+//                                        PREPARE, EXECUTE, and RELEASE for
+//                                        sim_release_held()
+//   <t_us> GATTS|GAP <event> key=value ...
+//                                        an event the firmware's handlers got
+//   <t_us> END                           where recording stopped
+//
+// Replaying a trace repeats its PEER lines at their times and runs the clock
+// to its END. The stack answers the firmware's own calls as it did when the
+// trace was recorded, so a firmware that behaves the same reproduces every
+// event line. Link model, central capabilities and event filter are not part
+// of the trace: replay under the ones it was recorded with.
+typedef struct sim_trace sim_trace_t;
+
+sim_trace_t *sim_trace_new(void);
+void sim_trace_free(sim_trace_t *trace);
+// Starts appending to trace; NULL stops the current recording with an END line.
+void sim_trace_record(sim_trace_t *trace);
+size_t sim_trace_len(const sim_trace_t *trace);
+const char *sim_trace_line(const sim_trace_t *trace, size_t i);
+bool sim_trace_save(const sim_trace_t *trace, const char *path);
+// NULL when the file cannot be read.
+sim_trace_t *sim_trace_load(const char *path);
+// Runs the trace's BOOT and PEER lines from the current time on, which must
+// not be past the first; false at the first line it cannot run.
+bool sim_trace_replay(const sim_trace_t *trace);
+
+//-----------------------------------------------------------------------------
+// Statistics
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} sim_cost_t;
+
+#define SIM_MAX_TIMERS      8
+#define SIM_GATTS_EVT_MAX   32
+#define SIM_GAP_EVT_MAX     64
+
+typedef struct {
+    sim_cost_t gatts[SIM_GATTS_EVT_MAX];    // host time spent in gatts_event_handler, by event
+    sim_cost_t gap[SIM_GAP_EVT_MAX];        // host time spent in gap_event_handler, by event
+    sim_cost_t timer[SIM_MAX_TIMERS];       // host time spent in timer callbacks
+    sim_cost_t timer_late[SIM_MAX_TIMERS];  // virtual time from expiry to callback start (ns)
+    const char *timer_name[SIM_MAX_TIMERS];
+
+    uint64_t notify_sent;       // on air
+    uint64_t notify_bytes;
+    uint64_t notify_failed;
+    uint64_t notify_refused;    // rejected while the link was congested
+    uint64_t congest_events;
+    uint64_t writes_delivered;
+    uint64_t write_bytes;
+    uint64_t responses_sent;
+    uint64_t led_updates;       // ledc_update_duty calls
+    uint64_t led_fades;         // ledc_fade_start calls
+    uint64_t adv_starts;
+    uint64_t log_lines;
+    uint64_t log_uart_bytes;    // of the lines that went to the UART
+    uint64_t log_uart_ns;       // their transmit time
+    uint64_t nvs_reads;         // nvs_get_* calls
+    uint64_t nvs_writes;        // nvs_set_* and nvs_erase_key calls
+    uint64_t nvs_commits;
+} sim_stats_t;
+
+const sim_stats_t *sim_stats(void);
+void sim_stats_reset(void);
+
+// Current LEDC duty of a channel, as last written by ledc_update_duty() or
+// reached by a fade.
+uint32_t sim_led_duty(int channel);
@@ -0,0 +1,13 @@
+#include "sim_internal.h"
+
+// Kept apart from sim_core.c so tools that use the simulator without a
+// firmware image (e.g. bench_spsc_ring) do not need app_main.
+void sim_boot(void)
+{
+    sim_trace_boot();
+    app_main();
+    sim_run_pending();
+    for (uint64_t due; (due = sim_events_next_due_us()) != UINT64_MAX;) {
+        sim_advance_us(due - sim_now_us());
+    }
+}
@@ -0,0 +1,1304 @@
+#include <string.h>
+
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+
+#include "sim_internal.h"
+
+#define SIM_GATTS_IF        3
+#define SIM_FIRST_HANDLE    40
+#define SIM_MAX_ATTRS       32
+#define SIM_MAX_CONNS       9
+#define SIM_LINK_MAX_BUFS   32
+#define SIM_LINK_EVENT_GUARD_US 500 // connection event time the controller leaves unused
+#define SIM_LL_DATA_LEN_DEFAULT 27
+#define SIM_LL_DATA_LEN_EVENTS  2   // connection events a data length exchange takes
+#define SIM_LL_PHY_EVENTS       6   // PHY update instant, in connection events
+
+//-----------------------------------------------------------------------------
+// Controller / Bluedroid
+static bool s_controller_ready;
+static bool s_bluedroid_ready;
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg)
+{
+    if (cfg == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+    s_controller_ready = (mode & ESP_BT_MODE_BLE) != 0;
+    sim_boot_step(SIM_BOOT_CONTROLLER);
+    return s_controller_ready ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_bluedroid_init(void)
+{
+    return s_controller_ready ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bluedroid_enable(void)
+{
+    s_bluedroid_ready = s_controller_ready;
+    sim_boot_step(SIM_BOOT_BLUEDROID);
+    return s_bluedroid_ready ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+//-----------------------------------------------------------------------------
+// Callbacks
+static esp_gatts_cb_t s_gatts_cb;
+static esp_gap_ble_cb_t s_gap_cb;
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+    s_gatts_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+    s_gap_cb = callback;
+    return ESP_OK;
+}
+
+// Time charged to the handler running on this thread ( the UART of its log
+// lines ), beside the host time it takes.
+static __thread bool s_in_handler;
+static __thread uint64_t s_handler_charged_ns;
+
+bool sim_bt_charge_handler_ns(uint64_t ns)
+{
+    if (!s_in_handler) {
+        return false;
+    }
+    s_handler_charged_ns += ns;
+    return true;
+}
+
+void sim_bt_dispatch_gatts(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t *param)
+{
+    if (s_gatts_cb == NULL) {
+        return;
+    }
+    bool nested = s_in_handler;
+    uint64_t charged = s_handler_charged_ns;
+    s_in_handler = true;
+    uint64_t start = sim_host_ns();
+    s_gatts_cb(event, SIM_GATTS_IF, param);
+    uint64_t elapsed = sim_host_ns() - start + s_handler_charged_ns - charged;
+    s_in_handler = nested;
+
+    sim_lock();
+    if ((int)event < SIM_GATTS_EVT_MAX) {
+        sim_cost_add(&sim_stats_mut()->gatts[event], elapsed);
+    }
+    sim_unlock();
+}
+
+void sim_bt_dispatch_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    if (s_gap_cb == NULL) {
+        return;
+    }
+    bool nested = s_in_handler;
+    uint64_t charged = s_handler_charged_ns;
+    s_in_handler = true;
+    uint64_t start = sim_host_ns();
+    s_gap_cb(event, param);
+    uint64_t elapsed = sim_host_ns() - start + s_handler_charged_ns - charged;
+    s_in_handler = nested;
+
+    sim_lock();
+    if ((int)event < SIM_GAP_EVT_MAX) {
+        sim_cost_add(&sim_stats_mut()->gap[event], elapsed);
+    }
+    sim_unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Attribute database
+typedef struct {
+    uint16_t handle;
+    uint16_t service_handle;
+    esp_bt_uuid_t uuid;
+    bool is_descr;
+    esp_gatt_char_prop_t prop;
+    uint16_t len;
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+} sim_attr_t;
+
+static sim_attr_t s_attrs[SIM_MAX_ATTRS];
+static int s_attr_count;
+static uint16_t s_table_handles[SIM_MAX_ATTRS];    // ESP_GATTS_CREAT_ATTR_TAB_EVT points here
+static uint16_t s_next_handle = SIM_FIRST_HANDLE;
+static uint16_t s_service_handle;
+static uint16_t s_service_end;
+
+static sim_attr_t *attr_find(uint16_t handle)
+{
+    for (int i = 0; i < s_attr_count; i++) {
+        if (s_attrs[i].handle == handle) {
+            return &s_attrs[i];
+        }
+    }
+    return NULL;
+}
+
+static sim_attr_t *attr_add(uint16_t handle, const esp_bt_uuid_t *uuid, bool is_descr,
+                            esp_gatt_char_prop_t prop, const esp_attr_value_t *val)
+{
+    if (s_attr_count >= SIM_MAX_ATTRS) {
+        return NULL;
+    }
+    sim_attr_t *attr = &s_attrs[s_attr_count++];
+    memset(attr, 0, sizeof(*attr));
+    attr->handle = handle;
+    attr->service_handle = s_service_handle;
+    attr->uuid = *uuid;
+    attr->is_descr = is_descr;
+    attr->prop = prop;
+    if (val != NULL && val->attr_value != NULL) {
+        attr->len = val->attr_len < sizeof(attr->value) ? val->attr_len : sizeof(attr->value);
+        memcpy(attr->value, val->attr_value, attr->len);
+    }
+    return attr;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+    if (!s_bluedroid_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_ble_gatts_cb_param_t p = { .reg = { .status = ESP_GATT_OK, .app_id = app_id } };
+    sim_post_gatts_reply(ESP_GATTS_REG_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_create_service(esp_gatt_if_t gatts_if, esp_gatt_srvc_id_t *service_id, uint16_t num_handle)
+{
+    if (gatts_if != SIM_GATTS_IF || service_id == NULL || num_handle == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.create.status = ESP_GATT_OK;
+    p.create.service_handle = s_next_handle;
+    p.create.service_id = *service_id;
+
+    s_service_handle = s_next_handle;
+    s_service_end = s_next_handle + num_handle;
+    s_next_handle++;
+
+    sim_post_gatts_reply(ESP_GATTS_CREATE_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_add_char(uint16_t service_handle, esp_bt_uuid_t *char_uuid,
+                                 esp_gatt_perm_t perm, esp_gatt_char_prop_t property,
+                                 esp_attr_value_t *char_val, esp_attr_control_t *control)
+{
+    (void)perm;
+    (void)control;
+    if (char_uuid == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.add_char.service_handle = service_handle;
+    p.add_char.char_uuid = *char_uuid;
+
+    // Declaration + value
+    if (service_handle != s_service_handle || s_next_handle + 2 > s_service_end
+        || attr_add(s_next_handle + 1, char_uuid, false, property, char_val) == NULL) {
+        p.add_char.status = ESP_GATT_NO_RESOURCES;
+    } else {
+        p.add_char.status = ESP_GATT_OK;
+        p.add_char.attr_handle = s_next_handle + 1;
+        s_next_handle += 2;
+    }
+    sim_post_gatts_reply(ESP_GATTS_ADD_CHAR_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_add_char_descr(uint16_t service_handle, esp_bt_uuid_t *descr_uuid,
+                                       esp_gatt_perm_t perm, esp_attr_value_t *char_descr_val,
+                                       esp_attr_control_t *control)
+{
+    (void)perm;
+    (void)control;
+    if (descr_uuid == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.add_char_descr.service_handle = service_handle;
+    p.add_char_descr.descr_uuid = *descr_uuid;
+
+    if (service_handle != s_service_handle || s_next_handle + 1 > s_service_end
+        || attr_add(s_next_handle, descr_uuid, true, 0, char_descr_val) == NULL) {
+        p.add_char_descr.status = ESP_GATT_NO_RESOURCES;
+    } else {
+        p.add_char_descr.status = ESP_GATT_OK;
+        p.add_char_descr.attr_handle = s_next_handle;
+        s_next_handle++;
+    }
+    sim_post_gatts_reply(ESP_GATTS_ADD_CHAR_DESCR_EVT, &p);
+    return ESP_OK;
+}
+
+static bool desc_uuid16_is(const esp_attr_desc_t *desc, uint16_t uuid16)
+{
+    return desc->uuid_length == ESP_UUID_LEN_16 && desc->uuid_p != NULL
+        && (uint16_t)(desc->uuid_p[0] | (desc->uuid_p[1] << 8)) == uuid16;
+}
+
+static bool desc_uuid(const esp_attr_desc_t *desc, esp_bt_uuid_t *uuid)
+{
+    memset(uuid, 0, sizeof(*uuid));
+    if (desc->uuid_p == NULL) {
+        return false;
+    }
+    if (desc->uuid_length == ESP_UUID_LEN_16) {
+        uuid->len = ESP_UUID_LEN_16;
+        uuid->uuid.uuid16 = (uint16_t)(desc->uuid_p[0] | (desc->uuid_p[1] << 8));
+        return true;
+    }
+    if (desc->uuid_length == ESP_UUID_LEN_128) {
+        uuid->len = ESP_UUID_LEN_128;
+        memcpy(uuid->uuid.uuid128, desc->uuid_p, ESP_UUID_LEN_128);
+        return true;
+    }
+    return false;
+}
+
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t *gatts_attr_db, esp_gatt_if_t gatts_if,
+                                        uint16_t max_nb_attr, uint8_t srvc_inst_id)
+{
+    if (gatts_if != SIM_GATTS_IF || gatts_attr_db == NULL || max_nb_attr == 0 || max_nb_attr > SIM_MAX_ATTRS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.add_attr_tab.svc_inst_id = srvc_inst_id;
+    p.add_attr_tab.handles = s_table_handles;
+
+    // The table opens with the primary service declaration, its UUID as value
+    const esp_attr_desc_t *svc = &gatts_attr_db[0].att_desc;
+    esp_attr_desc_t svc_uuid = { .uuid_length = svc->length, .uuid_p = svc->value };
+    if (!desc_uuid16_is(svc, ESP_GATT_UUID_PRI_SERVICE) || !desc_uuid(&svc_uuid, &p.add_attr_tab.svc_uuid)) {
+        p.add_attr_tab.status = ESP_GATT_INVALID_PDU;
+        sim_post_gatts_reply(ESP_GATTS_CREAT_ATTR_TAB_EVT, &p);
+        return ESP_OK;
+    }
+    s_service_handle = s_next_handle;
+    s_service_end = s_next_handle + max_nb_attr;
+
+    // Handles in table order; declarations take one but are not in the database
+    esp_gatt_status_t status = ESP_GATT_OK;
+    for (uint16_t i = 0; i < max_nb_attr && status == ESP_GATT_OK; i++) {
+        const esp_attr_desc_t *desc = &gatts_attr_db[i].att_desc;
+        s_table_handles[i] = s_next_handle++;
+        if (i == 0 || desc_uuid16_is(desc, ESP_GATT_UUID_CHAR_DECLARE)) {
+            continue;
+        }
+        // a value follows its declaration, which holds the properties; anything else is a descriptor
+        const esp_attr_desc_t *prev = &gatts_attr_db[i - 1].att_desc;
+        bool is_value = desc_uuid16_is(prev, ESP_GATT_UUID_CHAR_DECLARE);
+        esp_gatt_char_prop_t prop = is_value && prev->value != NULL ? prev->value[0] : 0;
+        esp_attr_value_t val = { .attr_max_len = desc->max_length, .attr_len = desc->length, .attr_value = desc->value };
+        esp_bt_uuid_t uuid;
+        if (!desc_uuid(desc, &uuid)) {
+            status = ESP_GATT_INVALID_PDU;
+        } else if (attr_add(s_table_handles[i], &uuid, !is_value, prop, &val) == NULL) {
+            status = ESP_GATT_NO_RESOURCES;
+        }
+    }
+    p.add_attr_tab.status = status;
+    p.add_attr_tab.num_handle = status == ESP_GATT_OK ? max_nb_attr : 0;
+    sim_post_gatts_reply(ESP_GATTS_CREAT_ATTR_TAB_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle)
+{
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.start.status = service_handle == s_service_handle ? ESP_GATT_OK : ESP_GATT_INVALID_HANDLE;
+    p.start.service_handle = service_handle;
+    sim_post_gatts_reply(ESP_GATTS_START_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_set_attr_value(uint16_t attr_handle, uint16_t length, const uint8_t *value)
+{
+    sim_attr_t *attr = attr_find(attr_handle);
+    if (attr == NULL || length > sizeof(attr->value)) {
+        return ESP_FAIL;
+    }
+    memcpy(attr->value, value, length);
+    attr->len = length;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_get_attr_value(uint16_t attr_handle, uint16_t *length, const uint8_t **value)
+{
+    sim_attr_t *attr = attr_find(attr_handle);
+    if (attr == NULL) {
+        *length = 0;
+        *value = NULL;
+        return ESP_FAIL;
+    }
+    *length = attr->len;
+    *value = attr->value;
+    return ESP_OK;
+}
+
+uint16_t sim_find_char(const uint8_t uuid128[16])
+{
+    for (int i = 0; i < s_attr_count; i++) {
+        if (!s_attrs[i].is_descr && s_attrs[i].uuid.len == ESP_UUID_LEN_128
+            && memcmp(s_attrs[i].uuid.uuid.uuid128, uuid128, 16) == 0) {
+            return s_attrs[i].handle;
+        }
+    }
+    return 0;
+}
+
+uint16_t sim_find_descr(uint16_t char_handle, uint16_t uuid16)
+{
+    for (int i = 0; i < s_attr_count; i++) {
+        if (s_attrs[i].handle != char_handle) {
+            continue;
+        }
+        for (int j = i + 1; j < s_attr_count && s_attrs[j].is_descr; j++) {
+            if (s_attrs[j].uuid.len == ESP_UUID_LEN_16 && s_attrs[j].uuid.uuid.uuid16 == uuid16) {
+                return s_attrs[j].handle;
+            }
+        }
+        break;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Connections
+typedef struct {
+    uint16_t handle;
+    uint16_t len;
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+} sim_link_pkt_t;
+
+// An LL control procedure the central answers at due_us.
+typedef struct {
+    bool pending;
+    bool ok;
+    uint16_t value;         // octets, or the PHY
+    uint64_t due_us;
+} sim_ll_proc_t;
+
+typedef struct {
+    bool connected;
+    uint16_t conn_id;
+    esp_bd_addr_t bda;
+    uint16_t mtu;
+    esp_gatt_conn_params_t params;
+    esp_ble_gap_phy_t phy;
+    uint16_t tx_octets;     // LL data length
+
+    // controller TX buffer, drained once per connection event
+    sim_link_pkt_t tx[SIM_LINK_MAX_BUFS];
+    uint16_t tx_head;
+    uint16_t tx_count;
+    uint16_t tx_head_sent;  // LL bytes of the head packet already on air (air time model)
+    bool congested;
+    uint64_t anchor_us;     // a connection event of the current interval
+    uint64_t next_event_us; // valid while tx_count > 0
+
+    sim_ll_proc_t data_len;
+    sim_ll_proc_t phy_update;
+} sim_conn_t;
+
+static sim_conn_t s_conns[SIM_MAX_CONNS];
+static uint16_t s_link_tx_buffers = 10;
+static uint16_t s_link_packets_per_event = 4;
+static sim_central_caps_t s_central = {
+    .max_data_len = 251,
+    .phy_mask = ESP_BLE_GAP_PHY_1M_PREF_MASK | ESP_BLE_GAP_PHY_2M_PREF_MASK,
+    .silent = false,
+};
+static uint16_t s_local_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+static uint32_t s_trans_id;
+static esp_gatt_status_t s_last_rsp_status;
+static uint16_t s_last_rsp_len;
+static uint8_t s_last_rsp_value[ESP_GATT_MAX_ATTR_LEN];
+static sim_notify_hook_t s_notify_hook;
+static void *s_notify_hook_ctx;
+
+static sim_conn_t *conn_find(uint16_t conn_id)
+{
+    for (int i = 0; i < SIM_MAX_CONNS; i++) {
+        if (s_conns[i].connected && s_conns[i].conn_id == conn_id) {
+            return &s_conns[i];
+        }
+    }
+    return NULL;
+}
+
+static sim_conn_t *conn_find_bda(const esp_bd_addr_t bda)
+{
+    for (int i = 0; i < SIM_MAX_CONNS; i++) {
+        if (s_conns[i].connected && memcmp(s_conns[i].bda, bda, ESP_BD_ADDR_LEN) == 0) {
+            return &s_conns[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu)
+{
+    if (mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    s_local_mtu = mtu;
+    return ESP_OK;
+}
+
+void sim_set_notify_hook(sim_notify_hook_t hook, void *ctx)
+{
+    s_notify_hook = hook;
+    s_notify_hook_ctx = ctx;
+}
+
+void sim_set_link_model(uint16_t tx_buffers, uint16_t packets_per_event)
+{
+    sim_lock();
+    s_link_tx_buffers = tx_buffers < 1 ? 1 : (tx_buffers > SIM_LINK_MAX_BUFS ? SIM_LINK_MAX_BUFS : tx_buffers);
+    s_link_packets_per_event = packets_per_event;
+    sim_unlock();
+}
+
+void sim_set_central_caps(const sim_central_caps_t *caps)
+{
+    sim_lock();
+    s_central = *caps;
+    sim_unlock();
+}
+
+static uint64_t link_interval_us(const sim_conn_t *conn)
+{
+    return (uint64_t)conn->params.interval * 1250;
+}
+
+// Air time of one LL data PDU with `octets` payload bytes, the central's empty
+// reply and both inter-frame spaces.
+static uint32_t link_pdu_exchange_us(const sim_conn_t *conn, uint16_t octets)
+{
+    // preamble + access address + header + CRC
+    uint32_t overhead = conn->phy == ESP_BLE_GAP_PHY_2M ? 11 : 10;
+    uint32_t us_per_byte = conn->phy == ESP_BLE_GAP_PHY_2M ? 4 : conn->phy == ESP_BLE_GAP_PHY_CODED ? 64 : 8;
+    return (octets + overhead) * us_per_byte + 150 + overhead * us_per_byte + 150;
+}
+
+// Notifications that complete in the next connection event; advances the
+// head's partial progress. Called with the lock held.
+static uint16_t link_event_packets(sim_conn_t *conn)
+{
+    if (s_link_packets_per_event > 0) {
+        return conn->tx_count < s_link_packets_per_event ? conn->tx_count : s_link_packets_per_event;
+    }
+    uint64_t interval = link_interval_us(conn);
+    uint32_t budget = interval > SIM_LINK_EVENT_GUARD_US ? (uint32_t)(interval - SIM_LINK_EVENT_GUARD_US) : 0;
+    uint16_t done = 0;
+    uint32_t sent = conn->tx_head_sent;
+    bool any = false;
+    for (uint16_t k = 0; k < conn->tx_count; k++) {
+        const sim_link_pkt_t *pkt = &conn->tx[(conn->tx_head + k) % SIM_LINK_MAX_BUFS];
+        uint32_t total = pkt->len + 3 + 4; // ATT + L2CAP headers
+        while (sent < total) {
+            uint16_t frag = (uint16_t)(total - sent < conn->tx_octets ? total - sent : conn->tx_octets);
+            uint32_t t = link_pdu_exchange_us(conn, frag);
+            // the event always carries at least one PDU
+            if (t > budget && any) {
+                conn->tx_head_sent = (uint16_t)sent;
+                return done;
+            }
+            budget = t > budget ? 0 : budget - t;
+            sent += frag;
+            any = true;
+        }
+        done++;
+        sent = 0;
+    }
+    conn->tx_head_sent = 0;
+    return done;
+}
+
+// First connection event strictly after now_us.
+static uint64_t link_next_event_after(const sim_conn_t *conn, uint64_t now_us)
+{
+    uint64_t interval = link_interval_us(conn);
+    uint64_t elapsed = now_us - conn->anchor_us;
+    return conn->anchor_us + (elapsed / interval + 1) * interval;
+}
+
+static void post_congest(uint16_t conn_id, bool congested)
+{
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.congest.conn_id = conn_id;
+    p.congest.congested = congested;
+    sim_post_gatts(ESP_GATTS_CONGEST_EVT, &p, NULL, 0);
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm)
+{
+    sim_charge_stack_call();
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    sim_stats_t *stats = sim_stats_mut();
+    if (gatts_if != SIM_GATTS_IF || conn == NULL || attr_find(attr_handle) == NULL) {
+        stats->notify_failed++;
+        sim_unlock();
+        return ESP_FAIL;
+    }
+    (void)need_confirm;
+
+    if (value_len > conn->mtu - 3 || value_len > ESP_GATT_MAX_ATTR_LEN) {
+        // Bluedroid refuses payloads that do not fit the ATT MTU
+        stats->notify_failed++;
+        sim_unlock();
+        esp_ble_gatts_cb_param_t p = { 0 };
+        p.conf.conn_id = conn_id;
+        p.conf.handle = attr_handle;
+        p.conf.len = value_len;
+        p.conf.status = ESP_GATT_ERROR;
+        sim_post_gatts(ESP_GATTS_CONF_EVT, &p, NULL, 0);
+        return ESP_OK;
+    }
+    if (conn->congested) {
+        // the L2CAP channel is congested: the send is rejected outright
+        stats->notify_refused++;
+        sim_unlock();
+        return ESP_FAIL;
+    }
+
+    uint16_t tail = (conn->tx_head + conn->tx_count) % SIM_LINK_MAX_BUFS;
+    sim_link_pkt_t *pkt = &conn->tx[tail];
+    pkt->handle = attr_handle;
+    pkt->len = value_len;
+    memcpy(pkt->value, value, value_len);
+    if (conn->tx_count++ == 0) {
+        conn->next_event_us = link_next_event_after(conn, sim_now_us());
+    }
+    bool congested = conn->tx_count >= s_link_tx_buffers;
+    if (congested) {
+        conn->congested = true;
+        stats->congest_events++;
+    }
+    sim_unlock();
+
+    if (congested) {
+        post_congest(conn_id, true);
+    }
+    return ESP_OK;
+}
+
+uint64_t sim_link_next_event_us(void)
+{
+    uint64_t next = UINT64_MAX;
+    sim_lock();
+    for (int i = 0; i < SIM_MAX_CONNS; i++) {
+        const sim_conn_t *conn = &s_conns[i];
+        if (!conn->connected) {
+            continue;
+        }
+        if (conn->tx_count > 0 && conn->next_event_us < next) {
+            next = conn->next_event_us;
+        }
+        if (conn->data_len.pending && conn->data_len.due_us < next) {
+            next = conn->data_len.due_us;
+        }
+        if (conn->phy_update.pending && conn->phy_update.due_us < next) {
+            next = conn->phy_update.due_us;
+        }
+    }
+    sim_unlock();
+    return next;
+}
+
+// Completes the LL procedures that are due; the new data length / PHY takes
+// effect from then on.
+static void link_run_procedures(sim_conn_t *conn, uint64_t now_us)
+{
+    sim_lock();
+    if (!conn->connected) {
+        sim_unlock();
+        return;
+    }
+    bool data_len_done = conn->data_len.pending && conn->data_len.due_us <= now_us;
+    esp_ble_gap_cb_param_t dl = { 0 };
+    if (data_len_done) {
+        conn->data_len.pending = false;
+        if (conn->data_len.ok) {
+            conn->tx_octets = conn->data_len.value;
+        }
+        // the event carries no address: the app has to know which link asked
+        dl.pkt_data_length_cmpl.status = conn->data_len.ok ? ESP_BT_STATUS_SUCCESS : ESP_BT_STATUS_UNSUPPORTED;
+        dl.pkt_data_length_cmpl.params.tx_len = conn->tx_octets;
+        dl.pkt_data_length_cmpl.params.rx_len = conn->tx_octets;
+    }
+    bool phy_done = conn->phy_update.pending && conn->phy_update.due_us <= now_us;
+    esp_ble_gap_cb_param_t pu = { 0 };
+    if (phy_done) {
+        conn->phy_update.pending = false;
+        if (conn->phy_update.ok) {
+            conn->phy = (esp_ble_gap_phy_t)conn->phy_update.value;
+        }
+        memcpy(pu.phy_update.bda, conn->bda, ESP_BD_ADDR_LEN);
+        pu.phy_update.status = conn->phy_update.ok ? ESP_BT_STATUS_SUCCESS : ESP_BT_STATUS_UNSUPPORTED;
+        pu.phy_update.tx_phy = conn->phy;
+        pu.phy_update.rx_phy = conn->phy;
+    }
+    sim_unlock();
+
+    if (data_len_done) {
+        sim_post_gap(ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT, &dl);
+    }
+    if (phy_done) {
+        sim_post_gap(ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT, &pu);
+    }
+}
+
+void sim_link_run_due(uint64_t now_us)
+{
+    for (int i = 0; i < SIM_MAX_CONNS; i++) {
+        sim_conn_t *conn = &s_conns[i];
+        link_run_procedures(conn, now_us);
+        sim_lock();
+        if (!conn->connected || conn->tx_count == 0 || conn->next_event_us > now_us) {
+            sim_unlock();
+            continue;
+        }
+        uint16_t conn_id = conn->conn_id;
+        uint16_t n = link_event_packets(conn);
+        sim_unlock();
+
+        // one connection event: n packets go on air, each confirmed to the app
+        for (uint16_t k = 0; k < n; k++) {
+            sim_lock();
+            if (!conn->connected || conn->conn_id != conn_id || conn->tx_count == 0) {
+                sim_unlock();
+                break;
+            }
+            sim_link_pkt_t pkt = conn->tx[conn->tx_head];
+            conn->tx_head = (conn->tx_head + 1) % SIM_LINK_MAX_BUFS;
+            conn->tx_count--;
+            sim_stats_t *stats = sim_stats_mut();
+            stats->notify_sent++;
+            stats->notify_bytes += pkt.len;
+            sim_notify_hook_t hook = s_notify_hook;
+            void *hook_ctx = s_notify_hook_ctx;
+            sim_unlock();
+
+            if (hook != NULL) {
+                hook(conn_id, pkt.handle, pkt.value, pkt.len, hook_ctx);
+            }
+            esp_ble_gatts_cb_param_t p = { 0 };
+            p.conf.status = ESP_GATT_OK;
+            p.conf.conn_id = conn_id;
+            p.conf.handle = pkt.handle;
+            p.conf.len = pkt.len;
+            sim_post_gatts(ESP_GATTS_CONF_EVT, &p, NULL, 0);
+        }
+
+        sim_lock();
+        bool uncongested = false;
+        if (conn->connected && conn->conn_id == conn_id) {
+            // congestion clears once the buffer is half empty
+            if (conn->congested && conn->tx_count <= s_link_tx_buffers / 2) {
+                conn->congested = false;
+                uncongested = true;
+            }
+            if (conn->tx_count > 0) {
+                conn->next_event_us = link_next_event_after(conn, now_us);
+            }
+        }
+        sim_unlock();
+        if (uncongested) {
+            post_congest(conn_id, false);
+        }
+    }
+}
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp)
+{
+    (void)trans_id;
+    if (gatts_if != SIM_GATTS_IF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_lock();
+    sim_stats_mut()->responses_sent++;
+    s_last_rsp_status = status;
+    s_last_rsp_len = 0;
+    if (rsp != NULL && rsp->attr_value.len <= sizeof(s_last_rsp_value)) {
+        s_last_rsp_len = rsp->attr_value.len;
+        memcpy(s_last_rsp_value, rsp->attr_value.value, s_last_rsp_len);
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.rsp.status = conn_find(conn_id) != NULL ? ESP_GATT_OK : ESP_GATT_ERROR;
+    p.rsp.conn_id = conn_id;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_RESPONSE_EVT, &p, NULL, 0);
+    return ESP_OK;
+}
+
+//-----------------------------------------------------------------------------
+// GAP
+static bool s_advertising;
+static uint32_t s_adv_interval_us;
+static uint64_t s_adv_next_us;      // next advertising event
+static uint32_t s_adv_epoch;        // advertising starts so far
+static uint64_t s_adv_rng = 0x2545F4914F6CDD1Dull;
+static uint32_t s_scan_window_us = 100000;
+static uint32_t s_scan_interval_us = 100000;
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len)
+{
+    esp_ble_gap_cb_param_t p = { 0 };
+    p.adv_data_raw_cmpl.status = (raw_data != NULL && raw_data_len <= 31) ? ESP_BT_STATUS_SUCCESS : ESP_BT_STATUS_PARM_INVALID;
+    sim_post_gap_reply(ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_scan_rsp_data_raw(uint8_t *raw_data, uint32_t raw_data_len)
+{
+    esp_ble_gap_cb_param_t p = { 0 };
+    p.scan_rsp_data_raw_cmpl.status = (raw_data != NULL && raw_data_len <= 31) ? ESP_BT_STATUS_SUCCESS : ESP_BT_STATUS_PARM_INVALID;
+    sim_post_gap_reply(ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params)
+{
+    if (adv_params == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ble_gap_cb_param_t p = { 0 };
+    sim_lock();
+    if (s_advertising) {
+        // The controller rejects LE Set Advertising Enable while already advertising
+        p.adv_start_cmpl.status = ESP_BT_STATUS_FAIL;
+    } else {
+        s_advertising = true;
+        s_adv_interval_us = adv_params->adv_int_min * 625u;
+        s_adv_next_us = sim_now_us() + sim_stack_reply_us();
+        s_adv_epoch++;
+        sim_stats_mut()->adv_starts++;
+        p.adv_start_cmpl.status = ESP_BT_STATUS_SUCCESS;
+    }
+    sim_unlock();
+    sim_post_gap_reply(ESP_GAP_BLE_ADV_START_COMPLETE_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_stop_advertising(void)
+{
+    esp_ble_gap_cb_param_t p = { 0 };
+    sim_lock();
+    s_advertising = false;
+    sim_unlock();
+    p.adv_stop_cmpl.status = ESP_BT_STATUS_SUCCESS;
+    sim_post_gap_reply(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, &p);
+    return ESP_OK;
+}
+
+bool sim_is_advertising(void)
+{
+    return s_advertising;
+}
+
+uint32_t sim_adv_interval_us(void)
+{
+    return s_advertising ? s_adv_interval_us : 0;
+}
+
+void sim_set_scanner(uint32_t window_us, uint32_t interval_us)
+{
+    s_scan_interval_us = interval_us > 0 ? interval_us : 1;
+    s_scan_window_us = window_us < s_scan_interval_us ? window_us : s_scan_interval_us;
+}
+
+// Called with sim_lock held.
+static uint32_t adv_rand(uint32_t bound)
+{
+    s_adv_rng ^= s_adv_rng << 13;
+    s_adv_rng ^= s_adv_rng >> 7;
+    s_adv_rng ^= s_adv_rng << 17;
+    return (uint32_t)((s_adv_rng >> 32) % bound);
+}
+
+// advDelay: the controller adds 0-10 ms to every advertising interval.
+static uint32_t adv_delay_us(void)
+{
+    return adv_rand(10001);
+}
+
+esp_err_t esp_ble_gap_set_prefer_conn_params(esp_bd_addr_t bd_addr,
+                                             uint16_t min_conn_int, uint16_t max_conn_int,
+                                             uint16_t slave_latency, uint16_t supervision_tout)
+{
+    if (min_conn_int < 0x06 || max_conn_int > 0x0C80 || min_conn_int > max_conn_int) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_lock();
+    sim_conn_t *conn = conn_find_bda(bd_addr);
+    if (conn == NULL) {
+        sim_unlock();
+        return ESP_FAIL;
+    }
+    // The central accepts the fastest interval offered
+    conn->params.interval = min_conn_int;
+    conn->anchor_us = sim_now_us();
+    if (conn->tx_count > 0) {
+        conn->next_event_us = link_next_event_after(conn, conn->anchor_us);
+    }
+    conn->params.latency = slave_latency;
+    conn->params.timeout = supervision_tout;
+
+    esp_ble_gap_cb_param_t p = { 0 };
+    p.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    memcpy(p.update_conn_params.bda, bd_addr, ESP_BD_ADDR_LEN);
+    p.update_conn_params.min_int = min_conn_int;
+    p.update_conn_params.max_int = max_conn_int;
+    p.update_conn_params.latency = slave_latency;
+    p.update_conn_params.conn_int = min_conn_int;
+    p.update_conn_params.timeout = supervision_tout;
+    sim_unlock();
+    sim_post_gap(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &p);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params)
+{
+    if (params == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_ble_gap_set_prefer_conn_params(params->bda, params->min_int, params->max_int,
+                                              params->latency, params->timeout);
+}
+
+esp_err_t esp_ble_gap_set_preferred_phy(esp_bd_addr_t bd_addr,
+                                        esp_ble_gap_all_phys_t all_phys_mask,
+                                        esp_ble_gap_phy_mask_t tx_phy_mask,
+                                        esp_ble_gap_phy_mask_t rx_phy_mask,
+                                        esp_ble_gap_prefer_phy_options_t phy_options)
+{
+    (void)all_phys_mask;
+    (void)rx_phy_mask;
+    (void)phy_options;
+    sim_lock();
+    sim_conn_t *conn = conn_find_bda(bd_addr);
+    if (conn == NULL) {
+        sim_unlock();
+        return ESP_FAIL;
+    }
+    esp_ble_gap_cb_param_t done = { 0 };
+    done.set_perf_phy.status = ESP_BT_STATUS_SUCCESS;
+    if (!s_central.silent) {
+        sim_ll_proc_t *proc = &conn->phy_update;
+        proc->pending = true;
+        // a central without the LE PHY update procedure rejects it
+        proc->ok = s_central.phy_mask != 0;
+        proc->value = conn->phy;
+        // the central picks the fastest PHY both sides allow, else stays put
+        esp_ble_gap_phy_mask_t common = tx_phy_mask & s_central.phy_mask;
+        if (common & ESP_BLE_GAP_PHY_2M_PREF_MASK) {
+            proc->value = ESP_BLE_GAP_PHY_2M;
+        } else if (common & ESP_BLE_GAP_PHY_1M_PREF_MASK) {
+            proc->value = ESP_BLE_GAP_PHY_1M;
+        } else if (common & ESP_BLE_GAP_PHY_CODED_PREF_MASK) {
+            proc->value = ESP_BLE_GAP_PHY_CODED;
+        }
+        uint64_t now = sim_now_us();
+        proc->due_us = link_next_event_after(conn, now) + (SIM_LL_PHY_EVENTS - 1) * link_interval_us(conn);
+    }
+    sim_unlock();
+
+    sim_post_gap(ESP_GAP_BLE_SET_PREFERRED_PHY_COMPLETE_EVT, &done);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_pkt_data_len(esp_bd_addr_t remote_device, uint16_t tx_data_length)
+{
+    if (tx_data_length < SIM_LL_DATA_LEN_DEFAULT || tx_data_length > 251) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_lock();
+    sim_conn_t *conn = conn_find_bda(remote_device);
+    if (conn == NULL) {
+        sim_unlock();
+        return ESP_FAIL;
+    }
+    if (!s_central.silent) {
+        sim_ll_proc_t *proc = &conn->data_len;
+        proc->pending = true;
+        proc->ok = s_central.max_data_len != 0;
+        uint16_t len = tx_data_length < s_central.max_data_len ? tx_data_length : s_central.max_data_len;
+        proc->value = len < SIM_LL_DATA_LEN_DEFAULT ? SIM_LL_DATA_LEN_DEFAULT : len;
+        uint64_t now = sim_now_us();
+        proc->due_us = link_next_event_after(conn, now) + (SIM_LL_DATA_LEN_EVENTS - 1) * link_interval_us(conn);
+    }
+    sim_unlock();
+    return ESP_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Client side
+bool sim_connect(uint16_t conn_id, const esp_bd_addr_t bda)
+{
+    sim_lock();
+    if (!s_advertising || conn_find(conn_id) != NULL) {
+        sim_unlock();
+        return false;
+    }
+    sim_conn_t *conn = NULL;
+    for (int i = 0; i < SIM_MAX_CONNS; i++) {
+        if (!s_conns[i].connected) {
+            conn = &s_conns[i];
+            break;
+        }
+    }
+    if (conn == NULL) {
+        sim_unlock();
+        return false;
+    }
+    char hex[2 * ESP_BD_ADDR_LEN + 1];
+    sim_trace_peer("CONNECT conn=%u bda=%s", conn_id, sim_trace_hex(hex, bda, ESP_BD_ADDR_LEN));
+    // Connectable advertising ends when a central connects
+    s_advertising = false;
+
+    memset(conn, 0, sizeof(*conn));
+    conn->connected = true;
+    conn->conn_id = conn_id;
+    memcpy(conn->bda, bda, ESP_BD_ADDR_LEN);
+    conn->mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+    conn->params.interval = 0x18; // 30ms, a typical central default
+    conn->params.latency = 0;
+    conn->params.timeout = 400;
+    conn->phy = ESP_BLE_GAP_PHY_1M;
+    conn->tx_octets = SIM_LL_DATA_LEN_DEFAULT;
+    conn->anchor_us = sim_now_us();
+
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.connect.conn_id = conn_id;
+    p.connect.link_role = 1; // slave
+    memcpy(p.connect.remote_bda, bda, ESP_BD_ADDR_LEN);
+    p.connect.conn_params = conn->params;
+    p.connect.ble_addr_type = BLE_ADDR_TYPE_PUBLIC;
+    p.connect.conn_handle = conn_id;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_CONNECT_EVT, &p, NULL, 0);
+    sim_run_pending();
+    return true;
+}
+
+bool sim_connect_scanned(uint16_t conn_id, const esp_bd_addr_t bda, uint32_t timeout_ms)
+{
+    uint64_t start = sim_now_us();
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000;
+    sim_lock();
+    // where in its scan interval the central is when it starts
+    uint64_t phase = adv_rand(s_scan_interval_us);
+    sim_unlock();
+    for (;;) {
+        uint64_t now = sim_now_us();
+        sim_lock();
+        bool advertising = s_advertising;
+        uint32_t epoch = s_adv_epoch;
+        while (advertising && s_adv_next_us < now) {
+            s_adv_next_us += s_adv_interval_us + adv_delay_us();
+        }
+        uint64_t event = s_adv_next_us;
+        sim_unlock();
+        if (!advertising || event > deadline) {
+            if (now >= deadline) {
+                return false;
+            }
+            // wait for advertising to (re)start
+            sim_advance_us(deadline - now < 250 ? deadline - now : 250);
+            continue;
+        }
+        if (event > now) {
+            sim_advance_us(event - now);
+        }
+        sim_lock();
+        bool heard = s_advertising && s_adv_epoch == epoch
+            && (event - start + phase) % s_scan_interval_us < s_scan_window_us;
+        if (s_advertising && s_adv_epoch == epoch && s_adv_next_us == event) {
+            s_adv_next_us = event + s_adv_interval_us + adv_delay_us();
+        }
+        sim_unlock();
+        if (heard) {
+            return sim_connect(conn_id, bda);
+        }
+    }
+}
+
+static void disconnect(uint16_t conn_id, esp_gatt_conn_reason_t reason)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn == NULL) {
+        sim_unlock();
+        return;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.disconnect.conn_id = conn_id;
+    memcpy(p.disconnect.remote_bda, conn->bda, ESP_BD_ADDR_LEN);
+    p.disconnect.reason = reason;
+    conn->connected = false;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_DISCONNECT_EVT, &p, NULL, 0);
+}
+
+void sim_disconnect(uint16_t conn_id)
+{
+    sim_lock();
+    if (conn_find(conn_id) != NULL) {
+        sim_trace_peer("DISCONNECT conn=%u", conn_id);
+    }
+    sim_unlock();
+    disconnect(conn_id, ESP_GATT_CONN_TERMINATE_PEER_USER);
+    sim_run_pending();
+}
+
+esp_err_t esp_ble_gatts_close(esp_gatt_if_t gatts_if, uint16_t conn_id)
+{
+    if (gatts_if != SIM_GATTS_IF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Delivered on the next sim_run_pending(), like any stack event
+    disconnect(conn_id, ESP_GATT_CONN_TERMINATE_LOCAL_HOST);
+    return ESP_OK;
+}
+
+void sim_set_mtu(uint16_t conn_id, uint16_t mtu)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn == NULL) {
+        sim_unlock();
+        return;
+    }
+    sim_trace_peer("MTU conn=%u mtu=%u", conn_id, mtu);
+    // Exchange MTU settles on the smaller of the two sides
+    conn->mtu = mtu < s_local_mtu ? mtu : s_local_mtu;
+    if (conn->mtu < ESP_GATT_DEF_BLE_MTU_SIZE) {
+        conn->mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.mtu.conn_id = conn_id;
+    p.mtu.mtu = conn->mtu;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_MTU_EVT, &p, NULL, 0);
+    sim_run_pending();
+}
+
+uint16_t sim_negotiated_mtu(uint16_t conn_id)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    uint16_t mtu = conn != NULL ? conn->mtu : 0;
+    sim_unlock();
+    return mtu;
+}
+
+void sim_write(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len, bool need_rsp)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn == NULL) {
+        sim_unlock();
+        return;
+    }
+    if (sim_trace_recording()) {
+        char hex[2 * ESP_GATT_MAX_ATTR_LEN + 1];
+        sim_trace_peer("WRITE conn=%u handle=%u rsp=%d value=%s", conn_id, handle, need_rsp
+                       , sim_trace_hex(hex, value, len < ESP_GATT_MAX_ATTR_LEN ? len : ESP_GATT_MAX_ATTR_LEN));
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.write.conn_id = conn_id;
+    p.write.trans_id = ++s_trans_id;
+    memcpy(p.write.bda, conn->bda, ESP_BD_ADDR_LEN);
+    p.write.handle = handle;
+    p.write.offset = 0;
+    p.write.need_rsp = need_rsp;
+    p.write.is_prep = false;
+    p.write.len = len;
+
+    sim_stats_t *stats = sim_stats_mut();
+    stats->writes_delivered++;
+    stats->write_bytes += len;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_WRITE_EVT, &p, value, len);
+    sim_run_pending();
+}
+
+uint16_t sim_read(uint16_t conn_id, uint16_t handle, uint8_t *value, uint16_t cap)
+{
+    // ATT Read, then Read Blob at increasing offsets while the answers fill
+    // the MTU, as a central's long read does
+    sim_lock();
+    if (conn_find(conn_id) != NULL) {
+        sim_trace_peer("READ conn=%u handle=%u cap=%u", conn_id, handle, cap);
+    }
+    sim_unlock();
+    uint16_t total = 0;
+    for (;;) {
+        sim_lock();
+        sim_conn_t *conn = conn_find(conn_id);
+        if (conn == NULL) {
+            sim_unlock();
+            return 0;
+        }
+        uint16_t chunk_max = (uint16_t)(conn->mtu - 1);
+        esp_ble_gatts_cb_param_t p = { 0 };
+        p.read.conn_id = conn_id;
+        p.read.trans_id = ++s_trans_id;
+        memcpy(p.read.bda, conn->bda, ESP_BD_ADDR_LEN);
+        p.read.handle = handle;
+        p.read.offset = total;
+        p.read.is_long = total > 0;
+        p.read.need_rsp = true;
+        s_last_rsp_len = 0;
+        s_last_rsp_status = ESP_GATT_ERROR;
+        sim_unlock();
+
+        sim_post_gatts(ESP_GATTS_READ_EVT, &p, NULL, 0);
+        sim_run_pending();
+
+        sim_lock();
+        if (s_last_rsp_status != ESP_GATT_OK) {
+            sim_unlock();
+            return 0;
+        }
+        uint16_t len = s_last_rsp_len < chunk_max ? s_last_rsp_len : chunk_max;
+        uint16_t copy = total + len > cap ? (uint16_t)(cap - total) : len;
+        memcpy(value + total, s_last_rsp_value, copy);
+        total = (uint16_t)(total + copy);
+        sim_unlock();
+        if (len < chunk_max || total == cap) {
+            return total;
+        }
+    }
+}
+
+esp_gatt_status_t sim_prepare_write(uint16_t conn_id, uint16_t handle, uint16_t offset, const uint8_t *value, uint16_t len)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn == NULL) {
+        sim_unlock();
+        return ESP_GATT_ERROR;
+    }
+    if (sim_trace_recording()) {
+        char hex[2 * ESP_GATT_MAX_ATTR_LEN + 1];
+        sim_trace_peer("PREPARE conn=%u handle=%u offset=%u value=%s", conn_id, handle, offset
+                       , sim_trace_hex(hex, value, len < ESP_GATT_MAX_ATTR_LEN ? len : ESP_GATT_MAX_ATTR_LEN));
+    }
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.write.conn_id = conn_id;
+    p.write.trans_id = ++s_trans_id;
+    memcpy(p.write.bda, conn->bda, ESP_BD_ADDR_LEN);
+    p.write.handle = handle;
+    p.write.offset = offset;
+    p.write.need_rsp = true;
+    p.write.is_prep = true;
+    p.write.len = len;
+    s_last_rsp_len = 0;
+    s_last_rsp_status = ESP_GATT_ERROR;
+
+    sim_stats_t *stats = sim_stats_mut();
+    stats->writes_delivered++;
+    stats->write_bytes += len;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_WRITE_EVT, &p, value, len);
+    sim_run_pending();
+
+    // the response must echo the piece, as a central checks for reliable writes
+    sim_lock();
+    esp_gatt_status_t status = s_last_rsp_status;
+    if (status == ESP_GATT_OK && (s_last_rsp_len != len || memcmp(s_last_rsp_value, value, len) != 0)) {
+        status = ESP_GATT_ERROR;
+    }
+    sim_unlock();
+    return status;
+}
+
+esp_gatt_status_t sim_execute_write(uint16_t conn_id, bool execute)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn == NULL) {
+        sim_unlock();
+        return ESP_GATT_ERROR;
+    }
+    sim_trace_peer("EXECUTE conn=%u execute=%d", conn_id, execute);
+    esp_ble_gatts_cb_param_t p = { 0 };
+    p.exec_write.conn_id = conn_id;
+    p.exec_write.trans_id = ++s_trans_id;
+    memcpy(p.exec_write.bda, conn->bda, ESP_BD_ADDR_LEN);
+    p.exec_write.exec_write_flag = execute ? ESP_GATT_PREP_WRITE_EXEC : ESP_GATT_PREP_WRITE_CANCEL;
+    s_last_rsp_status = ESP_GATT_ERROR;
+    sim_unlock();
+
+    sim_post_gatts(ESP_GATTS_EXEC_WRITE_EVT, &p, NULL, 0);
+    sim_run_pending();
+    return sim_last_response_status();
+}
+
+uint32_t sim_att_air_us(uint16_t conn_id, uint16_t att_len)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    uint32_t us = 0;
+    if (conn != NULL) {
+        uint32_t remaining = att_len + 4u; // L2CAP header
+        while (remaining > 0) {
+            uint16_t frag = (uint16_t)(remaining < conn->tx_octets ? remaining : conn->tx_octets);
+            us += link_pdu_exchange_us(conn, frag);
+            remaining -= frag;
+        }
+    }
+    sim_unlock();
+    return us;
+}
+
+esp_gatt_status_t sim_last_response_status(void)
+{
+    sim_lock();
+    esp_gatt_status_t status = s_last_rsp_status;
+    sim_unlock();
+    return status;
+}
+
+bool sim_link(uint16_t conn_id, sim_link_t *link)
+{
+    sim_lock();
+    sim_conn_t *conn = conn_find(conn_id);
+    if (conn != NULL) {
+        link->params = conn->params;
+        link->phy = conn->phy;
+        link->tx_octets = conn->tx_octets;
+    }
+    sim_unlock();
+    return conn != NULL;
+}
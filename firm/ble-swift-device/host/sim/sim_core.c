@@ -0,0 +1,447 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "sdkconfig.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "sim_internal.h"
+
+//-----------------------------------------------------------------------------
+// Lock and statistics
+static pthread_mutex_t s_lock;
+static pthread_once_t s_lock_once = PTHREAD_ONCE_INIT;
+
+static void lock_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void sim_lock(void)
+{
+    pthread_once(&s_lock_once, lock_init);
+    pthread_mutex_lock(&s_lock);
+}
+
+void sim_unlock(void)
+{
+    pthread_mutex_unlock(&s_lock);
+}
+
+static sim_stats_t s_stats;
+
+sim_stats_t *sim_stats_mut(void)
+{
+    return &s_stats;
+}
+
+const sim_stats_t *sim_stats(void)
+{
+    return &s_stats;
+}
+
+void sim_stats_reset(void)
+{
+    sim_lock();
+    const char *names[SIM_MAX_TIMERS];
+    memcpy(names, s_stats.timer_name, sizeof(names));
+    memset(&s_stats, 0, sizeof(s_stats));
+    memcpy(s_stats.timer_name, names, sizeof(names));
+    sim_unlock();
+}
+
+uint64_t sim_host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void sim_cost_add(sim_cost_t *cost, uint64_t ns)
+{
+    cost->count++;
+    cost->total_ns += ns;
+    if (ns > cost->max_ns) {
+        cost->max_ns = ns;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Virtual clock
+static uint64_t s_now_us;
+
+uint64_t sim_now_us(void)
+{
+    return __atomic_load_n(&s_now_us, __ATOMIC_ACQUIRE);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)sim_now_us();
+}
+
+//-----------------------------------------------------------------------------
+// Event queue
+#define SIM_EVENT_QUEUE_LEN 1024
+#define SIM_EVENT_HELD_MAX  64
+
+typedef struct {
+    bool is_gap;
+    int event;
+    uint64_t due_us;
+    union {
+        esp_ble_gatts_cb_param_t gatts;
+        esp_ble_gap_cb_param_t gap;
+    } param;
+    uint16_t value_len;
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+} sim_event_t;
+
+static sim_event_t s_events[SIM_EVENT_QUEUE_LEN];
+static uint32_t s_event_head;
+static uint32_t s_event_tail;
+
+static uint32_t s_reply_us;
+static sim_event_filter_t s_filter;
+static void *s_filter_ctx;
+static sim_event_t s_held[SIM_EVENT_HELD_MAX];
+static int s_held_count;
+
+static sim_event_t *event_push(void)
+{
+    if (s_event_tail - s_event_head >= SIM_EVENT_QUEUE_LEN) {
+        fprintf(stderr, "sim: event queue overflow\n");
+        abort();
+    }
+    sim_event_t *ev = &s_events[s_event_tail % SIM_EVENT_QUEUE_LEN];
+    s_event_tail++;
+    return ev;
+}
+
+static void post_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param,
+                       const uint8_t *value, uint16_t len, uint64_t delay_us)
+{
+    sim_lock();
+    sim_event_t *ev = event_push();
+    ev->is_gap = false;
+    ev->event = event;
+    ev->due_us = sim_now_us() + delay_us;
+    ev->param.gatts = *param;
+    ev->value_len = 0;
+    if (value != NULL && len > 0) {
+        if (len > sizeof(ev->value)) {
+            len = sizeof(ev->value);
+        }
+        memcpy(ev->value, value, len);
+        ev->value_len = len;
+    }
+    sim_unlock();
+}
+
+static void post_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param, uint64_t delay_us)
+{
+    sim_lock();
+    sim_event_t *ev = event_push();
+    ev->is_gap = true;
+    ev->event = event;
+    ev->due_us = sim_now_us() + delay_us;
+    ev->param.gap = *param;
+    ev->value_len = 0;
+    sim_unlock();
+}
+
+void sim_post_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param,
+                    const uint8_t *value, uint16_t len)
+{
+    post_gatts(event, param, value, len, 0);
+}
+
+void sim_post_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param)
+{
+    post_gap(event, param, 0);
+}
+
+void sim_post_gatts_reply(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param)
+{
+    post_gatts(event, param, NULL, 0, s_reply_us);
+}
+
+void sim_post_gap_reply(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param)
+{
+    post_gap(event, param, s_reply_us);
+}
+
+void sim_set_stack_reply_us(uint32_t us)
+{
+    s_reply_us = us;
+}
+
+uint32_t sim_stack_reply_us(void)
+{
+    return s_reply_us;
+}
+
+//-----------------------------------------------------------------------------
+// Boot steps
+static uint32_t s_boot_cost_us[SIM_BOOT_STEP_MAX];
+static uint64_t s_boot_done_us[SIM_BOOT_STEP_MAX];
+static bool s_boot_done[SIM_BOOT_STEP_MAX];
+
+void sim_set_boot_cost_us(sim_boot_step_t step, uint32_t us)
+{
+    if (step < SIM_BOOT_STEP_MAX) {
+        s_boot_cost_us[step] = us;
+    }
+}
+
+uint64_t sim_boot_step_done_us(sim_boot_step_t step)
+{
+    return step < SIM_BOOT_STEP_MAX && s_boot_done[step] ? s_boot_done_us[step] : UINT64_MAX;
+}
+
+void sim_boot_step(sim_boot_step_t step)
+{
+    sim_charge_blocking_us(s_boot_cost_us[step]);
+    s_boot_done_us[step] = sim_now_us();
+    s_boot_done[step] = true;
+}
+
+uint64_t sim_events_next_due_us(void)
+{
+    sim_lock();
+    uint64_t due = s_event_head != s_event_tail ? s_events[s_event_head % SIM_EVENT_QUEUE_LEN].due_us : UINT64_MAX;
+    sim_unlock();
+    return due;
+}
+
+void sim_set_event_filter(sim_event_filter_t filter, void *ctx)
+{
+    sim_lock();
+    s_filter = filter;
+    s_filter_ctx = ctx;
+    sim_unlock();
+}
+
+int sim_release_held(void)
+{
+    sim_lock();
+    int count = s_held_count;
+    sim_trace_peer("RELEASE count=%d", count);
+    for (int i = 0; i < count; i++) {
+        *event_push() = s_held[i];
+    }
+    s_held_count = 0;
+    sim_unlock();
+    return count;
+}
+
+void sim_inject_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param,
+                      const uint8_t *value, uint16_t len)
+{
+    sim_post_gatts(event, param, value, len);
+}
+
+void sim_inject_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param)
+{
+    sim_post_gap(event, param);
+}
+
+static void dispatch(sim_event_t *ev)
+{
+    if (ev->is_gap) {
+        sim_trace_gap((esp_gap_ble_cb_event_t)ev->event, &ev->param.gap);
+        sim_bt_dispatch_gap((esp_gap_ble_cb_event_t)ev->event, &ev->param.gap);
+    } else {
+        if (ev->event == ESP_GATTS_WRITE_EVT) {
+            ev->param.gatts.write.value = ev->value;
+            ev->param.gatts.write.len = ev->value_len;
+        }
+        sim_trace_gatts((esp_gatts_cb_event_t)ev->event, &ev->param.gatts);
+        sim_bt_dispatch_gatts((esp_gatts_cb_event_t)ev->event, &ev->param.gatts);
+    }
+}
+
+// Whether the event at the head of the queue is due; the ones behind it wait
+// their turn, as the stack hands its callbacks over from a single task.
+static bool event_due(void)
+{
+    sim_lock();
+    bool due = s_event_head != s_event_tail && s_events[s_event_head % SIM_EVENT_QUEUE_LEN].due_us <= sim_now_us();
+    sim_unlock();
+    return due;
+}
+
+void sim_run_pending(void)
+{
+    // Dispatch until both the event queue and every task are idle; tasks may
+    // post new events (e.g. notifications) while they run.
+    for (;;) {
+        sim_tasks_settle();
+        if (!event_due()) {
+            break;
+        }
+        sim_event_t ev;
+        sim_lock();
+        if (s_event_head == s_event_tail) {
+            sim_unlock();
+            continue;
+        }
+        ev = s_events[s_event_head % SIM_EVENT_QUEUE_LEN];
+        s_event_head++;
+        sim_event_filter_t filter = s_filter;
+        void *filter_ctx = s_filter_ctx;
+        sim_unlock();
+
+        sim_event_action_t action = SIM_EVENT_DELIVER;
+        if (filter != NULL) {
+            action = filter(ev.is_gap, ev.event, &ev.param, filter_ctx);
+        }
+        switch (action) {
+            case SIM_EVENT_DROP:
+                break;
+            case SIM_EVENT_HOLD:
+                sim_lock();
+                if (s_held_count >= SIM_EVENT_HELD_MAX) {
+                    fprintf(stderr, "sim: too many held events\n");
+                    abort();
+                }
+                s_held[s_held_count++] = ev;
+                sim_unlock();
+                break;
+            case SIM_EVENT_DUPLICATE: {
+                sim_event_t again = ev;
+                dispatch(&ev);
+                dispatch(&again);
+                break;
+            }
+            default:
+                dispatch(&ev);
+                break;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Clock advance
+void sim_advance_us(uint64_t us)
+{
+    uint64_t target = sim_now_us() + us;
+    sim_run_pending();
+    for (;;) {
+        uint64_t next = sim_timers_next_expiry_us();
+        uint64_t next_task = sim_tasks_next_deadline_us();
+        if (next_task < next) {
+            next = next_task;
+        }
+        uint64_t next_link = sim_link_next_event_us();
+        if (next_link < next) {
+            next = next_link;
+        }
+        uint64_t next_event = sim_events_next_due_us();
+        if (next_event < next) {
+            next = next_event;
+        }
+        if (next > target) {
+            break;
+        }
+        if (next > sim_now_us()) {
+            __atomic_store_n(&s_now_us, next, __ATOMIC_RELEASE);
+        }
+        sim_tasks_wake_due(sim_now_us());
+        sim_run_pending();
+        sim_link_run_due(sim_now_us());
+        sim_run_pending();
+        sim_timers_fire_due(sim_now_us());
+        sim_run_pending();
+    }
+    __atomic_store_n(&s_now_us, target, __ATOMIC_RELEASE);
+    sim_run_pending();
+}
+
+void sim_advance_ms(uint32_t ms)
+{
+    sim_advance_us((uint64_t)ms * 1000);
+}
+
+//-----------------------------------------------------------------------------
+// esp_log / esp_err
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static uint32_t s_log_uart_baud;
+
+void sim_set_log_level(esp_log_level_t level)
+{
+    s_log_level = level;
+}
+
+void sim_set_log_uart_baud(uint32_t baud)
+{
+    s_log_uart_baud = baud;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(sim_now_us() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    __atomic_fetch_add(&s_stats.log_lines, 1, __ATOMIC_RELAXED);
+    if (s_log_uart_baud > 0 && level <= CONFIG_LOG_DEFAULT_LEVEL) {
+        // "I (12345) tag: line\r\n" on the wire
+        uint64_t bytes = (uint64_t)snprintf(NULL, 0, "%c (%" PRIu32 ") %s: %s\r\n", letters[level], esp_log_timestamp(), tag, line);
+        uint64_t ns = bytes * 10 * 1000000000ull / s_log_uart_baud;
+        __atomic_fetch_add(&s_stats.log_uart_bytes, bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&s_stats.log_uart_ns, ns, __ATOMIC_RELAXED);
+        if (!sim_bt_charge_handler_ns(ns)) {
+            sim_charge_busy_us(ns / 1000);
+        }
+    }
+    if (level <= s_log_level) {
+        printf("%c (%" PRIu32 ") %s: %s\n", letters[level], esp_log_timestamp(), tag, line);
+    }
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_KEY_TOO_LONG: return "ESP_ERR_NVS_KEY_TOO_LONG";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        default: return "UNKNOWN ERROR";
+    }
+}
@@ -0,0 +1,611 @@
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+#include "sim_internal.h"
+
+#define US_PER_TICK (1000000ull / configTICK_RATE_HZ)
+
+//-----------------------------------------------------------------------------
+// Ticks
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_now_us() / US_PER_TICK);
+}
+
+//-----------------------------------------------------------------------------
+// Tasks
+//
+// s_running counts tasks that are not blocked. A blocked task waits on its own
+// condition variable until it is notified or its virtual deadline passes.
+#define SIM_MAX_TASKS 8
+
+struct sim_task {
+    pthread_t thread;
+    const char *name;
+    TaskFunction_t fn;
+    void *param;
+    pthread_cond_t cond;
+    uint32_t notify;
+    bool blocked;
+    bool wake_on_notify;
+    bool wake;
+    uint64_t deadline_us;
+    uint64_t busy_us;           // charged stack calls, slept off before the next wait
+};
+
+static struct sim_task s_tasks[SIM_MAX_TASKS];
+static int s_task_count;
+static int s_running;
+static pthread_mutex_t s_task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_idle_cond = PTHREAD_COND_INITIALIZER;
+static __thread struct sim_task *s_current_task;
+
+static void *task_entry(void *arg)
+{
+    struct sim_task *task = arg;
+    s_current_task = task;
+    task->fn(task->param);
+    // FreeRTOS tasks must not return; treat it as the task deleting itself
+    pthread_mutex_lock(&s_task_lock);
+    s_running--;
+    pthread_cond_broadcast(&s_idle_cond);
+    pthread_mutex_unlock(&s_task_lock);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID)
+{
+    (void)usStackDepth;
+    (void)uxPriority;
+    (void)xCoreID;
+    pthread_mutex_lock(&s_task_lock);
+    if (s_task_count >= SIM_MAX_TASKS) {
+        pthread_mutex_unlock(&s_task_lock);
+        return pdFAIL;
+    }
+    struct sim_task *task = &s_tasks[s_task_count++];
+    task->name = pcName;
+    task->fn = pxTaskCode;
+    task->param = pvParameters;
+    task->deadline_us = UINT64_MAX;
+    pthread_cond_init(&task->cond, NULL);
+    s_running++;
+    pthread_mutex_unlock(&s_task_lock);
+
+    if (pxCreatedTask != NULL) {
+        *pxCreatedTask = task;
+    }
+    pthread_create(&task->thread, NULL, task_entry, task);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority,
+                                   pxCreatedTask, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current_task;
+}
+
+// Called with s_task_lock held; returns once woken.
+static void task_block_until(struct sim_task *task, uint64_t deadline_us, bool wake_on_notify)
+{
+    task->blocked = true;
+    task->wake = false;
+    task->wake_on_notify = wake_on_notify;
+    task->deadline_us = deadline_us;
+    s_running--;
+    pthread_cond_broadcast(&s_idle_cond);
+    while (!task->wake) {
+        pthread_cond_wait(&task->cond, &s_task_lock);
+    }
+    task->blocked = false;
+    task->deadline_us = UINT64_MAX;
+}
+
+static void task_block(struct sim_task *task, TickType_t ticks, bool wake_on_notify)
+{
+    task_block_until(task, ticks == portMAX_DELAY ? UINT64_MAX : sim_now_us() + (uint64_t)ticks * US_PER_TICK, wake_on_notify);
+}
+
+// Called with s_task_lock held.
+static void task_wake(struct sim_task *task)
+{
+    task->wake = true;
+    s_running++;
+    pthread_cond_signal(&task->cond);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    struct sim_task *task = s_current_task;
+    if (task == NULL || (xTaskToDelete != NULL && xTaskToDelete != task)) {
+        return; // only a task deleting itself is simulated
+    }
+    pthread_mutex_lock(&s_task_lock);
+    s_running--;
+    pthread_cond_broadcast(&s_idle_cond);
+    pthread_mutex_unlock(&s_task_lock);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    struct sim_task *task = s_current_task;
+    if (task == NULL) {
+        // Not a simulated task (e.g. the harness thread): nothing to wait for
+        sched_yield();
+        return;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    // sleeps off what it was charged, then the delay
+    uint64_t busy_us = task->busy_us;
+    task->busy_us = 0;
+    if (xTicksToDelay == portMAX_DELAY) {
+        task_block(task, xTicksToDelay, false);
+    } else {
+        task_block_until(task, sim_now_us() + busy_us + (uint64_t)xTicksToDelay * US_PER_TICK, false);
+    }
+    pthread_mutex_unlock(&s_task_lock);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    *pxPreviousWakeTime = wake;
+    struct sim_task *task = s_current_task;
+    uint64_t wake_us = (uint64_t)wake * US_PER_TICK;
+    if (task == NULL || wake_us <= sim_now_us()) {
+        return pdFALSE;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    task_block_until(task, wake_us, false);
+    pthread_mutex_unlock(&s_task_lock);
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    struct sim_task *task = s_current_task;
+    if (task == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    if (task->busy_us > 0) {
+        // still inside its stack calls: notifications pile up meanwhile
+        uint64_t busy_us = task->busy_us;
+        task->busy_us = 0;
+        task_block_until(task, sim_now_us() + busy_us, false);
+    }
+    if (task->notify == 0 && xTicksToWait != 0) {
+        task_block(task, xTicksToWait, true);
+    }
+    uint32_t value = task->notify;
+    if (value > 0) {
+        task->notify = xClearCountOnExit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&s_task_lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    if (xTaskToNotify == NULL) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    xTaskToNotify->notify++;
+    if (xTaskToNotify->blocked && xTaskToNotify->wake_on_notify && !xTaskToNotify->wake) {
+        task_wake(xTaskToNotify);
+    }
+    pthread_mutex_unlock(&s_task_lock);
+    return pdPASS;
+}
+
+void sim_tasks_settle(void)
+{
+    pthread_mutex_lock(&s_task_lock);
+    while (s_running > 0) {
+        pthread_cond_wait(&s_idle_cond, &s_task_lock);
+    }
+    pthread_mutex_unlock(&s_task_lock);
+}
+
+uint64_t sim_tasks_next_deadline_us(void)
+{
+    uint64_t next = UINT64_MAX;
+    pthread_mutex_lock(&s_task_lock);
+    for (int i = 0; i < s_task_count; i++) {
+        if (s_tasks[i].blocked && !s_tasks[i].wake && s_tasks[i].deadline_us < next) {
+            next = s_tasks[i].deadline_us;
+        }
+    }
+    pthread_mutex_unlock(&s_task_lock);
+    return next;
+}
+
+void sim_tasks_wake_due(uint64_t now_us)
+{
+    pthread_mutex_lock(&s_task_lock);
+    for (int i = 0; i < s_task_count; i++) {
+        if (s_tasks[i].blocked && !s_tasks[i].wake && s_tasks[i].deadline_us <= now_us) {
+            task_wake(&s_tasks[i]);
+        }
+    }
+    pthread_mutex_unlock(&s_task_lock);
+}
+
+//-----------------------------------------------------------------------------
+// Software timers
+struct sim_timer {
+    const char *name;
+    TickType_t period;
+    bool auto_reload;
+    bool active;
+    bool in_use;
+    void *id;
+    TimerCallbackFunction_t callback;
+    uint64_t expiry_us;
+    int slot;
+};
+
+static struct sim_timer s_timers[SIM_MAX_TIMERS];
+
+// The timer service task: callbacks run one after another, so stack calls
+// charged to one hold back every timer due before it ends.
+static __thread bool s_in_timer_callback;
+static uint64_t s_timer_task_busy_us;   // charged by the running callback
+static uint64_t s_timer_task_free_us;   // virtual time the last callback ended
+
+static uint32_t s_stack_call_us;
+
+void sim_set_stack_call_us(uint32_t us)
+{
+    s_stack_call_us = us;
+}
+
+void sim_charge_stack_call(void)
+{
+    if (s_stack_call_us > 0) {
+        sim_charge_busy_us(s_stack_call_us);
+    }
+}
+
+bool sim_charge_busy_us(uint64_t us)
+{
+    if (s_in_timer_callback) {
+        s_timer_task_busy_us += us;
+        return true;
+    }
+    struct sim_task *task = s_current_task;
+    if (task == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    task->busy_us += us;
+    pthread_mutex_unlock(&s_task_lock);
+    return true;
+}
+
+void sim_charge_blocking_us(uint64_t us)
+{
+    if (us == 0) {
+        return;
+    }
+    if (s_in_timer_callback) {
+        s_timer_task_busy_us += us;
+        return;
+    }
+    struct sim_task *task = s_current_task;
+    if (task == NULL) {
+        sim_advance_us(us);
+        return;
+    }
+    pthread_mutex_lock(&s_task_lock);
+    task_block_until(task, sim_now_us() + us, false);
+    pthread_mutex_unlock(&s_task_lock);
+}
+
+TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriodInTicks,
+                           UBaseType_t uxAutoReload, void *pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction)
+{
+    if (xTimerPeriodInTicks == 0 || pxCallbackFunction == NULL) {
+        return NULL;
+    }
+    sim_lock();
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (!s_timers[i].in_use) {
+            struct sim_timer *t = &s_timers[i];
+            memset(t, 0, sizeof(*t));
+            t->in_use = true;
+            t->name = pcTimerName;
+            t->period = xTimerPeriodInTicks;
+            t->auto_reload = uxAutoReload != pdFALSE;
+            t->id = pvTimerID;
+            t->callback = pxCallbackFunction;
+            t->slot = i;
+            sim_stats_mut()->timer_name[i] = pcTimerName;
+            sim_unlock();
+            return t;
+        }
+    }
+    sim_unlock();
+    return NULL;
+}
+
+static BaseType_t timer_arm(TimerHandle_t xTimer)
+{
+    if (xTimer == NULL) {
+        return pdFAIL;
+    }
+    sim_lock();
+    xTimer->active = true;
+    xTimer->expiry_us = sim_now_us() + (uint64_t)xTimer->period * US_PER_TICK;
+    sim_unlock();
+    return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    return timer_arm(xTimer);
+}
+
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    return timer_arm(xTimer);
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    if (xTimer == NULL) {
+        return pdFAIL;
+    }
+    sim_lock();
+    xTimer->active = false;
+    sim_unlock();
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    if (xTimer == NULL || xNewPeriod == 0) {
+        return pdFAIL;
+    }
+    // As in FreeRTOS, changing the period also starts a dormant timer.
+    sim_lock();
+    xTimer->period = xNewPeriod;
+    sim_unlock();
+    return timer_arm(xTimer);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    if (xTimer == NULL) {
+        return pdFAIL;
+    }
+    sim_lock();
+    xTimer->active = false;
+    xTimer->in_use = false;
+    sim_unlock();
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+    return (xTimer != NULL && xTimer->active) ? pdTRUE : pdFALSE;
+}
+
+TickType_t xTimerGetPeriod(TimerHandle_t xTimer)
+{
+    return xTimer->period;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t xTimer)
+{
+    return xTimer->id;
+}
+
+const char *pcTimerGetName(TimerHandle_t xTimer)
+{
+    return xTimer->name;
+}
+
+uint64_t sim_timers_next_expiry_us(void)
+{
+    uint64_t next = UINT64_MAX;
+    sim_lock();
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (s_timers[i].in_use && s_timers[i].active && s_timers[i].expiry_us < next) {
+            next = s_timers[i].expiry_us;
+        }
+    }
+    if (next != UINT64_MAX && next < s_timer_task_free_us) {
+        next = s_timer_task_free_us;
+    }
+    sim_unlock();
+    return next;
+}
+
+void sim_timers_fire_due(uint64_t now_us)
+{
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        struct sim_timer *t = &s_timers[i];
+        sim_lock();
+        bool due = t->in_use && t->active && t->expiry_us <= now_us && s_timer_task_free_us <= now_us;
+        uint64_t expiry_us = t->expiry_us;
+        if (due) {
+            if (t->auto_reload) {
+                t->expiry_us += (uint64_t)t->period * US_PER_TICK;
+            } else {
+                t->active = false;
+            }
+        }
+        sim_unlock();
+        if (!due) {
+            continue;
+        }
+
+        s_timer_task_busy_us = 0;
+        s_in_timer_callback = true;
+        uint64_t start = sim_host_ns();
+        t->callback(t);
+        uint64_t elapsed = sim_host_ns() - start;
+        s_in_timer_callback = false;
+        s_timer_task_free_us = now_us + s_timer_task_busy_us;
+
+        sim_lock();
+        sim_cost_add(&sim_stats_mut()->timer[t->slot], elapsed);
+        sim_cost_add(&sim_stats_mut()->timer_late[t->slot], (now_us - expiry_us) * 1000);
+        sim_unlock();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Queues
+struct sim_queue {
+    pthread_mutex_t lock;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    if (uxQueueLength == 0 || uxItemSize == 0) {
+        return NULL;
+    }
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return NULL;
+    }
+    q->storage = calloc(uxQueueLength, uxItemSize);
+    if (q->storage == NULL) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    q->length = uxQueueLength;
+    q->item_size = uxItemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if (xQueue == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&xQueue->lock);
+    free(xQueue->storage);
+    free(xQueue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    BaseType_t ret = errQUEUE_FULL;
+    pthread_mutex_lock(&xQueue->lock);
+    if (xQueue->count < xQueue->length) {
+        UBaseType_t slot = (xQueue->head + xQueue->count) % xQueue->length;
+        memcpy(xQueue->storage + slot * xQueue->item_size, pvItemToQueue, xQueue->item_size);
+        xQueue->count++;
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return ret;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+{
+    // Only defined for queues of length one
+    pthread_mutex_lock(&xQueue->lock);
+    memcpy(xQueue->storage, pvItemToQueue, xQueue->item_size);
+    xQueue->head = 0;
+    xQueue->count = 1;
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    (void)xTicksToWait;
+    BaseType_t ret = pdFALSE;
+    pthread_mutex_lock(&xQueue->lock);
+    if (xQueue->count > 0) {
+        memcpy(pvBuffer, xQueue->storage + xQueue->head * xQueue->item_size, xQueue->item_size);
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return ret;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+// Mutexes
+struct sim_mutex {
+    pthread_mutex_t lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct sim_mutex *m = calloc(1, sizeof(*m));
+    if (m != NULL) {
+        pthread_mutex_init(&m->lock, NULL);
+    }
+    return m;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    if (xSemaphore != NULL) {
+        pthread_mutex_destroy(&xSemaphore->lock);
+        free(xSemaphore);
+    }
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    if (xBlockTime == 0) {
+        return pthread_mutex_trylock(&xSemaphore->lock) == 0 ? pdTRUE : pdFALSE;
+    }
+    // Holders never wait on virtual time, so any finite timeout is as good as forever
+    pthread_mutex_lock(&xSemaphore->lock);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return pdTRUE;
+}
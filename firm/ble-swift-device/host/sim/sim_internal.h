@@ -0,0 +1,74 @@
+// Shared state between the simulator translation units.
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+
+#include "sim.h"
+
+// Serialises access to simulator state from firmware tasks and the harness.
+void sim_lock(void);
+void sim_unlock(void);
+
+sim_stats_t *sim_stats_mut(void);
+
+void sim_cost_add(sim_cost_t *cost, uint64_t ns);
+
+// Queue a stack event for dispatch; value is copied for write events.
+void sim_post_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param,
+                    const uint8_t *value, uint16_t len);
+void sim_post_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param);
+// The same for an event that answers one of the firmware's setup calls; it
+// is due sim_set_stack_reply_us() later.
+void sim_post_gatts_reply(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param);
+void sim_post_gap_reply(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param);
+// Due time of the next queued event, or UINT64_MAX.
+uint64_t sim_events_next_due_us(void);
+uint32_t sim_stack_reply_us(void);
+// Charges the step's boot cost to the caller and notes when it finished.
+void sim_boot_step(sim_boot_step_t step);
+
+// Implemented in sim_bt.c
+void sim_bt_dispatch_gatts(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t *param);
+void sim_bt_dispatch_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+// Earliest connection event with queued notifications, or UINT64_MAX.
+uint64_t sim_link_next_event_us(void);
+// Runs every connection event due at or before now_us.
+void sim_link_run_due(uint64_t now_us);
+
+// Implemented in sim_freertos.c
+// Earliest expiry of an active timer, or UINT64_MAX.
+uint64_t sim_timers_next_expiry_us(void);
+// Fires every timer due at or before now_us.
+void sim_timers_fire_due(uint64_t now_us);
+
+// Blocks until every simulated task is waiting (notification or delay).
+void sim_tasks_settle(void);
+// Earliest virtual deadline of a blocked task, or UINT64_MAX.
+uint64_t sim_tasks_next_deadline_us(void);
+// Wakes every task whose deadline is at or before now_us.
+void sim_tasks_wake_due(uint64_t now_us);
+// Charges one stack call (see sim_set_stack_call_us) to the calling context.
+void sim_charge_stack_call(void);
+// Charges us to a task or timer callback as sim_charge_stack_call does; false
+// from elsewhere (the harness, app_main, stack callbacks).
+bool sim_charge_busy_us(uint64_t us);
+// Keeps the caller busy for us: a task sleeps, a timer callback holds up the
+// timer service task, the harness advances the clock. Not from stack callbacks.
+void sim_charge_blocking_us(uint64_t us);
+
+// Implemented in sim_bt.c: adds ns to the cost of the GATTS/GAP handler
+// running on this thread; false outside one.
+bool sim_bt_charge_handler_ns(uint64_t ns);
+
+// Implemented in sim_trace.c; each is a no-op while nothing records.
+bool sim_trace_recording(void);
+void sim_trace_boot(void);
+// Appends "<now> PEER " and the formatted action.
+void sim_trace_peer(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void sim_trace_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param);
+void sim_trace_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *param);
+// Lowercase hex of data into out, which holds 2 * len + 1 bytes; returns out.
+char *sim_trace_hex(char *out, const uint8_t *data, uint16_t len);
@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "nvs_flash.h"
+
+#include "sim_internal.h"
+
+//-----------------------------------------------------------------------------
+// NVS: a flat table of entries, each in a namespace. The backing file has one
+// line per entry, "<namespace> <key> u8|blob <hex value>".
+#define SIM_NVS_ENTRIES     64
+#define SIM_NVS_VALUE_MAX   512
+#define SIM_NVS_HANDLES     8
+
+typedef enum {
+    SIM_NVS_U8,
+    SIM_NVS_BLOB,
+} sim_nvs_type_t;
+
+typedef struct {
+    bool used;
+    char ns[NVS_KEY_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    sim_nvs_type_t type;
+    uint16_t len;
+    uint8_t value[SIM_NVS_VALUE_MAX];
+} sim_nvs_entry_t;
+
+typedef struct {
+    bool open;
+    bool writable;
+    char ns[NVS_KEY_NAME_MAX_SIZE];
+} sim_nvs_handle_t;
+
+static sim_nvs_entry_t s_entries[SIM_NVS_ENTRIES];
+static sim_nvs_handle_t s_handles[SIM_NVS_HANDLES];
+static char s_created_ns[SIM_NVS_HANDLES][NVS_KEY_NAME_MAX_SIZE];
+static bool s_initialized;
+static char s_file[256];
+static uint32_t s_read_us;
+static uint32_t s_write_us;
+
+void sim_nvs_set_file(const char *path)
+{
+    if (path == NULL) {
+        s_file[0] = '\0';
+    } else {
+        snprintf(s_file, sizeof(s_file), "%s", path);
+    }
+}
+
+void sim_set_nvs_cost_us(uint32_t read_us, uint32_t write_us)
+{
+    s_read_us = read_us;
+    s_write_us = write_us;
+}
+
+// Flash access keeps the caller busy; a GATTS/GAP handler is charged for it.
+static void charge(uint32_t us, uint64_t *counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+    if (us > 0 && !sim_bt_charge_handler_ns((uint64_t)us * 1000)) {
+        sim_charge_blocking_us(us);
+    }
+}
+
+static bool valid_name(const char *name)
+{
+    return name != NULL && name[0] != '\0' && strlen(name) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Replaces the table with the file's entries; a missing file is an empty flash.
+static void load_file(void)
+{
+    memset(s_entries, 0, sizeof(s_entries));
+    memset(s_created_ns, 0, sizeof(s_created_ns));
+    FILE *f = s_file[0] != '\0' ? fopen(s_file, "r") : NULL;
+    if (f == NULL) {
+        return;
+    }
+    char line[2 * SIM_NVS_VALUE_MAX + 64];
+    for (int i = 0; i < SIM_NVS_ENTRIES && fgets(line, sizeof(line), f) != NULL;) {
+        char ns[NVS_KEY_NAME_MAX_SIZE], key[NVS_KEY_NAME_MAX_SIZE], type[8];
+        char hex[2 * SIM_NVS_VALUE_MAX + 1] = "";
+        if (sscanf(line, "%15s %15s %7s %1024s", ns, key, type, hex) < 3) {
+            continue;
+        }
+        sim_nvs_entry_t *e = &s_entries[i];
+        size_t digits = strlen(hex);
+        if (digits % 2 != 0) {
+            continue;
+        }
+        for (size_t j = 0; j < digits / 2; j++) {
+            int hi = hex_digit(hex[2 * j]), lo = hex_digit(hex[2 * j + 1]);
+            if (hi < 0 || lo < 0) {
+                digits = 1;
+                break;
+            }
+            e->value[j] = (uint8_t)(hi << 4 | lo);
+        }
+        if (digits % 2 != 0) {
+            continue;
+        }
+        e->type = strcmp(type, "u8") == 0 ? SIM_NVS_U8 : SIM_NVS_BLOB;
+        e->len = (uint16_t)(digits / 2);
+        snprintf(e->ns, sizeof(e->ns), "%s", ns);
+        snprintf(e->key, sizeof(e->key), "%s", key);
+        e->used = true;
+        i++;
+    }
+    fclose(f);
+}
+
+static esp_err_t save_file(void)
+{
+    if (s_file[0] == '\0') {
+        return ESP_OK;
+    }
+    char tmp[sizeof(s_file) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s_file);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        const sim_nvs_entry_t *e = &s_entries[i];
+        if (!e->used) {
+            continue;
+        }
+        char hex[2 * SIM_NVS_VALUE_MAX + 1];
+        fprintf(f, "%s %s %s %s\n", e->ns, e->key, e->type == SIM_NVS_U8 ? "u8" : "blob"
+            , sim_trace_hex(hex, e->value, e->len));
+    }
+    bool ok = fclose(f) == 0;
+    return ok && rename(tmp, s_file) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static bool ns_exists(const char *ns)
+{
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        if (s_entries[i].used && strcmp(s_entries[i].ns, ns) == 0) {
+            return true;
+        }
+    }
+    for (int i = 0; i < SIM_NVS_HANDLES; i++) {
+        if (strcmp(s_created_ns[i], ns) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static sim_nvs_handle_t *get_handle(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > SIM_NVS_HANDLES || !s_handles[handle - 1].open) {
+        return NULL;
+    }
+    return &s_handles[handle - 1];
+}
+
+static sim_nvs_entry_t *find(const sim_nvs_handle_t *h, const char *key)
+{
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        sim_nvs_entry_t *e = &s_entries[i];
+        if (e->used && strcmp(e->ns, h->ns) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    sim_lock();
+    if (!s_initialized) {
+        load_file();
+        s_initialized = true;
+    }
+    sim_unlock();
+    sim_boot_step(SIM_BOOT_NVS);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    sim_lock();
+    memset(s_entries, 0, sizeof(s_entries));
+    memset(s_created_ns, 0, sizeof(s_created_ns));
+    memset(s_handles, 0, sizeof(s_handles));
+    s_initialized = false;
+    if (s_file[0] != '\0') {
+        remove(s_file);
+    }
+    sim_unlock();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!valid_name(namespace_name) || out_handle == NULL) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    sim_lock();
+    esp_err_t err = ESP_OK;
+    int slot = -1;
+    for (int i = 0; i < SIM_NVS_HANDLES && slot < 0; i++) {
+        if (!s_handles[i].open) {
+            slot = i;
+        }
+    }
+    if (!s_initialized) {
+        err = ESP_ERR_NVS_NOT_INITIALIZED;
+    } else if (!ns_exists(namespace_name)) {
+        if (open_mode == NVS_READONLY) {
+            err = ESP_ERR_NVS_NOT_FOUND;
+        } else {
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+            for (int i = 0; i < SIM_NVS_HANDLES; i++) {
+                if (s_created_ns[i][0] == '\0') {
+                    snprintf(s_created_ns[i], sizeof(s_created_ns[i]), "%s", namespace_name);
+                    err = ESP_OK;
+                    break;
+                }
+            }
+        }
+    }
+    if (err == ESP_OK && slot < 0) {
+        err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (err == ESP_OK) {
+        s_handles[slot].open = true;
+        s_handles[slot].writable = open_mode == NVS_READWRITE;
+        snprintf(s_handles[slot].ns, sizeof(s_handles[slot].ns), "%s", namespace_name);
+        *out_handle = (nvs_handle_t)(slot + 1);
+    }
+    sim_unlock();
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    sim_lock();
+    sim_nvs_handle_t *h = get_handle(handle);
+    if (h != NULL) {
+        h->open = false;
+    }
+    sim_unlock();
+}
+
+static esp_err_t get(nvs_handle_t handle, const char *key, sim_nvs_type_t type, void *out, size_t *len)
+{
+    charge(s_read_us, &sim_stats_mut()->nvs_reads);
+    sim_lock();
+    esp_err_t err = ESP_OK;
+    const sim_nvs_handle_t *h = get_handle(handle);
+    const sim_nvs_entry_t *e = NULL;
+    if (h == NULL) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!valid_name(key)) {
+        err = ESP_ERR_NVS_INVALID_NAME;
+    } else if ((e = find(h, key)) == NULL) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (e->type != type) {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (out == NULL) {
+        *len = e->len;
+    } else if (*len < e->len) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, e->value, e->len);
+        *len = e->len;
+    }
+    sim_unlock();
+    return err;
+}
+
+static esp_err_t set(nvs_handle_t handle, const char *key, sim_nvs_type_t type, const void *value, size_t len)
+{
+    charge(s_write_us, &sim_stats_mut()->nvs_writes);
+    sim_lock();
+    esp_err_t err = ESP_OK;
+    const sim_nvs_handle_t *h = get_handle(handle);
+    sim_nvs_entry_t *e = NULL;
+    if (h == NULL) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!h->writable) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else if (!valid_name(key)) {
+        err = strlen(key) >= NVS_KEY_NAME_MAX_SIZE ? ESP_ERR_NVS_KEY_TOO_LONG : ESP_ERR_NVS_INVALID_NAME;
+    } else if (len > SIM_NVS_VALUE_MAX) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else if ((e = find(h, key)) == NULL) {
+        for (int i = 0; i < SIM_NVS_ENTRIES && e == NULL; i++) {
+            if (!s_entries[i].used) {
+                e = &s_entries[i];
+            }
+        }
+        if (e == NULL) {
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        } else {
+            e->used = true;
+            snprintf(e->ns, sizeof(e->ns), "%s", h->ns);
+            snprintf(e->key, sizeof(e->key), "%s", key);
+        }
+    }
+    if (err == ESP_OK) {
+        e->type = type;
+        e->len = (uint16_t)len;
+        memcpy(e->value, value, len);
+    }
+    sim_unlock();
+    return err;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    size_t len = 1;
+    return out_value == NULL ? ESP_ERR_INVALID_ARG : get(handle, key, SIM_NVS_U8, out_value, &len);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return set(handle, key, SIM_NVS_U8, &value, 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return length == NULL ? ESP_ERR_INVALID_ARG : get(handle, key, SIM_NVS_BLOB, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return value == NULL && length > 0 ? ESP_ERR_INVALID_ARG : set(handle, key, SIM_NVS_BLOB, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    charge(s_write_us, &sim_stats_mut()->nvs_writes);
+    sim_lock();
+    esp_err_t err = ESP_OK;
+    const sim_nvs_handle_t *h = get_handle(handle);
+    sim_nvs_entry_t *e = NULL;
+    if (h == NULL) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!h->writable) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else if (!valid_name(key) || (e = find(h, key)) == NULL) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else {
+        e->used = false;
+    }
+    sim_unlock();
+    return err;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    charge(s_write_us, &sim_stats_mut()->nvs_commits);
+    sim_lock();
+    esp_err_t err = get_handle(handle) == NULL ? ESP_ERR_NVS_INVALID_HANDLE : save_file();
+    sim_unlock();
+    return err;
+}
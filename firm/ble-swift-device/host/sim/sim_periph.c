@@ -0,0 +1,101 @@
+#include "driver/ledc.h"
+
+#include "sim_internal.h"
+
+//-----------------------------------------------------------------------------
+// LEDC
+static uint32_t s_pending_duty[LEDC_CHANNEL_MAX];
+static uint32_t s_duty[LEDC_CHANNEL_MAX];
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    if (timer_conf == NULL || timer_conf->timer_num >= LEDC_TIMER_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if (ledc_conf == NULL || ledc_conf->channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pending_duty[ledc_conf->channel] = ledc_conf->duty;
+    s_duty[ledc_conf->channel] = ledc_conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pending_duty[channel] = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_lock();
+    s_duty[channel] = s_pending_duty[channel];
+    sim_stats_mut()->led_updates++;
+    sim_unlock();
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    (void)speed_mode;
+    return channel < LEDC_CHANNEL_MAX ? s_duty[channel] : 0;
+}
+
+// Fades are not stepped: a started fade lands on its target at once, which
+// is where the hardware is by the time the next one starts.
+static bool s_fade_installed;
+static uint32_t s_fade_target[LEDC_CHANNEL_MAX];
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    if (s_fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_fade_installed = true;
+    sim_boot_step(SIM_BOOT_LEDC);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms)
+{
+    if (!s_fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || max_fade_time_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_fade_target[channel] = target_duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode)
+{
+    if (!s_fade_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (speed_mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX || fade_mode >= LEDC_FADE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_lock();
+    s_duty[channel] = s_fade_target[channel];
+    s_pending_duty[channel] = s_fade_target[channel];
+    sim_stats_mut()->led_fades++;
+    sim_unlock();
+    return ESP_OK;
+}
+
+uint32_t sim_led_duty(int channel)
+{
+    return (channel >= 0 && channel < LEDC_CHANNEL_MAX) ? s_duty[channel] : 0;
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_internal.h"
+
+// Kept apart from sim_trace.c, like sim_boot.c: replay boots the firmware.
+
+// Value of " key=" in line, up to the next space; false when absent.
+static bool field(const char *line, const char *key, char *out, size_t cap)
+{
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), " %s=", key);
+    const char *p = strstr(line, pattern);
+    if (p == NULL) {
+        return false;
+    }
+    p += strlen(pattern);
+    size_t n = strcspn(p, " ");
+    if (n >= cap) {
+        return false;
+    }
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return true;
+}
+
+static bool field_u16(const char *line, const char *key, uint16_t *value)
+{
+    char text[16];
+    if (!field(line, key, text, sizeof(text))) {
+        return false;
+    }
+    char *end;
+    unsigned long v = strtoul(text, &end, 0);
+    if (*end != '\0' || v > UINT16_MAX) {
+        return false;
+    }
+    *value = (uint16_t)v;
+    return true;
+}
+
+// Bytes of a hex field; -1 when absent or not hex.
+static int field_hex(const char *line, const char *key, uint8_t *out, size_t cap)
+{
+    static char text[2 * ESP_GATT_MAX_ATTR_LEN + 1];
+    if (!field(line, key, text, sizeof(text)) || strlen(text) % 2 != 0 || strlen(text) / 2 > cap) {
+        return -1;
+    }
+    size_t len = strlen(text) / 2;
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+        if (sscanf(text + 2 * i, "%2x", &byte) != 1) {
+            return -1;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    return (int)len;
+}
+
+static bool run_peer(const char *action, const char *line)
+{
+    static uint8_t value[UINT16_MAX];
+    uint16_t conn, handle, arg;
+    if (!field_u16(line, "conn", &conn)) {
+        return false;
+    }
+    if (strncmp(action, "CONNECT ", 8) == 0) {
+        int len = field_hex(line, "bda", value, ESP_BD_ADDR_LEN);
+        return len == ESP_BD_ADDR_LEN && sim_connect(conn, value);
+    }
+    if (strncmp(action, "DISCONNECT ", 11) == 0) {
+        sim_disconnect(conn);
+        return true;
+    }
+    if (strncmp(action, "MTU ", 4) == 0) {
+        if (!field_u16(line, "mtu", &arg)) {
+            return false;
+        }
+        sim_set_mtu(conn, arg);
+        return true;
+    }
+    if (strncmp(action, "WRITE ", 6) == 0) {
+        int len = field_hex(line, "value", value, ESP_GATT_MAX_ATTR_LEN);
+        if (len < 0 || !field_u16(line, "handle", &handle) || !field_u16(line, "rsp", &arg)) {
+            return false;
+        }
+        sim_write(conn, handle, value, (uint16_t)len, arg != 0);
+        return true;
+    }
+    if (strncmp(action, "READ ", 5) == 0) {
+        if (!field_u16(line, "handle", &handle) || !field_u16(line, "cap", &arg)) {
+            return false;
+        }
+        sim_read(conn, handle, value, arg);
+        return true;
+    }
+    if (strncmp(action, "PREPARE ", 8) == 0) {
+        int len = field_hex(line, "value", value, ESP_GATT_MAX_ATTR_LEN);
+        if (len < 0 || !field_u16(line, "handle", &handle) || !field_u16(line, "offset", &arg)) {
+            return false;
+        }
+        sim_prepare_write(conn, handle, arg, value, (uint16_t)len);
+        return true;
+    }
+    if (strncmp(action, "EXECUTE ", 8) == 0) {
+        if (!field_u16(line, "execute", &arg)) {
+            return false;
+        }
+        sim_execute_write(conn, arg != 0);
+        return true;
+    }
+    return false;
+}
+
+bool sim_trace_replay(const sim_trace_t *trace)
+{
+    for (size_t i = 0; i < sim_trace_len(trace); i++) {
+        const char *line = sim_trace_line(trace, i);
+        char *rest;
+        unsigned long long t_us = strtoull(line, &rest, 10);
+        if (rest == line || *rest != ' ') {
+            fprintf(stderr, "sim: replay line %zu: no time: %s\n", i + 1, line);
+            return false;
+        }
+        rest++;
+        bool is_boot = strcmp(rest, "BOOT") == 0;
+        bool is_peer = strncmp(rest, "PEER ", 5) == 0;
+        if (!is_boot && !is_peer && strcmp(rest, "END") != 0) {
+            continue;   // an event: the firmware's answer, not ours to repeat
+        }
+        if (t_us < sim_now_us()) {
+            fprintf(stderr, "sim: replay line %zu: in the past (now %llu us): %s\n", i + 1
+                    , (unsigned long long)sim_now_us(), line);
+            return false;
+        }
+        if (t_us > sim_now_us()) {
+            sim_advance_us(t_us - sim_now_us());
+        }
+        bool ok = true;
+        if (is_boot) {
+            sim_boot();
+        } else if (is_peer && strncmp(rest + 5, "RELEASE ", 8) == 0) {
+            sim_release_held();
+            sim_run_pending();
+        } else if (is_peer) {
+            ok = run_peer(rest + 5, line);
+        }
+        if (!ok) {
+            fprintf(stderr, "sim: replay line %zu: cannot run: %s\n", i + 1, line);
+            return false;
+        }
+    }
+    return true;
+}
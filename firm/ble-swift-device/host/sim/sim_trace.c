@@ -0,0 +1,301 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_internal.h"
+
+#define SIM_TRACE_LINE_MAX  (2 * ESP_GATT_MAX_ATTR_LEN + 128)
+
+struct sim_trace {
+    char **lines;
+    size_t len;
+    size_t cap;
+};
+
+static sim_trace_t *s_recording;
+
+//-----------------------------------------------------------------------------
+// Lines
+sim_trace_t *sim_trace_new(void)
+{
+    return calloc(1, sizeof(sim_trace_t));
+}
+
+void sim_trace_free(sim_trace_t *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < trace->len; i++) {
+        free(trace->lines[i]);
+    }
+    free(trace->lines);
+    free(trace);
+}
+
+static void trace_append(sim_trace_t *trace, const char *line)
+{
+    if (trace->len == trace->cap) {
+        trace->cap = trace->cap ? 2 * trace->cap : 256;
+        trace->lines = realloc(trace->lines, trace->cap * sizeof(char *));
+        if (trace->lines == NULL) {
+            fprintf(stderr, "sim: out of memory for the trace\n");
+            abort();
+        }
+    }
+    trace->lines[trace->len++] = strdup(line);
+}
+
+size_t sim_trace_len(const sim_trace_t *trace)
+{
+    return trace->len;
+}
+
+const char *sim_trace_line(const sim_trace_t *trace, size_t i)
+{
+    return i < trace->len ? trace->lines[i] : NULL;
+}
+
+bool sim_trace_save(const sim_trace_t *trace, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < trace->len; i++) {
+        fprintf(f, "%s\n", trace->lines[i]);
+    }
+    return fclose(f) == 0;
+}
+
+sim_trace_t *sim_trace_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+    sim_trace_t *trace = sim_trace_new();
+    static char line[SIM_TRACE_LINE_MAX];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') {
+            trace_append(trace, line);
+        }
+    }
+    fclose(f);
+    return trace;
+}
+
+//-----------------------------------------------------------------------------
+// Recording
+bool sim_trace_recording(void)
+{
+    return __atomic_load_n(&s_recording, __ATOMIC_ACQUIRE) != NULL;
+}
+
+static void record(const char *format, va_list args)
+{
+    char line[SIM_TRACE_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "%llu ", (unsigned long long)sim_now_us());
+    vsnprintf(line + n, sizeof(line) - n, format, args);
+    trace_append(s_recording, line);
+}
+
+static void __attribute__((format(printf, 1, 2))) record_line(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    record(format, args);
+    va_end(args);
+}
+
+void sim_trace_record(sim_trace_t *trace)
+{
+    sim_lock();
+    if (s_recording != NULL) {
+        record_line("END");
+    }
+    __atomic_store_n(&s_recording, trace, __ATOMIC_RELEASE);
+    sim_unlock();
+}
+
+void sim_trace_boot(void)
+{
+    sim_lock();
+    if (s_recording != NULL) {
+        record_line("BOOT");
+    }
+    sim_unlock();
+}
+
+void sim_trace_peer(const char *format, ...)
+{
+    sim_lock();
+    if (s_recording != NULL) {
+        char action[SIM_TRACE_LINE_MAX - 32];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(action, sizeof(action), format, args);
+        va_end(args);
+        record_line("PEER %s", action);
+    }
+    sim_unlock();
+}
+
+char *sim_trace_hex(char *out, const uint8_t *data, uint16_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (uint16_t i = 0; i < len; i++) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    out[2 * len] = '\0';
+    return out;
+}
+
+static const char *uuid_str(char *out, const esp_bt_uuid_t *uuid)
+{
+    if (uuid->len == ESP_UUID_LEN_16) {
+        sprintf(out, "0x%04x", uuid->uuid.uuid16);
+        return out;
+    }
+    return sim_trace_hex(out, uuid->uuid.uuid128, ESP_UUID_LEN_128);
+}
+
+//-----------------------------------------------------------------------------
+// Events
+static const char *const gatts_names[] = {
+    [ESP_GATTS_REG_EVT] = "REG",
+    [ESP_GATTS_READ_EVT] = "READ",
+    [ESP_GATTS_WRITE_EVT] = "WRITE",
+    [ESP_GATTS_EXEC_WRITE_EVT] = "EXEC_WRITE",
+    [ESP_GATTS_MTU_EVT] = "MTU",
+    [ESP_GATTS_CONF_EVT] = "CONF",
+    [ESP_GATTS_CREATE_EVT] = "CREATE",
+    [ESP_GATTS_ADD_CHAR_EVT] = "ADD_CHAR",
+    [ESP_GATTS_ADD_CHAR_DESCR_EVT] = "ADD_CHAR_DESCR",
+    [ESP_GATTS_START_EVT] = "START",
+    [ESP_GATTS_CONNECT_EVT] = "CONNECT",
+    [ESP_GATTS_DISCONNECT_EVT] = "DISCONNECT",
+    [ESP_GATTS_CONGEST_EVT] = "CONGEST",
+    [ESP_GATTS_RESPONSE_EVT] = "RESPONSE",
+    [ESP_GATTS_CREAT_ATTR_TAB_EVT] = "CREAT_ATTR_TAB",
+};
+
+void sim_trace_gatts(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *p)
+{
+    if (!sim_trace_recording()) {
+        return;
+    }
+    char name[16];
+    if ((size_t)event < sizeof(gatts_names) / sizeof(gatts_names[0]) && gatts_names[event] != NULL) {
+        snprintf(name, sizeof(name), "%s", gatts_names[event]);
+    } else {
+        snprintf(name, sizeof(name), "EVT%d", (int)event);
+    }
+    char hex[2 * ESP_GATT_MAX_ATTR_LEN + 1];
+    sim_lock();
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+            record_line("GATTS %s status=%d app=%u", name, p->reg.status, p->reg.app_id);
+            break;
+        case ESP_GATTS_READ_EVT:
+            record_line("GATTS %s conn=%u handle=%u offset=%u", name, p->read.conn_id, p->read.handle, p->read.offset);
+            break;
+        case ESP_GATTS_WRITE_EVT:
+            record_line("GATTS %s conn=%u handle=%u offset=%u rsp=%d prep=%d value=%s", name
+                        , p->write.conn_id, p->write.handle, p->write.offset, p->write.need_rsp, p->write.is_prep
+                        , sim_trace_hex(hex, p->write.value, p->write.len));
+            break;
+        case ESP_GATTS_EXEC_WRITE_EVT:
+            record_line("GATTS %s conn=%u flag=%u", name, p->exec_write.conn_id, p->exec_write.exec_write_flag);
+            break;
+        case ESP_GATTS_MTU_EVT:
+            record_line("GATTS %s conn=%u mtu=%u", name, p->mtu.conn_id, p->mtu.mtu);
+            break;
+        case ESP_GATTS_CONF_EVT:
+            record_line("GATTS %s conn=%u handle=%u status=%d", name, p->conf.conn_id, p->conf.handle, p->conf.status);
+            break;
+        case ESP_GATTS_CREATE_EVT:
+            record_line("GATTS %s status=%d handle=%u", name, p->create.status, p->create.service_handle);
+            break;
+        case ESP_GATTS_ADD_CHAR_EVT:
+            record_line("GATTS %s status=%d handle=%u uuid=%s", name, p->add_char.status, p->add_char.attr_handle
+                        , uuid_str(hex, &p->add_char.char_uuid));
+            break;
+        case ESP_GATTS_ADD_CHAR_DESCR_EVT:
+            record_line("GATTS %s status=%d handle=%u uuid=%s", name, p->add_char_descr.status, p->add_char_descr.attr_handle
+                        , uuid_str(hex, &p->add_char_descr.descr_uuid));
+            break;
+        case ESP_GATTS_START_EVT:
+            record_line("GATTS %s status=%d handle=%u", name, p->start.status, p->start.service_handle);
+            break;
+        case ESP_GATTS_CONNECT_EVT:
+            record_line("GATTS %s conn=%u bda=%s interval=%u latency=%u timeout=%u", name, p->connect.conn_id
+                        , sim_trace_hex(hex, p->connect.remote_bda, ESP_BD_ADDR_LEN), p->connect.conn_params.interval
+                        , p->connect.conn_params.latency, p->connect.conn_params.timeout);
+            break;
+        case ESP_GATTS_DISCONNECT_EVT:
+            record_line("GATTS %s conn=%u reason=0x%x", name, p->disconnect.conn_id, p->disconnect.reason);
+            break;
+        case ESP_GATTS_CONGEST_EVT:
+            record_line("GATTS %s conn=%u congested=%d", name, p->congest.conn_id, p->congest.congested);
+            break;
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+            record_line("GATTS %s status=%d uuid=%s handles=%u first=%u", name, p->add_attr_tab.status
+                        , uuid_str(hex, &p->add_attr_tab.svc_uuid), p->add_attr_tab.num_handle
+                        , p->add_attr_tab.num_handle > 0 ? p->add_attr_tab.handles[0] : 0);
+            break;
+        case ESP_GATTS_RESPONSE_EVT:
+            record_line("GATTS %s status=%d conn=%u handle=%u", name, p->rsp.status, p->rsp.conn_id, p->rsp.handle);
+            break;
+        default:
+            record_line("GATTS %s", name);
+            break;
+    }
+    sim_unlock();
+}
+
+void sim_trace_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t *p)
+{
+    if (!sim_trace_recording()) {
+        return;
+    }
+    char hex[2 * ESP_BD_ADDR_LEN + 1];
+    sim_lock();
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
+            record_line("GAP ADV_DATA_RAW_SET_COMPLETE status=%d", p->adv_data_raw_cmpl.status);
+            break;
+        case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT:
+            record_line("GAP SCAN_RSP_DATA_RAW_SET_COMPLETE status=%d", p->scan_rsp_data_raw_cmpl.status);
+            break;
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            record_line("GAP ADV_START_COMPLETE status=%d", p->adv_start_cmpl.status);
+            break;
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            record_line("GAP ADV_STOP_COMPLETE status=%d", p->adv_stop_cmpl.status);
+            break;
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            record_line("GAP UPDATE_CONN_PARAMS status=%d bda=%s interval=%u latency=%u timeout=%u"
+                        , p->update_conn_params.status, sim_trace_hex(hex, p->update_conn_params.bda, ESP_BD_ADDR_LEN)
+                        , p->update_conn_params.conn_int, p->update_conn_params.latency, p->update_conn_params.timeout);
+            break;
+        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+            record_line("GAP SET_PKT_LENGTH_COMPLETE status=%d tx=%u rx=%u", p->pkt_data_length_cmpl.status
+                        , p->pkt_data_length_cmpl.params.tx_len, p->pkt_data_length_cmpl.params.rx_len);
+            break;
+        case ESP_GAP_BLE_SET_PREFERRED_PHY_COMPLETE_EVT:
+            record_line("GAP SET_PREFERRED_PHY_COMPLETE status=%d", p->set_perf_phy.status);
+            break;
+        case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+            record_line("GAP PHY_UPDATE_COMPLETE status=%d bda=%s tx=%u rx=%u", p->phy_update.status
+                        , sim_trace_hex(hex, p->phy_update.bda, ESP_BD_ADDR_LEN), p->phy_update.tx_phy, p->phy_update.rx_phy);
+            break;
+        default:
+            record_line("GAP EVT%d", (int)event);
+            break;
+    }
+    sim_unlock();
+}
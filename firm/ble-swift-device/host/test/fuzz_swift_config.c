@@ -0,0 +1,167 @@
+// Fuzz target for swift_config_parse() (main/swift_config.c).
+//
+// LLVMFuzzerTestOneInput parses one input on top of the defaults, placed so
+// that it ends right before an inaccessible page: a read past len faults
+// with or without a sanitizer. A rejected write must leave the config as it
+// was and report no changes; an accepted one must pass
+// swift_config_validate(), report only records it knows, and re-encode and
+// re-parse to itself.
+//
+// Built with -fsanitize=fuzzer (clang) it is a libFuzzer target
+// (fuzz_swift_config). Otherwise main() below replays the files given as
+// arguments, then --iterations deterministic mutations of valid writes,
+// truncations and random bytes; test_swift_config_fuzz runs that under
+// AddressSanitizer/UBSan where the compiler has them.
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "swift_config.h"
+
+#include "test_common.h"
+
+#define FUZZ_MAX_LEN 512
+
+static uint8_t *s_area;
+static size_t s_page;
+
+// The input's last byte is the last readable byte.
+static const uint8_t *guarded_copy(const uint8_t *data, size_t len)
+{
+    if (s_area == NULL) {
+        s_page = (size_t)sysconf(_SC_PAGESIZE);
+        s_area = mmap(NULL, 2 * s_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (s_area == MAP_FAILED || mprotect(s_area + s_page, s_page, PROT_NONE) != 0) {
+            abort();
+        }
+    }
+    uint8_t *copy = s_area + s_page - len;
+    memcpy(copy, data, len);
+    return copy;
+}
+
+static uint32_t known_records_mask(void)
+{
+    uint32_t mask = 0;
+    for (uint8_t type = 0; type < 32; type++) {
+        if (type != SWIFT_CONFIG_LINK_STATUS) {
+            uint8_t record[2] = { type, 0 };
+            swift_config_t cfg;
+            swift_config_defaults(&cfg);
+            // a known type with the wrong length is a length error, not an unknown type
+            if (swift_config_parse(record, sizeof(record), &cfg, NULL) != SWIFT_CONFIG_ERR_UNKNOWN_TYPE) {
+                mask |= SWIFT_CONFIG_CHANGED(type);
+            }
+        }
+    }
+    return mask;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static uint32_t known;
+    if (known == 0) {
+        known = known_records_mask();
+    }
+    size_t len = size < FUZZ_MAX_LEN ? size : FUZZ_MAX_LEN;
+    const uint8_t *input = guarded_copy(data, len);
+
+    swift_config_t base, cfg;
+    swift_config_defaults(&base);
+    cfg = base;
+    uint32_t changed = 0;
+    swift_config_status_t status = swift_config_parse(input, (uint16_t)len, &cfg, &changed);
+    if (status != SWIFT_CONFIG_OK) {
+        if (!TEST_CHECK(memcmp(&cfg, &base, sizeof(cfg)) == 0 && changed == 0)) {
+            abort();
+        }
+        return 0;
+    }
+    uint8_t encoded[SWIFT_CONFIG_ENCODED_LEN];
+    uint16_t encoded_len = swift_config_encode(&cfg, encoded, sizeof(encoded));
+    swift_config_t reparsed = base;
+    bool ok = TEST_CHECK(swift_config_validate(&cfg));
+    ok &= TEST_CHECK((changed & ~known) == 0);
+    ok &= TEST_CHECK(encoded_len > 0 && encoded_len <= SWIFT_CONFIG_ENCODED_LEN);
+    ok &= TEST_CHECK(swift_config_parse(encoded, encoded_len, &reparsed, NULL) == SWIFT_CONFIG_OK
+        && memcmp(&reparsed, &cfg, sizeof(cfg)) == 0);
+    if (!ok) {
+        abort();
+    }
+    return 0;
+}
+
+#ifndef SWIFT_FUZZ_LIBFUZZER
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 32);
+}
+
+static void run_file(const char *path)
+{
+    uint8_t buf[FUZZ_MAX_LEN];
+    FILE *f = fopen(path, "rb");
+    if (!TEST_CHECK(f != NULL)) {
+        return;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, len);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 500000;
+    int first_file = 1;
+    if (argc > 2 && strcmp(argv[1], "--iterations") == 0) {
+        iterations = (uint32_t)strtoul(argv[2], NULL, 0);
+        first_file = 3;
+    }
+    for (int i = first_file; i < argc; i++) {
+        run_file(argv[i]);
+    }
+
+    swift_config_t cfg;
+    swift_config_defaults(&cfg);
+    uint8_t valid[SWIFT_CONFIG_ENCODED_LEN + SWIFT_CONFIG_LINK_STATUS_LEN];
+    uint16_t valid_len = swift_config_encode(&cfg, valid, sizeof(valid));
+    swift_link_status_t link = { 2, 2, 251, 251, 247, 12 };
+    valid_len += swift_config_encode_link_status(&link, valid + valid_len, sizeof(valid) - valid_len);
+
+    // every truncation of a full read-back, including the empty write
+    for (uint16_t len = 0; len <= valid_len; len++) {
+        LLVMFuzzerTestOneInput(valid, len);
+    }
+
+    uint8_t buf[96];
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len;
+        if (rng_next() % 8 == 0) {
+            len = rng_next() % sizeof(buf);
+            for (size_t k = 0; k < len; k++) {
+                buf[k] = (uint8_t)rng_next();
+            }
+        } else {
+            // a valid write with a few bytes flipped, cut short or extended
+            memcpy(buf, valid, valid_len);
+            len = valid_len;
+            for (int e = 1 + (int)(rng_next() % 3); e > 0 && len > 0; e--) {
+                switch (rng_next() % 4) {
+                    case 0: buf[rng_next() % len] = (uint8_t)rng_next(); break;
+                    case 1: buf[rng_next() % len] ^= (uint8_t)(1u << (rng_next() % 8)); break;
+                    case 2: len = rng_next() % (len + 1); break;
+                    case 3: if (len < sizeof(buf)) { buf[len++] = (uint8_t)rng_next(); } break;
+                }
+            }
+        }
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+    return test_finish("test_swift_config_fuzz");
+}
+#endif
@@ -0,0 +1,192 @@
+// Unit tests for main/blob_rx.c: the CRC-32 check value, in-order assembly
+// to an exactly full arena, out-of-order and oversize pieces, a second
+// connection refused until the owner goes stale (also across the ms wrap),
+// restart and abort, chunk headers at the 24-bit extremes, and the status
+// record.
+#include <string.h>
+
+#include "blob_rx.h"
+
+#include "test_common.h"
+
+#define ARENA_LEN 64
+#define CONN_A 1
+#define CONN_B 2
+
+static uint8_t s_arena[ARENA_LEN + 1];
+
+static void test_crc32(void)
+{
+    const uint8_t check[] = "123456789";
+    TEST_CHECK(blob_crc32_update(0, check, 9) == 0xCBF43926u);
+    TEST_CHECK(blob_crc32_update(0, check, 0) == 0);
+    // piecewise equals one pass
+    uint32_t crc = 0;
+    for (int i = 0; i < 9; i++) {
+        crc = blob_crc32_update(crc, check + i, 1);
+    }
+    TEST_CHECK(crc == 0xCBF43926u);
+}
+
+static void test_assemble_full(void)
+{
+    blob_rx_t rx;
+    uint8_t src[ARENA_LEN];
+    for (int i = 0; i < ARENA_LEN; i++) {
+        src[i] = (uint8_t)(i * 7 + 3);
+    }
+    s_arena[ARENA_LEN] = 0xEE;
+    blob_rx_init(&rx, s_arena, ARENA_LEN);
+    TEST_CHECK(blob_rx_begin(&rx, CONN_A, 100) == BLOB_RX_OK);
+    uint32_t off = 0;
+    static const uint32_t pieces[] = { 1, 0, 18, 20, 25 };
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        TEST_CHECK(blob_rx_append(&rx, CONN_A, off, src + off, pieces[i], 100 + (uint32_t)i) == BLOB_RX_OK);
+        off += pieces[i];
+    }
+    TEST_CHECK(off == ARENA_LEN && rx.len == ARENA_LEN);
+    // a full arena takes no more, not even one byte
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, off, src, 1, 110) == BLOB_RX_ERR_OVERFLOW);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, off, src, 0, 110) == BLOB_RX_OK);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_A, 150) == BLOB_RX_COMPLETE);
+    TEST_CHECK(rx.done_len == ARENA_LEN && rx.done_crc == blob_crc32_update(0, src, ARENA_LEN));
+    TEST_CHECK(rx.done_duration_ms == 50);
+    TEST_CHECK(memcmp(s_arena, src, ARENA_LEN) == 0 && s_arena[ARENA_LEN] == 0xEE);
+    TEST_CHECK(rx.completed == 1 && rx.rejected == 1 && rx.aborted == 0);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_A, 160) == BLOB_RX_ERR_IDLE);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 0, src, 1, 160) == BLOB_RX_ERR_IDLE);
+}
+
+static void test_bad_pieces(void)
+{
+    blob_rx_t rx;
+    uint8_t data[ARENA_LEN + 8] = { 0 };
+    blob_rx_init(&rx, s_arena, ARENA_LEN);
+    blob_rx_begin(&rx, CONN_A, 0);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 0, data, 10, 1) == BLOB_RX_OK);
+    // repeated, skipped ahead and gone back
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 0, data, 10, 2) == BLOB_RX_ERR_OFFSET);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 11, data, 10, 2) == BLOB_RX_ERR_OFFSET);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 9, data, 1, 2) == BLOB_RX_ERR_OFFSET);
+    // one byte past the arena, and a length that would wrap the arithmetic
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 10, data, ARENA_LEN - 9, 3) == BLOB_RX_ERR_OVERFLOW);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 10, data, UINT32_MAX, 3) == BLOB_RX_ERR_OVERFLOW);
+    TEST_CHECK(rx.rejected == 5 && rx.len == 10);
+    uint32_t crc = rx.crc;
+    // the transfer survives the refused pieces
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 10, data, ARENA_LEN - 10, 4) == BLOB_RX_OK);
+    TEST_CHECK(rx.crc != crc);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_A, 5) == BLOB_RX_COMPLETE && rx.done_len == ARENA_LEN);
+}
+
+static void test_second_client(void)
+{
+    blob_rx_t rx;
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    blob_rx_init(&rx, s_arena, ARENA_LEN);
+    // owner's last piece just before the ms counter wraps
+    uint32_t t0 = UINT32_MAX - 1000;
+    blob_rx_begin(&rx, CONN_A, t0);
+    blob_rx_append(&rx, CONN_A, 0, data, 8, t0);
+    TEST_CHECK(blob_rx_begin(&rx, CONN_B, t0 + BLOB_RX_STALE_MS - 1) == BLOB_RX_ERR_BUSY);
+    TEST_CHECK(blob_rx_append(&rx, CONN_B, 8, data, 8, t0 + 10) == BLOB_RX_ERR_BUSY);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_B, t0 + 10) == BLOB_RX_ERR_IDLE);
+    blob_rx_abort(&rx, CONN_B);
+    TEST_CHECK(rx.active && rx.conn_id == CONN_A && rx.aborted == 0);
+    TEST_CHECK(rx.rejected == 2);
+
+    // quiet for BLOB_RX_STALE_MS: B may take over, A's transfer is aborted
+    uint32_t t1 = t0 + BLOB_RX_STALE_MS;
+    TEST_CHECK(blob_rx_begin(&rx, CONN_B, t1) == BLOB_RX_OK);
+    TEST_CHECK(rx.conn_id == CONN_B && rx.len == 0 && rx.aborted == 1);
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 8, data, 8, t1 + 1) == BLOB_RX_ERR_BUSY);
+    TEST_CHECK(blob_rx_append(&rx, CONN_B, 0, data, 4, t1 + 1) == BLOB_RX_OK);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_B, t1 + 2) == BLOB_RX_COMPLETE);
+    TEST_CHECK(rx.done_crc == blob_crc32_update(0, data, 4));
+    TEST_CHECK(rx.done_duration_ms == 2);
+    // once idle, an append from anyone is IDLE, not BUSY
+    TEST_CHECK(blob_rx_append(&rx, CONN_A, 0, data, 1, t1 + 3) == BLOB_RX_ERR_IDLE);
+}
+
+static void test_restart_abort(void)
+{
+    blob_rx_t rx;
+    uint8_t data[4] = { 9, 9, 9, 9 };
+    blob_rx_init(&rx, s_arena, ARENA_LEN);
+    blob_rx_begin(&rx, CONN_A, 0);
+    blob_rx_append(&rx, CONN_A, 0, data, 4, 0);
+    // the owner starting over drops its earlier transfer
+    TEST_CHECK(blob_rx_begin(&rx, CONN_A, 1) == BLOB_RX_OK);
+    TEST_CHECK(rx.len == 0 && rx.crc == 0 && rx.aborted == 1);
+    blob_rx_append(&rx, CONN_A, 0, data, 2, 1);
+    blob_rx_abort(&rx, CONN_A);
+    TEST_CHECK(!rx.active && rx.aborted == 2);
+    blob_rx_abort(&rx, CONN_A);
+    TEST_CHECK(rx.aborted == 2);
+    TEST_CHECK(blob_rx_finish(&rx, CONN_A, 2) == BLOB_RX_ERR_IDLE);
+    TEST_CHECK(rx.completed == 0 && rx.done_len == 0);
+    // right after an abort another connection may begin
+    TEST_CHECK(blob_rx_begin(&rx, CONN_B, 3) == BLOB_RX_OK);
+}
+
+static void test_chunk_header(void)
+{
+    uint8_t buf[BLOB_CHUNK_HEADER_LEN];
+    uint8_t flags;
+    uint32_t offset;
+    static const uint32_t offsets[] = { 0, 1, 0xFF, 0x100, 0xABCDEF, 0xFFFFFF };
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        blob_chunk_encode_header(BLOB_CHUNK_FIRST | BLOB_CHUNK_LAST, offsets[i], buf);
+        TEST_CHECK(blob_chunk_decode_header(buf, sizeof(buf), &flags, &offset));
+        TEST_CHECK(flags == (BLOB_CHUNK_FIRST | BLOB_CHUNK_LAST) && offset == offsets[i]);
+    }
+    // offsets are 24 bits wide
+    blob_chunk_encode_header(0, 0x01000005, buf);
+    blob_chunk_decode_header(buf, sizeof(buf), &flags, &offset);
+    TEST_CHECK(offset == 5);
+    flags = 0x55;
+    for (uint16_t len = 0; len < BLOB_CHUNK_HEADER_LEN; len++) {
+        TEST_CHECK(!blob_chunk_decode_header(buf, len, &flags, &offset));
+    }
+    TEST_CHECK(flags == 0x55);
+}
+
+static void test_status(void)
+{
+    blob_rx_t rx;
+    uint8_t data[3] = { 1, 2, 3 };
+    uint8_t buf[BLOB_RX_STATUS_LEN];
+    blob_rx_init(&rx, s_arena, ARENA_LEN);
+    blob_rx_begin(&rx, CONN_A, 0);
+    blob_rx_append(&rx, CONN_A, 0, data, 3, 0);
+    blob_rx_finish(&rx, CONN_A, 0);
+    blob_rx_begin(&rx, CONN_A, 1);
+    blob_rx_append(&rx, CONN_A, 0, data, 2, 1);
+    blob_rx_append(&rx, CONN_A, 7, data, 1, 1);
+    blob_rx_encode_status(&rx, buf);
+    uint32_t crc = blob_crc32_update(0, data, 3);
+    const uint8_t expect[BLOB_RX_STATUS_LEN] = {
+        3, 0, 0, 0,
+        (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24),
+        1, 0, 0, 0,
+        1, 0, 0, 0,
+        2, 0, 0, 0,
+    };
+    TEST_CHECK(memcmp(buf, expect, sizeof(expect)) == 0);
+    blob_rx_abort(&rx, CONN_A);
+    blob_rx_encode_status(&rx, buf);
+    TEST_CHECK(buf[16] == 0);
+    TEST_CHECK(blob_rx_status_str((blob_rx_status_t)99)[0] == '?');
+}
+
+int main(void)
+{
+    test_crc32();
+    test_assemble_full();
+    test_bad_pieces();
+    test_second_client();
+    test_restart_abort();
+    test_chunk_header();
+    test_status();
+    return test_finish("test_blob_rx");
+}
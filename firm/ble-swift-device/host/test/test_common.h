@@ -0,0 +1,30 @@
+// Assertions shared by the host unit tests.
+//
+// Each test is a plain executable registered with CTest. TEST_CHECK reports
+// a failed condition with its location and carries on; test_finish() prints
+// the tally and returns the exit status, non-zero when any check failed.
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+static int test_checks;
+static int test_failures;
+
+static inline bool test_check_(bool ok, const char *expr, const char *file, int line)
+{
+    test_checks++;
+    if (!ok) {
+        test_failures++;
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+    }
+    return ok;
+}
+
+#define TEST_CHECK(cond) test_check_((cond), #cond, __FILE__, __LINE__)
+
+static inline int test_finish(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Unit tests for main/frame.c: round trips at the field extremes, byte
+// order, payload clamping and zero padding, a counter-only frame, and
+// malformed input (short buffers, unknown types, oversized payload lengths).
+#include <string.h>
+
+#include "frame.h"
+
+#include "test_common.h"
+
+static bool frames_equal(const frame_t *a, const frame_t *b)
+{
+    return a->seq == b->seq && a->type == b->type && a->payload_len == b->payload_len
+        && a->timestamp_ms == b->timestamp_ms && memcmp(a->payload, b->payload, a->payload_len) == 0;
+}
+
+static void test_round_trip_extremes(void)
+{
+    static const uint16_t seqs[] = { 0, 1, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF };
+    static const uint32_t stamps[] = { 0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu };
+    for (size_t i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+        for (size_t j = 0; j < sizeof(stamps) / sizeof(stamps[0]); j++) {
+            for (uint8_t type = 0; type < FRAME_TYPE_MAX; type++) {
+                for (uint8_t len = 0; len <= FRAME_PAYLOAD_MAX; len++) {
+                    frame_t in = { .seq = seqs[i], .type = type, .payload_len = len, .timestamp_ms = stamps[j],
+                        .payload = { 0xFF, 0x80 } };
+                    uint8_t buf[FRAME_LEN];
+                    frame_t out;
+                    frame_encode(&in, buf);
+                    TEST_CHECK(frame_decode(buf, sizeof(buf), &out));
+                    TEST_CHECK(frames_equal(&in, &out));
+                }
+            }
+        }
+    }
+}
+
+static void test_layout(void)
+{
+    frame_t in = { .seq = 0x1234, .type = FRAME_TYPE_LED, .payload_len = 1, .timestamp_ms = 0xA1B2C3D4u,
+        .payload = { 0x5A, 0x77 } };
+    uint8_t buf[FRAME_LEN];
+    memset(buf, 0xEE, sizeof(buf));
+    frame_encode(&in, buf);
+    static const uint8_t expect[FRAME_LEN] = { 0x34, 0x12, FRAME_TYPE_LED, 1, 0xD4, 0xC3, 0xB2, 0xA1, 0x5A, 0x00 };
+    TEST_CHECK(memcmp(buf, expect, sizeof(expect)) == 0);
+
+    // an oversized length is clamped on encode, never written past the frame
+    uint8_t big[FRAME_LEN + 1];
+    big[FRAME_LEN] = 0xEE;
+    in.payload_len = 200;
+    frame_encode(&in, big);
+    TEST_CHECK(big[3] == FRAME_PAYLOAD_MAX);
+    TEST_CHECK(big[FRAME_LEN] == 0xEE);
+}
+
+static void test_counter_only(void)
+{
+    uint8_t buf[FRAME_LEN] = { 0xFF, 0xFF };
+    frame_t out;
+    TEST_CHECK(frame_decode(buf, sizeof(buf), &out));
+    TEST_CHECK(out.seq == 0xFFFF && out.type == FRAME_TYPE_DATA);
+    TEST_CHECK(out.timestamp_ms == 0 && out.payload_len == 0);
+}
+
+static void test_malformed(void)
+{
+    frame_t in = { .seq = 7, .type = FRAME_TYPE_DATA, .payload_len = 2, .timestamp_ms = 9 };
+    uint8_t buf[FRAME_LEN + 4] = { 0 };
+    frame_encode(&in, buf);
+    frame_t out = { .seq = 0xABCD };
+    for (uint16_t len = 0; len < FRAME_LEN; len++) {
+        TEST_CHECK(!frame_decode(buf, len, &out));
+    }
+    TEST_CHECK(out.seq == 0xABCD);
+    // trailing bytes are ignored
+    TEST_CHECK(frame_decode(buf, sizeof(buf), &out) && out.seq == 7);
+
+    buf[2] = FRAME_TYPE_MAX;
+    TEST_CHECK(!frame_decode(buf, FRAME_LEN, &out));
+    buf[2] = 0xFF;
+    TEST_CHECK(!frame_decode(buf, FRAME_LEN, &out));
+    buf[2] = FRAME_TYPE_WRITE_ACK;
+    buf[3] = FRAME_PAYLOAD_MAX + 1;
+    TEST_CHECK(!frame_decode(buf, FRAME_LEN, &out));
+    buf[3] = 0xFF;
+    TEST_CHECK(!frame_decode(buf, FRAME_LEN, &out));
+    buf[3] = FRAME_PAYLOAD_MAX;
+    TEST_CHECK(frame_decode(buf, FRAME_LEN, &out) && out.type == FRAME_TYPE_WRITE_ACK);
+}
+
+int main(void)
+{
+    test_round_trip_extremes();
+    test_layout();
+    test_counter_only();
+    test_malformed();
+    return test_finish("test_frame");
+}
@@ -0,0 +1,189 @@
+// Unit tests for main/link_neg.c: every data length and PHY outcome (ok,
+// partial, rejected, timeout, skipped), the deadline edge, a second link
+// queued behind the one that owns the data length request, unsolicited
+// events, and requests clamped to the LL limits.
+#include "esp_gap_ble_api.h"
+#include "link_neg.h"
+
+#include "test_common.h"
+
+#define PHY_2M_MASK ESP_BLE_GAP_PHY_2M_PREF_MASK
+#define T0 1000
+
+static void test_init_clamps(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 1000, PHY_2M_MASK);
+    TEST_CHECK(ln.state == LINK_NEG_IDLE);
+    TEST_CHECK(ln.want_tx_octets == LINK_DATA_LEN_MAX);
+    TEST_CHECK(ln.tx_octets == LINK_DATA_LEN_DEFAULT && ln.rx_octets == LINK_DATA_LEN_DEFAULT);
+    TEST_CHECK(ln.tx_phy == LINK_PHY_1M && ln.rx_phy == LINK_PHY_1M);
+    TEST_CHECK(!link_neg_is_pending(&ln));
+}
+
+static void test_all_ok(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 251, PHY_2M_MASK);
+    TEST_CHECK(link_neg_start(&ln, false, T0) == LINK_NEG_ACTION_SET_DATA_LEN);
+    TEST_CHECK(ln.state == LINK_NEG_DATA_LEN_PENDING && link_neg_is_pending(&ln));
+    TEST_CHECK(ln.deadline_us == T0 + LINK_NEG_TIMEOUT_US);
+    // a second start while running does nothing
+    TEST_CHECK(link_neg_start(&ln, false, T0 + 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.started_us == T0);
+
+    TEST_CHECK(link_neg_on_data_len(&ln, true, 251, 251, T0 + 10) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_OK);
+    TEST_CHECK(ln.state == LINK_NEG_PHY_PENDING && ln.phy_result == LINK_NEG_RESULT_PENDING);
+    TEST_CHECK(link_neg_on_phy(&ln, true, LINK_PHY_2M, LINK_PHY_2M, T0 + 20) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_OK);
+    TEST_CHECK(ln.state == LINK_NEG_DONE && !link_neg_is_pending(&ln));
+    TEST_CHECK(ln.done_us == T0 + 20);
+    TEST_CHECK(ln.tx_octets == 251 && ln.rx_octets == 251);
+    TEST_CHECK(ln.tx_phy == LINK_PHY_2M && ln.rx_phy == LINK_PHY_2M);
+    // done stays done
+    TEST_CHECK(link_neg_start(&ln, false, T0 + 30) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(link_neg_poll(&ln, false, T0 + 10 * LINK_NEG_TIMEOUT_US) == LINK_NEG_ACTION_NONE);
+}
+
+static void test_partial(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 251, PHY_2M_MASK);
+    link_neg_start(&ln, false, T0);
+    TEST_CHECK(link_neg_on_data_len(&ln, true, 123, 27, T0 + 1) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_PARTIAL);
+    TEST_CHECK(ln.tx_octets == 123 && ln.rx_octets == 27);
+    // only one direction moved to 2M
+    link_neg_on_phy(&ln, true, LINK_PHY_2M, LINK_PHY_1M, T0 + 2);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_PARTIAL);
+    TEST_CHECK(ln.tx_phy == LINK_PHY_2M && ln.rx_phy == LINK_PHY_1M);
+
+    // an out-of-range PHY from the controller is never a match
+    link_neg_init(&ln, 0, 0xFF);
+    link_neg_start(&ln, false, T0);
+    link_neg_on_phy(&ln, true, 0, 7, T0 + 1);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_PARTIAL);
+}
+
+static void test_rejected(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 251, PHY_2M_MASK);
+    link_neg_start(&ln, false, T0);
+    // a failed event keeps the values the link had
+    TEST_CHECK(link_neg_on_data_len(&ln, false, 251, 251, T0 + 1) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_REJECTED);
+    TEST_CHECK(ln.tx_octets == LINK_DATA_LEN_DEFAULT && ln.rx_octets == LINK_DATA_LEN_DEFAULT);
+    TEST_CHECK(link_neg_on_phy(&ln, false, LINK_PHY_2M, LINK_PHY_2M, T0 + 2) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_REJECTED);
+    TEST_CHECK(ln.tx_phy == LINK_PHY_1M && ln.rx_phy == LINK_PHY_1M);
+    TEST_CHECK(ln.state == LINK_NEG_DONE);
+}
+
+static void test_timeout(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 251, PHY_2M_MASK);
+    link_neg_start(&ln, false, T0);
+    // the deadline itself is the first instant that times out
+    TEST_CHECK(link_neg_poll(&ln, false, T0 + LINK_NEG_TIMEOUT_US - 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.state == LINK_NEG_DATA_LEN_PENDING);
+    TEST_CHECK(link_neg_poll(&ln, false, T0 + LINK_NEG_TIMEOUT_US) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_TIMEOUT);
+    int64_t phy_start = T0 + LINK_NEG_TIMEOUT_US;
+    TEST_CHECK(ln.deadline_us == phy_start + LINK_NEG_TIMEOUT_US);
+
+    // a late data length event neither restarts nor changes the outcome
+    TEST_CHECK(link_neg_on_data_len(&ln, true, 251, 251, phy_start + 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_TIMEOUT);
+    TEST_CHECK(ln.tx_octets == 251);
+    TEST_CHECK(ln.state == LINK_NEG_PHY_PENDING);
+
+    TEST_CHECK(link_neg_poll(&ln, false, phy_start + LINK_NEG_TIMEOUT_US) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_TIMEOUT);
+    TEST_CHECK(ln.state == LINK_NEG_DONE && ln.done_us == phy_start + LINK_NEG_TIMEOUT_US);
+}
+
+static void test_skipped(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, LINK_DATA_LEN_DEFAULT, PHY_2M_MASK);
+    TEST_CHECK(link_neg_start(&ln, true, T0) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_SKIPPED);
+
+    link_neg_init(&ln, 251, 0);
+    link_neg_start(&ln, false, T0);
+    TEST_CHECK(link_neg_on_data_len(&ln, true, 251, 251, T0 + 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_SKIPPED && ln.state == LINK_NEG_DONE);
+
+    link_neg_init(&ln, 0, 0);
+    TEST_CHECK(link_neg_start(&ln, false, T0) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.state == LINK_NEG_DONE);
+    TEST_CHECK(ln.data_len_result == LINK_NEG_RESULT_SKIPPED && ln.phy_result == LINK_NEG_RESULT_SKIPPED);
+}
+
+// Two links, one data length request at a time: the caller's owner flag is
+// the other link being in LINK_NEG_DATA_LEN_PENDING.
+static void test_queued_owner(void)
+{
+    link_neg_t a, b;
+    link_neg_init(&a, 251, PHY_2M_MASK);
+    link_neg_init(&b, 251, PHY_2M_MASK);
+    TEST_CHECK(link_neg_start(&a, false, T0) == LINK_NEG_ACTION_SET_DATA_LEN);
+    bool busy = a.state == LINK_NEG_DATA_LEN_PENDING;
+    TEST_CHECK(link_neg_start(&b, busy, T0 + 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(b.state == LINK_NEG_DATA_LEN_QUEUED && link_neg_is_pending(&b));
+    TEST_CHECK(b.data_len_result == LINK_NEG_RESULT_PENDING);
+    // queued links do not time out while they wait
+    TEST_CHECK(link_neg_poll(&b, true, T0 + 10 * LINK_NEG_TIMEOUT_US) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(b.state == LINK_NEG_DATA_LEN_QUEUED);
+    // an event for the owner does not touch the queued link's state
+    TEST_CHECK(link_neg_on_data_len(&b, true, 200, 200, T0 + 2) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(b.state == LINK_NEG_DATA_LEN_QUEUED);
+
+    link_neg_on_data_len(&a, true, 251, 251, T0 + 3);
+    busy = a.state == LINK_NEG_DATA_LEN_PENDING;
+    TEST_CHECK(!busy);
+    int64_t now = T0 + 4;
+    TEST_CHECK(link_neg_poll(&b, busy, now) == LINK_NEG_ACTION_SET_DATA_LEN);
+    TEST_CHECK(b.state == LINK_NEG_DATA_LEN_PENDING && b.deadline_us == now + LINK_NEG_TIMEOUT_US);
+    TEST_CHECK(link_neg_on_data_len(&b, true, 251, 251, now + 1) == LINK_NEG_ACTION_SET_PHY);
+    TEST_CHECK(b.data_len_result == LINK_NEG_RESULT_OK);
+}
+
+static void test_unsolicited(void)
+{
+    link_neg_t ln;
+    link_neg_init(&ln, 251, PHY_2M_MASK);
+    // peer-initiated updates before start are recorded but start nothing
+    TEST_CHECK(link_neg_on_phy(&ln, true, LINK_PHY_CODED, LINK_PHY_CODED, T0) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(link_neg_on_data_len(&ln, true, 60, 60, T0) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.state == LINK_NEG_IDLE);
+    TEST_CHECK(ln.tx_phy == LINK_PHY_CODED && ln.tx_octets == 60);
+    TEST_CHECK(ln.phy_result == LINK_NEG_RESULT_SKIPPED && ln.data_len_result == LINK_NEG_RESULT_SKIPPED);
+    // a PHY event during the data length step does not skip ahead
+    link_neg_start(&ln, false, T0);
+    TEST_CHECK(link_neg_on_phy(&ln, true, LINK_PHY_2M, LINK_PHY_2M, T0 + 1) == LINK_NEG_ACTION_NONE);
+    TEST_CHECK(ln.state == LINK_NEG_DATA_LEN_PENDING && ln.phy_result == LINK_NEG_RESULT_SKIPPED);
+}
+
+static void test_result_str(void)
+{
+    TEST_CHECK(link_neg_result_str(LINK_NEG_RESULT_TIMEOUT)[0] == 't');
+    TEST_CHECK(link_neg_result_str((link_neg_result_t)99)[0] == '?');
+}
+
+int main(void)
+{
+    test_init_clamps();
+    test_all_ok();
+    test_partial();
+    test_rejected();
+    test_timeout();
+    test_skipped();
+    test_queued_owner();
+    test_unsolicited();
+    test_result_str();
+    return test_finish("test_link_neg");
+}
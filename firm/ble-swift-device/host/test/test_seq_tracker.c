@@ -0,0 +1,115 @@
+// Unit tests for main/seq_tracker.c: in-order runs across the 16-bit wrap,
+// gaps, duplicates, late frames filling gaps (also across the wrap), the
+// window and resync edges, loss per mille, and the jitter estimate.
+#include "seq_tracker.h"
+
+#include "test_common.h"
+
+static void test_in_order_wrap(void)
+{
+    seq_tracker_t t;
+    seq_tracker_init(&t);
+    uint16_t seq = 0xFFF0;
+    for (int i = 0; i < 40; i++, seq++) {
+        TEST_CHECK(seq_tracker_on_frame(&t, seq, 0, 0) == SEQ_NEW);
+    }
+    TEST_CHECK(t.highest == (uint16_t)(0xFFF0 + 39));
+    TEST_CHECK(t.received == 40 && t.gaps == 0 && t.resyncs == 0);
+    TEST_CHECK(seq_tracker_loss_permille(&t) == 0);
+}
+
+static void test_gaps_and_late(void)
+{
+    seq_tracker_t t;
+    seq_tracker_init(&t);
+    seq_tracker_on_frame(&t, 0xFFFD, 0, 0);
+    // 0xFFFE, 0xFFFF and 0 skipped across the wrap
+    TEST_CHECK(seq_tracker_on_frame(&t, 1, 0, 0) == SEQ_NEW);
+    TEST_CHECK(t.gaps == 3 && seq_tracker_lost(&t) == 3);
+    TEST_CHECK(seq_tracker_on_frame(&t, 0xFFFF, 0, 0) == SEQ_LATE);
+    TEST_CHECK(seq_tracker_on_frame(&t, 0, 0, 0) == SEQ_LATE);
+    TEST_CHECK(t.reordered == 2 && seq_tracker_lost(&t) == 1);
+    TEST_CHECK(seq_tracker_on_frame(&t, 0, 0, 0) == SEQ_DUPLICATE);
+    TEST_CHECK(seq_tracker_on_frame(&t, 1, 0, 0) == SEQ_DUPLICATE);
+    TEST_CHECK(seq_tracker_on_frame(&t, 0xFFFD, 0, 0) == SEQ_DUPLICATE);
+    TEST_CHECK(t.duplicates == 3);
+    TEST_CHECK(t.received == 4);
+    // 1 lost of 5 sent
+    TEST_CHECK(seq_tracker_loss_permille(&t) == 200);
+}
+
+static void test_window_edges(void)
+{
+    seq_tracker_t t;
+    seq_tracker_init(&t);
+    seq_tracker_on_frame(&t, 100, 0, 0);
+    TEST_CHECK(seq_tracker_on_frame(&t, 100 + SEQ_TRACKER_WINDOW, 0, 0) == SEQ_NEW);
+    TEST_CHECK(t.window == 1);
+    // the oldest slot still tracked, then the first outside the window
+    TEST_CHECK(seq_tracker_on_frame(&t, 100 + 1, 0, 0) == SEQ_LATE);
+    TEST_CHECK(seq_tracker_on_frame(&t, 100 + 1, 0, 0) == SEQ_DUPLICATE);
+    TEST_CHECK(seq_tracker_on_frame(&t, 100, 0, 0) == SEQ_STALE);
+    TEST_CHECK(t.stale == 1 && t.received == 3);
+
+    // a shift of exactly WINDOW - 1 keeps the old highest
+    seq_tracker_init(&t);
+    seq_tracker_on_frame(&t, 0, 0, 0);
+    seq_tracker_on_frame(&t, SEQ_TRACKER_WINDOW - 1, 0, 0);
+    TEST_CHECK(seq_tracker_on_frame(&t, 0, 0, 0) == SEQ_DUPLICATE);
+}
+
+static void test_resync(void)
+{
+    seq_tracker_t t;
+    seq_tracker_init(&t);
+    seq_tracker_on_frame(&t, 0xFF00, 0, 0);
+    // a jump of exactly RESYNC is still loss, one more is a restart
+    TEST_CHECK(seq_tracker_on_frame(&t, (uint16_t)(0xFF00 + SEQ_TRACKER_RESYNC), 0, 0) == SEQ_NEW);
+    TEST_CHECK(t.gaps == SEQ_TRACKER_RESYNC - 1);
+    uint16_t high = t.highest;
+    TEST_CHECK(seq_tracker_on_frame(&t, (uint16_t)(high - SEQ_TRACKER_RESYNC), 0, 0) == SEQ_STALE);
+    TEST_CHECK(seq_tracker_on_frame(&t, (uint16_t)(high + SEQ_TRACKER_RESYNC + 1), 0, 0) == SEQ_RESYNC);
+    TEST_CHECK(t.resyncs == 1);
+    high = t.highest;
+    TEST_CHECK(seq_tracker_on_frame(&t, (uint16_t)(high - SEQ_TRACKER_RESYNC - 1), 0, 0) == SEQ_RESYNC);
+    TEST_CHECK(t.resyncs == 2 && t.window == 1);
+    TEST_CHECK(t.gaps == SEQ_TRACKER_RESYNC - 1);
+    // tracking continues from the new sequence
+    TEST_CHECK(seq_tracker_on_frame(&t, (uint16_t)(t.highest + 2), 0, 0) == SEQ_NEW);
+    TEST_CHECK(t.gaps == SEQ_TRACKER_RESYNC);
+}
+
+static void test_jitter(void)
+{
+    seq_tracker_t t;
+    seq_tracker_init(&t);
+    // constant transit: no jitter, whatever the clock offset and wrap
+    uint32_t stamp = 0xFFFFFF00u;
+    for (uint16_t i = 0; i < 100; i++, stamp += 10) {
+        seq_tracker_on_frame(&t, i, stamp, stamp + 12345u);
+    }
+    TEST_CHECK(t.jitter_x16_ms == 0);
+
+    // transit alternating by 8 ms converges on 8 ms
+    seq_tracker_init(&t);
+    for (uint16_t i = 0; i < 400; i++) {
+        uint32_t ts = 1000u + i * 10u;
+        seq_tracker_on_frame(&t, i, ts, ts + 50u + (i & 1) * 8u);
+    }
+    TEST_CHECK(seq_tracker_jitter_ms(&t) >= 7 && seq_tracker_jitter_ms(&t) <= 8);
+
+    // unstamped frames leave the estimate alone
+    uint32_t before = t.jitter_x16_ms;
+    seq_tracker_on_frame(&t, 400, 0, 999999u);
+    TEST_CHECK(t.jitter_x16_ms == before);
+}
+
+int main(void)
+{
+    test_in_order_wrap();
+    test_gaps_and_late();
+    test_window_edges();
+    test_resync();
+    test_jitter();
+    return test_finish("test_seq_tracker");
+}
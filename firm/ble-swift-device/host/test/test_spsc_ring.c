@@ -0,0 +1,145 @@
+// Unit tests for main/spsc_ring.c: argument checks, FIFO order, full and
+// empty rings, index wrap at 2^32, item copies that stay inside their slot,
+// and one producer thread against one consumer thread.
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "spsc_ring.h"
+
+#include "test_common.h"
+
+static void test_init(void)
+{
+    uint32_t storage[8];
+    spsc_ring_t ring;
+    TEST_CHECK(!spsc_ring_init(NULL, storage, 4, 8));
+    TEST_CHECK(!spsc_ring_init(&ring, NULL, 4, 8));
+    TEST_CHECK(!spsc_ring_init(&ring, storage, 0, 8));
+    TEST_CHECK(!spsc_ring_init(&ring, storage, 4, 1));
+    TEST_CHECK(!spsc_ring_init(&ring, storage, 4, 6));
+    TEST_CHECK(spsc_ring_init(&ring, storage, 4, 8));
+    TEST_CHECK(spsc_ring_capacity(&ring) == 8);
+    TEST_CHECK(spsc_ring_count(&ring) == 0);
+}
+
+static void test_fifo_full_empty(void)
+{
+    uint32_t storage[4];
+    spsc_ring_t ring;
+    spsc_ring_init(&ring, storage, sizeof(uint32_t), 4);
+    uint32_t v;
+    TEST_CHECK(!spsc_ring_pop(&ring, &v));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK(spsc_ring_push(&ring, &i));
+    }
+    uint32_t extra = 99;
+    TEST_CHECK(!spsc_ring_push(&ring, &extra));
+    TEST_CHECK(!spsc_ring_push(&ring, &extra));
+    TEST_CHECK(atomic_load(&ring.dropped) == 2);
+    TEST_CHECK(atomic_load(&ring.pushed) == 4);
+    TEST_CHECK(atomic_load(&ring.high_water) == 4);
+    TEST_CHECK(spsc_ring_count(&ring) == 4);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK(spsc_ring_pop(&ring, &v) && v == i);
+    }
+    TEST_CHECK(!spsc_ring_pop(&ring, &v));
+    TEST_CHECK(atomic_load(&ring.popped) == 4);
+    // a slot freed by the consumer takes a push again
+    TEST_CHECK(spsc_ring_push(&ring, &extra) && spsc_ring_pop(&ring, &v) && v == 99);
+}
+
+static void test_index_wrap(void)
+{
+    uint32_t storage[4];
+    spsc_ring_t ring;
+    spsc_ring_init(&ring, storage, sizeof(uint32_t), 4);
+    // free-running indices just short of 2^32
+    atomic_store(&ring.head, UINT32_MAX - 1);
+    atomic_store(&ring.tail, UINT32_MAX - 1);
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK(spsc_ring_push(&ring, &i));
+    }
+    uint32_t v = 0;
+    TEST_CHECK(!spsc_ring_push(&ring, &v));
+    TEST_CHECK(spsc_ring_count(&ring) == 4);
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_CHECK(spsc_ring_pop(&ring, &v) && v == i);
+    }
+    TEST_CHECK(spsc_ring_count(&ring) == 0 && !spsc_ring_pop(&ring, &v));
+}
+
+static void test_odd_item_size(void)
+{
+    // 3-byte items in 12 bytes, guarded on both sides
+    uint8_t area[4 + 12 + 4];
+    memset(area, 0xAA, sizeof(area));
+    spsc_ring_t ring;
+    TEST_CHECK(spsc_ring_init(&ring, area + 4, 3, 4));
+    for (int round = 0; round < 3; round++) {
+        for (uint8_t i = 0; i < 4; i++) {
+            uint8_t item[3] = { i, (uint8_t)(i + 1), (uint8_t)round };
+            TEST_CHECK(spsc_ring_push(&ring, item));
+        }
+        for (uint8_t i = 0; i < 4; i++) {
+            uint8_t item[3];
+            TEST_CHECK(spsc_ring_pop(&ring, item) && item[0] == i && item[1] == i + 1 && item[2] == round);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        TEST_CHECK(area[i] == 0xAA && area[sizeof(area) - 1 - i] == 0xAA);
+    }
+}
+
+#define THREAD_ITEMS 200000
+
+static spsc_ring_t s_ring;
+static uint64_t s_storage[16];
+
+static void *producer(void *arg)
+{
+    (void)arg;
+    for (uint64_t i = 0; i < THREAD_ITEMS;) {
+        if (spsc_ring_push(&s_ring, &i)) {
+            i++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    spsc_ring_init(&s_ring, s_storage, sizeof(uint64_t), 16);
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, NULL);
+    uint64_t expected = 0;
+    bool in_order = true;
+    while (expected < THREAD_ITEMS) {
+        uint64_t v;
+        if (spsc_ring_pop(&s_ring, &v)) {
+            in_order &= v == expected;
+            expected++;
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join(thread, NULL);
+    TEST_CHECK(in_order);
+    TEST_CHECK(atomic_load(&s_ring.popped) == THREAD_ITEMS);
+    TEST_CHECK(atomic_load(&s_ring.pushed) == THREAD_ITEMS);
+    TEST_CHECK(atomic_load(&s_ring.high_water) <= 16);
+}
+
+int main(void)
+{
+    test_init();
+    test_fifo_full_empty();
+    test_index_wrap();
+    test_odd_item_size();
+    test_threads();
+    return test_finish("test_spsc_ring");
+}
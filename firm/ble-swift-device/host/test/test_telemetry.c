@@ -0,0 +1,74 @@
+// Unit tests for the histogram bucket scheme shared by main/latency_hist.c
+// and main/telemetry.c: bucket edges in both, and telemetry_hist_since
+// windows (deltas, the open-ended last bucket, sum and count wrap).
+#include "latency_hist.h"
+#include "telemetry.h"
+
+#include "test_common.h"
+
+static void test_bucket_edges(void)
+{
+    TEST_CHECK(latency_hist_bucket(0, LATENCY_HIST_BUCKETS) == 0);
+    TEST_CHECK(latency_hist_bucket(1, LATENCY_HIST_BUCKETS) == 1);
+    TEST_CHECK(latency_hist_bucket(2, LATENCY_HIST_BUCKETS) == 2);
+    TEST_CHECK(latency_hist_bucket(3, LATENCY_HIST_BUCKETS) == 2);
+    TEST_CHECK(latency_hist_bucket(1u << 14, TELEMETRY_HIST_BUCKETS) == TELEMETRY_HIST_BUCKETS - 1);
+    TEST_CHECK(latency_hist_bucket((1u << 14) - 1, TELEMETRY_HIST_BUCKETS) == TELEMETRY_HIST_BUCKETS - 2);
+    TEST_CHECK(latency_hist_bucket(UINT32_MAX, TELEMETRY_HIST_BUCKETS) == TELEMETRY_HIST_BUCKETS - 1);
+    TEST_CHECK(latency_hist_bucket(UINT32_MAX, LATENCY_HIST_BUCKETS) == LATENCY_HIST_BUCKETS - 1);
+
+    // both histograms put every value below their last bucket in the same place
+    static telemetry_t tel;
+    telemetry_reset(&tel);
+    latency_hist_t hist;
+    latency_hist_reset(&hist);
+    for (uint32_t us = 0; us < (1u << 14); us += 7) {
+        telemetry_hist_add(&tel, TELEMETRY_HIST_GAP, us);
+        latency_hist_add(&hist, us);
+    }
+    bool same = true;
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        same = same && atomic_load(&tel.hists[TELEMETRY_HIST_GAP].buckets[i]) == hist.buckets[i];
+    }
+    TEST_CHECK(same);
+}
+
+static void test_since(void)
+{
+    static telemetry_t tel;
+    telemetry_reset(&tel);
+    telemetry_hist_mark_t mark = { 0 };
+    latency_hist_t window;
+
+    telemetry_hist_since(&tel, TELEMETRY_HIST_WRITE_LATENCY, &mark, 0, &window);
+    TEST_CHECK(window.count == 0 && window.sum_us == 0);
+
+    telemetry_hist_add(&tel, TELEMETRY_HIST_WRITE_LATENCY, 5);
+    telemetry_hist_add(&tel, TELEMETRY_HIST_WRITE_LATENCY, 100);
+    telemetry_hist_since(&tel, TELEMETRY_HIST_WRITE_LATENCY, &mark, 100, &window);
+    TEST_CHECK(window.count == 2 && window.sum_us == 105 && window.max_us == 100);
+    TEST_CHECK(window.buckets[3] == 1 && window.buckets[7] == 1);
+    TEST_CHECK(latency_hist_percentile_us(&window, 100) == 100);
+
+    // the next window holds only what came after, with 50 ms in the last bucket
+    telemetry_hist_add(&tel, TELEMETRY_HIST_WRITE_LATENCY, 50000);
+    telemetry_hist_since(&tel, TELEMETRY_HIST_WRITE_LATENCY, &mark, 50000, &window);
+    TEST_CHECK(window.count == 1 && window.sum_us == 50000);
+    TEST_CHECK(window.buckets[latency_hist_bucket(50000, LATENCY_HIST_BUCKETS)] == 1);
+    TEST_CHECK(window.buckets[TELEMETRY_HIST_BUCKETS - 1] == 0);
+    TEST_CHECK(latency_hist_percentile_us(&window, 99) == 50000);
+
+    // the 32-bit sum wraps between two windows
+    atomic_store(&tel.hists[TELEMETRY_HIST_WRITE_LATENCY].sum_us, UINT32_MAX - 10);
+    mark.sum_us = UINT32_MAX - 10;
+    telemetry_hist_add(&tel, TELEMETRY_HIST_WRITE_LATENCY, 30);
+    telemetry_hist_since(&tel, TELEMETRY_HIST_WRITE_LATENCY, &mark, 30, &window);
+    TEST_CHECK(window.count == 1 && window.sum_us == 30);
+}
+
+int main(void)
+{
+    test_bucket_edges();
+    test_since();
+    return test_finish("test_telemetry");
+}
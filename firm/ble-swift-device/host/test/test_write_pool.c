@@ -0,0 +1,128 @@
+// Unit tests for main/write_pool.c: argument checks, slot size and
+// alignment, claiming every buffer of a full pool, exhaustion counting,
+// release order, invalid handles and double releases, and the counters
+// over many wraps of the free ring.
+#include <string.h>
+
+#include "write_pool.h"
+
+#include "test_common.h"
+
+#define POOL_LEN    8
+#define DATA_CAP    13
+
+static _Alignas(8) uint8_t s_storage[POOL_LEN * WRITE_POOL_SLOT_SIZE(DATA_CAP)];
+static write_buf_handle_t s_free[POOL_LEN];
+
+static void test_init(void)
+{
+    write_pool_t pool;
+    TEST_CHECK(!write_pool_init(NULL, s_storage, DATA_CAP, s_free, POOL_LEN));
+    TEST_CHECK(!write_pool_init(&pool, NULL, DATA_CAP, s_free, POOL_LEN));
+    TEST_CHECK(!write_pool_init(&pool, s_storage + 4, DATA_CAP, s_free, POOL_LEN));
+    TEST_CHECK(!write_pool_init(&pool, s_storage, DATA_CAP, NULL, POOL_LEN));
+    TEST_CHECK(!write_pool_init(&pool, s_storage, DATA_CAP, s_free, 6));
+    TEST_CHECK(!write_pool_init(&pool, s_storage, DATA_CAP, s_free, 0));
+    TEST_CHECK(write_pool_init(&pool, s_storage, DATA_CAP, s_free, POOL_LEN));
+    TEST_CHECK(write_pool_in_use(&pool) == 0);
+    TEST_CHECK(pool.slot_size % 8 == 0 && pool.slot_size >= sizeof(write_buf_t) + DATA_CAP);
+}
+
+static void test_full_pool(void)
+{
+    write_pool_t pool;
+    write_pool_init(&pool, s_storage, DATA_CAP, s_free, POOL_LEN);
+    write_buf_handle_t handles[POOL_LEN];
+    uint32_t seen = 0;
+    for (int i = 0; i < POOL_LEN; i++) {
+        handles[i] = write_pool_claim(&pool);
+        TEST_CHECK(handles[i] < POOL_LEN);
+        seen |= 1u << handles[i];
+        // each buffer is aligned and its data does not reach the next one
+        write_buf_t *buf = write_pool_buf(&pool, handles[i]);
+        TEST_CHECK(((uintptr_t)buf & 7) == 0);
+        TEST_CHECK((uint8_t *)buf >= s_storage && buf->data + DATA_CAP <= s_storage + sizeof(s_storage));
+        memset(buf->data, 0xA0 + handles[i], DATA_CAP);
+        buf->len = DATA_CAP;
+    }
+    TEST_CHECK(seen == (1u << POOL_LEN) - 1);
+    TEST_CHECK(write_pool_in_use(&pool) == POOL_LEN);
+    TEST_CHECK(atomic_load(&pool.high_water) == POOL_LEN);
+
+    TEST_CHECK(write_pool_claim(&pool) == WRITE_BUF_NONE);
+    TEST_CHECK(write_pool_claim(&pool) == WRITE_BUF_NONE);
+    TEST_CHECK(atomic_load(&pool.exhausted) == 2);
+    TEST_CHECK(atomic_load(&pool.claimed) == POOL_LEN);
+
+    // buffers kept their contents: no slot overlaps another
+    bool intact = true;
+    for (int i = 0; i < POOL_LEN; i++) {
+        const write_buf_t *buf = write_pool_buf(&pool, handles[i]);
+        for (int k = 0; k < DATA_CAP; k++) {
+            intact = intact && buf->data[k] == (uint8_t)(0xA0 + handles[i]);
+        }
+    }
+    TEST_CHECK(intact);
+
+    // released buffers come back in release order
+    TEST_CHECK(write_pool_release(&pool, handles[5]));
+    TEST_CHECK(write_pool_release(&pool, handles[2]));
+    TEST_CHECK(write_pool_in_use(&pool) == POOL_LEN - 2);
+    TEST_CHECK(write_pool_claim(&pool) == handles[5]);
+    TEST_CHECK(write_pool_claim(&pool) == handles[2]);
+    for (int i = 0; i < POOL_LEN; i++) {
+        write_pool_release(&pool, handles[i]);
+    }
+    TEST_CHECK(write_pool_in_use(&pool) == 0);
+}
+
+static void test_invalid_release(void)
+{
+    write_pool_t pool;
+    write_pool_init(&pool, s_storage, DATA_CAP, s_free, POOL_LEN);
+    // nothing claimed: a release is a double release and is refused
+    TEST_CHECK(!write_pool_release(&pool, 0));
+    TEST_CHECK(write_pool_in_use(&pool) == 0);
+
+    write_buf_handle_t h = write_pool_claim(&pool);
+    TEST_CHECK(!write_pool_release(&pool, WRITE_BUF_NONE));
+    TEST_CHECK(!write_pool_release(&pool, POOL_LEN));
+    TEST_CHECK(write_pool_in_use(&pool) == 1);
+    TEST_CHECK(write_pool_release(&pool, h));
+    TEST_CHECK(!write_pool_release(&pool, h));
+    TEST_CHECK(write_pool_in_use(&pool) == 0);
+
+    // the refused releases left nothing behind to claim
+    for (int i = 0; i < POOL_LEN; i++) {
+        TEST_CHECK(write_pool_claim(&pool) < POOL_LEN);
+    }
+    TEST_CHECK(write_pool_claim(&pool) == WRITE_BUF_NONE);
+}
+
+static void test_ring_wrap(void)
+{
+    write_pool_t pool;
+    write_pool_init(&pool, s_storage, DATA_CAP, s_free, POOL_LEN);
+    // the free ring's indices wrap many times over
+    bool ok = true;
+    for (uint32_t i = 0; i < 100000; i++) {
+        write_buf_handle_t a = write_pool_claim(&pool);
+        write_buf_handle_t b = write_pool_claim(&pool);
+        ok = ok && a < POOL_LEN && b < POOL_LEN && a != b;
+        ok = ok && write_pool_release(&pool, b) && write_pool_release(&pool, a);
+    }
+    TEST_CHECK(ok);
+    TEST_CHECK(write_pool_in_use(&pool) == 0);
+    TEST_CHECK(atomic_load(&pool.claimed) == 200000);
+    TEST_CHECK(atomic_load(&pool.high_water) == 2);
+    TEST_CHECK(atomic_load(&pool.exhausted) == 0);
+}
+
+int main(void)
+{
+    test_init();
+    test_full_pool();
+    test_invalid_release();
+    test_ring_wrap();
+    return test_finish("test_write_pool");
+}
@@ -1,11 +1,16 @@
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "sdkconfig.h"
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "esp_bt.h"
@@ -13,10 +18,32 @@
 
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
 
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 
+#include "blob_rx.h"
+#include "boot_timeline.h"
+#include "conn_table.h"
+#include "duty_lut.h"
+#include "frame.h"
+#include "hot_log.h"
+#include "latency_hist.h"
+#include "led_pattern.h"
+#include "link_neg.h"
+#include "notify_packer.h"
+#include "notify_pacer.h"
+#include "notify_sched.h"
+#include "sample_buf.h"
+#include "sample_codec.h"
+#include "sample_source.h"
+#include "spsc_ring.h"
+#include "swift_config.h"
+#include "telemetry.h"
+#include "tuning_profile.h"
+#include "write_pool.h"
+
 #define MAIN_TAG "GATTS_DEMO"
 
 
@@ -24,13 +51,29 @@
 #define SERVICE_UUID      0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x01,   0x00,0x40,0x6E
 #define NOTIFY_CHAR_UUID  0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x02,   0x00,0x40,0x6E
 #define WRITE_CHAR_UUID   0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x03,   0x00,0x40,0x6E
+#define CONFIG_CHAR_UUID  0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x04,   0x00,0x40,0x6E
+#define TELEMETRY_CHAR_UUID 0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x05,   0x00,0x40,0x6E
+#define BLOB_CHAR_UUID    0x9E,0xCA,0xDC,0x24,0x0E,0xE5,   0xA9,0xE0,0xF3,0x93,0xA3,0xB5,   0x06,   0x00,0x40,0x6E
 #define DEVICE_NAME       'S', 'w', 'i', 'f', 't', 'D', 'e', 'v', 'i', 'c', 'e'
 #define DEVICE_NAME_LEN   11
 
-// Advertise parameter
-static esp_ble_adv_params_t adv_params = {
-    .adv_int_min = 0x20, // advertising interval max (32ms)
-    .adv_int_max = 0x40, // advertising interval max (64ms)
+// Advertising interval in 0.625 ms units
+#define ADV_INTERVAL(ms) ((uint16_t)((ms) * 8 / 5))
+
+// Advertise parameter: fast for CONFIG_SWIFT_ADV_FAST_WINDOW_MS after boot
+// and after every disconnect, so a central that comes back finds the device
+// in its first scan window, then slow. Both built once, not per restart.
+static esp_ble_adv_params_t adv_params_fast = {
+    .adv_int_min = ADV_INTERVAL(CONFIG_SWIFT_ADV_FAST_INTERVAL_MS), // advertising interval min (default 20ms)
+    .adv_int_max = ADV_INTERVAL(CONFIG_SWIFT_ADV_FAST_INTERVAL_MS), // advertising interval max
+    .adv_type = ADV_TYPE_IND, // connectable advertise
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC, // public address
+    .channel_map = ADV_CHNL_ALL, // use all channels
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY, // allow scan & connectable
+};
+static esp_ble_adv_params_t adv_params_slow = {
+    .adv_int_min = ADV_INTERVAL(CONFIG_SWIFT_ADV_SLOW_INTERVAL_MS), // advertising interval min (default 152ms)
+    .adv_int_max = ADV_INTERVAL(CONFIG_SWIFT_ADV_SLOW_INTERVAL_MS), // advertising interval max
     .adv_type = ADV_TYPE_IND, // connectable advertise
     .own_addr_type = BLE_ADDR_TYPE_PUBLIC, // public address
     .channel_map = ADV_CHNL_ALL, // use all channels
@@ -71,6 +114,12 @@ static uint8_t service_uuid[16] = { SERVICE_UUID };
 static uint8_t notify_char_uuid[16] = { NOTIFY_CHAR_UUID };
 // Characteristic UUID : Write
 static uint8_t write_char_uuid[16] = { WRITE_CHAR_UUID };
+// Characteristic UUID : Config
+static uint8_t config_char_uuid[16] = { CONFIG_CHAR_UUID };
+// Characteristic UUID : Telemetry
+static uint8_t telemetry_char_uuid[16] = { TELEMETRY_CHAR_UUID };
+// Characteristic UUID : Blob
+static uint8_t blob_char_uuid[16] = { BLOB_CHAR_UUID };
 
 
 static uint8_t raw_scan_rsp_data[] = {
@@ -85,6 +134,71 @@ static uint8_t raw_scan_rsp_data[] = {
     //DEVICE_NAME,
 };
 
+#if CONFIG_SWIFT_GATTS_ATTR_TABLE
+//-----------------------------------------------------------------------------
+// GATT attribute table ( the whole service in one esp_ble_gatts_create_attr_tab() call )
+//
+// Same attributes in the same order as the create/add chain, so the handles
+// come out the same either way.
+enum {
+    ATTR_IDX_SERVICE,
+    ATTR_IDX_NOTIFY_DECL,
+    ATTR_IDX_NOTIFY_VALUE,
+    ATTR_IDX_NOTIFY_CCCD,
+    ATTR_IDX_WRITE_DECL,
+    ATTR_IDX_WRITE_VALUE,
+    ATTR_IDX_CONFIG_DECL,
+    ATTR_IDX_CONFIG_VALUE,
+    ATTR_IDX_TELEMETRY_DECL,
+    ATTR_IDX_TELEMETRY_VALUE,
+    ATTR_IDX_BLOB_DECL,
+    ATTR_IDX_BLOB_VALUE,
+    ATTR_IDX_COUNT,
+};
+
+static const uint16_t primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t char_declaration_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t char_client_config_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+
+static const uint8_t notify_char_prop = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t write_char_prop = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static const uint8_t config_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+static const uint8_t telemetry_char_prop = ESP_GATT_CHAR_PROP_BIT_READ;
+static const uint8_t blob_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static const uint8_t cccd_default[2] = { 0x00, 0x00 };
+
+// Reads and writes are answered by the app ( ESP_GATT_RSP_BY_APP ): the stack
+// keeps no value for the characteristics, and each client reads its own CCCD.
+// The notify and write values are not readable.
+#define ATTR_CHAR_DECL(prop) \
+    { { ESP_GATT_RSP_BY_APP }, { ESP_UUID_LEN_16, (uint8_t *)&char_declaration_uuid, ESP_GATT_PERM_READ \
+        , sizeof(uint8_t), sizeof(uint8_t), (uint8_t *)&(prop) } }
+#define ATTR_CHAR_VALUE(uuid, perm) \
+    { { ESP_GATT_RSP_BY_APP }, { ESP_UUID_LEN_128, (uuid), (perm), 0, 0, NULL } }
+
+static const esp_gatts_attr_db_t gatt_db[ATTR_IDX_COUNT] = {
+    [ATTR_IDX_SERVICE] = { { ESP_GATT_RSP_BY_APP }, { ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid, ESP_GATT_PERM_READ
+        , sizeof(service_uuid), sizeof(service_uuid), service_uuid } },
+
+    [ATTR_IDX_NOTIFY_DECL] = ATTR_CHAR_DECL(notify_char_prop),
+    [ATTR_IDX_NOTIFY_VALUE] = ATTR_CHAR_VALUE(notify_char_uuid, 0),
+    [ATTR_IDX_NOTIFY_CCCD] = { { ESP_GATT_RSP_BY_APP }, { ESP_UUID_LEN_16, (uint8_t *)&char_client_config_uuid
+        , ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, sizeof(cccd_default), sizeof(cccd_default), (uint8_t *)cccd_default } },
+
+    [ATTR_IDX_WRITE_DECL] = ATTR_CHAR_DECL(write_char_prop),
+    [ATTR_IDX_WRITE_VALUE] = ATTR_CHAR_VALUE(write_char_uuid, ESP_GATT_PERM_WRITE),
+
+    [ATTR_IDX_CONFIG_DECL] = ATTR_CHAR_DECL(config_char_prop),
+    [ATTR_IDX_CONFIG_VALUE] = ATTR_CHAR_VALUE(config_char_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
+
+    [ATTR_IDX_TELEMETRY_DECL] = ATTR_CHAR_DECL(telemetry_char_prop),
+    [ATTR_IDX_TELEMETRY_VALUE] = ATTR_CHAR_VALUE(telemetry_char_uuid, ESP_GATT_PERM_READ),
+
+    [ATTR_IDX_BLOB_DECL] = ATTR_CHAR_DECL(blob_char_prop),
+    [ATTR_IDX_BLOB_VALUE] = ATTR_CHAR_VALUE(blob_char_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
+};
+#endif
+
 //-----------------------------------------------------------------------------
 // GATT handles and ids
 struct my_gatt_handles_and_ids_t
@@ -94,47 +208,99 @@ struct my_gatt_handles_and_ids_t
     uint16_t gatt_notify_char_handle;
     uint16_t gatt_cccd_handle;
     uint16_t gatt_write_char_handle;
-    uint16_t gatt_conn_id;
+    uint16_t gatt_config_char_handle;
+    uint16_t gatt_telemetry_char_handle;
+    uint16_t gatt_blob_char_handle;
     esp_gatt_srvc_id_t serviceid;
     esp_bt_uuid_t notify_charuuid;
     esp_bt_uuid_t write_charuuid;
+    esp_bt_uuid_t config_charuuid;
+    esp_bt_uuid_t telemetry_charuuid;
+    esp_bt_uuid_t blob_charuuid;
     esp_bt_uuid_t descruuid;
-    bool is_notify_enabled;
+    bool adv_data_set;
+    bool service_started;
+    bool is_advertising;
+    bool adv_fast;      // at the fast interval, the backoff timer armed
 };
+
 static struct my_gatt_handles_and_ids_t gatt_info = {
     .gatt_if = ESP_GATT_IF_NONE,
     .gatt_service_handle = 0,
     .gatt_notify_char_handle = 0,
     .gatt_cccd_handle = 0,
     .gatt_write_char_handle = 0,
-    .gatt_conn_id = 0,
-    .is_notify_enabled = false,
+    .gatt_config_char_handle = 0,
+    .gatt_telemetry_char_handle = 0,
+    .gatt_blob_char_handle = 0,
+    .adv_data_set = false,
+    .service_started = false,
+    .is_advertising = false,
 };
 
+//-----------------------------------------------------------------------------
+// Telemetry ( counters and handler times, read through the telemetry characteristic )
+static telemetry_t telemetry;
+// A long read of the telemetry characteristic is served from the snapshot
+// taken at offset 0, so its parts fit together.
+static uint8_t telemetry_snapshot[TELEMETRY_ENCODED_LEN];
+static uint16_t telemetry_snapshot_len;
+
+//-----------------------------------------------------------------------------
+// Boot and reconnect timeline ( logged when advertising first starts and at
+// the first notification after each disconnect )
+static boot_timeline_t boot_timeline;
+#define BOOT_TIMELINE_LOG_LEN 192
+
+//-----------------------------------------------------------------------------
+// Connections ( one slot per central, up to CONFIG_SWIFT_MAX_CONNECTIONS )
+static conn_table_t conn_table;
+static SemaphoreHandle_t conn_table_lock; // GATTS callback <-> notify timer
+
+// Runtime config ( written through the config characteristic, guarded by conn_table_lock )
+static swift_config_t swift_config;
+
 
 
 
 //---------------------------------------------------------------------
 // LED
 #define LED_GPIO 21
-static uint16_t s_led_state = 0;
 
 // PWM Setting
 #define LEDC_TIMER LEDC_TIMER_0
 #define LEDC_CHANNEL LEDC_CHANNEL_0
 #define LEDC_DUTY_RES LEDC_TIMER_13_BIT // 13 bit resolution (0 - 8191)
+#define LEDC_DUTY_MAX 8191
 #define LEDC_FREQUENCY 1000 // PWM frequency 1kHz
 #define FADE_TIME 30 // 30ms interval
 #define MAX_DUTY 34 // max duty ( cycle per seconds )
 
+// Write counter -> LEDC duty, scaled, gamma corrected and inverted ( active low )
+static duty_lut_t led_duty_lut;
+static uint32_t s_led_duty = LEDC_DUTY_MAX;
+// Set by led_init_task once LEDC is configured; until then the LED calls
+// below only leave s_led_duty for it to show.
+static atomic_bool led_ready = false;
+
 static void blink_led(void)
 {
-    // Scaling : s_led_state (0 - 34) map to (0 - 8191)
-    uint32_t scaled_duty = (s_led_state * 8191) / MAX_DUTY;
+    if (!atomic_load_explicit(&led_ready, memory_order_acquire)) {
+        return;
+    }
+    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL, s_led_duty));
+    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL));
+}
 
+// Ramps to duty (0 - 8191) in hardware over FADE_TIME; returns at once.
+static void fade_led(uint32_t duty)
+{
+    if (!atomic_load_explicit(&led_ready, memory_order_acquire)) {
+        return;
+    }
     // Active Low : invert duty
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL, 8191 - scaled_duty));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL));
+    ESP_ERROR_CHECK(ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL, LEDC_DUTY_MAX - duty, FADE_TIME));
+    ESP_ERROR_CHECK(ledc_fade_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL, LEDC_FADE_NO_WAIT));
 }
 
 static void configure_led(void)
@@ -154,108 +320,1213 @@ static void configure_led(void)
         .channel = LEDC_CHANNEL,
         .intr_type = LEDC_INTR_DISABLE,
         .timer_sel = LEDC_TIMER,
-        .duty = 8191, // initial off (active low)
+        .duty = LEDC_DUTY_MAX, // initial off (active low)
         .hpoint = 0
     };
     ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
+}
+
+//-----------------------------------------------------------------------------
+// LED pattern
+//
+// An uploaded pattern ( see led_pattern.h ) is compiled once into a duty
+// table, one entry per FADE_TIME tick. led_pattern_timer then steps through
+// the table and the LEDC fade hardware ramps between entries, so playback
+// costs one timer callback per tick and no BLE traffic. While a pattern
+// plays it owns the LED: writes still update s_led_duty but leave the LED alone.
+//
+// Two tables: an upload compiles into the one not playing and hands its
+// index to the timer through led_pattern_pending. The timer only switches
+// tables by taking led_pattern_pending, so once an upload has taken it back
+// the table playing stays put until the upload hands its own over.
+#define LED_PATTERN_TABLE_LEN 1024 // ticks, ~30 s at FADE_TIME
+#define LED_PATTERN_NONE (-1)
+#define LED_PATTERN_STOP 2
+static uint16_t led_pattern_tables[2][LED_PATTERN_TABLE_LEN];
+static led_pattern_t led_patterns[2];
+static atomic_int led_pattern_pending = LED_PATTERN_NONE; // GATTS callback -> led_pattern_timer
+static atomic_int led_pattern_current = LED_PATTERN_NONE; // led_pattern_timer -> GATTS callback
+static atomic_bool led_pattern_playing = false;
+static TimerHandle_t led_pattern_timer;
+static uint32_t led_pattern_pos; // owned by led_pattern_timer
+
+static void led_pattern_idle(void)
+{
+    atomic_store(&led_pattern_current, LED_PATTERN_NONE);
+    atomic_store(&led_pattern_playing, false);
+    xTimerStop(led_pattern_timer, 0);
+    // an upload handed over since this tick began may have queued its start before the stop
+    if (atomic_load(&led_pattern_pending) != LED_PATTERN_NONE) {
+        xTimerStart(led_pattern_timer, 0);
+    }
+}
+
+static void led_pattern_timer_callback(TimerHandle_t xTimer)
+{
+    int pending = atomic_exchange(&led_pattern_pending, LED_PATTERN_NONE);
+    if (pending == LED_PATTERN_STOP) {
+        led_pattern_idle();
+        return;
+    }
+    int current = atomic_load(&led_pattern_current);
+    if (pending != LED_PATTERN_NONE) {
+        current = pending;
+        atomic_store(&led_pattern_current, current);
+        led_pattern_pos = 0;
+        atomic_store(&led_pattern_playing, true);
+    }
+    if (current == LED_PATTERN_NONE) {
+        led_pattern_idle();
+        return;
+    }
+
+    const led_pattern_t *pattern = &led_patterns[current];
+    if (led_pattern_pos >= pattern->len) {
+        if (!pattern->loop) {
+            // one-shot done: the last level stays until the next write
+            led_pattern_idle();
+            return;
+        }
+        led_pattern_pos = 0;
+    }
+    fade_led(pattern->table[led_pattern_pos++]);
+}
+
+// Compiles a pattern record and starts it from its first tick; a record with
+// no keyframes stops the pattern and hands the LED back to writes.
+static void led_pattern_load(const uint8_t *record, uint32_t len)
+{
+    if (led_pattern_keyframes(record, len) == 0) {
+        ESP_LOGI(MAIN_TAG, "LED : Pattern stopped");
+        atomic_store(&led_pattern_pending, LED_PATTERN_STOP);
+        xTimerStart(led_pattern_timer, 0);
+        return;
+    }
+
+    // a table handed over but not picked up yet plays nothing and is reused;
+    // otherwise the spare is the one the timer is not playing
+    int taken = atomic_exchange(&led_pattern_pending, LED_PATTERN_NONE);
+    int spare = taken;
+    if (spare != 0 && spare != 1) {
+        spare = atomic_load(&led_pattern_current) == 0 ? 1 : 0;
+    }
+    int64_t start_us = esp_timer_get_time();
+    led_pattern_status_t status = led_pattern_compile(&led_patterns[spare], record, len, LEDC_DUTY_MAX);
+    if (status != LED_PATTERN_OK) {
+        ESP_LOGW(MAIN_TAG, "LED : Pattern rejected: %s", led_pattern_status_str(status));
+        telemetry_count(&telemetry, TELEMETRY_LED_PATTERNS_REJECTED, 1);
+        // the table is left untouched on error: hand back what was taken
+        if (taken != LED_PATTERN_NONE) {
+            atomic_store(&led_pattern_pending, taken);
+            xTimerStart(led_pattern_timer, 0);
+        }
+        return;
+    }
+    ESP_LOGI(MAIN_TAG, "LED : Pattern loaded, keyframes=%" PRId32 ", %" PRIu32 " ticks of %dms, loop=%d, compiled in %" PRId64 "us"
+        , led_pattern_keyframes(record, len), led_patterns[spare].len, FADE_TIME, led_patterns[spare].loop, esp_timer_get_time() - start_us);
+    telemetry_count(&telemetry, TELEMETRY_LED_PATTERNS_LOADED, 1);
+
+    atomic_store(&led_pattern_pending, spare);
+    xTimerStart(led_pattern_timer, 0);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Samples
+//
+// With a sample source configured ( CONFIG_SWIFT_SAMPLE_SOURCE_* ), sample_task
+// reads the source into one of three sample blocks every SAMPLE_BLOCK_LEN
+// sample periods and hands it over to the notify path ( see sample_buf.h ).
+// Each notify tick moves on to the next block, and every client is sent that
+// block's samples, one per frame, encoded straight out of the block. A client
+// that has not sent the whole block by then skips the rest of it. The notify
+// period is capped at SAMPLE_BLOCK_MS, since ticks further apart would leave
+// handed-over blocks to be overwritten unread.
+#define SAMPLES_ENABLED (!CONFIG_SWIFT_SAMPLE_SOURCE_NONE)
+
+#if SAMPLES_ENABLED
+#define SAMPLE_TASK_PRIO 6 // above the write consumer: the source must not back up
+#define SAMPLE_BLOCK_MS (CONFIG_SWIFT_SAMPLE_BLOCK_LEN * 1000 / CONFIG_SWIFT_SAMPLE_RATE_HZ)
+#define SAMPLE_REPLAY_MAX (CONFIG_SWIFT_BLOB_MAX_LEN / 2)
+
+static sample_source_t sample_source;
+static SemaphoreHandle_t sample_source_lock; // sample_task <-> replay upload
+static sample_buf_t sample_buf;
+static uint16_t sample_storage[SAMPLE_BUF_BLOCKS * CONFIG_SWIFT_SAMPLE_BLOCK_LEN];
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+static uint16_t sample_replay_data[SAMPLE_REPLAY_MAX];
+#endif
+#endif
+// block the notify path sends from ( guarded by conn_table_lock )
+static const sample_block_t *sample_block;
+
+#if SAMPLES_ENABLED
+static void sample_task(void *arg)
+{
+    TickType_t period = pdMS_TO_TICKS(SAMPLE_BLOCK_MS) > 0 ? pdMS_TO_TICKS(SAMPLE_BLOCK_MS) : 1;
+    TickType_t wake = xTaskGetTickCount();
+    uint32_t dropped_seen = 0;
+    for (;;) {
+        vTaskDelayUntil(&wake, period);
+
+        uint16_t overwritten;
+        sample_block_t *block = sample_buf_write_begin(&sample_buf, &overwritten);
+        if (overwritten > 0) {
+            telemetry_count(&telemetry, TELEMETRY_SAMPLES_DROPPED, overwritten);
+            telemetry_count(&telemetry, TELEMETRY_SAMPLE_BLOCKS_OVERWRITTEN, 1);
+        }
+        if (block == NULL) {
+            continue; // the notify path holds the other blocks: the samples wait in the source
+        }
+
+        xSemaphoreTake(sample_source_lock, portMAX_DELAY);
+        block->count = sample_source_read(&sample_source, block->samples, sample_buf.cap, esp_timer_get_time(), &block->t0_us);
+        block->period_us = sample_source.period_us;
+        uint32_t dropped = sample_source.dropped;
+        xSemaphoreGive(sample_source_lock);
+
+        telemetry_count(&telemetry, TELEMETRY_SAMPLES_PRODUCED, block->count);
+        if (dropped != dropped_seen) {
+            telemetry_count(&telemetry, TELEMETRY_SAMPLES_DROPPED, dropped - dropped_seen);
+            dropped_seen = dropped;
+        }
+        sample_buf_write_end(&sample_buf, block);
+    }
+}
+
+static bool samples_init(void)
+{
+    sample_source_lock = xSemaphoreCreateMutex();
+    if (sample_source_lock == NULL || !sample_buf_init(&sample_buf, sample_storage, CONFIG_SWIFT_SAMPLE_BLOCK_LEN)) {
+        return false;
+    }
+    int64_t now_us = esp_timer_get_time();
+#if CONFIG_SWIFT_SAMPLE_SOURCE_SYNTHETIC
+    sample_source_synthetic_init(&sample_source, CONFIG_SWIFT_SAMPLE_RATE_HZ, now_us);
+#elif CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+    sample_source_replay_init(&sample_source, CONFIG_SWIFT_SAMPLE_RATE_HZ, sample_replay_data, SAMPLE_REPLAY_MAX, now_us);
+#elif CONFIG_SWIFT_SAMPLE_SOURCE_ADC
+    (void)now_us;
+    if (!sample_source_adc_init(&sample_source, CONFIG_SWIFT_SAMPLE_RATE_HZ, CONFIG_SWIFT_SAMPLE_ADC_CHANNEL, CONFIG_SWIFT_SAMPLE_BLOCK_LEN)) {
+        return false;
+    }
+#endif
+    ESP_LOGI(MAIN_TAG, "Samples : %s source, %d Hz, %d samples per block"
+        , sample_source.name, CONFIG_SWIFT_SAMPLE_RATE_HZ, CONFIG_SWIFT_SAMPLE_BLOCK_LEN);
+    return true;
+}
+
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+// Replaces the replayed samples with an uploaded record.
+static void samples_replay_upload(const uint8_t *record, uint32_t len)
+{
+    xSemaphoreTake(sample_source_lock, portMAX_DELAY);
+    bool loaded = sample_source_replay_load(&sample_source, record, len);
+    xSemaphoreGive(sample_source_lock);
+    if (!loaded) {
+        ESP_LOGW(MAIN_TAG, "Samples : Replay record rejected, len=%" PRIu32, len);
+        return;
+    }
+    ESP_LOGI(MAIN_TAG, "Samples : Replaying %" PRId32 " samples", sample_replay_count(record, len));
+}
+#endif
+
+// Moves the notify path on to the next block, when the producer has handed
+// one over. Called with conn_table_lock held.
+static void notify_sample_advance(void)
+{
+    const sample_block_t *next = sample_buf_read_begin(&sample_buf);
+    if (next == NULL) {
+        return;
+    }
+    const sample_block_t *old = sample_block;
+    if (old != NULL) {
+        uint32_t skipped = 0;
+        uint32_t mask = conn_table.notify_mask;
+        while (mask) {
+            int slot = __builtin_ctz(mask);
+            mask &= mask - 1;
+            uint32_t sent = conn_table.state[slot].sample_next - old->seq;
+            if (sent < old->count) {
+                skipped += old->count - sent;
+            }
+        }
+        if (skipped > 0) {
+            telemetry_count(&telemetry, TELEMETRY_SAMPLES_SKIPPED, skipped);
+        }
+        sample_buf_read_end(&sample_buf, old);
+    }
+    sample_block = next;
+}
+#endif
+
+// First sample still to send to a client: where it left off, or the start of
+// the current block when it is new or fell behind. Called with conn_table_lock held.
+static uint32_t notify_sample_start(const conn_state_t *conn)
+{
+    const sample_block_t *block = sample_block;
+    if (block != NULL && (int32_t)(conn->sample_next - block->seq) < 0) {
+        return block->seq;
+    }
+    return conn->sample_next;
+}
+
+#if SAMPLES_ENABLED
+// Puts sample number `sample` of the current block, and its sample time, into
+// a frame header; false when the block has no such sample.
+static bool notify_sample_frame(uint32_t sample, frame_t *header)
+{
+    const sample_block_t *block = sample_block;
+    if (block == NULL) {
+        return false;
+    }
+    uint32_t i = sample - block->seq;
+    if (i >= block->count) {
+        return false;
+    }
+    uint16_t value = block->samples[i];
+    header->payload_len = 2;
+    header->payload[0] = (uint8_t)value;
+    header->payload[1] = (uint8_t)(value >> 8);
+    header->timestamp_ms = (uint32_t)((block->t0_us + (int64_t)i * block->period_us) / 1000);
+    return true;
+}
+#endif
+
+
+
+//-----------------------------------------------------------------------------
+// Notify
+//
+// With CONFIG_SWIFT_NOTIFY_TASK the notify timer only timestamps the tick and
+// wakes notify_task, which builds and sends the notifications. A slow
+// esp_ble_gatts_send_indicate then holds up that task alone, not the timer
+// service task every other software timer runs in. Ticks that arrive while
+// the task is still sending queue up in notify_tick_ring and are sent as one
+// batch.
+#define NOTIFY_FRAME_LEN FRAME_LEN // sequenced frame header (see frame.h), one sample or no payload
+#define NOTIFY_TASK_PRIO 4 // below the write consumer: actuation first
+#define NOTIFY_TICK_RING_LEN 16 // ticks the task may fall behind before they are dropped
+#define NOTIFY_RUN_DATA (FRAME_LEN + SAMPLE_RUN_HEADER_LEN) // sample run bytes before the codec's
+
+static TimerHandle_t notify_timer;
+
+// Timer period for a notify period; never 0 ticks at a coarse FreeRTOS tick
+// rate, and with samples never longer than a sample block.
+// sdkconfig.defaults sets 1 ms ticks; a coarser tick would round the shortest periods up
+_Static_assert(CONFIG_FREERTOS_HZ * SWIFT_CONFIG_NOTIFY_PERIOD_MIN >= 1000, "CONFIG_FREERTOS_HZ too low for SWIFT_CONFIG_NOTIFY_PERIOD_MIN");
+
+static TickType_t notify_period_ticks(uint16_t period_ms)
+{
+#if SAMPLES_ENABLED
+    if (period_ms > SAMPLE_BLOCK_MS) {
+        ESP_LOGW(MAIN_TAG, "Samples : Notify period %u ms capped at the %d ms block", period_ms, SAMPLE_BLOCK_MS);
+        period_ms = SAMPLE_BLOCK_MS;
+    }
+#endif
+    TickType_t ticks = pdMS_TO_TICKS(period_ms);
+    return ticks > 0 ? ticks : 1;
+}
+
+// Reserves the next frame of a notification and fills in its header; NULL
+// when it is full, or when the client has been sent every sample there is.
+static uint8_t *notify_next_frame(notify_packer_t *packer, frame_t *header, uint32_t sample)
+{
+#if SAMPLES_ENABLED
+    if (!notify_sample_frame(sample, header)) {
+        return NULL;
+    }
+#endif
+    return notify_packer_next(packer, NOTIFY_FRAME_LEN);
+}
+
+// Packs as many of the client's next frames as fit into cap bytes, one
+// sample each when there are samples; returns the payload length.
+static uint16_t notify_pack_frames(uint8_t *data, uint16_t cap, uint32_t *counter, uint32_t *sample)
+{
+    notify_packer_t packer;
+    notify_packer_init(&packer, data, NOTIFY_PAYLOAD_MAX, cap);
+    frame_t header = {
+        .type = FRAME_TYPE_DATA,
+        .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+    };
+    uint8_t *frame;
+    while ((frame = notify_next_frame(&packer, &header, *sample)) != NULL) {
+        header.seq = (uint16_t)*counter;
+        frame_encode(&header, frame);
+        (*counter)++;
+        (*sample)++;
+    }
+    return packer.len;
+}
+
+#if SAMPLES_ENABLED
+// Packs the client's next samples as one run ( see sample_codec.h ): the
+// first in a SAMPLE_RUN frame, as many of the rest of the block as fit delta
+// coded behind it. Returns the payload length, 0 when there is no sample.
+static uint16_t notify_pack_run(sample_codec_t codec, uint8_t *data, uint16_t cap, uint32_t *counter, uint32_t *sample)
+{
+    frame_t header = {
+        .seq = (uint16_t)*counter,
+        .type = FRAME_TYPE_SAMPLE_RUN,
+    };
+    if (!notify_sample_frame(*sample, &header)) {
+        return 0;
+    }
+    const sample_block_t *block = sample_block;
+    uint32_t first = *sample - block->seq;
+    uint32_t rest = block->count - first - 1;
+    if (rest > SAMPLE_RUN_COUNT_MAX) {
+        rest = SAMPLE_RUN_COUNT_MAX;
+    }
+    uint16_t count;
+    uint16_t len = sample_codec_encode(codec, block->samples[first], &block->samples[first + 1], (uint16_t)rest
+        , data + NOTIFY_RUN_DATA, cap - NOTIFY_RUN_DATA, &count);
+
+    frame_encode(&header, data);
+    sample_run_t run = {
+        .codec = codec,
+        .count = (uint8_t)count,
+        .period_us = (uint16_t)block->period_us,
+    };
+    sample_run_encode_header(&run, data + FRAME_LEN);
+    *counter += 1u + count;
+    *sample += 1u + count;
+    return NOTIFY_RUN_DATA + len;
+}
+#endif
+
+// Builds and sends one notification; false when there was nothing to send or
+// the stack refused it.
+static bool notify_client_one(conn_state_t *conn)
+{
+    // as many frames as fit into MTU-3, or into the configured payload size
+    uint16_t cap = notify_payload_capacity(conn->mtu);
+    if (swift_config.payload_len != 0 && swift_config.payload_len < cap) {
+        cap = swift_config.payload_len;
+    }
+    uint8_t data[NOTIFY_PAYLOAD_MAX];
+    uint32_t counter = conn->notify_counter;
+    uint32_t sample = notify_sample_start(conn);
+    uint16_t len;
+#if SAMPLES_ENABLED
+    // the client decodes sample runs; a payload too small for one gets frames
+    sample_codec_t codec = (sample_codec_t)swift_config.sample_codec;
+    if (codec != SAMPLE_CODEC_NONE && cap > NOTIFY_RUN_DATA) {
+        len = notify_pack_run(codec, data, cap, &counter, &sample);
+    } else {
+        len = notify_pack_frames(data, cap, &counter, &sample);
+    }
+#else
+    len = notify_pack_frames(data, cap, &counter, &sample);
+#endif
+    if (len == 0) {
+        return false;
+    }
+
+    //ESP_LOGI(MAIN_TAG, "Sending notify: %"PRIx32"", counter);
+    bool accepted = esp_ble_gatts_send_indicate(gatt_info.gatt_if, conn->conn_id, gatt_info.gatt_notify_char_handle, len, data, false) == ESP_OK;
+    notify_pacer_on_send(&conn->pacer, accepted);
+    if (accepted) {
+        conn->notify_counter = counter;
+        conn->sample_next = sample;
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_SENT, 1);
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_BYTES, len);
+        if (boot_timeline_mark_conn(&boot_timeline, BOOT_MARK_FIRST_NOTIFY, conn->conn_id, esp_timer_get_time())) {
+            char line[BOOT_TIMELINE_LOG_LEN];
+            boot_timeline_format(&boot_timeline, BOOT_MARK_DISCONNECT, BOOT_MARK_FIRST_NOTIFY, line, sizeof(line));
+            ESP_LOGI(MAIN_TAG, "GATT: %s: %s", boot_timeline_has(&boot_timeline, BOOT_MARK_DISCONNECT) ? "Reconnect" : "First client", line);
+        }
+    } else {
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_REFUSED, 1);
+    }
+    return accepted;
+}
+
+//-----------------------------------------------------------------------------
+// Notify events
+//
+// Alerts, the LED duty and write acknowledgements go to subscribed clients as
+// event frames on the notify characteristic, each channel under the policy
+// the config characteristic set for it ( see notify_sched.h ). All channels
+// are off by default, so a client that does not decode events gets none.
+static atomic_uint notify_event_mask; // bit per channel with a policy, set under conn_table_lock
+
+// Sends the client's pending events, packed MTU-full whatever the configured
+// payload size, while the pacing window has room. They take no credit:
+// events are not what the tick paces. Called with conn_table_lock held.
+static void notify_events_flush(conn_state_t *conn)
+{
+    uint16_t cap = notify_payload_capacity(conn->mtu);
+    while (notify_sched_pending(&conn->events) && notify_pacer_room(&conn->pacer) > 0) {
+        uint8_t data[NOTIFY_PAYLOAD_MAX];
+        uint16_t len = notify_sched_pack(&conn->events, data, cap);
+        bool accepted = esp_ble_gatts_send_indicate(gatt_info.gatt_if, conn->conn_id, gatt_info.gatt_notify_char_handle, len, data, false) == ESP_OK;
+        notify_pacer_on_send_unpaced(&conn->pacer, accepted);
+        if (!accepted) {
+            // still pending: the next tick or confirmation tries again
+            telemetry_count(&telemetry, TELEMETRY_NOTIFY_REFUSED, 1);
+            return;
+        }
+        notify_sched_commit(&conn->events, len);
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_SENT, 1);
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_BYTES, len);
+    }
+}
+
+// Publishes an event to the client conn_id, or with -1 to every subscribed
+// client. An IMMEDIATE one is sent from here, the others at the next tick.
+static void notify_event(notify_channel_t ch, int conn_id, uint16_t value)
+{
+    if (!(atomic_load_explicit(&notify_event_mask, memory_order_relaxed) & (1u << ch))) {
+        return;
+    }
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+    notify_policy_t policy = (notify_policy_t)swift_config.notify_policy[ch];
+    uint32_t mask = gatt_info.gatt_notify_char_handle != 0 ? conn_table.notify_mask : 0;
+    while (mask) {
+        int slot = __builtin_ctz(mask);
+        mask &= mask - 1;
+        conn_state_t *conn = &conn_table.state[slot];
+        if (conn_id >= 0 && conn->conn_id != conn_id) {
+            continue;
+        }
+        if (notify_sched_publish(&conn->events, ch, policy, value, now_ms)) {
+            notify_events_flush(conn);
+        }
+    }
+    xSemaphoreGive(conn_table_lock);
+}
+
+// A config write set the policies; channels turned off drop what they hold.
+// Called with conn_table_lock held.
+static void notify_events_configure(const swift_config_t *cfg)
+{
+    unsigned mask = 0;
+    for (int ch = 0; ch < NOTIFY_CH_COUNT; ch++) {
+        if (cfg->notify_policy[ch] != NOTIFY_POLICY_OFF) {
+            mask |= 1u << ch;
+            continue;
+        }
+        for (int i = 0; i < CONN_TABLE_MAX; i++) {
+            notify_sched_clear(&conn_table.state[i].events, (notify_channel_t)ch);
+        }
+    }
+    atomic_store_explicit(&notify_event_mask, mask, memory_order_relaxed);
+}
+
+// Sends as much of the client's credit as the pacing window allows, after an
+// IMMEDIATE event still waiting for room. Called with conn_table_lock held.
+static void notify_client(conn_state_t *conn)
+{
+    if (notify_sched_urgent(&conn->events)) {
+        notify_events_flush(conn);
+    }
+    uint16_t budget = notify_pacer_budget(&conn->pacer);
+    for (uint16_t i = 0; i < budget; i++) {
+        if (!notify_client_one(conn)) {
+            break;
+        }
+    }
+}
+
+// Grants every subscribed client the credit of `ticks` ticks and sends it.
+static void notify_fan_out(uint32_t ticks)
+{
+    if (gatt_info.gatt_notify_char_handle == 0) {
+        return;
+    }
+    int64_t start_us = esp_timer_get_time();
+    uint32_t target = ticks * CONFIG_SWIFT_NOTIFY_BURST;
+    if (target > UINT16_MAX) {
+        target = UINT16_MAX;
+    }
+
+    // fan out to every subscribed client
+    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+#if SAMPLES_ENABLED
+    notify_sample_advance();
+#endif
+    uint32_t mask = conn_table.notify_mask;
+    while (mask) {
+        int slot = __builtin_ctz(mask);
+        mask &= mask - 1;
+        // NOTIFY_BURST per tick; whatever the window holds back is sent on CONF_EVT
+        notify_pacer_tick(&conn_table.state[slot].pacer, (uint16_t)target);
+        // the events coalesced since the last tick first
+        notify_events_flush(&conn_table.state[slot]);
+        notify_client(&conn_table.state[slot]);
+    }
+    xSemaphoreGive(conn_table_lock);
+    telemetry_hist_add(&telemetry, TELEMETRY_HIST_NOTIFY_TIMER, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+#if CONFIG_SWIFT_NOTIFY_TASK
+// notify timer (producer) -> notify_task (consumer), tick times in us
+static spsc_ring_t notify_tick_ring;
+static int64_t notify_tick_ring_storage[NOTIFY_TICK_RING_LEN];
+static TaskHandle_t notify_task_handle;
+
+static void notify_timer_callback(TimerHandle_t xTimer) {
+    int64_t tick_us = esp_timer_get_time();
+    if (!spsc_ring_push(&notify_tick_ring, &tick_us)) {
+        telemetry_count(&telemetry, TELEMETRY_NOTIFY_TICKS_DROPPED, 1);
+    }
+    xTaskNotifyGive(notify_task_handle);
+}
+
+static void notify_task(void *arg)
+{
+    for (;;) {
+        // sleep until the timer signals a tick
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // every tick since the last batch, oldest first
+        uint32_t ticks = 0;
+        int64_t tick_us;
+        int64_t now_us = esp_timer_get_time();
+        while (spsc_ring_pop(&notify_tick_ring, &tick_us)) {
+            telemetry_hist_add(&telemetry, TELEMETRY_HIST_NOTIFY_LAG, (uint32_t)(now_us - tick_us));
+            ticks++;
+        }
+        if (ticks > 0) {
+            notify_fan_out(ticks);
+        }
+    }
+}
+#else
+static void notify_timer_callback(TimerHandle_t xTimer) {
+    notify_fan_out(1);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Runtime config
+static esp_err_t request_phy(const uint8_t *bda, uint8_t phy_mask)
+{
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    if (phy_mask == 0) {
+        return ESP_ERR_NOT_SUPPORTED; // no preference: leave it to the central
+    }
+    esp_bd_addr_t bd_addr;
+    memcpy(bd_addr, bda, sizeof(esp_bd_addr_t));
+    // config bits match ESP_BLE_GAP_PHY_*_PREF_MASK
+    esp_err_t ret = esp_ble_gap_set_preferred_phy(bd_addr, 0, phy_mask, phy_mask, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "GAP : Set preferred PHY failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+#else
+    (void)bda;
+    (void)phy_mask; // BLE 4.2 controller: 1M only
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static void request_conn_params(const uint8_t *bda, const swift_config_t *cfg)
+{
+    esp_ble_conn_update_params_t params = {
+        .min_int = cfg->conn_int_min,
+        .max_int = cfg->conn_int_max,
+        .latency = cfg->conn_latency,
+        .timeout = cfg->conn_timeout,
+    };
+    memcpy(params.bda, bda, sizeof(esp_bd_addr_t));
+    esp_err_t ret = esp_ble_gap_update_conn_params(&params);
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "GAP : Update connection params failed: %s", esp_err_to_name(ret));
+    }
+}
+
+// Applies the fields of a config write to the running device.
+static void apply_config(const swift_config_t *cfg, uint32_t changed)
+{
+    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+    bool any_subscriber = conn_table_notify_count(&conn_table) > 0;
+    uint8_t bdas[CONN_TABLE_MAX][6];
+    int conn_count = 0;
+    for (int i = 0; i < CONN_TABLE_MAX; i++) {
+        if (conn_table.used_mask & (1u << i)) {
+            memcpy(bdas[conn_count++], conn_table.state[i].bda, 6);
+        }
+    }
+    xSemaphoreGive(conn_table_lock);
+
+    if (changed & SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_PERIOD)) {
+        // xTimerChangePeriod also starts a dormant timer
+        xTimerChangePeriod(notify_timer, notify_period_ticks(cfg->notify_period_ms), 0);
+        if (!any_subscriber) {
+            xTimerStop(notify_timer, 0);
+        }
+    }
+
+    // re-negotiate every open link
+    bool conn_params = (changed & (SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_CONN_INTERVAL) | SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_CONN_LATENCY))) != 0;
+    bool phy = (changed & SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PHY)) != 0;
+    for (int i = 0; i < conn_count; i++) {
+        if (conn_params) {
+            request_conn_params(bdas[i], cfg);
+        }
+        if (phy) {
+            request_phy(bdas[i], cfg->phy_mask);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Link negotiation ( data length, then PHY, per link; see link_neg.h )
+#define LINK_NEG_POLL_MS 250
+
+static TimerHandle_t link_neg_timer;
+static int link_neg_data_len_owner = -1; // conn_id with a data length request outstanding
+
+static void log_link(const conn_state_t *conn)
+{
+    const link_neg_t *ln = &conn->link;
+    ESP_LOGI(MAIN_TAG, "GAP : Link ready, conn_id=%d: data len tx=%d rx=%d (%s), PHY tx=%d rx=%d (%s), %d ms"
+        , conn->conn_id, ln->tx_octets, ln->rx_octets, link_neg_result_str(ln->data_len_result)
+        , ln->tx_phy, ln->rx_phy, link_neg_result_str(ln->phy_result)
+        , (int)((ln->done_us - ln->started_us) / 1000));
+}
+
+// Issues what the negotiator asked for and follows up until it waits for the
+// controller. Called with conn_table_lock held.
+static void link_neg_run(conn_state_t *conn, link_neg_state_t before, link_neg_action_t action)
+{
+    while (action != LINK_NEG_ACTION_NONE) {
+        int64_t now = esp_timer_get_time();
+        esp_bd_addr_t bd_addr;
+        memcpy(bd_addr, conn->bda, sizeof(esp_bd_addr_t));
+        if (action == LINK_NEG_ACTION_SET_DATA_LEN) {
+            link_neg_data_len_owner = conn->conn_id;
+            esp_err_t ret = esp_ble_gap_set_pkt_data_len(bd_addr, conn->link.want_tx_octets);
+            if (ret == ESP_OK) {
+                break;
+            }
+            ESP_LOGE(MAIN_TAG, "GAP : Set data length failed: %s", esp_err_to_name(ret));
+            link_neg_data_len_owner = -1;
+            action = link_neg_on_data_len(&conn->link, false, 0, 0, now);
+        } else {
+            if (request_phy(conn->bda, conn->link.want_phy_mask) == ESP_OK) {
+                break;
+            }
+            action = link_neg_on_phy(&conn->link, false, 0, 0, now);
+        }
+    }
+    if (link_neg_data_len_owner == conn->conn_id && conn->link.state != LINK_NEG_DATA_LEN_PENDING) {
+        link_neg_data_len_owner = -1; // timed out
+    }
+    if (before != LINK_NEG_DONE && conn->link.state == LINK_NEG_DONE) {
+        log_link(conn);
+    }
+}
+
+// Starts queued links and gives up on unanswered requests. Called with conn_table_lock held.
+static bool link_neg_poll_all(void)
+{
+    bool any_pending = false;
+    for (int i = 0; i < CONN_TABLE_MAX; i++) {
+        if (!(conn_table.used_mask & (1u << i))) {
+            continue;
+        }
+        conn_state_t *conn = &conn_table.state[i];
+        link_neg_state_t before = conn->link.state;
+        bool busy = link_neg_data_len_owner >= 0 && link_neg_data_len_owner != conn->conn_id;
+        link_neg_run(conn, before, link_neg_poll(&conn->link, busy, esp_timer_get_time()));
+        any_pending |= link_neg_is_pending(&conn->link);
+    }
+    return any_pending;
+}
+
+static void link_neg_timer_callback(TimerHandle_t xTimer)
+{
+    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+    bool any_pending = link_neg_poll_all();
+    xSemaphoreGive(conn_table_lock);
+    if (!any_pending) {
+        xTimerStop(link_neg_timer, 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Write
+//
+// A write carries one or more whole frames back to back; a single short
+// write (the old counter-only client) is zero padded to one frame.
+#define WRITE_FRAME_LEN FRAME_LEN
+// ATT Write Request / Command header: opcode (1 byte) + attribute handle (2 bytes)
+#define ATT_WRITE_HEADER_LEN 3
+#define ATT_VALUE_MAX 512
+// Largest value one write can carry at the local MTU
+#define WRITE_BUF_LEN (CONFIG_SWIFT_LOCAL_MTU - ATT_WRITE_HEADER_LEN < ATT_VALUE_MAX ? CONFIG_SWIFT_LOCAL_MTU - ATT_WRITE_HEADER_LEN : ATT_VALUE_MAX)
+#define WRITE_CONSUMER_TASK_PRIO 5
+
+_Static_assert((CONFIG_SWIFT_WRITE_RING_LEN & (CONFIG_SWIFT_WRITE_RING_LEN - 1)) == 0
+    , "CONFIG_SWIFT_WRITE_RING_LEN must be a power of two");
+
+// GATTS callback claims a buffer, copies the value in once and passes the
+// handle on; write_consumer_task applies it in place and releases it
+static write_pool_t write_pool;
+static _Alignas(8) uint8_t write_pool_storage[CONFIG_SWIFT_WRITE_RING_LEN * WRITE_POOL_SLOT_SIZE(WRITE_BUF_LEN)];
+static write_buf_handle_t write_pool_free_storage[CONFIG_SWIFT_WRITE_RING_LEN];
+static uint32_t write_pool_exhausted_reported = 0;
+
+// GATTS callback (producer) -> write_consumer_task (consumer), claimed handles in order.
+// As large as the pool, so a claimed handle always fits.
+static spsc_ring_t write_ring;
+static write_buf_handle_t write_ring_storage[CONFIG_SWIFT_WRITE_RING_LEN];
+
+// write-to-actuation latency: recorded in telemetry, logged per window by
+// write_consumer_task, which owns the mark and the window's max
+static telemetry_hist_mark_t write_latency_mark;
+static uint32_t write_latency_max_us;
+static atomic_bool write_latency_report_requested = false;
+
+static uint16_t write_frame_count(uint16_t len)
+{
+    return len <= WRITE_FRAME_LEN ? 1 : len / WRITE_FRAME_LEN;
+}
+
+static bool write_len_valid(uint16_t len)
+{
+    return len <= WRITE_FRAME_LEN || (len <= WRITE_BUF_LEN && len % WRITE_FRAME_LEN == 0);
+}
+
+static void apply_write_frame(const uint8_t *frame)
+{
+    uint16_t counter = (uint16_t)(frame[0] | (frame[1] << 8));
+    s_led_duty = duty_lut_get(&led_duty_lut, counter);
+
+    if (!atomic_load_explicit(&led_pattern_playing, memory_order_relaxed)) {
+        blink_led();
+    }
+}
+
+static void report_write_latency(void)
+{
+    latency_hist_t window;
+    telemetry_hist_since(&telemetry, TELEMETRY_HIST_WRITE_LATENCY, &write_latency_mark, write_latency_max_us, &window);
+    if (window.count > 0) {
+        latency_hist_log(MAIN_TAG, "Write latency", &window);
+    }
+    write_latency_max_us = 0;
+}
+
+static TaskHandle_t write_consumer_task_handle;
+static void write_consumer_task(void *arg)
+{
+    for (;;) {
+        // sleep until the GATTS callback signals new writes
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // drain every pending write, oldest first
+        write_buf_handle_t handle;
+        while (spsc_ring_pop(&write_ring, &handle)) {
+            const write_buf_t *buf = write_pool_buf(&write_pool, handle);
+            for (uint16_t off = 0; off + WRITE_FRAME_LEN <= buf->len; off += WRITE_FRAME_LEN) {
+                apply_write_frame(buf->data + off);
+                notify_event(NOTIFY_CH_WRITE_ACK, buf->conn_id, (uint16_t)(buf->data[off] | (buf->data[off + 1] << 8)));
+            }
+            if (buf->len >= WRITE_FRAME_LEN) {
+                notify_event(NOTIFY_CH_LED, -1, (uint16_t)s_led_duty);
+            }
+            uint32_t latency_us = (uint32_t)(esp_timer_get_time() - buf->rx_time_us);
+            write_pool_release(&write_pool, handle);
+
+            telemetry_hist_add(&telemetry, TELEMETRY_HIST_WRITE_LATENCY, latency_us);
+            if (latency_us > write_latency_max_us) {
+                write_latency_max_us = latency_us;
+            }
+            telemetry_count(&telemetry, TELEMETRY_WRITES_APPLIED, 1);
+        }
+
+        uint32_t exhausted = atomic_load_explicit(&write_pool.exhausted, memory_order_relaxed);
+        if (exhausted != write_pool_exhausted_reported) {
+            HOT_LOGW(MAIN_TAG, "Write pool exhausted, dropped=%" PRIu32 ", high water=%" PRIu32 "/%u"
+                , exhausted, atomic_load_explicit(&write_pool.high_water, memory_order_relaxed), write_pool.count);
+            write_pool_exhausted_reported = exhausted;
+        }
+
+        uint32_t window_count = atomic_load_explicit(&telemetry.hists[TELEMETRY_HIST_WRITE_LATENCY].count, memory_order_relaxed)
+            - write_latency_mark.count;
+        if (window_count >= CONFIG_SWIFT_WRITE_LATENCY_LOG_INTERVAL
+            || atomic_exchange(&write_latency_report_requested, false)) {
+            report_write_latency();
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Blob
+//
+// Large uploads (long writes, or chunked Write Commands) are reassembled in
+// blob_arena. Only the GATTS callback touches blob_rx, so it takes no lock.
+static blob_rx_t blob_rx;
+static uint8_t blob_arena[CONFIG_SWIFT_BLOB_MAX_LEN];
+
+static esp_gatt_status_t blob_att_status(blob_rx_status_t status)
+{
+    switch (status) {
+        case BLOB_RX_OK:
+        case BLOB_RX_COMPLETE:
+            return ESP_GATT_OK;
+        case BLOB_RX_ERR_OFFSET:
+        case BLOB_RX_ERR_IDLE:
+            return ESP_GATT_INVALID_OFFSET;
+        case BLOB_RX_ERR_OVERFLOW:
+            return ESP_GATT_PREPARE_Q_FULL;
+        case BLOB_RX_ERR_BUSY:
+        default:
+            return ESP_GATT_BUSY;
+    }
+}
+
+static void blob_received(uint16_t conn_id)
+{
+    ESP_LOGI(MAIN_TAG, "GATT: Blob received, conn_id=%d: len=%" PRIu32 " crc=0x%08" PRIx32 " in %" PRIu32 "ms"
+        , conn_id, blob_rx.done_len, blob_rx.done_crc, blob_rx.done_duration_ms);
+    telemetry_count(&telemetry, TELEMETRY_BLOBS_COMPLETED, 1);
+    telemetry_count(&telemetry, TELEMETRY_BLOB_BYTES, blob_rx.done_len);
+    notify_event(NOTIFY_CH_ALERT, conn_id, NOTIFY_ALERT_BLOB_COMPLETE);
+
+    // the first byte says what the blob is
+    if (blob_rx.done_len > 0 && blob_arena[0] == LED_PATTERN_RECORD_TYPE) {
+        led_pattern_load(blob_arena, blob_rx.done_len);
+    }
+#if CONFIG_SWIFT_SAMPLE_SOURCE_REPLAY
+    if (blob_rx.done_len > 0 && blob_arena[0] == SAMPLE_REPLAY_RECORD_TYPE) {
+        samples_replay_upload(blob_arena, blob_rx.done_len);
+    }
+#endif
+}
+
+static void blob_rejected(uint16_t conn_id, uint32_t offset, blob_rx_status_t status)
+{
+    ESP_LOGW(MAIN_TAG, "GATT: Blob piece rejected, conn_id=%d, offset=%" PRIu32 ": %s", conn_id, offset, blob_rx_status_str(status));
+    telemetry_count(&telemetry, TELEMETRY_BLOB_REJECTED, 1);
+    notify_event(NOTIFY_CH_ALERT, conn_id, (uint16_t)(NOTIFY_ALERT_BLOB_REJECTED | (status << 8)));
+}
+
+// Prepare Write ( one piece of a long write ): streamed into the arena now,
+// completed by ESP_GATTS_EXEC_WRITE_EVT. The response echoes the piece.
+static void handle_prepare_write(esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t *param)
+{
+    esp_gatt_status_t status;
+    if (param->write.handle != gatt_info.gatt_blob_char_handle) {
+        status = ESP_GATT_NOT_LONG;
+    } else {
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        blob_rx_status_t rx_status = BLOB_RX_OK;
+        if (param->write.offset == 0) {
+            rx_status = blob_rx_begin(&blob_rx, param->write.conn_id, now_ms);
+        }
+        if (rx_status == BLOB_RX_OK) {
+            rx_status = blob_rx_append(&blob_rx, param->write.conn_id, param->write.offset, param->write.value, param->write.len, now_ms);
+        }
+        if (rx_status != BLOB_RX_OK) {
+            blob_rejected(param->write.conn_id, param->write.offset, rx_status);
+        }
+        status = blob_att_status(rx_status);
+    }
+    if (!param->write.need_rsp) {
+        return;
+    }
+    static esp_gatt_rsp_t rsp; // too large for the BTC task stack; only used from the GATTS callback
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.attr_value.handle = param->write.handle;
+    rsp.attr_value.offset = param->write.offset;
+    rsp.attr_value.len = param->write.len;
+    rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+    memcpy(rsp.attr_value.value, param->write.value, param->write.len);
+    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, &rsp);
 }
 
-
-
-//-----------------------------------------------------------------------------
-// Notify
-static TimerHandle_t notify_timer;
-static void notify_timer_callback(TimerHandle_t xTimer) {
-    if (gatt_info.is_notify_enabled && gatt_info.gatt_notify_char_handle != 0) {
-
-        // 10 bytes dummy data
-        static uint32_t counter = 0;
-        uint8_t data[10] = {0};
-        data[0] = (uint8_t)(counter & 0xFF);
-        data[1] = (uint8_t)((counter >> 8) & 0xFF);
-        counter++;
-        
-        //ESP_LOGI(MAIN_TAG, "Sending notify: %"PRIx32"", counter);
-        esp_ble_gatts_send_indicate(gatt_info.gatt_if, gatt_info.gatt_conn_id, gatt_info.gatt_notify_char_handle, 10, data, false);
+// Write Command / Request with a chunk header ( see blob_rx.h )
+static esp_gatt_status_t handle_blob_chunk(const esp_ble_gatts_cb_param_t *param)
+{
+    uint8_t flags;
+    uint32_t offset;
+    if (!blob_chunk_decode_header(param->write.value, param->write.len, &flags, &offset)) {
+        telemetry_count(&telemetry, TELEMETRY_BLOB_REJECTED, 1);
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    blob_rx_status_t rx_status = BLOB_RX_OK;
+    if (flags & BLOB_CHUNK_FIRST) {
+        rx_status = blob_rx_begin(&blob_rx, param->write.conn_id, now_ms);
+    }
+    if (rx_status == BLOB_RX_OK) {
+        rx_status = blob_rx_append(&blob_rx, param->write.conn_id, offset
+            , param->write.value + BLOB_CHUNK_HEADER_LEN, param->write.len - BLOB_CHUNK_HEADER_LEN, now_ms);
+    }
+    if (rx_status == BLOB_RX_OK && (flags & BLOB_CHUNK_LAST)) {
+        rx_status = blob_rx_finish(&blob_rx, param->write.conn_id, now_ms);
     }
+    if (rx_status == BLOB_RX_COMPLETE) {
+        blob_received(param->write.conn_id);
+    } else if (rx_status != BLOB_RX_OK) {
+        // a broken stream is not resumed; the client starts over with FIRST
+        blob_rejected(param->write.conn_id, offset, rx_status);
+        blob_rx_abort(&blob_rx, param->write.conn_id);
+    }
+    return blob_att_status(rx_status);
 }
 
 //-----------------------------------------------------------------------------
-// Write
-static QueueHandle_t write_data_queue;
-static TimerHandle_t write_data_read_timer;
-static void write_data_read_timer_callback(TimerHandle_t xTimer)
+// Advertising
+//
+// Fast until adv_fast_until_us, then adv_backoff_timer stops it and
+// ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT starts it again at the slow interval.
+// A stop asked for while a start is on its way answers an advertising set
+// that is already gone; adv_starts and adv_stop_at tell the two apart.
+static int64_t adv_fast_until_us;           // GATTS/GAP callbacks ( and app_main before them )
+static TimerHandle_t adv_backoff_timer;
+static _Atomic uint32_t adv_starts;         // advertising starts asked for
+static _Atomic uint32_t adv_stop_at;        // adv_starts when the last stop was asked for
+
+// Opens the fast advertising window, from now on.
+static void adv_fast_burst(void)
 {
-    uint8_t data[10];
-    // peek recent data from queue (non-blocking)
-    if (xQueueReceive(write_data_queue, data, 0) == pdTRUE) {
-
-        uint16_t counter = (uint16_t)(data[0] | (data[1] << 8));
-        uint32_t duty = counter % (2 * MAX_DUTY);
-        if (duty >= MAX_DUTY) {
-            duty = 2 * MAX_DUTY - duty - 1;
-        }
-        s_led_state = duty;
+    adv_fast_until_us = esp_timer_get_time() + (int64_t)CONFIG_SWIFT_ADV_FAST_WINDOW_MS * 1000;
+}
 
-        blink_led();
+// Stops advertising; ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT starts it again at
+// the interval of the moment.
+static void restart_advertising(void)
+{
+    atomic_store(&adv_stop_at, atomic_load(&adv_starts));
+    esp_err_t ret = esp_ble_gap_stop_advertising();
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "GAP : Stop advertising failed: %s", esp_err_to_name(ret));
     }
 }
 
+// One-shot: the fast window has closed.
+static void adv_backoff_timer_callback(TimerHandle_t xTimer)
+{
+    restart_advertising();
+}
+
+// Re-arms the backoff timer for the rest of the fast window.
+static void adv_backoff_arm(void)
+{
+    int64_t left_us = adv_fast_until_us - esp_timer_get_time();
+    if (left_us > 0) {
+        // xTimerChangePeriod also starts a dormant timer
+        xTimerChangePeriod(adv_backoff_timer, pdMS_TO_TICKS(left_us / 1000) + 1, 0);
+    }
+}
 
+static void start_advertising(void)
+{
+    // not before both the advertising data and the service are in place: a
+    // central that connects earlier finds nothing to subscribe to
+    if (gatt_info.is_advertising || !gatt_info.adv_data_set || !gatt_info.service_started) {
+        return;
+    }
+    bool fast = adv_fast_until_us > esp_timer_get_time();
+    gatt_info.is_advertising = true;
+    gatt_info.adv_fast = fast;
+    atomic_fetch_add(&adv_starts, 1);
+    esp_err_t ret = esp_ble_gap_start_advertising(fast ? &adv_params_fast : &adv_params_slow);
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "GAP : Start advertising failed: %s", esp_err_to_name(ret));
+        gatt_info.is_advertising = false;
+        return;
+    }
+    if (fast) {
+        adv_backoff_arm();
+    }
+}
 
 //-----------------------------------------------------------------------------
 // GAP event handler
-static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+static void handle_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
     switch (event) {
         case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT: // seq[b-2]
+            if (param->adv_data_raw_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGE(MAIN_TAG, "GAP : Advertising data set failed, status=%d", param->adv_data_raw_cmpl.status);
+                break;
+            }
             ESP_LOGI(MAIN_TAG, "GAP : Advertising data set complete");
+            gatt_info.adv_data_set = true;
             
-            // start advertising
-            esp_ble_gap_start_advertising(&adv_params);
+            // start advertising ( once the service has started too )
+            start_advertising();
             break;
         
         case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
             if (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
-                ESP_LOGI(MAIN_TAG, "GAP : Advertising started");
+                ESP_LOGI(MAIN_TAG, "GAP : Advertising started, %s", gatt_info.adv_fast ? "fast" : "slow");
+                int64_t now_us = esp_timer_get_time();
+                if (boot_timeline_mark(&boot_timeline, BOOT_MARK_ADV_STARTED, now_us)) {
+                    char line[BOOT_TIMELINE_LOG_LEN];
+                    boot_timeline_format(&boot_timeline, BOOT_MARK_APP_MAIN, BOOT_MARK_LED_READY, line, sizeof(line));
+                    ESP_LOGI(MAIN_TAG, "GAP : Boot to advertising %lld us: %s"
+                        , (long long)boot_timeline_between(&boot_timeline, BOOT_MARK_APP_MAIN, BOOT_MARK_ADV_STARTED), line);
+                }
+                if (boot_timeline_has(&boot_timeline, BOOT_MARK_DISCONNECT)) {
+                    boot_timeline_mark(&boot_timeline, BOOT_MARK_ADV_RESTARTED, now_us);
+                }
             } else {
                 ESP_LOGE(MAIN_TAG, "GAP : Advertising start failed");
+                gatt_info.is_advertising = false;
+            }
+            break;
+
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT: {
+            ESP_LOGI(MAIN_TAG, "GAP : Advertising stopped, status=%d", param->adv_stop_cmpl.status);
+            if (atomic_load(&adv_stop_at) != atomic_load(&adv_starts)) {
+                break;  // a start followed the stop: that one is running
+            }
+            // the stop ended the current advertising ( or a central had already )
+            gatt_info.is_advertising = false;
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            bool has_free_slot = !conn_table_is_full(&conn_table);
+            xSemaphoreGive(conn_table_lock);
+            if (has_free_slot) {
+                start_advertising();
             }
             break;
+        }
 
         case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT:
             ESP_LOGI(MAIN_TAG, "GAP : ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT");
             break;
 
-        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
-            ESP_LOGI(MAIN_TAG, "GAP : ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT");
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+            ESP_LOGI(MAIN_TAG, "GAP : Connection params updated, status=%d, interval=%d, latency=%d, timeout=%d"
+                , param->update_conn_params.status, param->update_conn_params.conn_int
+                , param->update_conn_params.latency, param->update_conn_params.timeout);
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find_bda(&conn_table, param->update_conn_params.bda);
+            if (conn != NULL && param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+                conn->conn_interval = param->update_conn_params.conn_int;
+                conn->conn_latency = param->update_conn_params.latency;
+                conn->conn_timeout = param->update_conn_params.timeout;
+            }
+            xSemaphoreGive(conn_table_lock);
             break;
+        }
             
-        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
-            ESP_LOGI(MAIN_TAG, "GAP : ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT");
+        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT: {
+            ESP_LOGI(MAIN_TAG, "GAP : Data length set, status=%d, tx_len=%d, rx_len=%d"
+                , param->pkt_data_length_cmpl.status, param->pkt_data_length_cmpl.params.tx_len, param->pkt_data_length_cmpl.params.rx_len);
+            // no address in this event: it answers the one outstanding request
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = link_neg_data_len_owner >= 0 ? conn_table_find(&conn_table, link_neg_data_len_owner) : NULL;
+            link_neg_data_len_owner = -1;
+            if (conn != NULL) {
+                link_neg_state_t before = conn->link.state;
+                link_neg_run(conn, before, link_neg_on_data_len(&conn->link
+                    , param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS
+                    , param->pkt_data_length_cmpl.params.tx_len, param->pkt_data_length_cmpl.params.rx_len
+                    , esp_timer_get_time()));
+            }
+            link_neg_poll_all();
+            xSemaphoreGive(conn_table_lock);
             break;
+        }
             
         case ESP_GAP_BLE_CHANNEL_SELECT_ALGORITHM_EVT:
             ESP_LOGI(MAIN_TAG, "GAP : ESP_GAP_BLE_CHANNEL_SELECT_ALGORITHM_EVT");
             break;;
 
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+        case ESP_GAP_BLE_SET_PREFERRED_PHY_COMPLETE_EVT:
+            if (param->set_perf_phy.status != ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGE(MAIN_TAG, "GAP : Set preferred PHY failed, status=%d", param->set_perf_phy.status);
+            }
+            break;
+
+        case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT: {
+            ESP_LOGI(MAIN_TAG, "GAP : PHY updated, status=%d, tx_phy=%d, rx_phy=%d"
+                , param->phy_update.status, param->phy_update.tx_phy, param->phy_update.rx_phy);
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find_bda(&conn_table, param->phy_update.bda);
+            if (conn != NULL) {
+                link_neg_state_t before = conn->link.state;
+                link_neg_run(conn, before, link_neg_on_phy(&conn->link
+                    , param->phy_update.status == ESP_BT_STATUS_SUCCESS
+                    , param->phy_update.tx_phy, param->phy_update.rx_phy
+                    , esp_timer_get_time()));
+            }
+            xSemaphoreGive(conn_table_lock);
+            break;
+        }
+#endif
+
         default:
-            ESP_LOGI(MAIN_TAG, "GAP : Unhandled GAP event: %d", event);
+            HOT_LOGI(MAIN_TAG, "GAP : Unhandled GAP event: %d", event);
             break;
     }
 }
 
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    int64_t start_us = esp_timer_get_time();
+    handle_gap_event(event, param);
+    telemetry_hist_add(&telemetry, TELEMETRY_HIST_GAP, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
 
 //-----------------------------------------------------------------------------
 // gatt event handler
-static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+
+// Service setup is REG -> CREAT_ATTR_TAB -> START: the attribute table
+// creates the service and every characteristic in one call, and its event
+// carries all the handles. Without CONFIG_SWIFT_GATTS_ATTR_TABLE it is a
+// chain: REG -> CREATE -> ADD_CHAR notify -> ADD_CHAR_DESCR -> ADD_CHAR write,
+// config, telemetry, blob -> START, each step issued from the previous one's
+// event, characteristics told apart by their UUID. Either way an answer setup
+// already had is ignored, so a repeated event cannot shift the handles; a
+// failed step ends setup and the device does not advertise.
+static bool setup_first_answer(bool known, const char *what)
+{
+    if (known) {
+        ESP_LOGW(MAIN_TAG, "GATT: %s answered twice, ignored", what);
+        return false;
+    }
+    return true;
+}
+
+#if !CONFIG_SWIFT_GATTS_ATTR_TABLE
+static bool char_uuid_is(const esp_bt_uuid_t *uuid, const uint8_t uuid128[ESP_UUID_LEN_128])
+{
+    return uuid->len == ESP_UUID_LEN_128 && memcmp(uuid->uuid.uuid128, uuid128, ESP_UUID_LEN_128) == 0;
+}
+#endif
+
+// Answers a read with value[offset..]; long reads come in at increasing offsets.
+static void send_read_response(esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t *param, const uint8_t *value, uint16_t len)
+{
+    esp_gatt_rsp_t rsp;
+    memset(&rsp, 0, sizeof(rsp));
+    esp_gatt_status_t status = ESP_GATT_OK;
+    if (param->read.offset > len) {
+        status = ESP_GATT_INVALID_OFFSET;
+    } else {
+        rsp.attr_value.handle = param->read.handle;
+        rsp.attr_value.offset = param->read.offset;
+        rsp.attr_value.len = len - param->read.offset;
+        memcpy(rsp.attr_value.value, value + param->read.offset, rsp.attr_value.len);
+    }
+    esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, status, &rsp);
+}
+
+static void handle_gatts_event(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
 {
     esp_err_t ret;
     switch (event) {
         case ESP_GATTS_REG_EVT: // seq[a-2]
             ESP_LOGI(MAIN_TAG, "GATT: GATT app registered, status=%d", param->reg.status);
-            if (param->reg.status == ESP_GATT_OK) {
-
+            if (param->reg.status == ESP_GATT_OK && setup_first_answer(gatt_info.gatt_if != ESP_GATT_IF_NONE, "App registration")) {
+                boot_timeline_mark(&boot_timeline, BOOT_MARK_GATT_REGISTERED, esp_timer_get_time());
 
                 // set advertise data
                 ESP_LOGI(MAIN_TAG, "GATT: Configuring adv data");
@@ -273,6 +1544,13 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                 // gatt interface
                 gatt_info.gatt_if = gatts_if;
 
+#if CONFIG_SWIFT_GATTS_ATTR_TABLE
+                // Create the service and its characteristics. // triggers ESP_GATTS_CREAT_ATTR_TAB_EVT.
+                ret = esp_ble_gatts_create_attr_tab(gatt_db, gatts_if, ATTR_IDX_COUNT, 0);
+                if (ret) {
+                    ESP_LOGE(MAIN_TAG, "GATT: Create attribute table failed, error code = %s", esp_err_to_name(ret));
+                }
+#else
                 // prepare service id
                 gatt_info.serviceid.id.inst_id = 0;
                 gatt_info.serviceid.is_primary = true;
@@ -281,10 +1559,46 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                 
                 // Create a GATT Server service. // triggers ESP_GATTS_CREATE_EVT.
                 esp_ble_gatts_create_service(gatts_if, &gatt_info.serviceid, 12); // 12: The number of handles requested for this service.
+#endif
             }
             break;
 
+#if CONFIG_SWIFT_GATTS_ATTR_TABLE
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT: { // seq[a-3]
+            if (param->add_attr_tab.status != ESP_GATT_OK) {
+                ESP_LOGE(MAIN_TAG, "GATT: Create attribute table failed, status=%d", param->add_attr_tab.status);
+                break;
+            }
+            if (param->add_attr_tab.num_handle != ATTR_IDX_COUNT) {
+                ESP_LOGE(MAIN_TAG, "GATT: Attribute table has %d handles, expected %d", param->add_attr_tab.num_handle, ATTR_IDX_COUNT);
+                break;
+            }
+            if (!setup_first_answer(gatt_info.gatt_service_handle != 0, "Attribute table")) {
+                break;
+            }
+            const uint16_t *handles = param->add_attr_tab.handles;
+            ESP_LOGI(MAIN_TAG, "GATT: Attribute table created, service handle=%d", handles[ATTR_IDX_SERVICE]);
+            gatt_info.gatt_service_handle = handles[ATTR_IDX_SERVICE];
+            gatt_info.gatt_notify_char_handle = handles[ATTR_IDX_NOTIFY_VALUE];
+            gatt_info.gatt_cccd_handle = handles[ATTR_IDX_NOTIFY_CCCD];
+            gatt_info.gatt_write_char_handle = handles[ATTR_IDX_WRITE_VALUE];
+            gatt_info.gatt_config_char_handle = handles[ATTR_IDX_CONFIG_VALUE];
+            gatt_info.gatt_telemetry_char_handle = handles[ATTR_IDX_TELEMETRY_VALUE];
+            gatt_info.gatt_blob_char_handle = handles[ATTR_IDX_BLOB_VALUE];
+
+            // Start a service. // triggers ESP_GATTS_START_EVT.
+            esp_ble_gatts_start_service(gatt_info.gatt_service_handle);
+            break;
+        }
+#else
         case ESP_GATTS_CREATE_EVT: // seq[a-3]
+            if (param->create.status != ESP_GATT_OK) {
+                ESP_LOGE(MAIN_TAG, "GATT: Create service failed, status=%d", param->create.status);
+                break;
+            }
+            if (!setup_first_answer(gatt_info.gatt_service_handle != 0, "Create service")) {
+                break;
+            }
             ESP_LOGI(MAIN_TAG, "GATT: Service created, handle=%d", param->create.service_handle);
 
             // gatt service handle
@@ -297,16 +1611,21 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             // Add a characteristic into a service. // triggers ESP_GATTS_ADD_CHAR_EVT.
             esp_ble_gatts_add_char(gatt_info.gatt_service_handle
                 , &gatt_info.notify_charuuid
-                , ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE
+                , 0
                 , ESP_GATT_CHAR_PROP_BIT_NOTIFY // | ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE
                 , NULL
                 , NULL
             );
             break;
 
-        case ESP_GATTS_ADD_CHAR_EVT: // seq[a-4], seq[a-6]
-            if (param->add_char.status == ESP_GATT_OK) {
-                if (!gatt_info.gatt_notify_char_handle) {
+        case ESP_GATTS_ADD_CHAR_EVT: { // seq[a-4], seq[a-6], seq[a-7], seq[a-8], seq[a-9]
+            if (param->add_char.status != ESP_GATT_OK) {
+                ESP_LOGE(MAIN_TAG, "GATT: Add characteristic failed, status=%d", param->add_char.status);
+                break;
+            }
+            const esp_bt_uuid_t *uuid = &param->add_char.char_uuid;
+            if (char_uuid_is(uuid, notify_char_uuid)) {
+                if (setup_first_answer(gatt_info.gatt_notify_char_handle != 0, "Notify characteristic")) {
                     ESP_LOGI(MAIN_TAG, "GATT: Characteristic added, handle=%d", param->add_char.attr_handle);
 
                     // gatt notify characteristic handle
@@ -337,21 +1656,81 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                     if (ret) {
                         ESP_LOGE(MAIN_TAG, "GATT: %s Add a characteristic descriptor failed, error code = %s", __func__, esp_err_to_name(ret));
                     }
-                } else {
+                }
+            } else if (char_uuid_is(uuid, write_char_uuid)) {
+                if (setup_first_answer(gatt_info.gatt_write_char_handle != 0, "Write characteristic")) {
                     ESP_LOGI(MAIN_TAG, "GATT: Write characteristic added, handle=%d", param->add_char.attr_handle);
                     gatt_info.gatt_write_char_handle = param->add_char.attr_handle;
 
+                    // Config characteristic // triggers ESP_GATTS_ADD_CHAR_EVT.
+                    gatt_info.config_charuuid.len = ESP_UUID_LEN_128;
+                    memcpy(gatt_info.config_charuuid.uuid.uuid128, config_char_uuid, sizeof(config_char_uuid));
+                    ret = esp_ble_gatts_add_char(gatt_info.gatt_service_handle
+                        , &gatt_info.config_charuuid
+                        , ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE
+                        , ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE
+                        , NULL
+                        , NULL
+                    );
+                    if (ret) {
+                        ESP_LOGE(MAIN_TAG, "GATT: Add Config characteristic failed, error code = %s", esp_err_to_name(ret));
+                    }
+                }
+            } else if (char_uuid_is(uuid, config_char_uuid)) {
+                if (setup_first_answer(gatt_info.gatt_config_char_handle != 0, "Config characteristic")) {
+                    ESP_LOGI(MAIN_TAG, "GATT: Config characteristic added, handle=%d", param->add_char.attr_handle);
+                    gatt_info.gatt_config_char_handle = param->add_char.attr_handle;
+
+                    // Telemetry characteristic // triggers ESP_GATTS_ADD_CHAR_EVT.
+                    gatt_info.telemetry_charuuid.len = ESP_UUID_LEN_128;
+                    memcpy(gatt_info.telemetry_charuuid.uuid.uuid128, telemetry_char_uuid, sizeof(telemetry_char_uuid));
+                    ret = esp_ble_gatts_add_char(gatt_info.gatt_service_handle
+                        , &gatt_info.telemetry_charuuid
+                        , ESP_GATT_PERM_READ
+                        , ESP_GATT_CHAR_PROP_BIT_READ
+                        , NULL
+                        , NULL
+                    );
+                    if (ret) {
+                        ESP_LOGE(MAIN_TAG, "GATT: Add Telemetry characteristic failed, error code = %s", esp_err_to_name(ret));
+                    }
+                }
+            } else if (char_uuid_is(uuid, telemetry_char_uuid)) {
+                if (setup_first_answer(gatt_info.gatt_telemetry_char_handle != 0, "Telemetry characteristic")) {
+                    ESP_LOGI(MAIN_TAG, "GATT: Telemetry characteristic added, handle=%d", param->add_char.attr_handle);
+                    gatt_info.gatt_telemetry_char_handle = param->add_char.attr_handle;
+
+                    // Blob characteristic // triggers ESP_GATTS_ADD_CHAR_EVT.
+                    gatt_info.blob_charuuid.len = ESP_UUID_LEN_128;
+                    memcpy(gatt_info.blob_charuuid.uuid.uuid128, blob_char_uuid, sizeof(blob_char_uuid));
+                    ret = esp_ble_gatts_add_char(gatt_info.gatt_service_handle
+                        , &gatt_info.blob_charuuid
+                        , ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE
+                        , ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR
+                        , NULL
+                        , NULL
+                    );
+                    if (ret) {
+                        ESP_LOGE(MAIN_TAG, "GATT: Add Blob characteristic failed, error code = %s", esp_err_to_name(ret));
+                    }
+                }
+            } else if (char_uuid_is(uuid, blob_char_uuid)) {
+                if (setup_first_answer(gatt_info.gatt_blob_char_handle != 0, "Blob characteristic")) {
+                    ESP_LOGI(MAIN_TAG, "GATT: Blob characteristic added, handle=%d", param->add_char.attr_handle);
+                    gatt_info.gatt_blob_char_handle = param->add_char.attr_handle;
+
                     // Start a service. // triggers ESP_GATTS_START_EVT.
                     esp_ble_gatts_start_service(gatt_info.gatt_service_handle);
                 }
-
             } else {
-                ESP_LOGE(MAIN_TAG, "GATT: Add characteristic failed, status=%d", param->add_char.status);
+                ESP_LOGW(MAIN_TAG, "GATT: Unknown characteristic added, handle=%d", param->add_char.attr_handle);
             }
             break;
+        }
 
         case ESP_GATTS_ADD_CHAR_DESCR_EVT: // seq[a-5]
-            if (param->add_char_descr.status == ESP_GATT_OK) {
+            if (param->add_char_descr.status == ESP_GATT_OK
+                && setup_first_answer(gatt_info.gatt_cccd_handle != 0, "CCCD")) {
                 ESP_LOGI(MAIN_TAG, "GATT: CCCD added, handle=%d", param->add_char_descr.attr_handle);
 
                 // cccd handle
@@ -362,7 +1741,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                 memcpy(gatt_info.write_charuuid.uuid.uuid128, write_char_uuid, sizeof(write_char_uuid));
                 ret = esp_ble_gatts_add_char(gatt_info.gatt_service_handle
                     , &gatt_info.write_charuuid
-                    , ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE
+                    , ESP_GATT_PERM_WRITE
                     , ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR
                     , NULL
                     , NULL
@@ -370,125 +1749,609 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                 if (ret) {
                     ESP_LOGE(MAIN_TAG, "GATT: Add Write characteristic failed, error code = %s", esp_err_to_name(ret));
                 }
-            } else {
+            } else if (param->add_char_descr.status != ESP_GATT_OK) {
                 ESP_LOGE(MAIN_TAG, "GATT: Add CCCD failed, status=%d (0x%x)", param->add_char_descr.status, param->add_char_descr.status);
             }
             break;
+#endif
 
-        case ESP_GATTS_START_EVT: // seq[a-7]
+        case ESP_GATTS_START_EVT: // seq[a-4] ( seq[a-10] in the chain )
+            if (param->start.status != ESP_GATT_OK) {
+                ESP_LOGE(MAIN_TAG, "GATT: Start service failed, status=%d", param->start.status);
+                break;
+            }
             ESP_LOGI(MAIN_TAG, "GATT: Service started, handle=%d", param->start.service_handle);
+            gatt_info.service_started = true;
+            boot_timeline_mark(&boot_timeline, BOOT_MARK_SERVICE_STARTED, esp_timer_get_time());
+
+            // start advertising ( once the advertising data is set too )
+            start_advertising();
             break;
 
         
-        case ESP_GATTS_CONNECT_EVT:
+        case ESP_GATTS_CONNECT_EVT: {
+            // a repeated CONNECT for a live link is not a new client; taken
+            // for one, it would find no free slot in the table and close it
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            bool known = conn_table_find(&conn_table, param->connect.conn_id) != NULL;
+            xSemaphoreGive(conn_table_lock);
+            if (known) {
+                ESP_LOGW(MAIN_TAG, "GATT: conn_id=%d already connected, CONNECT ignored", param->connect.conn_id);
+                break;
+            }
             ESP_LOGI(MAIN_TAG, "GATT: Client connected, conn_id=%d", param->connect.conn_id);
-            gatt_info.gatt_conn_id = param->connect.conn_id;
+            telemetry_count(&telemetry, TELEMETRY_CONNECTS, 1);
+            boot_timeline_connect(&boot_timeline, param->connect.conn_id, esp_timer_get_time());
+
+            // connectable advertising stops when a central connects
+            gatt_info.is_advertising = false;
+
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            swift_config_t cfg = swift_config;
+            conn_state_t *conn = conn_table_add(&conn_table, param->connect.conn_id, param->connect.remote_bda);
+            if (conn != NULL) {
+                conn->conn_interval = param->connect.conn_params.interval;
+                conn->conn_latency = param->connect.conn_params.latency;
+                conn->conn_timeout = param->connect.conn_params.timeout;
+                notify_pacer_init(&conn->pacer, CONFIG_SWIFT_NOTIFY_WINDOW_INIT, CONFIG_SWIFT_NOTIFY_WINDOW_MAX);
+                notify_sched_init(&conn->events);
+                seq_tracker_init(&conn->write_seq);
+                conn->sample_next = notify_sample_start(conn);
+
+                // ask for long LL packets, then the faster PHY
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+                link_neg_init(&conn->link, CONFIG_SWIFT_DATA_LEN, cfg.phy_mask);
+#else
+                link_neg_init(&conn->link, CONFIG_SWIFT_DATA_LEN, 0);
+#endif
+                bool busy = link_neg_data_len_owner >= 0;
+                link_neg_run(conn, LINK_NEG_IDLE, link_neg_start(&conn->link, busy, esp_timer_get_time()));
+                if (link_neg_is_pending(&conn->link)) {
+                    xTimerStart(link_neg_timer, 0);
+                }
+            }
+            bool has_free_slot = !conn_table_is_full(&conn_table);
+            int conn_count = conn_table_count(&conn_table);
+            xSemaphoreGive(conn_table_lock);
+
+            if (conn == NULL) {
+                ESP_LOGW(MAIN_TAG, "GATT: No free connection slot, closing conn_id=%d", param->connect.conn_id);
+                esp_ble_gatts_close(gatts_if, param->connect.conn_id);
+                break;
+            }
+
+            // keep advertising while slots remain
+            ESP_LOGI(MAIN_TAG, "GATT: %d/%d clients connected", conn_count, CONN_TABLE_MAX);
+            if (has_free_slot) {
+                start_advertising();
+            }
 
             esp_bd_addr_t bd_addr;
             memcpy(bd_addr, param->connect.remote_bda, sizeof(esp_bd_addr_t));
             ret = esp_ble_gap_set_prefer_conn_params(
                 bd_addr
-                , 0x06 // min interval: 7.5ms
-                , 0x0C // max interva: 15ms
-                , 0    // latency : 0 sec
-                , 400  // timeout : 4 sec
+                , cfg.conn_int_min // default min interval: 7.5ms
+                , cfg.conn_int_max // default max interval: 15ms
+                , cfg.conn_latency // default latency : 0
+                , cfg.conn_timeout // default timeout : 4 sec
             );
             if (ret != ESP_OK) {
                 ESP_LOGE(MAIN_TAG, "GATT: Set preferred connection params failed: %s", esp_err_to_name(ret));
             } else {
-                ESP_LOGI(MAIN_TAG, "GATT: Set preferred connection params: min_int=7.5ms, max_int=15ms");
+                ESP_LOGI(MAIN_TAG, "GATT: Set preferred connection params: min_int=%d, max_int=%d (1.25ms units)", cfg.conn_int_min, cfg.conn_int_max);
             }
             break;
+        }
+
+        case ESP_GATTS_DISCONNECT_EVT: {
+            telemetry_count(&telemetry, TELEMETRY_DISCONNECTS, 1);
+            boot_timeline_disconnect(&boot_timeline, esp_timer_get_time());
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find(&conn_table, param->disconnect.conn_id);
+            if (conn != NULL) {
+                const notify_pacer_t *pacer = &conn->pacer;
+                ESP_LOGI(MAIN_TAG, "GATT: Client disconnected, conn_id=%d, reason=0x%x, notify sent=%" PRIu32 " refused=%" PRIu32 " failed=%" PRIu32 ", writes=%" PRIu32
+                    , conn->conn_id, param->disconnect.reason, pacer->sent, pacer->refused, pacer->failed, conn->writes_received);
+                ESP_LOGI(MAIN_TAG, "GATT: Notify pacing conn_id=%d: %" PRIu32 "/%" PRIu32 " of target (%" PRIu32 ".%" PRIu32 "%%), window=%d, congestion events=%" PRIu32
+                    , conn->conn_id, pacer->sent, pacer->requested
+                    , notify_pacer_achieved_permille(pacer) / 10, notify_pacer_achieved_permille(pacer) % 10
+                    , pacer->window, pacer->congest_events);
+                const seq_tracker_t *seq = &conn->write_seq;
+                ESP_LOGI(MAIN_TAG, "GATT: Write delivery conn_id=%d: received=%" PRIu32 " lost=%" PRIu32 " (%" PRIu32 ".%" PRIu32 "%%) duplicates=%" PRIu32 " reordered=%" PRIu32 " stale=%" PRIu32 " resyncs=%" PRIu32 " jitter=%" PRIu32 "ms"
+                    , conn->conn_id, seq->received, seq_tracker_lost(seq)
+                    , seq_tracker_loss_permille(seq) / 10, seq_tracker_loss_permille(seq) % 10
+                    , seq->duplicates, seq->reordered, seq->stale, seq->resyncs, seq_tracker_jitter_ms(seq));
+                conn_table_remove(&conn_table, param->disconnect.conn_id);
+            }
+            // hand a data length request slot held by this link to the next one
+            if (link_neg_data_len_owner == param->disconnect.conn_id) {
+                link_neg_data_len_owner = -1;
+                link_neg_poll_all();
+            }
+            bool any_subscriber = conn_table_notify_count(&conn_table) > 0;
+            xSemaphoreGive(conn_table_lock);
 
-        case ESP_GATTS_DISCONNECT_EVT:
-            ESP_LOGI(MAIN_TAG, "GATT: Client disconnected");
-            gatt_info.is_notify_enabled = false;
-            gatt_info.gatt_conn_id = 0;
+            if (!any_subscriber) {
+                xTimerStop(notify_timer, 0);
+            }
+
+            // an unfinished upload from this client is dropped
+            blob_rx_abort(&blob_rx, param->disconnect.conn_id);
+
+            // log this session's write latency
+            atomic_store(&write_latency_report_requested, true);
+            if (write_consumer_task_handle) {
+                xTaskNotifyGive(write_consumer_task_handle);
+            }
 
-            // re-start advertising
-            esp_ble_gap_start_advertising(&adv_params);
+            // re-start advertising fast ( a slow one still running is
+            // restarted fast, a fast one gets the longer window )
+            adv_fast_burst();
+            if (gatt_info.is_advertising && !gatt_info.adv_fast) {
+                restart_advertising();
+            } else if (gatt_info.is_advertising) {
+                adv_backoff_arm();
+            } else {
+                start_advertising();
+            }
             break;
+        }
 
 
 
         case ESP_GATTS_WRITE_EVT:
+            if (param->write.is_prep) {
+                // Long write: only the blob characteristic takes one
+                handle_prepare_write(gatts_if, param);
+                break;
+            }
             // Write to CCCD
             if (param->write.handle == gatt_info.gatt_cccd_handle) {
                 if (param->write.len == 2 && param->write.value[0] == 0x01 && param->write.value[1] == 0x00) {
-                    ESP_LOGI(MAIN_TAG, "GATT: Notify enabled");
-                    gatt_info.is_notify_enabled = true;
-
-                    // Start notify timer
-                    xTimerStart(notify_timer, 0);
+                    HOT_LOGI(MAIN_TAG, "GATT: Notify enabled, conn_id=%d", param->write.conn_id);
+                    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                    bool first = conn_table_notify_count(&conn_table) == 0;
+                    conn_table_set_notify(&conn_table, param->write.conn_id, true);
+                    xSemaphoreGive(conn_table_lock);
+                    boot_timeline_mark_conn(&boot_timeline, BOOT_MARK_SUBSCRIBED, param->write.conn_id, esp_timer_get_time());
+
+                    // Start notify timer with the first subscriber
+                    if (first) {
+                        xTimerStart(notify_timer, 0);
+                    }
 
                 } else if (param->write.len == 2 && param->write.value[0] == 0x00 && param->write.value[1] == 0x00) {
-                    ESP_LOGI(MAIN_TAG, "GATT: Notify disabled");
-                    gatt_info.is_notify_enabled = false;
-
-                    // Stop notify timer
-                    xTimerStop(notify_timer, 0);
+                    HOT_LOGI(MAIN_TAG, "GATT: Notify disabled, conn_id=%d", param->write.conn_id);
+                    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                    conn_table_set_notify(&conn_table, param->write.conn_id, false);
+                    bool any_subscriber = conn_table_notify_count(&conn_table) > 0;
+                    xSemaphoreGive(conn_table_lock);
+
+                    // Stop notify timer with the last subscriber
+                    if (!any_subscriber) {
+                        xTimerStop(notify_timer, 0);
+                    }
                 }
 
                 if (param->write.need_rsp) {
-                    ESP_LOGI(MAIN_TAG, "GATT: Notify Send Response");
+                    HOT_LOGI(MAIN_TAG, "GATT: Notify Send Response");
                     esp_ble_gatts_send_response(gatt_info.gatt_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
                 }
             } else if (param->write.handle == gatt_info.gatt_write_char_handle) {
                 
                 // Write Characteristic
                 //ESP_LOGI(MAIN_TAG, "GATT: Write to Write characteristic, len=%d", param->write.len);
-                
-                if (param->write.len <= 10) {
-
-                    uint8_t queue_data[10] = {0}; // 10 bytes
-                    memcpy(queue_data, param->write.value, param->write.len);
-                    
-                    // Overwrite queue with recent data
-                    if (xQueueOverwrite(write_data_queue, queue_data) != pdTRUE) {
-                        ESP_LOGE(MAIN_TAG, "Failed to overwrite queue");
+
+                // claim a pool buffer and copy the value in ( the only copy; the consumer works in place )
+                uint16_t len = param->write.len;
+                bool valid = write_len_valid(len);
+                write_buf_handle_t handle = valid ? write_pool_claim(&write_pool) : WRITE_BUF_NONE;
+                const uint8_t *frames = param->write.value;
+                uint8_t padded[WRITE_FRAME_LEN] = {0};
+                if (handle != WRITE_BUF_NONE) {
+                    write_buf_t *buf = write_pool_buf(&write_pool, handle);
+                    buf->rx_time_us = esp_timer_get_time();
+                    buf->conn_id = param->write.conn_id;
+                    memcpy(buf->data, param->write.value, len);
+                    if (len < WRITE_FRAME_LEN) {
+                        memset(buf->data + len, 0, WRITE_FRAME_LEN - len);
+                    }
+                    buf->len = len < WRITE_FRAME_LEN ? WRITE_FRAME_LEN : len;
+                    frames = buf->data;
+                } else if (valid && len < WRITE_FRAME_LEN) {
+                    // dropped, but still sequence checked
+                    memcpy(padded, param->write.value, len);
+                    frames = padded;
+                }
+
+                // sequence check on every frame header
+                uint16_t frame_count = valid ? write_frame_count(len) : 0;
+                uint32_t invalid = valid ? 0 : 1;
+                uint32_t duplicates = 0;
+                uint32_t reordered = 0;
+                uint32_t gaps = 0;
+
+                xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                conn_state_t *conn = conn_table_find(&conn_table, param->write.conn_id);
+                if (conn != NULL) {
+                    conn->writes_received++;
+                    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+                    uint32_t gaps_before = conn->write_seq.gaps;
+                    for (uint16_t i = 0; i < frame_count; i++) {
+                        frame_t header;
+                        if (!frame_decode(frames + i * WRITE_FRAME_LEN, WRITE_FRAME_LEN, &header)) {
+                            invalid++;
+                            continue;
+                        }
+                        seq_result_t seq_result = seq_tracker_on_frame(&conn->write_seq, header.seq, header.timestamp_ms, now_ms);
+                        if (seq_result == SEQ_DUPLICATE) {
+                            duplicates++;
+                        } else if (seq_result == SEQ_LATE) {
+                            reordered++;
+                        }
+                    }
+                    gaps = conn->write_seq.gaps - gaps_before;
+                }
+                xSemaphoreGive(conn_table_lock);
+                telemetry_count(&telemetry, TELEMETRY_WRITES_RECEIVED, 1);
+                telemetry_count(&telemetry, TELEMETRY_WRITE_BYTES, len);
+                if (invalid | duplicates | reordered | gaps) {
+                    telemetry_count(&telemetry, TELEMETRY_WRITES_INVALID, invalid);
+                    telemetry_count(&telemetry, TELEMETRY_WRITES_DUPLICATE, duplicates);
+                    telemetry_count(&telemetry, TELEMETRY_WRITES_REORDERED, reordered);
+                    telemetry_count(&telemetry, TELEMETRY_WRITE_SEQ_GAPS, gaps);
+                }
+
+                esp_gatt_status_t rsp_status = ESP_GATT_OK;
+                if (handle != WRITE_BUF_NONE) {
+                    // Hand the buffer over to the consumer, in order. The ring holds every pool handle, so this cannot fail.
+                    spsc_ring_push(&write_ring, &handle);
+                    if (write_consumer_task_handle) {
+                        xTaskNotifyGive(write_consumer_task_handle);
+                    }
+                } else if (valid) {
+                    // every buffer is pending; counted in write_pool.exhausted
+                    telemetry_count(&telemetry, TELEMETRY_WRITES_DROPPED, 1);
+                } else {
+                    HOT_LOGW(MAIN_TAG, "GATT: Write rejected, len=%d: not whole %d-byte frames", len, WRITE_FRAME_LEN);
+                    rsp_status = ESP_GATT_INVALID_ATTR_LEN;
+                }
+                if (param->write.need_rsp) {
+                    HOT_LOGI(MAIN_TAG, "GATT: Write Send Response");
+                    esp_ble_gatts_send_response(gatt_info.gatt_if, param->write.conn_id, param->write.trans_id, rsp_status, NULL);
+                }
+            } else if (param->write.handle == gatt_info.gatt_config_char_handle) {
+
+                // Config Characteristic : validate the whole write, then apply it live
+                // ( config writes come one at a time, on this task: only the copy needs the lock )
+                xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                swift_config_t cfg = swift_config;
+                xSemaphoreGive(conn_table_lock);
+                swift_config_t before = cfg;
+                uint32_t changed = 0;
+                swift_config_status_t status = swift_config_parse(param->write.value, param->write.len, &cfg, &changed);
+                if (status == SWIFT_CONFIG_OK && (changed & SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE))) {
+                    // a profile switch: what the write changed goes on top of that profile's settings
+                    uint8_t edits[SWIFT_CONFIG_ENCODED_LEN];
+                    uint16_t edits_len = swift_config_encode_diff(&cfg, &before, edits, sizeof(edits));
+                    esp_err_t err = tuning_profile_get((swift_profile_t)cfg.profile, &cfg);
+                    if (err != ESP_OK) {
+                        ESP_LOGW(MAIN_TAG, "NVS : Profile %s unusable ( %s ), using built-in", tuning_profile_name((swift_profile_t)cfg.profile), esp_err_to_name(err));
                     }
-                    //ESP_LOGI(MAIN_TAG, "Write received, len=%d, data[0]=0x%02x", param->write.len, queue_data[0]);
+                    status = swift_config_parse(edits, edits_len, &cfg, NULL);
+                    changed |= SWIFT_CONFIG_CHANGED_SETTINGS;
+                }
+                if (status == SWIFT_CONFIG_OK) {
+                    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                    swift_config = cfg;
+                    notify_events_configure(&cfg);
+                    xSemaphoreGive(conn_table_lock);
+                }
 
+                esp_gatt_status_t rsp_status = ESP_GATT_OK;
+                if (status == SWIFT_CONFIG_OK) {
+                    ESP_LOGI(MAIN_TAG, "GATT: Config updated, conn_id=%d: profile=%s period=%dms payload=%d interval=%d-%d latency=%d timeout=%d phy=0x%x codec=%s events=%s/%s/%s"
+                        , param->write.conn_id, tuning_profile_name((swift_profile_t)cfg.profile), cfg.notify_period_ms, cfg.payload_len
+                        , cfg.conn_int_min, cfg.conn_int_max, cfg.conn_latency, cfg.conn_timeout, cfg.phy_mask, sample_codec_str(cfg.sample_codec)
+                        , notify_policy_str(cfg.notify_policy[NOTIFY_CH_ALERT]), notify_policy_str(cfg.notify_policy[NOTIFY_CH_LED])
+                        , notify_policy_str(cfg.notify_policy[NOTIFY_CH_WRITE_ACK]));
+                    apply_config(&cfg, changed);
+                    // the profile to boot with; saved settings too. Applied live either way.
+                    if (changed & (SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE) | SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE_SAVE))) {
+                        esp_err_t err = tuning_profile_store(&cfg, (changed & SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE_SAVE)) != 0);
+                        if (err != ESP_OK) {
+                            ESP_LOGE(MAIN_TAG, "NVS : Profile %s not stored: %s", tuning_profile_name((swift_profile_t)cfg.profile), esp_err_to_name(err));
+                            rsp_status = ESP_GATT_INTERNAL_ERROR;
+                        }
+                    }
                 } else {
-                    ESP_LOGW(MAIN_TAG, "GATT: Write data too long, len=%d", param->write.len);
+                    ESP_LOGW(MAIN_TAG, "GATT: Config write rejected, conn_id=%d: %s", param->write.conn_id, swift_config_status_str(status));
+                    rsp_status = (status == SWIFT_CONFIG_ERR_TRUNCATED || status == SWIFT_CONFIG_ERR_LENGTH)
+                        ? ESP_GATT_INVALID_ATTR_LEN : ESP_GATT_OUT_OF_RANGE;
                 }
                 if (param->write.need_rsp) {
-                    ESP_LOGI(MAIN_TAG, "GATT: Write Send Response");
-                    esp_ble_gatts_send_response(gatt_info.gatt_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
+                    esp_ble_gatts_send_response(gatt_info.gatt_if, param->write.conn_id, param->write.trans_id, rsp_status, NULL);
+                }
+            } else if (param->write.handle == gatt_info.gatt_blob_char_handle) {
+
+                // Blob Characteristic : one chunk of an upload
+                esp_gatt_status_t rsp_status = handle_blob_chunk(param);
+                if (param->write.need_rsp) {
+                    esp_ble_gatts_send_response(gatt_info.gatt_if, param->write.conn_id, param->write.trans_id, rsp_status, NULL);
+                }
+            }
+            break;
+
+        case ESP_GATTS_EXEC_WRITE_EVT: {
+            // End of a long write: complete or drop the blob this client streamed in
+            uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC) {
+                if (blob_rx_finish(&blob_rx, param->exec_write.conn_id, now_ms) == BLOB_RX_COMPLETE) {
+                    blob_received(param->exec_write.conn_id);
+                }
+            } else {
+                ESP_LOGI(MAIN_TAG, "GATT: Long write cancelled, conn_id=%d", param->exec_write.conn_id);
+                blob_rx_abort(&blob_rx, param->exec_write.conn_id);
+            }
+            esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id, ESP_GATT_OK, NULL);
+            break;
+        }
+
+        case ESP_GATTS_READ_EVT: {
+            if (!param->read.need_rsp) {
+                break;
+            }
+            if (param->read.handle == gatt_info.gatt_telemetry_char_handle) {
+                // Telemetry Characteristic : see telemetry.h for the layout
+                if (param->read.offset == 0) {
+                    telemetry_snapshot_len = telemetry_encode(&telemetry, (uint32_t)(esp_timer_get_time() / 1000)
+                        , telemetry_snapshot, sizeof(telemetry_snapshot));
                 }
+                send_read_response(gatts_if, param, telemetry_snapshot, telemetry_snapshot_len);
+                break;
             }
+            if (param->read.handle == gatt_info.gatt_blob_char_handle) {
+                // Blob Characteristic : upload status, see blob_rx.h for the layout
+                uint8_t status[BLOB_RX_STATUS_LEN];
+                blob_rx_encode_status(&blob_rx, status);
+                send_read_response(gatts_if, param, status, sizeof(status));
+                break;
+            }
+            if (param->read.handle == gatt_info.gatt_cccd_handle) {
+                // CCCD : this client's own subscription
+                xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+                conn_state_t *conn = conn_table_find(&conn_table, param->read.conn_id);
+                bool enabled = conn != NULL && (conn_table.notify_mask & (1u << conn_table_slot(&conn_table, conn)));
+                xSemaphoreGive(conn_table_lock);
+                uint8_t cccd[2] = { enabled ? 0x01 : 0x00, 0x00 };
+                send_read_response(gatts_if, param, cccd, sizeof(cccd));
+                break;
+            }
+            if (param->read.handle != gatt_info.gatt_config_char_handle) {
+                // not readable: answer rather than let the client's read time out
+                esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_READ_NOT_PERMIT, NULL);
+                break;
+            }
+            // Config Characteristic : current config, every record
+            uint8_t encoded[SWIFT_CONFIG_ENCODED_LEN + SWIFT_CONFIG_LINK_STATUS_LEN];
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            uint16_t len = swift_config_encode(&swift_config, encoded, sizeof(encoded));
+            conn_state_t *conn = conn_table_find(&conn_table, param->read.conn_id);
+            if (conn != NULL) {
+                // followed by what this link actually negotiated
+                swift_link_status_t link = {
+                    .tx_phy = conn->link.tx_phy,
+                    .rx_phy = conn->link.rx_phy,
+                    .tx_octets = conn->link.tx_octets,
+                    .rx_octets = conn->link.rx_octets,
+                    .mtu = conn->mtu,
+                    .conn_interval = conn->conn_interval,
+                };
+                len += swift_config_encode_link_status(&link, encoded + len, sizeof(encoded) - len);
+            }
+            xSemaphoreGive(conn_table_lock);
+            send_read_response(gatts_if, param, encoded, len);
             break;
+        }
 
-        case ESP_GATTS_MTU_EVT:
-            ESP_LOGI(MAIN_TAG, "GATT: ESP_GATTS_MTU_EVT");
+        case ESP_GATTS_MTU_EVT: {
+            ESP_LOGI(MAIN_TAG, "GATT: MTU negotiated, conn_id=%d, mtu=%d (%d frames per notify)"
+                , param->mtu.conn_id, param->mtu.mtu, notify_frames_per_packet(param->mtu.mtu, NOTIFY_FRAME_LEN));
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find(&conn_table, param->mtu.conn_id);
+            if (conn != NULL) {
+                conn->mtu = param->mtu.mtu;
+            }
+            xSemaphoreGive(conn_table_lock);
             break;
+        }
 
-        case ESP_GATTS_CONF_EVT:
+        case ESP_GATTS_CONF_EVT: {
             if (param->conf.status != ESP_GATT_OK) {
-                ESP_LOGE(MAIN_TAG, "GATT: Notify confirm failed, status=%d (0x%x)", param->conf.status, param->conf.status);
+                HOT_LOGE(MAIN_TAG, "GATT: Notify confirm failed, status=%d (0x%x)", param->conf.status, param->conf.status);
+            }
+            telemetry_count(&telemetry, param->conf.status == ESP_GATT_OK ? TELEMETRY_NOTIFY_CONFIRMED : TELEMETRY_NOTIFY_FAILED, 1);
+            // the notification has left the stack; refill the window from this tick's credit
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find(&conn_table, param->conf.conn_id);
+            if (conn != NULL) {
+                notify_pacer_on_complete(&conn->pacer, param->conf.status == ESP_GATT_OK);
+                if (conn_table.notify_mask & (1u << conn_table_slot(&conn_table, conn))) {
+                    notify_client(conn);
+                }
+            }
+            xSemaphoreGive(conn_table_lock);
+            break;
+        }
+
+        case ESP_GATTS_CONGEST_EVT: {
+            HOT_LOGD(MAIN_TAG, "GATT: Link congested=%d, conn_id=%d", param->congest.congested, param->congest.conn_id);
+            if (param->congest.congested) {
+                telemetry_count(&telemetry, TELEMETRY_CONGEST_EVENTS, 1);
+            }
+            xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+            conn_state_t *conn = conn_table_find(&conn_table, param->congest.conn_id);
+            if (conn != NULL) {
+                notify_pacer_on_congest(&conn->pacer, param->congest.congested);
+                if (!param->congest.congested && (conn_table.notify_mask & (1u << conn_table_slot(&conn_table, conn)))) {
+                    notify_client(conn);
+                }
             }
+            xSemaphoreGive(conn_table_lock);
             break;
+        }
 
         case ESP_GATTS_RESPONSE_EVT:
             if (param->rsp.status != ESP_GATT_OK) {
-                ESP_LOGE(MAIN_TAG, "GATT: response failed, status=%d (0x%x)", param->rsp.status, param->rsp.status);
+                HOT_LOGE(MAIN_TAG, "GATT: response failed, status=%d (0x%x)", param->rsp.status, param->rsp.status);
             }
             break;
 
         default:
-            ESP_LOGI(MAIN_TAG, "GATT: Unhandled GATT event: %d", event);
+            HOT_LOGI(MAIN_TAG, "GATT: Unhandled GATT event: %d", event);
             break;
     }
 }
 
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    int64_t start_us = esp_timer_get_time();
+    handle_gatts_event(event, gatts_if, param);
+    telemetry_hist_add(&telemetry, TELEMETRY_HIST_GATTS, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+
+//-----------------------------------------------------------------------------
+// Hot-path log drain task
+//
+// Prints what the HOT_LOG* sites queued, below every task that serves a
+// client: the UART time lands here instead of in the handlers.
+#if CONFIG_SWIFT_HOT_LOG_RING
+#define HOT_LOG_TASK_PRIO 1
+
+static void hot_log_task(void *arg)
+{
+    for (;;) {
+        hot_log_drain(&hot_log_ring);
+        vTaskDelay(pdMS_TO_TICKS(HOT_LOG_DRAIN_MS));
+    }
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+// LED init task
+//
+// Configuring LEDC takes a few ms that advertising need not wait for: this
+// runs beside the Bluetooth bring-up, below every other task, and shows the
+// duty the writes so far have left in s_led_duty.
+#define LED_INIT_TASK_PRIO 1
+
+static void led_init_task(void *arg)
+{
+    configure_led();
+    atomic_store_explicit(&led_ready, true, memory_order_release);
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_LED_READY, esp_timer_get_time());
+    ESP_LOGI(MAIN_TAG, "LED : Ready");
+    if (!atomic_load_explicit(&led_pattern_playing, memory_order_relaxed)) {
+        blink_led();
+    }
+    vTaskDelete(NULL);
+}
+
 
 //-----------------------------------------------------------------------------
 void app_main(void)
 {
+    boot_timeline_init(&boot_timeline);
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_APP_MAIN, esp_timer_get_time());
+    hot_log_ring_init(&hot_log_ring);
     ESP_LOGI(MAIN_TAG, "Starting app_main");
 
     esp_err_t ret;
 
+    //-----------------------------------------------------------------------------
+    // connection table
+    conn_table_init(&conn_table);
+    swift_config_defaults(&swift_config);
+    telemetry_reset(&telemetry);
+    conn_table_lock = xSemaphoreCreateMutex();
+    if (conn_table_lock == NULL) {
+        ESP_LOGE(MAIN_TAG, "Failed to create connection table lock");
+        return;
+    }
+
+    // Everything the GATTS/GAP callbacks and the tasks they wake use is set up
+    // before Bluetooth starts; only LEDC is left to led_init_task.
+
+    //-----------------------------------------------------------------------------
+    // LED ( the duty table here, LEDC in led_init_task beside the Bluetooth bring-up )
+    if (!duty_lut_init(&led_duty_lut, MAX_DUTY, LEDC_DUTY_RES, CONFIG_SWIFT_LED_GAMMA_X10, true)) {
+        ESP_LOGE(MAIN_TAG, "LED : Failed to build duty table ( steps=%d, gamma x10=%d )", MAX_DUTY, CONFIG_SWIFT_LED_GAMMA_X10);
+    }
+    if (xTaskCreate(led_init_task, "LedInit", 2048, NULL, LED_INIT_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(MAIN_TAG, "Failed to create LED init task");
+    }
+
+    //-----------------------------------------------------------------------------
+    // LED pattern timer ( runs only while a pattern plays )
+    for (int i = 0; i < 2; i++) {
+        led_pattern_init(&led_patterns[i], led_pattern_tables[i], LED_PATTERN_TABLE_LEN, FADE_TIME);
+    }
+    led_pattern_timer = xTimerCreate("LedPatternTimer", pdMS_TO_TICKS(FADE_TIME), pdTRUE, NULL, led_pattern_timer_callback);
+
+    //-----------------------------------------------------------------------------
+    // Notify timer
+    notify_timer = xTimerCreate("NotifyTimer", notify_period_ticks(swift_config.notify_period_ms), pdTRUE, NULL, notify_timer_callback);
+#if CONFIG_SWIFT_NOTIFY_TASK
+    // Notify task ( the timer only signals ticks )
+    if (!spsc_ring_init(&notify_tick_ring, notify_tick_ring_storage, sizeof(int64_t), NOTIFY_TICK_RING_LEN)
+        || xTaskCreate(notify_task, "NotifyTask", 4096, NULL, NOTIFY_TASK_PRIO, &notify_task_handle) != pdPASS) {
+        ESP_LOGE(MAIN_TAG, "Failed to create notify task");
+    }
+#endif
+
+#if SAMPLES_ENABLED
+    //-----------------------------------------------------------------------------
+    // Sample source and producer task ( fills the blocks the notify path sends )
+    if (!samples_init()
+        || xTaskCreate(sample_task, "SampleTask", 3072, NULL, SAMPLE_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(MAIN_TAG, "Failed to start sample source");
+    }
+#endif
+
+    //-----------------------------------------------------------------------------
+    // Link negotiation timer ( runs only while a link is negotiating )
+    link_neg_timer = xTimerCreate("LinkNegTimer", pdMS_TO_TICKS(LINK_NEG_POLL_MS), pdTRUE, NULL, link_neg_timer_callback);
+
+    //-----------------------------------------------------------------------------
+    // Blob reassembly arena
+    blob_rx_init(&blob_rx, blob_arena, sizeof(blob_arena));
+
+    //-----------------------------------------------------------------------------
+    // Write pool and ring ( every write is kept, in order, up to CONFIG_SWIFT_WRITE_RING_LEN pending )
+    if (!write_pool_init(&write_pool, write_pool_storage, WRITE_BUF_LEN, write_pool_free_storage, CONFIG_SWIFT_WRITE_RING_LEN)
+        || !spsc_ring_init(&write_ring, write_ring_storage, sizeof(write_buf_handle_t), CONFIG_SWIFT_WRITE_RING_LEN)) {
+        ESP_LOGE(MAIN_TAG, "Failed to create write pool");
+    }
+    // Write consumer task ( wakes on every write instead of polling )
+    if (xTaskCreate(write_consumer_task, "WriteConsumer", 3072, NULL, WRITE_CONSUMER_TASK_PRIO, &write_consumer_task_handle) != pdPASS) {
+        ESP_LOGE(MAIN_TAG, "Failed to create write consumer task");
+    }
+
+#if CONFIG_SWIFT_HOT_LOG_RING
+    //-----------------------------------------------------------------------------
+    // Hot-path log drain task
+    if (xTaskCreate(hot_log_task, "HotLog", 3072, NULL, HOT_LOG_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(MAIN_TAG, "Failed to create hot log task");
+    }
+#endif
+
+    //-----------------------------------------------------------------------------
+    // Fast advertising window ( from boot; every disconnect opens it again )
+    adv_fast_burst();
+    adv_backoff_timer = xTimerCreate("AdvBackoffTimer", 1, pdFALSE, NULL, adv_backoff_timer_callback);
+
     //-----------------------------------------------------------------------------
     // nvs
     ret = nvs_flash_init();
@@ -499,6 +2362,23 @@ void app_main(void)
     }
     ESP_ERROR_CHECK( ret );
     ESP_LOGI(MAIN_TAG, "NVS initialized");
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_NVS, esp_timer_get_time());
+
+    //-----------------------------------------------------------------------------
+    // Tuning profile ( the active one, in place before the controller starts and the first advertising )
+    swift_config_t profile_cfg;
+    ret = tuning_profile_load_active(&profile_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(MAIN_TAG, "NVS : Profile %s unusable ( %s ), using built-in", tuning_profile_name((swift_profile_t)profile_cfg.profile), esp_err_to_name(ret));
+    }
+    xSemaphoreTake(conn_table_lock, portMAX_DELAY);
+    swift_config = profile_cfg;
+    notify_events_configure(&profile_cfg);
+    xSemaphoreGive(conn_table_lock);
+    // no link yet: only the notify timer's period
+    apply_config(&profile_cfg, SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_PERIOD));
+    ESP_LOGI(MAIN_TAG, "Tuning profile %s", tuning_profile_name((swift_profile_t)profile_cfg.profile));
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_PROFILE, esp_timer_get_time());
 
 
     //-----------------------------------------------------------------------------
@@ -516,6 +2396,7 @@ void app_main(void)
         ESP_LOGE(MAIN_TAG, "%s enable controller failed: %s", __func__, esp_err_to_name(ret));
         return;
     }
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_CONTROLLER, esp_timer_get_time());
 
     //-----------------------------------------------------------------------------
     // bluedroid
@@ -531,6 +2412,7 @@ void app_main(void)
         ESP_LOGE(MAIN_TAG, "%s enable bluetooth failed: %s", __func__, esp_err_to_name(ret));
         return;
     }
+    boot_timeline_mark(&boot_timeline, BOOT_MARK_BLUEDROID, esp_timer_get_time());
 
     //-----------------------------------------------------------------------------
     // gatt callback
@@ -550,6 +2432,13 @@ void app_main(void)
         return;
     }
 
+    //-----------------------------------------------------------------------------
+    // local MTU : let the central negotiate up to CONFIG_SWIFT_LOCAL_MTU (default is 23)
+    ret = esp_ble_gatt_set_local_mtu(CONFIG_SWIFT_LOCAL_MTU);
+    if (ret) {
+        ESP_LOGE(MAIN_TAG, "%s set local MTU failed, error code = %s", __func__, esp_err_to_name(ret));
+    }
+
     //-----------------------------------------------------------------------------
     // gatt app
     ESP_LOGI(MAIN_TAG, "Registering GATT app");
@@ -558,29 +2447,4 @@ void app_main(void)
         ESP_LOGE(MAIN_TAG, "%s gatt app register error, error code = %s", __func__, esp_err_to_name(ret));
         return;
     }
-
-
-
-    //-----------------------------------------------------------------------------
-    // LED
-    configure_led();
-
-    //-----------------------------------------------------------------------------
-    // Notify timer
-    notify_timer = xTimerCreate("NotifyTimer", pdMS_TO_TICKS(30), pdTRUE, NULL, notify_timer_callback);
-
-    //-----------------------------------------------------------------------------
-    // Write timer
-    write_data_read_timer = xTimerCreate("ReadTimer", pdMS_TO_TICKS(100), pdTRUE, NULL, write_data_read_timer_callback);
-    if (write_data_read_timer == NULL) {
-        ESP_LOGE(MAIN_TAG, "Failed to create read timer");
-    } else {
-        xTimerStart(write_data_read_timer, 0);
-    }
-    // Write data queue ( size:1, most recent only )
-    write_data_queue = xQueueCreate(1, 10 * sizeof(uint8_t));
-    if (write_data_queue == NULL) {
-        ESP_LOGE(MAIN_TAG, "Failed to create write data queue");
-    }
-
 }
@@ -0,0 +1,141 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "blob_rx.h"
+
+void blob_rx_init(blob_rx_t *rx, uint8_t *arena, uint32_t cap)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->arena = arena;
+    rx->cap = cap;
+}
+
+static bool owned_by_other(const blob_rx_t *rx, uint16_t conn_id, uint32_t now_ms)
+{
+    return rx->active && rx->conn_id != conn_id && now_ms - rx->last_ms < BLOB_RX_STALE_MS;
+}
+
+blob_rx_status_t blob_rx_begin(blob_rx_t *rx, uint16_t conn_id, uint32_t now_ms)
+{
+    if (owned_by_other(rx, conn_id, now_ms)) {
+        rx->rejected++;
+        return BLOB_RX_ERR_BUSY;
+    }
+    if (rx->active) {
+        rx->aborted++;
+    }
+    rx->active = true;
+    rx->conn_id = conn_id;
+    rx->len = 0;
+    rx->crc = 0;
+    rx->started_ms = now_ms;
+    rx->last_ms = now_ms;
+    return BLOB_RX_OK;
+}
+
+blob_rx_status_t blob_rx_append(blob_rx_t *rx, uint16_t conn_id, uint32_t offset, const uint8_t *data, uint32_t len, uint32_t now_ms)
+{
+    blob_rx_status_t status = BLOB_RX_OK;
+    if (!rx->active || rx->conn_id != conn_id) {
+        status = owned_by_other(rx, conn_id, now_ms) ? BLOB_RX_ERR_BUSY : BLOB_RX_ERR_IDLE;
+    } else if (offset != rx->len) {
+        status = BLOB_RX_ERR_OFFSET;
+    } else if (len > rx->cap - rx->len) {
+        status = BLOB_RX_ERR_OVERFLOW;
+    }
+    if (status != BLOB_RX_OK) {
+        rx->rejected++;
+        return status;
+    }
+
+    memcpy(rx->arena + rx->len, data, len);
+    rx->crc = blob_crc32_update(rx->crc, data, len);
+    rx->len += len;
+    rx->last_ms = now_ms;
+    return BLOB_RX_OK;
+}
+
+blob_rx_status_t blob_rx_finish(blob_rx_t *rx, uint16_t conn_id, uint32_t now_ms)
+{
+    if (!rx->active || rx->conn_id != conn_id) {
+        return BLOB_RX_ERR_IDLE;
+    }
+    rx->active = false;
+    rx->done_len = rx->len;
+    rx->done_crc = rx->crc;
+    rx->done_duration_ms = now_ms - rx->started_ms;
+    rx->completed++;
+    return BLOB_RX_COMPLETE;
+}
+
+void blob_rx_abort(blob_rx_t *rx, uint16_t conn_id)
+{
+    if (rx->active && rx->conn_id == conn_id) {
+        rx->active = false;
+        rx->aborted++;
+    }
+}
+
+const char *blob_rx_status_str(blob_rx_status_t status)
+{
+    switch (status) {
+        case BLOB_RX_OK: return "ok";
+        case BLOB_RX_COMPLETE: return "complete";
+        case BLOB_RX_ERR_OFFSET: return "unexpected offset";
+        case BLOB_RX_ERR_OVERFLOW: return "too large";
+        case BLOB_RX_ERR_BUSY: return "another transfer in progress";
+        case BLOB_RX_ERR_IDLE: return "no transfer in progress";
+        default: return "?";
+    }
+}
+
+uint32_t blob_crc32_update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    // reflected polynomial 0xEDB88320, a nibble at a time
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+void blob_chunk_encode_header(uint8_t flags, uint32_t offset, uint8_t *buf)
+{
+    buf[0] = flags;
+    buf[1] = (uint8_t)(offset & 0xFF);
+    buf[2] = (uint8_t)((offset >> 8) & 0xFF);
+    buf[3] = (uint8_t)((offset >> 16) & 0xFF);
+}
+
+bool blob_chunk_decode_header(const uint8_t *buf, uint16_t len, uint8_t *flags, uint32_t *offset)
+{
+    if (len < BLOB_CHUNK_HEADER_LEN) {
+        return false;
+    }
+    *flags = buf[0];
+    *offset = (uint32_t)buf[1] | ((uint32_t)buf[2] << 8) | ((uint32_t)buf[3] << 16);
+    return true;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+void blob_rx_encode_status(const blob_rx_t *rx, uint8_t *buf)
+{
+    put_u32(buf + 0, rx->done_len);
+    put_u32(buf + 4, rx->done_crc);
+    put_u32(buf + 8, rx->completed);
+    put_u32(buf + 12, rx->rejected);
+    put_u32(buf + 16, rx->active ? rx->len : 0);
+}
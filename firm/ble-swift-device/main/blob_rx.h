@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Blob reassembly
+//
+// Streams a large value (LED pattern, table, ...) into a preallocated arena
+// as its pieces arrive, from either transport:
+//   - a long write: ATT Prepare Write requests at increasing offsets, then
+//     Execute Write (blob_rx_finish) or cancel (blob_rx_abort)
+//   - chunked Write Commands, each led by a BLOB_CHUNK_HEADER_LEN header
+//
+// Pieces must arrive in order: every append must start where the previous one
+// ended, and nothing may run past the arena. One transfer is in progress at a
+// time, owned by one connection. Another connection can take over only once
+// the owner has been quiet for BLOB_RX_STALE_MS.
+//
+// A running CRC-32 (IEEE 802.3) of the assembled bytes is kept, so a
+// completed blob is checked without a second pass.
+#define BLOB_RX_STALE_MS 5000
+
+typedef enum {
+    BLOB_RX_OK = 0,
+    BLOB_RX_COMPLETE,           // the blob is in the arena until the next transfer begins
+    BLOB_RX_ERR_OFFSET,         // not where the previous piece ended
+    BLOB_RX_ERR_OVERFLOW,       // would run past the arena
+    BLOB_RX_ERR_BUSY,           // another connection's transfer is in progress
+    BLOB_RX_ERR_IDLE,           // no transfer in progress for this connection
+} blob_rx_status_t;
+
+typedef struct {
+    uint8_t *arena;
+    uint32_t cap;
+
+    // transfer in progress
+    bool active;
+    uint16_t conn_id;
+    uint32_t len;               // bytes assembled; the next piece starts here
+    uint32_t crc;               // running CRC-32 of arena[0..len)
+    uint32_t started_ms;
+    uint32_t last_ms;
+
+    // last completed blob
+    uint32_t done_len;
+    uint32_t done_crc;
+    uint32_t done_duration_ms;
+
+    uint32_t completed;
+    uint32_t aborted;
+    uint32_t rejected;          // appends refused with an error
+} blob_rx_t;
+
+void blob_rx_init(blob_rx_t *rx, uint8_t *arena, uint32_t cap);
+
+// Starts a new transfer for conn_id, dropping any earlier one it owned.
+blob_rx_status_t blob_rx_begin(blob_rx_t *rx, uint16_t conn_id, uint32_t now_ms);
+
+// Copies data to arena[offset..]; offset must be rx->len.
+blob_rx_status_t blob_rx_append(blob_rx_t *rx, uint16_t conn_id, uint32_t offset, const uint8_t *data, uint32_t len, uint32_t now_ms);
+
+// BLOB_RX_COMPLETE: done_len / done_crc describe arena[0..done_len).
+blob_rx_status_t blob_rx_finish(blob_rx_t *rx, uint16_t conn_id, uint32_t now_ms);
+
+// Drops conn_id's transfer; no-op when it owns none.
+void blob_rx_abort(blob_rx_t *rx, uint16_t conn_id);
+
+const char *blob_rx_status_str(blob_rx_status_t status);
+
+uint32_t blob_crc32_update(uint32_t crc, const uint8_t *data, uint32_t len);
+
+//-----------------------------------------------------------------------------
+// Chunk header for Write Commands
+//
+//   [0]    u8  flags (BLOB_CHUNK_*)
+//   [1..3] u24 offset of the data, little endian
+//   [4..]  data
+//
+// FIRST (offset 0) begins a transfer, LAST completes it once its data is in.
+#define BLOB_CHUNK_HEADER_LEN   4
+#define BLOB_CHUNK_FIRST        0x01
+#define BLOB_CHUNK_LAST         0x02
+
+void blob_chunk_encode_header(uint8_t flags, uint32_t offset, uint8_t *buf);
+
+// false for writes shorter than the header.
+bool blob_chunk_decode_header(const uint8_t *buf, uint16_t len, uint8_t *flags, uint32_t *offset);
+
+//-----------------------------------------------------------------------------
+// Status record (characteristic read)
+//
+//   [0..3]   u32 length of the last completed blob
+//   [4..7]   u32 its CRC-32
+//   [8..11]  u32 completed transfers
+//   [12..15] u32 rejected pieces
+//   [16..19] u32 bytes assembled in the transfer in progress (0 when idle)
+#define BLOB_RX_STATUS_LEN 20
+
+void blob_rx_encode_status(const blob_rx_t *rx, uint8_t *buf);
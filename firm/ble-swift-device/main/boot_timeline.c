@@ -0,0 +1,113 @@
+#include <stdio.h>
+
+#include "boot_timeline.h"
+
+static int64_t load(const boot_timeline_t *tl, boot_mark_t mark)
+{
+    return atomic_load_explicit((_Atomic int64_t *)&tl->at_us[mark], memory_order_relaxed);
+}
+
+void boot_timeline_init(boot_timeline_t *tl)
+{
+    for (int i = 0; i < BOOT_MARK_MAX; i++) {
+        atomic_init(&tl->at_us[i], -1);
+    }
+    atomic_init(&tl->conn_id, -1);
+}
+
+bool boot_timeline_mark(boot_timeline_t *tl, boot_mark_t mark, int64_t now_us)
+{
+    if (mark >= BOOT_MARK_MAX || now_us < 0) {
+        return false;
+    }
+    int64_t unset = -1;
+    return atomic_compare_exchange_strong_explicit(&tl->at_us[mark], &unset, now_us
+        , memory_order_relaxed, memory_order_relaxed);
+}
+
+bool boot_timeline_has(const boot_timeline_t *tl, boot_mark_t mark)
+{
+    return mark < BOOT_MARK_MAX && load(tl, mark) >= 0;
+}
+
+void boot_timeline_disconnect(boot_timeline_t *tl, int64_t now_us)
+{
+    for (int i = BOOT_MARK_DISCONNECT; i < BOOT_MARK_MAX; i++) {
+        atomic_store_explicit(&tl->at_us[i], -1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&tl->conn_id, -1, memory_order_relaxed);
+    boot_timeline_mark(tl, BOOT_MARK_DISCONNECT, now_us);
+}
+
+bool boot_timeline_connect(boot_timeline_t *tl, int conn_id, int64_t now_us)
+{
+    if (!boot_timeline_mark(tl, BOOT_MARK_CONNECT, now_us)) {
+        return false;
+    }
+    atomic_store_explicit(&tl->conn_id, conn_id, memory_order_relaxed);
+    return true;
+}
+
+bool boot_timeline_mark_conn(boot_timeline_t *tl, boot_mark_t mark, int conn_id, int64_t now_us)
+{
+    return conn_id >= 0 && atomic_load_explicit(&tl->conn_id, memory_order_relaxed) == conn_id
+        && boot_timeline_mark(tl, mark, now_us);
+}
+
+int64_t boot_timeline_between(const boot_timeline_t *tl, boot_mark_t from, boot_mark_t to)
+{
+    if (from >= BOOT_MARK_MAX || to >= BOOT_MARK_MAX) {
+        return -1;
+    }
+    int64_t a = load(tl, from);
+    int64_t b = load(tl, to);
+    return a < 0 || b < 0 ? -1 : b - a;
+}
+
+size_t boot_timeline_format(const boot_timeline_t *tl, boot_mark_t first, boot_mark_t last, char *buf, size_t cap)
+{
+    if (cap == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    int64_t origin = -1;
+    size_t len = 0;
+    for (int i = first; i <= (int)last && i < BOOT_MARK_MAX; i++) {
+        int64_t at = load(tl, (boot_mark_t)i);
+        if (at < 0) {
+            continue;
+        }
+        if (origin < 0) {
+            origin = at;
+        }
+        int64_t us = at - origin;
+        int n = snprintf(buf + len, cap - len, "%s%s +%lld.%lldms", len > 0 ? " " : "", boot_mark_str((boot_mark_t)i)
+            , (long long)(us / 1000), (long long)(us % 1000 / 100));
+        if (n < 0 || (size_t)n >= cap - len) {
+            return cap - 1;
+        }
+        len += (size_t)n;
+    }
+    return len;
+}
+
+const char *boot_mark_str(boot_mark_t mark)
+{
+    switch (mark) {
+        case BOOT_MARK_APP_MAIN:            return "app_main";
+        case BOOT_MARK_NVS:                 return "nvs";
+        case BOOT_MARK_PROFILE:             return "profile";
+        case BOOT_MARK_CONTROLLER:          return "controller";
+        case BOOT_MARK_BLUEDROID:           return "bluedroid";
+        case BOOT_MARK_GATT_REGISTERED:     return "gatt_registered";
+        case BOOT_MARK_SERVICE_STARTED:     return "service_started";
+        case BOOT_MARK_ADV_STARTED:         return "adv_started";
+        case BOOT_MARK_LED_READY:           return "led_ready";
+        case BOOT_MARK_DISCONNECT:          return "disconnect";
+        case BOOT_MARK_ADV_RESTARTED:       return "adv_restarted";
+        case BOOT_MARK_CONNECT:             return "connect";
+        case BOOT_MARK_SUBSCRIBED:          return "subscribed";
+        case BOOT_MARK_FIRST_NOTIFY:        return "first_notify";
+        default:                            return "?";
+    }
+}
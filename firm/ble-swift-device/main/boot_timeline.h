@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Boot and reconnect timeline
+//
+// When each step of bringing the device up, and of getting a central back
+// after a disconnect, first happened, in esp_timer microseconds. Any task may
+// mark a step (relaxed atomics, the first mark wins), so the marks show where
+// the time from app_main to advertising, and from a disconnect to the next
+// client's first notification, goes.
+typedef enum {
+    // boot
+    BOOT_MARK_APP_MAIN = 0,
+    BOOT_MARK_NVS,              // nvs_flash_init done
+    BOOT_MARK_PROFILE,          // active tuning profile loaded and applied
+    BOOT_MARK_CONTROLLER,       // BT controller enabled
+    BOOT_MARK_BLUEDROID,        // Bluedroid enabled
+    BOOT_MARK_GATT_REGISTERED,  // ESP_GATTS_REG_EVT
+    BOOT_MARK_SERVICE_STARTED,  // ESP_GATTS_START_EVT
+    BOOT_MARK_ADV_STARTED,      // first ESP_GAP_BLE_ADV_START_COMPLETE_EVT
+    BOOT_MARK_LED_READY,        // LEDC configured, off the critical path
+    // reconnect: since the last disconnect ( or boot, for the first client )
+    BOOT_MARK_DISCONNECT,
+    BOOT_MARK_ADV_RESTARTED,
+    BOOT_MARK_CONNECT,
+    BOOT_MARK_SUBSCRIBED,       // the connected client enabled notifications
+    BOOT_MARK_FIRST_NOTIFY,     // and got its first one
+    BOOT_MARK_MAX,
+} boot_mark_t;
+
+typedef struct {
+    _Atomic int64_t at_us[BOOT_MARK_MAX];   // -1: not yet
+    _Atomic int32_t conn_id;                // of BOOT_MARK_CONNECT, -1 before
+} boot_timeline_t;
+
+void boot_timeline_init(boot_timeline_t *tl);
+
+// Marks step at now_us unless it is marked already; true when this call did.
+bool boot_timeline_mark(boot_timeline_t *tl, boot_mark_t mark, int64_t now_us);
+bool boot_timeline_has(const boot_timeline_t *tl, boot_mark_t mark);
+
+// Starts a reconnect: clears the reconnect marks and marks the disconnect.
+void boot_timeline_disconnect(boot_timeline_t *tl, int64_t now_us);
+// Marks BOOT_MARK_CONNECT for conn_id, the first connect since the disconnect.
+bool boot_timeline_connect(boot_timeline_t *tl, int conn_id, int64_t now_us);
+// Marks a step of the connected client's; other connections are ignored.
+bool boot_timeline_mark_conn(boot_timeline_t *tl, boot_mark_t mark, int conn_id, int64_t now_us);
+
+// us from one mark to another; -1 when either is missing.
+int64_t boot_timeline_between(const boot_timeline_t *tl, boot_mark_t from, boot_mark_t to);
+
+// "nvs +12.0ms controller +74.5ms ..." for the marks first..last that are
+// set, each relative to first (or the earliest set mark); returns the length
+// written, truncated to fit cap.
+size_t boot_timeline_format(const boot_timeline_t *tl, boot_mark_t first, boot_mark_t last, char *buf, size_t cap);
+
+const char *boot_mark_str(boot_mark_t mark);
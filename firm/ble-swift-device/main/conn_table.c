@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "conn_table.h"
+
+_Static_assert(CONN_TABLE_MAX >= 1 && CONN_TABLE_MAX <= 32, "conn table masks are 32 bits wide");
+
+#define ALL_SLOTS_MASK ((uint32_t)(((uint64_t)1 << CONN_TABLE_MAX) - 1))
+
+static int find_slot(const conn_table_t *table, uint16_t conn_id)
+{
+    for (int i = 0; i < CONN_TABLE_MAX; i++) {
+        if ((table->used_mask & (1u << i)) && table->conn_ids[i] == conn_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void conn_table_init(conn_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+conn_state_t *conn_table_add(conn_table_t *table, uint16_t conn_id, const uint8_t bda[6])
+{
+    uint32_t free_mask = ~table->used_mask & ALL_SLOTS_MASK;
+    if (free_mask == 0 || find_slot(table, conn_id) >= 0) {
+        return NULL;
+    }
+    int slot = __builtin_ctz(free_mask);
+    table->used_mask |= 1u << slot;
+    table->notify_mask &= ~(1u << slot);
+    table->conn_ids[slot] = conn_id;
+
+    conn_state_t *state = &table->state[slot];
+    memset(state, 0, sizeof(*state));
+    state->conn_id = conn_id;
+    state->mtu = 23; // ATT default until the MTU exchange
+    if (bda != NULL) {
+        memcpy(state->bda, bda, sizeof(state->bda));
+    }
+    return state;
+}
+
+bool conn_table_remove(conn_table_t *table, uint16_t conn_id)
+{
+    int slot = find_slot(table, conn_id);
+    if (slot < 0) {
+        return false;
+    }
+    table->used_mask &= ~(1u << slot);
+    table->notify_mask &= ~(1u << slot);
+    return true;
+}
+
+conn_state_t *conn_table_find(conn_table_t *table, uint16_t conn_id)
+{
+    int slot = find_slot(table, conn_id);
+    return slot < 0 ? NULL : &table->state[slot];
+}
+
+conn_state_t *conn_table_find_bda(conn_table_t *table, const uint8_t bda[6])
+{
+    for (int i = 0; i < CONN_TABLE_MAX; i++) {
+        if ((table->used_mask & (1u << i)) && memcmp(table->state[i].bda, bda, 6) == 0) {
+            return &table->state[i];
+        }
+    }
+    return NULL;
+}
+
+bool conn_table_set_notify(conn_table_t *table, uint16_t conn_id, bool enabled)
+{
+    int slot = find_slot(table, conn_id);
+    if (slot < 0) {
+        return false;
+    }
+    if (enabled) {
+        table->notify_mask |= 1u << slot;
+    } else {
+        table->notify_mask &= ~(1u << slot);
+    }
+    return true;
+}
+
+int conn_table_count(const conn_table_t *table)
+{
+    return __builtin_popcount(table->used_mask);
+}
+
+int conn_table_notify_count(const conn_table_t *table)
+{
+    return __builtin_popcount(table->notify_mask);
+}
+
+bool conn_table_is_full(const conn_table_t *table)
+{
+    return (table->used_mask & ALL_SLOTS_MASK) == ALL_SLOTS_MASK;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "link_neg.h"
+#include "notify_pacer.h"
+#include "notify_sched.h"
+#include "seq_tracker.h"
+
+#define CONN_TABLE_MAX CONFIG_SWIFT_MAX_CONNECTIONS
+
+//-----------------------------------------------------------------------------
+// Per-connection state
+typedef struct {
+    uint16_t conn_id;
+    uint16_t mtu;
+    uint8_t bda[6];
+
+    // connection parameters (1.25ms units / events / 10ms units)
+    uint16_t conn_interval;
+    uint16_t conn_latency;
+    uint16_t conn_timeout;
+
+    uint32_t notify_counter; // next frame counter sent to this client
+    uint32_t sample_next;    // next sample (sample_block_t.seq numbering) sent to this client
+    notify_pacer_t pacer;
+    notify_sched_t events;   // event frames waiting to be notified
+    link_neg_t link;         // data length / PHY negotiation and outcome
+    uint32_t writes_received;
+    seq_tracker_t write_seq; // frame sequence of this client's writes
+} conn_state_t;
+
+//-----------------------------------------------------------------------------
+// Fixed-capacity connection table keyed by conn_id
+//
+// Lookups scan the small packed conn_id array; which slots are in use and
+// which are subscribed to notifications are bitmasks, so the notify fan-out
+// walks only subscribed slots without touching the others.
+typedef struct {
+    uint32_t used_mask;
+    uint32_t notify_mask;
+    uint16_t conn_ids[CONN_TABLE_MAX];
+    conn_state_t state[CONN_TABLE_MAX];
+} conn_table_t;
+
+void conn_table_init(conn_table_t *table);
+
+// Claims a slot for a new connection; NULL when the table is full or conn_id is known.
+conn_state_t *conn_table_add(conn_table_t *table, uint16_t conn_id, const uint8_t bda[6]);
+
+// Releases the slot (and its subscription); false when conn_id is unknown.
+bool conn_table_remove(conn_table_t *table, uint16_t conn_id);
+
+conn_state_t *conn_table_find(conn_table_t *table, uint16_t conn_id);
+conn_state_t *conn_table_find_bda(conn_table_t *table, const uint8_t bda[6]);
+
+// false when conn_id is unknown.
+bool conn_table_set_notify(conn_table_t *table, uint16_t conn_id, bool enabled);
+
+int conn_table_count(const conn_table_t *table);
+int conn_table_notify_count(const conn_table_t *table);
+bool conn_table_is_full(const conn_table_t *table);
+
+// Slot index of a state returned by this table.
+static inline int conn_table_slot(const conn_table_t *table, const conn_state_t *state)
+{
+    return (int)(state - table->state);
+}
@@ -0,0 +1,29 @@
+#include <math.h>
+
+#include "duty_lut.h"
+
+bool duty_lut_init(duty_lut_t *lut, uint32_t steps, uint32_t duty_bits, uint32_t gamma_x10, bool active_low)
+{
+    if (steps == 0 || steps > DUTY_LUT_STEPS_MAX || duty_bits == 0 || duty_bits > 16 || gamma_x10 == 0) {
+        return false;
+    }
+    uint32_t duty_max = (1u << duty_bits) - 1;
+    lut->period = 2 * steps;
+    lut->magic = (uint32_t)((((uint64_t)1 << 32) + lut->period - 1) / lut->period);
+
+    for (uint32_t level = 0; level < steps; level++) {
+        uint32_t duty;
+        if (gamma_x10 == DUTY_LUT_GAMMA_LINEAR) {
+            duty = (level * duty_max) / steps;
+        } else {
+            duty = (uint32_t)lround(duty_max * pow((double)level / steps, gamma_x10 / 10.0));
+        }
+        if (active_low) {
+            duty = duty_max - duty;
+        }
+        // up, then the mirror image back down
+        lut->duty[level] = (uint16_t)duty;
+        lut->duty[lut->period - 1 - level] = (uint16_t)duty;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Counter-to-duty lookup table
+//
+// A write's counter sweeps the LED up and back down: counter % (2 * steps)
+// climbs through levels 0 .. steps - 1 and then returns, and each level maps
+// to a duty at the channel's resolution. The table holds that whole triangle,
+// built once per channel with any gamma curve and active-low inversion folded
+// in, so a lookup is a multiply-shift reduction and a load: no reflection and
+// no division.
+#define DUTY_LUT_STEPS_MAX      128
+#define DUTY_LUT_GAMMA_LINEAR   10  // gamma x 10: (level / steps) ^ (gamma_x10 / 10)
+
+typedef struct {
+    uint16_t duty[2 * DUTY_LUT_STEPS_MAX];  // output duty by counter phase
+    uint32_t period;                        // 2 * steps
+    uint32_t magic;                         // 2^32 / period, rounded up
+} duty_lut_t;
+
+// Builds the table for steps levels (1..DUTY_LUT_STEPS_MAX) scaled to a
+// duty_bits (1..16) channel. Linear tables give exactly the old
+// (level * duty_max) / steps. Returns false on arguments out of range.
+bool duty_lut_init(duty_lut_t *lut, uint32_t steps, uint32_t duty_bits, uint32_t gamma_x10, bool active_low);
+
+// Duty for a write counter.
+static inline uint32_t duty_lut_get(const duty_lut_t *lut, uint16_t counter)
+{
+    // exact for any 16-bit counter and period < 2^16
+    uint32_t q = (uint32_t)(((uint64_t)counter * lut->magic) >> 32);
+    return lut->duty[counter - q * lut->period];
+}
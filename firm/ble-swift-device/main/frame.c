@@ -0,0 +1,31 @@
+#include <string.h>
+
+#include "frame.h"
+
+void frame_encode(const frame_t *frame, uint8_t *buf)
+{
+    uint8_t len = frame->payload_len <= FRAME_PAYLOAD_MAX ? frame->payload_len : FRAME_PAYLOAD_MAX;
+    buf[0] = (uint8_t)(frame->seq & 0xFF);
+    buf[1] = (uint8_t)(frame->seq >> 8);
+    buf[2] = frame->type;
+    buf[3] = len;
+    buf[4] = (uint8_t)(frame->timestamp_ms & 0xFF);
+    buf[5] = (uint8_t)((frame->timestamp_ms >> 8) & 0xFF);
+    buf[6] = (uint8_t)((frame->timestamp_ms >> 16) & 0xFF);
+    buf[7] = (uint8_t)(frame->timestamp_ms >> 24);
+    memset(buf + FRAME_HEADER_LEN, 0, FRAME_PAYLOAD_MAX);
+    memcpy(buf + FRAME_HEADER_LEN, frame->payload, len);
+}
+
+bool frame_decode(const uint8_t *buf, uint16_t len, frame_t *frame)
+{
+    if (len < FRAME_LEN || buf[2] >= FRAME_TYPE_MAX || buf[3] > FRAME_PAYLOAD_MAX) {
+        return false;
+    }
+    frame->seq = (uint16_t)(buf[0] | (buf[1] << 8));
+    frame->type = buf[2];
+    frame->payload_len = buf[3];
+    frame->timestamp_ms = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    memcpy(frame->payload, buf + FRAME_HEADER_LEN, FRAME_PAYLOAD_MAX);
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// 10-byte frame shared by both directions (notifications and writes)
+//
+//   [0..1] u16 sequence, little endian (the old counter: same place, same meaning)
+//   [2]    u8  type
+//   [3]    u8  payload length (0..FRAME_PAYLOAD_MAX)
+//   [4..7] u32 sender timestamp in ms, little endian (sender's own clock)
+//   [8..9] payload, zero padded
+//
+// A frame from a sender that only fills the counter decodes as a DATA frame
+// with timestamp 0 and no payload.
+//
+// With a sample source configured, every notified DATA frame carries one
+// sample: payload u16 little endian, timestamp = the sample's time. A client
+// that selects a sample codec (config characteristic) gets SAMPLE_RUN frames
+// instead, each followed by more samples, delta coded (see sample_codec.h).
+//
+// Events a client turned on (config characteristic) come as LED, WRITE_ACK
+// and ALERT frames between them, sequenced per type (see notify_sched.h).
+#define FRAME_LEN           10
+#define FRAME_HEADER_LEN    8
+#define FRAME_PAYLOAD_MAX   (FRAME_LEN - FRAME_HEADER_LEN)
+
+typedef enum {
+    FRAME_TYPE_DATA = 0x00,
+    FRAME_TYPE_SAMPLE_RUN = 0x01,   // notify only: first sample of a run, the rest follow the frame
+    FRAME_TYPE_ALERT = 0x02,        // notify only: u8 alert, u8 argument
+    FRAME_TYPE_LED = 0x03,          // notify only: u16 LED duty a write left
+    FRAME_TYPE_WRITE_ACK = 0x04,    // notify only: u16 sequence of an applied write frame
+    FRAME_TYPE_MAX,
+} frame_type_t;
+
+typedef struct {
+    uint16_t seq;
+    uint8_t type;
+    uint8_t payload_len;
+    uint32_t timestamp_ms;
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+} frame_t;
+
+// Writes FRAME_LEN bytes; payload beyond payload_len is zeroed.
+void frame_encode(const frame_t *frame, uint8_t *buf);
+
+// false for short buffers, unknown types and oversized payload lengths.
+bool frame_decode(const uint8_t *buf, uint16_t len, frame_t *frame);
@@ -0,0 +1,133 @@
+#include <inttypes.h>
+
+#include "hot_log.h"
+
+// Rate limit: one line per interval, bursts of up to CONFIG_SWIFT_HOT_LOG_BURST
+#define HOT_LOG_INTERVAL_MS     (1000u / CONFIG_SWIFT_HOT_LOG_RATE)
+#define HOT_LOG_TOLERANCE_MS    ((CONFIG_SWIFT_HOT_LOG_BURST - 1) * HOT_LOG_INTERVAL_MS)
+
+_Static_assert((CONFIG_SWIFT_HOT_LOG_RING_LEN & (CONFIG_SWIFT_HOT_LOG_RING_LEN - 1)) == 0
+    , "CONFIG_SWIFT_HOT_LOG_RING_LEN must be a power of two");
+
+hot_log_ring_t hot_log_ring;
+
+void hot_log_ring_init(hot_log_ring_t *ring)
+{
+    for (uint32_t i = 0; i < CONFIG_SWIFT_HOT_LOG_RING_LEN; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+    atomic_init(&ring->head, 0);
+    ring->tail = 0;
+    atomic_init(&ring->written, 0);
+    atomic_init(&ring->suppressed, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+bool hot_log_allow(hot_log_site_t *site, uint32_t now_ms)
+{
+    // GCRA: a line conforms unless the site's theoretical arrival time is
+    // more than the burst tolerance ahead. A CAS never sets it further ahead
+    // than tolerance + interval, so more than that is a site that never
+    // logged, or was quiet for half the 32-bit ms clock: start afresh.
+    uint32_t next = atomic_load_explicit(&site->next_ms, memory_order_relaxed);
+    for (;;) {
+        int32_t ahead = (int32_t)(next - now_ms);
+        if (ahead > (int32_t)(HOT_LOG_TOLERANCE_MS + HOT_LOG_INTERVAL_MS)) {
+            ahead = 0;
+        } else if (ahead > (int32_t)HOT_LOG_TOLERANCE_MS) {
+            return false;
+        }
+        uint32_t from = ahead > 0 ? next : now_ms;
+        if (atomic_compare_exchange_weak_explicit(&site->next_ms, &next, from + HOT_LOG_INTERVAL_MS
+            , memory_order_relaxed, memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool hot_log_write(hot_log_ring_t *ring, hot_log_site_t *site, uint32_t now_ms, const uint32_t *args)
+{
+    if (!hot_log_allow(site, now_ms)) {
+        atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->suppressed, 1, memory_order_relaxed);
+        return false;
+    }
+
+    // claim a slot: free when its sequence equals the position
+    uint32_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    hot_log_slot_t *slot;
+    for (;;) {
+        slot = &ring->slots[pos & (CONFIG_SWIFT_HOT_LOG_RING_LEN - 1)];
+        int32_t diff = (int32_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1
+                , memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full: the drain has not read this slot's previous record yet
+            atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+
+    hot_log_record_t *record = &slot->record;
+    record->site = site;
+    record->time_ms = now_ms;
+    record->suppressed = atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+    for (int i = 0; i < HOT_LOG_MAX_ARGS; i++) {
+        record->args[i] = args[i];
+    }
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->written, 1, memory_order_relaxed);
+    return true;
+}
+
+bool hot_log_pop(hot_log_ring_t *ring, hot_log_record_t *record)
+{
+    hot_log_slot_t *slot = &ring->slots[ring->tail & (CONFIG_SWIFT_HOT_LOG_RING_LEN - 1)];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != ring->tail + 1) {
+        return false;   // empty, or the producer of the oldest slot is still writing it
+    }
+    *record = slot->record;
+    // free for the producer one lap ahead
+    atomic_store_explicit(&slot->seq, ring->tail + CONFIG_SWIFT_HOT_LOG_RING_LEN, memory_order_release);
+    ring->tail++;
+    return true;
+}
+
+size_t hot_log_format(const hot_log_record_t *record, char *buf, size_t cap)
+{
+    if (cap == 0) {
+        return 0;
+    }
+    // the site's format takes HOT_LOG_MAX_ARGS integers at most; unused ones are ignored
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+    int n = snprintf(buf, cap, record->site->format, record->args[0], record->args[1], record->args[2]);
+#pragma GCC diagnostic pop
+    size_t len = n < 0 ? 0 : (size_t)n < cap ? (size_t)n : cap - 1;
+    n = snprintf(buf + len, cap - len, " [at %" PRIu32 " ms]", record->time_ms);
+    len = n < 0 ? len : (size_t)n < cap - len ? len + (size_t)n : cap - 1;
+    if (record->suppressed > 0) {
+        n = snprintf(buf + len, cap - len, " (+%" PRIu32 " not logged)", record->suppressed);
+        len = n < 0 ? len : (size_t)n < cap - len ? len + (size_t)n : cap - 1;
+    }
+    return len;
+}
+
+uint32_t hot_log_drain(hot_log_ring_t *ring)
+{
+    uint32_t count = 0;
+    hot_log_record_t record;
+    char line[160];
+    while (hot_log_pop(ring, &record)) {
+        hot_log_format(&record, line, sizeof(line));
+        ESP_LOG_LEVEL(record.site->level, record.site->tag, "%s", line);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sdkconfig.h"
+
+#include "esp_log.h"
+
+//-----------------------------------------------------------------------------
+// Hot-path logging
+//
+// ESP_LOG* formats its line and writes it to the console UART before it
+// returns: about 5 ms for a 60-character line at 115200 baud, spent on the
+// Bluetooth task when the caller is a GATTS/GAP handler. The log sites that
+// run per event use HOT_LOG* instead; CONFIG_SWIFT_HOT_LOG selects what that
+// costs:
+//
+//   DIRECT  ESP_LOG*, as before
+//   RING    every site is rate limited (CONFIG_SWIFT_HOT_LOG_RATE lines/s,
+//           bursts of CONFIG_SWIFT_HOT_LOG_BURST); a line that passes is
+//           stored as a record (site, time, up to HOT_LOG_MAX_ARGS integer
+//           arguments) in a lock-free ring, which a low-priority task drains
+//           into ESP_LOG*. Lines a site held back or the full ring dropped
+//           are reported with that site's next line.
+//   STRIP   compiled out, arguments not evaluated
+//
+// The format of a HOT_LOG* site takes integer conversions only (%d, %x,
+// PRIu32, ...), at most HOT_LOG_MAX_ARGS; it is checked as printf's is.
+// Sites above CONFIG_LOG_DEFAULT_LEVEL take no ring slot.
+#define HOT_LOG_MAX_ARGS    3
+#define HOT_LOG_DRAIN_MS    100     // drain task period
+
+typedef struct {
+    esp_log_level_t level;
+    const char *tag;
+    const char *format;
+    _Atomic uint32_t next_ms;       // rate limit (GCRA): theoretical arrival time
+    _Atomic uint32_t suppressed;    // lines not logged since the last record
+} hot_log_site_t;
+
+#define HOT_LOG_SITE_INIT(level_, tag_, format_) { .level = (level_), .tag = (tag_), .format = (format_) }
+
+typedef struct {
+    const hot_log_site_t *site;
+    uint32_t time_ms;
+    uint32_t suppressed;            // of this site, since its previous record
+    uint32_t args[HOT_LOG_MAX_ARGS];
+} hot_log_record_t;
+
+// Bounded multi-producer / single-consumer ring: any task or callback
+// pushes, the drain task pops. A producer claims a slot with a CAS on head
+// and publishes it through the slot's sequence; none ever waits.
+typedef struct {
+    _Atomic uint32_t seq;
+    hot_log_record_t record;
+} hot_log_slot_t;
+
+typedef struct {
+    hot_log_slot_t slots[CONFIG_SWIFT_HOT_LOG_RING_LEN];
+    _Atomic uint32_t head;          // next slot to claim (producers)
+    uint32_t tail;                  // next slot to read (consumer)
+
+    _Atomic uint32_t written;
+    _Atomic uint32_t suppressed;    // held back by a site's rate limit
+    _Atomic uint32_t dropped;       // found the ring full
+} hot_log_ring_t;
+
+// The ring HOT_LOG* sites write to.
+extern hot_log_ring_t hot_log_ring;
+
+void hot_log_ring_init(hot_log_ring_t *ring);
+
+// Rate limit of a site: true when a line at now_ms may be logged.
+bool hot_log_allow(hot_log_site_t *site, uint32_t now_ms);
+
+// Producer: rate limits, then queues a record of the site's line.
+bool hot_log_write(hot_log_ring_t *ring, hot_log_site_t *site, uint32_t now_ms, const uint32_t *args);
+
+// Consumer: copies the oldest record out; false when empty.
+bool hot_log_pop(hot_log_ring_t *ring, hot_log_record_t *record);
+
+// Formats a record's line, with its time and what the site did not log.
+size_t hot_log_format(const hot_log_record_t *record, char *buf, size_t cap);
+
+// Consumer: logs every queued record through ESP_LOG*; returns how many.
+uint32_t hot_log_drain(hot_log_ring_t *ring);
+
+#if CONFIG_SWIFT_HOT_LOG_STRIP
+#define HOT_LOG(level, tag, format, ...) do { \
+        (void)sizeof(snprintf(NULL, 0, format, ##__VA_ARGS__)); \
+    } while (0)
+#elif CONFIG_SWIFT_HOT_LOG_RING
+#define HOT_LOG(level, tag, format, ...) do { \
+        (void)sizeof(snprintf(NULL, 0, format, ##__VA_ARGS__)); \
+        static hot_log_site_t hot_log_site_ = HOT_LOG_SITE_INIT(level, tag, format); \
+        if ((level) <= CONFIG_LOG_DEFAULT_LEVEL) { \
+            hot_log_write(&hot_log_ring, &hot_log_site_, esp_log_timestamp() \
+                , (const uint32_t[HOT_LOG_MAX_ARGS]){ __VA_ARGS__ }); \
+        } \
+    } while (0)
+#else
+#define HOT_LOG(level, tag, format, ...) ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__)
+#endif
+
+#define HOT_LOGE(tag, format, ...) HOT_LOG(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define HOT_LOGW(tag, format, ...) HOT_LOG(ESP_LOG_WARN,  tag, format, ##__VA_ARGS__)
+#define HOT_LOGI(tag, format, ...) HOT_LOG(ESP_LOG_INFO,  tag, format, ##__VA_ARGS__)
+#define HOT_LOGD(tag, format, ...) HOT_LOG(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "latency_hist.h"
+
+void latency_hist_reset(latency_hist_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+void latency_hist_add(latency_hist_t *hist, uint32_t us)
+{
+    hist->buckets[latency_hist_bucket(us, LATENCY_HIST_BUCKETS)]++;
+    hist->count++;
+    hist->sum_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+uint32_t latency_hist_bucket_limit_us(int bucket)
+{
+    if (bucket >= LATENCY_HIST_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)1 << bucket;
+}
+
+uint32_t latency_hist_percentile_us(const latency_hist_t *hist, uint32_t percentile)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    // smallest bucket whose cumulative count reaches the rank
+    uint64_t rank = ((uint64_t)hist->count * percentile + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = latency_hist_bucket_limit_us(i);
+            return limit < hist->max_us ? limit : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+void latency_hist_log(const char *tag, const char *name, const latency_hist_t *hist)
+{
+    ESP_LOGI(tag, "%s: n=%" PRIu32 " avg=%" PRIu32 "us p50<=%" PRIu32 "us p90<=%" PRIu32 "us p99<=%" PRIu32 "us max=%" PRIu32 "us"
+        , name, hist->count
+        , hist->count ? (uint32_t)(hist->sum_us / hist->count) : 0
+        , latency_hist_percentile_us(hist, 50)
+        , latency_hist_percentile_us(hist, 90)
+        , latency_hist_percentile_us(hist, 99)
+        , hist->max_us);
+
+    char line[256];
+    int len = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS && len < (int)sizeof(line); i++) {
+        if (hist->buckets[i] == 0) {
+            continue;
+        }
+        uint32_t limit = latency_hist_bucket_limit_us(i);
+        if (limit == UINT32_MAX) {
+            len += snprintf(line + len, sizeof(line) - len, " >=%" PRIu32 "us:%" PRIu32
+                , latency_hist_bucket_limit_us(i - 1), hist->buckets[i]);
+        } else {
+            len += snprintf(line + len, sizeof(line) - len, " <%" PRIu32 "us:%" PRIu32, limit, hist->buckets[i]);
+        }
+    }
+    if (len > 0) {
+        ESP_LOGI(tag, "%s buckets:%s", name, line);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Fixed-bucket latency histogram
+//
+// Bucket 0 counts 0us, bucket i (i >= 1) counts [2^(i-1), 2^i) us, and the last
+// bucket also takes everything above. Adding a sample is a count-leading-zeros
+// and two increments, cheap enough for callback context.
+#define LATENCY_HIST_BUCKETS 21 // last bucket starts at 2^19 us (~524 ms)
+
+typedef struct {
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_hist_t;
+
+// Bucket of a sample in a histogram of this scheme with `buckets` buckets;
+// shared with the telemetry histograms.
+static inline int latency_hist_bucket(uint32_t us, int buckets)
+{
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    return bucket < buckets ? bucket : buckets - 1;
+}
+
+void latency_hist_reset(latency_hist_t *hist);
+void latency_hist_add(latency_hist_t *hist, uint32_t us);
+
+// Exclusive upper bound of a bucket in us (UINT32_MAX for the last bucket).
+uint32_t latency_hist_bucket_limit_us(int bucket);
+
+// Upper bound of the bucket holding the given percentile (0-100).
+uint32_t latency_hist_percentile_us(const latency_hist_t *hist, uint32_t percentile);
+
+// Logs a one-line summary and the non-empty buckets at INFO level.
+void latency_hist_log(const char *tag, const char *name, const latency_hist_t *hist);
@@ -0,0 +1,115 @@
+#include <stddef.h>
+
+#include "led_pattern.h"
+
+static uint16_t get_u16(const uint8_t *buf)
+{
+    return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+static void put_u16(uint16_t value, uint8_t *buf)
+{
+    buf[0] = (uint8_t)(value & 0xFF);
+    buf[1] = (uint8_t)(value >> 8);
+}
+
+void led_pattern_init(led_pattern_t *pattern, uint16_t *table, uint32_t cap, uint16_t tick_ms)
+{
+    pattern->table = table;
+    pattern->cap = cap;
+    pattern->len = 0;
+    pattern->tick_ms = tick_ms;
+    pattern->loop = false;
+}
+
+int32_t led_pattern_keyframes(const uint8_t *record, uint32_t len)
+{
+    if (len < LED_PATTERN_HEADER_LEN || record[0] != LED_PATTERN_RECORD_TYPE) {
+        return -1;
+    }
+    uint16_t count = get_u16(record + 2);
+    if (len != LED_PATTERN_HEADER_LEN + (uint32_t)count * LED_PATTERN_KEYFRAME_LEN) {
+        return -1;
+    }
+    return count;
+}
+
+static uint32_t level_to_duty(uint16_t level, uint32_t duty_max)
+{
+    return (uint32_t)(((uint64_t)level * duty_max + LED_PATTERN_LEVEL_MAX / 2) / LED_PATTERN_LEVEL_MAX);
+}
+
+led_pattern_status_t led_pattern_compile(led_pattern_t *pattern, const uint8_t *record, uint32_t len, uint32_t duty_max)
+{
+    int32_t count = led_pattern_keyframes(record, len);
+    if (count < 0) {
+        return LED_PATTERN_ERR_FORMAT;
+    }
+    const uint8_t *keyframes = record + LED_PATTERN_HEADER_LEN;
+    bool loop = (record[1] & LED_PATTERN_LOOP) != 0;
+
+    uint32_t total_ms = 0;
+    for (int32_t i = 0; i < count; i++) {
+        total_ms += get_u16(keyframes + i * LED_PATTERN_KEYFRAME_LEN + 2);
+    }
+    if (total_ms == 0) {
+        return LED_PATTERN_ERR_EMPTY;
+    }
+    uint32_t ticks = (total_ms + pattern->tick_ms - 1) / pattern->tick_ms;
+    if (ticks > pattern->cap) {
+        return LED_PATTERN_ERR_TOO_LONG;
+    }
+
+    // one pass: each tick samples the segment its end falls in; a sample on
+    // a keyframe boundary belongs to the next segment, so a jump shows at once
+    int32_t k = 0;
+    int32_t from = loop ? (int32_t)level_to_duty(get_u16(keyframes + (count - 1) * LED_PATTERN_KEYFRAME_LEN), duty_max) : 0;
+    int32_t to = (int32_t)level_to_duty(get_u16(keyframes), duty_max);
+    uint32_t seg_start = 0;
+    uint32_t ramp_ms = get_u16(keyframes + 2);
+    for (uint32_t j = 0; j < ticks; j++) {
+        uint32_t t = (j + 1) * pattern->tick_ms;
+        if (t > total_ms) {
+            t = total_ms;
+        }
+        while (t >= seg_start + ramp_ms && k < count - 1) {
+            seg_start += ramp_ms;
+            k++;
+            from = to;
+            to = (int32_t)level_to_duty(get_u16(keyframes + k * LED_PATTERN_KEYFRAME_LEN), duty_max);
+            ramp_ms = get_u16(keyframes + k * LED_PATTERN_KEYFRAME_LEN + 2);
+        }
+        int32_t duty = to;
+        if (ramp_ms > 0 && t < seg_start + ramp_ms) {
+            duty = from + (int32_t)((int64_t)(to - from) * (int64_t)(t - seg_start) / (int64_t)ramp_ms);
+        }
+        pattern->table[j] = (uint16_t)duty;
+    }
+    pattern->len = ticks;
+    pattern->loop = loop;
+    return LED_PATTERN_OK;
+}
+
+const char *led_pattern_status_str(led_pattern_status_t status)
+{
+    switch (status) {
+        case LED_PATTERN_OK:            return "ok";
+        case LED_PATTERN_ERR_FORMAT:    return "not a pattern record";
+        case LED_PATTERN_ERR_EMPTY:     return "no duration";
+        case LED_PATTERN_ERR_TOO_LONG:  return "too long for the table";
+        default:                        return "unknown";
+    }
+}
+
+void led_pattern_encode_header(uint8_t flags, uint16_t count, uint8_t *buf)
+{
+    buf[0] = LED_PATTERN_RECORD_TYPE;
+    buf[1] = flags;
+    put_u16(count, buf + 2);
+}
+
+void led_pattern_encode_keyframe(uint16_t level, uint16_t ramp_ms, uint8_t *buf)
+{
+    put_u16(level, buf);
+    put_u16(ramp_ms, buf + 2);
+}
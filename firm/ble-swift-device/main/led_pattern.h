@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// LED pattern
+//
+// A pattern is uploaded once as a blob (see blob_rx.h) and compiled into a
+// table of duties, one per tick, that the device plays back on its own:
+// a few keyframes drive seconds of animation with no further writes.
+//
+//   [0]    u8  LED_PATTERN_RECORD_TYPE
+//   [1]    u8  flags (LED_PATTERN_LOOP)
+//   [2..3] u16 keyframe count, little endian (0: stop the pattern)
+//   [4..]  keyframes, LED_PATTERN_KEYFRAME_LEN each:
+//          u16 level (0 off .. LED_PATTERN_LEVEL_MAX full)
+//          u16 ramp time in ms to reach it (0: jump)
+//
+// The first keyframe ramps from the last one's level when the pattern loops,
+// from off otherwise. A one-shot pattern holds its last level at the end.
+#define LED_PATTERN_RECORD_TYPE     0x01
+#define LED_PATTERN_HEADER_LEN      4
+#define LED_PATTERN_KEYFRAME_LEN    4
+#define LED_PATTERN_LOOP            0x01
+#define LED_PATTERN_LEVEL_MAX       0xFFFF
+
+typedef enum {
+    LED_PATTERN_OK = 0,
+    LED_PATTERN_ERR_FORMAT,         // not a pattern record, or truncated
+    LED_PATTERN_ERR_EMPTY,          // keyframes add up to no time
+    LED_PATTERN_ERR_TOO_LONG,       // more ticks than the table holds
+} led_pattern_status_t;
+
+typedef struct {
+    uint16_t *table;                // duty at the end of each tick
+    uint32_t cap;
+    uint32_t len;                   // ticks in the pattern
+    uint16_t tick_ms;
+    bool loop;
+} led_pattern_t;
+
+void led_pattern_init(led_pattern_t *pattern, uint16_t *table, uint32_t cap, uint16_t tick_ms);
+
+// Keyframe count of a record, once its header checks out; -1 otherwise.
+int32_t led_pattern_keyframes(const uint8_t *record, uint32_t len);
+
+// Interpolates the keyframes linearly into pattern->table, scaled to
+// 0..duty_max. The table is left untouched on error.
+led_pattern_status_t led_pattern_compile(led_pattern_t *pattern, const uint8_t *record, uint32_t len, uint32_t duty_max);
+
+const char *led_pattern_status_str(led_pattern_status_t status);
+
+// Writes a record header; the keyframes follow with led_pattern_encode_keyframe.
+void led_pattern_encode_header(uint8_t flags, uint16_t count, uint8_t *buf);
+void led_pattern_encode_keyframe(uint16_t level, uint16_t ramp_ms, uint8_t *buf);
@@ -0,0 +1,138 @@
+#include "link_neg.h"
+
+static uint8_t phy_bit(uint8_t phy)
+{
+    return (phy >= LINK_PHY_1M && phy <= LINK_PHY_CODED) ? (uint8_t)(1u << (phy - 1)) : 0;
+}
+
+static link_neg_action_t finish(link_neg_t *ln, int64_t now_us)
+{
+    ln->state = LINK_NEG_DONE;
+    ln->done_us = now_us;
+    return LINK_NEG_ACTION_NONE;
+}
+
+static link_neg_action_t start_phy(link_neg_t *ln, int64_t now_us)
+{
+    if (ln->want_phy_mask == 0) {
+        ln->phy_result = LINK_NEG_RESULT_SKIPPED;
+        return finish(ln, now_us);
+    }
+    ln->state = LINK_NEG_PHY_PENDING;
+    ln->phy_result = LINK_NEG_RESULT_PENDING;
+    ln->deadline_us = now_us + LINK_NEG_TIMEOUT_US;
+    return LINK_NEG_ACTION_SET_PHY;
+}
+
+static link_neg_action_t start_data_len(link_neg_t *ln, bool data_len_busy, int64_t now_us)
+{
+    if (ln->want_tx_octets <= LINK_DATA_LEN_DEFAULT) {
+        ln->data_len_result = LINK_NEG_RESULT_SKIPPED;
+        return start_phy(ln, now_us);
+    }
+    ln->data_len_result = LINK_NEG_RESULT_PENDING;
+    if (data_len_busy) {
+        ln->state = LINK_NEG_DATA_LEN_QUEUED;
+        return LINK_NEG_ACTION_NONE;
+    }
+    ln->state = LINK_NEG_DATA_LEN_PENDING;
+    ln->deadline_us = now_us + LINK_NEG_TIMEOUT_US;
+    return LINK_NEG_ACTION_SET_DATA_LEN;
+}
+
+void link_neg_init(link_neg_t *ln, uint16_t want_tx_octets, uint8_t want_phy_mask)
+{
+    *ln = (link_neg_t){ 0 };
+    ln->want_tx_octets = want_tx_octets > LINK_DATA_LEN_MAX ? LINK_DATA_LEN_MAX : want_tx_octets;
+    ln->want_phy_mask = want_phy_mask;
+    ln->tx_octets = LINK_DATA_LEN_DEFAULT;
+    ln->rx_octets = LINK_DATA_LEN_DEFAULT;
+    ln->tx_phy = LINK_PHY_1M;
+    ln->rx_phy = LINK_PHY_1M;
+}
+
+link_neg_action_t link_neg_start(link_neg_t *ln, bool data_len_busy, int64_t now_us)
+{
+    if (ln->state != LINK_NEG_IDLE) {
+        return LINK_NEG_ACTION_NONE;
+    }
+    ln->started_us = now_us;
+    return start_data_len(ln, data_len_busy, now_us);
+}
+
+link_neg_action_t link_neg_on_data_len(link_neg_t *ln, bool ok, uint16_t tx_octets, uint16_t rx_octets, int64_t now_us)
+{
+    if (ok) {
+        ln->tx_octets = tx_octets;
+        ln->rx_octets = rx_octets;
+    }
+    if (ln->state != LINK_NEG_DATA_LEN_PENDING) {
+        return LINK_NEG_ACTION_NONE;
+    }
+    if (!ok) {
+        ln->data_len_result = LINK_NEG_RESULT_REJECTED;
+    } else {
+        ln->data_len_result = tx_octets >= ln->want_tx_octets ? LINK_NEG_RESULT_OK : LINK_NEG_RESULT_PARTIAL;
+    }
+    return start_phy(ln, now_us);
+}
+
+link_neg_action_t link_neg_on_phy(link_neg_t *ln, bool ok, uint8_t tx_phy, uint8_t rx_phy, int64_t now_us)
+{
+    if (ok) {
+        ln->tx_phy = tx_phy;
+        ln->rx_phy = rx_phy;
+    }
+    if (ln->state != LINK_NEG_PHY_PENDING) {
+        return LINK_NEG_ACTION_NONE;
+    }
+    if (!ok) {
+        ln->phy_result = LINK_NEG_RESULT_REJECTED;
+    } else {
+        // ok when both directions use one of the requested PHYs
+        ln->phy_result = ((ln->want_phy_mask & phy_bit(tx_phy)) && (ln->want_phy_mask & phy_bit(rx_phy)))
+            ? LINK_NEG_RESULT_OK : LINK_NEG_RESULT_PARTIAL;
+    }
+    return finish(ln, now_us);
+}
+
+link_neg_action_t link_neg_poll(link_neg_t *ln, bool data_len_busy, int64_t now_us)
+{
+    switch (ln->state) {
+        case LINK_NEG_DATA_LEN_QUEUED:
+            if (data_len_busy) {
+                return LINK_NEG_ACTION_NONE;
+            }
+            return start_data_len(ln, false, now_us);
+
+        case LINK_NEG_DATA_LEN_PENDING:
+            if (now_us < ln->deadline_us) {
+                return LINK_NEG_ACTION_NONE;
+            }
+            ln->data_len_result = LINK_NEG_RESULT_TIMEOUT;
+            return start_phy(ln, now_us);
+
+        case LINK_NEG_PHY_PENDING:
+            if (now_us < ln->deadline_us) {
+                return LINK_NEG_ACTION_NONE;
+            }
+            ln->phy_result = LINK_NEG_RESULT_TIMEOUT;
+            return finish(ln, now_us);
+
+        default:
+            return LINK_NEG_ACTION_NONE;
+    }
+}
+
+const char *link_neg_result_str(link_neg_result_t result)
+{
+    switch (result) {
+        case LINK_NEG_RESULT_SKIPPED:  return "skipped";
+        case LINK_NEG_RESULT_PENDING:  return "pending";
+        case LINK_NEG_RESULT_OK:       return "ok";
+        case LINK_NEG_RESULT_PARTIAL:  return "partial";
+        case LINK_NEG_RESULT_REJECTED: return "rejected";
+        case LINK_NEG_RESULT_TIMEOUT:  return "timeout";
+        default:                       return "?";
+    }
+}
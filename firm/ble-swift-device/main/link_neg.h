@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// LL data length limits (octets per PDU payload)
+#define LINK_DATA_LEN_DEFAULT   27
+#define LINK_DATA_LEN_MAX       251
+
+// PHY values as reported by the controller (ESP_BLE_GAP_PHY_*)
+#define LINK_PHY_1M     1
+#define LINK_PHY_2M     2
+#define LINK_PHY_CODED  3
+
+// A request the controller does not answer within this time is given up on.
+#define LINK_NEG_TIMEOUT_US (2 * 1000 * 1000)
+
+//-----------------------------------------------------------------------------
+// Per-link Data Length Extension + PHY negotiation
+//
+// Runs the data length update first, then the PHY update, one procedure at a
+// time. Every outcome falls back cleanly: a rejected or unanswered request
+// leaves the link at the values it had (27 octets / 1M) and the machine moves
+// on. The machine only decides; the caller issues the returned action
+// (esp_ble_gap_set_pkt_data_len / esp_ble_gap_set_preferred_phy).
+//
+// The data length complete event does not say which link it belongs to, so
+// only one link may have a data length request outstanding: the caller
+// passes data_len_busy while another link owns it and the link queues.
+typedef enum {
+    LINK_NEG_IDLE = 0,
+    LINK_NEG_DATA_LEN_QUEUED,
+    LINK_NEG_DATA_LEN_PENDING,
+    LINK_NEG_PHY_PENDING,
+    LINK_NEG_DONE,
+} link_neg_state_t;
+
+typedef enum {
+    LINK_NEG_ACTION_NONE = 0,
+    LINK_NEG_ACTION_SET_DATA_LEN,   // request want_tx_octets
+    LINK_NEG_ACTION_SET_PHY,        // request want_phy_mask
+} link_neg_action_t;
+
+typedef enum {
+    LINK_NEG_RESULT_SKIPPED = 0,    // not requested
+    LINK_NEG_RESULT_PENDING,
+    LINK_NEG_RESULT_OK,             // got what was asked for
+    LINK_NEG_RESULT_PARTIAL,        // accepted, but the peer settled lower
+    LINK_NEG_RESULT_REJECTED,
+    LINK_NEG_RESULT_TIMEOUT,
+} link_neg_result_t;
+
+typedef struct {
+    link_neg_state_t state;
+    uint16_t want_tx_octets;    // LINK_DATA_LEN_DEFAULT or less: skip
+    uint8_t want_phy_mask;      // ESP_BLE_GAP_PHY_*_PREF_MASK bits; 0: skip
+
+    // current link, as last reported by the controller
+    uint16_t tx_octets;
+    uint16_t rx_octets;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+
+    link_neg_result_t data_len_result;
+    link_neg_result_t phy_result;
+    int64_t started_us;
+    int64_t deadline_us;        // of the outstanding request
+    int64_t done_us;
+} link_neg_t;
+
+void link_neg_init(link_neg_t *ln, uint16_t want_tx_octets, uint8_t want_phy_mask);
+
+link_neg_action_t link_neg_start(link_neg_t *ln, bool data_len_busy, int64_t now_us);
+
+// ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT for this link.
+link_neg_action_t link_neg_on_data_len(link_neg_t *ln, bool ok, uint16_t tx_octets, uint16_t rx_octets, int64_t now_us);
+
+// ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT for this link (also unsolicited ones).
+link_neg_action_t link_neg_on_phy(link_neg_t *ln, bool ok, uint8_t tx_phy, uint8_t rx_phy, int64_t now_us);
+
+// Periodic check: starts a queued link once data_len_busy clears and gives
+// up on requests past their deadline.
+link_neg_action_t link_neg_poll(link_neg_t *ln, bool data_len_busy, int64_t now_us);
+
+static inline bool link_neg_is_pending(const link_neg_t *ln)
+{
+    return ln->state != LINK_NEG_IDLE && ln->state != LINK_NEG_DONE;
+}
+
+const char *link_neg_result_str(link_neg_result_t result);
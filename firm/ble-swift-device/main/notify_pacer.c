@@ -0,0 +1,98 @@
+#include "notify_pacer.h"
+
+static void decrease(notify_pacer_t *pacer)
+{
+    // one loss episode (refusal + CONGEST_EVT + failed CONF) halves once
+    if (pacer->backed_off) {
+        return;
+    }
+    pacer->backed_off = true;
+    pacer->window = pacer->window > 1 ? pacer->window / 2 : 1;
+    pacer->clean_completions = 0;
+}
+
+void notify_pacer_init(notify_pacer_t *pacer, uint16_t window_init, uint16_t window_max)
+{
+    *pacer = (notify_pacer_t){ 0 };
+    pacer->window_max = window_max > 0 ? window_max : 1;
+    pacer->window = window_init == 0 ? 1 : (window_init > pacer->window_max ? pacer->window_max : window_init);
+}
+
+void notify_pacer_tick(notify_pacer_t *pacer, uint16_t target)
+{
+    pacer->ticks++;
+    pacer->requested += target;
+    pacer->skipped += pacer->credit;
+    pacer->credit = target;
+}
+
+uint16_t notify_pacer_budget(const notify_pacer_t *pacer)
+{
+    uint16_t room = notify_pacer_room(pacer);
+    return pacer->credit < room ? pacer->credit : room;
+}
+
+void notify_pacer_on_send(notify_pacer_t *pacer, bool accepted)
+{
+    if (accepted && pacer->credit > 0) {
+        pacer->credit--;
+    }
+    notify_pacer_on_send_unpaced(pacer, accepted);
+}
+
+uint16_t notify_pacer_room(const notify_pacer_t *pacer)
+{
+    if (pacer->congested || pacer->in_flight >= pacer->window) {
+        return 0;
+    }
+    return pacer->window - pacer->in_flight;
+}
+
+void notify_pacer_on_send_unpaced(notify_pacer_t *pacer, bool accepted)
+{
+    if (accepted) {
+        pacer->sent++;
+        pacer->in_flight++;
+    } else {
+        pacer->refused++;
+        decrease(pacer);
+    }
+}
+
+void notify_pacer_on_complete(notify_pacer_t *pacer, bool ok)
+{
+    if (pacer->in_flight > 0) {
+        pacer->in_flight--;
+    }
+    pacer->completed++;
+    if (!ok) {
+        pacer->failed++;
+        decrease(pacer);
+        return;
+    }
+    pacer->backed_off = false;
+    // additive increase: one slot per window of clean completions
+    if (++pacer->clean_completions >= pacer->window) {
+        pacer->clean_completions = 0;
+        if (pacer->window < pacer->window_max) {
+            pacer->window++;
+        }
+    }
+}
+
+void notify_pacer_on_congest(notify_pacer_t *pacer, bool congested)
+{
+    if (congested && !pacer->congested) {
+        pacer->congest_events++;
+        decrease(pacer);
+    }
+    pacer->congested = congested;
+}
+
+uint32_t notify_pacer_achieved_permille(const notify_pacer_t *pacer)
+{
+    if (pacer->requested == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)pacer->sent * 1000) / pacer->requested);
+}
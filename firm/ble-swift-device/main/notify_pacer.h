@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Congestion-aware notification pacing (one per connection)
+//
+// Each tick grants `target` notifications of credit; they are sent as far as
+// the window allows, and the rest as confirmations free up room, so a burst
+// keeps the link busy across connection events instead of once per tick.
+// Credit left over at the next tick is dropped (the data is stale by then).
+//
+// At most `window` notifications are in flight (handed to the stack but not
+// yet confirmed by ESP_GATTS_CONF_EVT). The window grows by one after a full
+// window of clean completions and halves on a refused send, a failed
+// completion or ESP_GATTS_CONGEST_EVT, at most once until the next clean
+// completion; while congested nothing is sent.
+typedef struct {
+    uint16_t window;
+    uint16_t window_max;
+    uint16_t in_flight;
+    uint16_t credit;            // notifications still owed this tick
+    uint16_t clean_completions; // since the last window change
+    bool congested;
+    bool backed_off;            // decreased, no clean completion since
+
+    uint32_t ticks;
+    uint32_t requested;         // sum of per-tick targets
+    uint32_t skipped;           // credit dropped at the next tick
+    uint32_t sent;              // accepted by the stack
+    uint32_t refused;           // rejected by esp_ble_gatts_send_indicate
+    uint32_t completed;
+    uint32_t failed;            // completed with an error status
+    uint32_t congest_events;
+} notify_pacer_t;
+
+void notify_pacer_init(notify_pacer_t *pacer, uint16_t window_init, uint16_t window_max);
+
+// Start of a tick: grants `target` notifications of credit.
+void notify_pacer_tick(notify_pacer_t *pacer, uint16_t target);
+
+// How many notifications may be sent right now.
+uint16_t notify_pacer_budget(const notify_pacer_t *pacer);
+
+// Result of one esp_ble_gatts_send_indicate call.
+void notify_pacer_on_send(notify_pacer_t *pacer, bool accepted);
+
+// Room the window has for a notification outside the tick's credit (events),
+// and the result of sending one: it takes a window slot but no credit.
+uint16_t notify_pacer_room(const notify_pacer_t *pacer);
+void notify_pacer_on_send_unpaced(notify_pacer_t *pacer, bool accepted);
+
+// ESP_GATTS_CONF_EVT for a notification.
+void notify_pacer_on_complete(notify_pacer_t *pacer, bool ok);
+
+// ESP_GATTS_CONGEST_EVT.
+void notify_pacer_on_congest(notify_pacer_t *pacer, bool congested);
+
+// Notifications accepted per 1000 requested.
+uint32_t notify_pacer_achieved_permille(const notify_pacer_t *pacer);
@@ -0,0 +1,37 @@
+#include "notify_packer.h"
+
+uint16_t notify_payload_capacity(uint16_t mtu)
+{
+    if (mtu <= ATT_NOTIFY_HEADER_LEN) {
+        return 0;
+    }
+    uint16_t cap = mtu - ATT_NOTIFY_HEADER_LEN;
+    return cap > NOTIFY_PAYLOAD_MAX ? NOTIFY_PAYLOAD_MAX : cap;
+}
+
+uint16_t notify_frames_per_packet(uint16_t mtu, uint16_t frame_len)
+{
+    if (frame_len == 0) {
+        return 0;
+    }
+    return notify_payload_capacity(mtu) / frame_len;
+}
+
+void notify_packer_init(notify_packer_t *packer, uint8_t *buf, uint16_t buf_len, uint16_t cap)
+{
+    packer->buf = buf;
+    packer->cap = cap > buf_len ? buf_len : cap;
+    packer->len = 0;
+    packer->count = 0;
+}
+
+uint8_t *notify_packer_next(notify_packer_t *packer, uint16_t frame_len)
+{
+    if (frame_len == 0 || (uint32_t)packer->len + frame_len > packer->cap) {
+        return NULL;
+    }
+    uint8_t *slot = packer->buf + packer->len;
+    packer->len += frame_len;
+    packer->count++;
+    return slot;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ATT notification header: opcode (1 byte) + attribute handle (2 bytes)
+#define ATT_NOTIFY_HEADER_LEN 3
+
+// Largest notification payload we ever build (ATT attribute value limit)
+#define NOTIFY_PAYLOAD_MAX 512
+
+//-----------------------------------------------------------------------------
+// Notify packer
+//
+// Packs fixed-size frames back to back into one notification payload.
+// Frames are written in place (notify_packer_next returns the slot to fill),
+// so packing costs no extra copy.
+typedef struct {
+    uint8_t *buf;
+    uint16_t cap;   // usable bytes in buf
+    uint16_t len;   // bytes packed so far
+    uint16_t count; // frames packed so far
+} notify_packer_t;
+
+// Notification payload that fits the negotiated ATT MTU (MTU - 3), bounded by NOTIFY_PAYLOAD_MAX.
+uint16_t notify_payload_capacity(uint16_t mtu);
+
+// Number of frame_len-byte frames that fit in one notification at this MTU.
+uint16_t notify_frames_per_packet(uint16_t mtu, uint16_t frame_len);
+
+// cap is clamped to buf_len.
+void notify_packer_init(notify_packer_t *packer, uint8_t *buf, uint16_t buf_len, uint16_t cap);
+
+// Reserves the next frame_len bytes; NULL when the frame would not fit.
+uint8_t *notify_packer_next(notify_packer_t *packer, uint16_t frame_len);
@@ -0,0 +1,118 @@
+#include "frame.h"
+#include "notify_sched.h"
+
+void notify_sched_init(notify_sched_t *sched)
+{
+    *sched = (notify_sched_t){ 0 };
+}
+
+bool notify_sched_publish(notify_sched_t *sched, notify_channel_t ch, notify_policy_t policy
+    , uint16_t value, uint32_t timestamp_ms)
+{
+    if (ch >= NOTIFY_CH_COUNT || policy == NOTIFY_POLICY_OFF || policy >= NOTIFY_POLICY_MAX) {
+        return false;
+    }
+    notify_sched_channel_t *c = &sched->ch[ch];
+    notify_event_t event = {
+        .seq = c->seq++,
+        .value = value,
+        .timestamp_ms = timestamp_ms,
+    };
+    sched->published++;
+    if (policy == NOTIFY_POLICY_QUEUE) {
+        if (c->count == NOTIFY_SCHED_QUEUE_LEN) {
+            sched->dropped++;
+            return false;
+        }
+        c->events[(c->head + c->count) % NOTIFY_SCHED_QUEUE_LEN] = event;
+        c->count++;
+        sched->pending++;
+        return false;
+    }
+    // LATEST / IMMEDIATE: the newest replaces whatever is pending
+    sched->coalesced += c->count;
+    sched->pending -= c->count;
+    c->head = 0;
+    c->count = 1;
+    c->events[0] = event;
+    sched->pending++;
+    if (policy != NOTIFY_POLICY_IMMEDIATE) {
+        sched->urgent &= (uint8_t)~(1u << ch);
+        return false;
+    }
+    sched->urgent |= (uint8_t)(1u << ch);
+    return true;
+}
+
+uint16_t notify_sched_pack(const notify_sched_t *sched, uint8_t *buf, uint16_t cap)
+{
+    uint16_t len = 0;
+    for (int ch = 0; ch < NOTIFY_CH_COUNT; ch++) {
+        const notify_sched_channel_t *c = &sched->ch[ch];
+        for (uint8_t i = 0; i < c->count; i++) {
+            if (cap - len < FRAME_LEN) {
+                return len;
+            }
+            const notify_event_t *event = &c->events[(c->head + i) % NOTIFY_SCHED_QUEUE_LEN];
+            frame_t frame = {
+                .seq = event->seq,
+                .type = notify_sched_frame_type((notify_channel_t)ch),
+                .payload_len = 2,
+                .timestamp_ms = event->timestamp_ms,
+                .payload = { (uint8_t)event->value, (uint8_t)(event->value >> 8) },
+            };
+            frame_encode(&frame, buf + len);
+            len += FRAME_LEN;
+        }
+    }
+    return len;
+}
+
+void notify_sched_commit(notify_sched_t *sched, uint16_t len)
+{
+    uint16_t frames = len / FRAME_LEN;
+    sched->sent += frames;
+    for (int ch = 0; ch < NOTIFY_CH_COUNT && frames > 0; ch++) {
+        notify_sched_channel_t *c = &sched->ch[ch];
+        uint8_t n = frames < c->count ? (uint8_t)frames : c->count;
+        c->head = (uint8_t)((c->head + n) % NOTIFY_SCHED_QUEUE_LEN);
+        c->count -= n;
+        sched->pending -= n;
+        frames -= n;
+        if (c->count == 0) {
+            sched->urgent &= (uint8_t)~(1u << ch);
+        }
+    }
+}
+
+void notify_sched_clear(notify_sched_t *sched, notify_channel_t ch)
+{
+    if (ch >= NOTIFY_CH_COUNT) {
+        return;
+    }
+    sched->pending -= sched->ch[ch].count;
+    sched->urgent &= (uint8_t)~(1u << ch);
+    sched->ch[ch].head = 0;
+    sched->ch[ch].count = 0;
+}
+
+uint8_t notify_sched_frame_type(notify_channel_t ch)
+{
+    switch (ch) {
+        case NOTIFY_CH_ALERT:       return FRAME_TYPE_ALERT;
+        case NOTIFY_CH_LED:         return FRAME_TYPE_LED;
+        case NOTIFY_CH_WRITE_ACK:   return FRAME_TYPE_WRITE_ACK;
+        default:                    return FRAME_TYPE_MAX;
+    }
+}
+
+const char *notify_policy_str(notify_policy_t policy)
+{
+    switch (policy) {
+        case NOTIFY_POLICY_OFF:         return "off";
+        case NOTIFY_POLICY_LATEST:      return "latest";
+        case NOTIFY_POLICY_QUEUE:       return "queue";
+        case NOTIFY_POLICY_IMMEDIATE:   return "immediate";
+        default:                        return "?";
+    }
+}
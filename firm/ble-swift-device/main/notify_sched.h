@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Event notification scheduler (one per connection)
+//
+// Beside the data stream the notify timer paces, the device notifies events
+// on the same characteristic: one 10-byte frame each, of its channel's frame
+// type (see frame.h), with the channel's own sequence and the time it was
+// published. Every channel has a policy:
+//
+//   LATEST     one frame pending at most, the newest; the older are coalesced
+//   QUEUE      every frame, in order, up to NOTIFY_SCHED_QUEUE_LEN pending
+//   IMMEDIATE  as LATEST, but the publisher sends it at once instead of at
+//              the next tick
+//
+// Pending frames go out at the next tick, packed back to back into as few
+// notifications as the MTU allows, channels in enum order; an IMMEDIATE frame
+// the window had no room for goes as soon as a notification is confirmed.
+// Frames leave the scheduler only once the stack took the notification
+// (notify_sched_commit), so a refused send is tried again instead of lost.
+//
+// Not thread safe: the caller holds the lock of the connection state.
+#define NOTIFY_SCHED_QUEUE_LEN 16 // frames pending per channel
+
+typedef enum {
+    NOTIFY_POLICY_OFF = 0,  // not published
+    NOTIFY_POLICY_LATEST,
+    NOTIFY_POLICY_QUEUE,
+    NOTIFY_POLICY_IMMEDIATE,
+    NOTIFY_POLICY_MAX,
+} notify_policy_t;
+
+typedef enum {
+    NOTIFY_CH_ALERT = 0,    // u8 alert, u8 argument ( notify_alert_t )
+    NOTIFY_CH_LED,          // u16 LED duty after a write was applied
+    NOTIFY_CH_WRITE_ACK,    // u16 sequence of an applied write frame
+    NOTIFY_CH_COUNT,
+} notify_channel_t;
+
+typedef enum {
+    NOTIFY_ALERT_BLOB_COMPLETE = 0x01,  // argument: 0
+    NOTIFY_ALERT_BLOB_REJECTED = 0x02,  // argument: blob_rx_status_t
+} notify_alert_t;
+
+typedef struct {
+    uint16_t seq;
+    uint16_t value;
+    uint32_t timestamp_ms;
+} notify_event_t;
+
+typedef struct {
+    notify_event_t events[NOTIFY_SCHED_QUEUE_LEN];
+    uint8_t head;           // oldest pending
+    uint8_t count;
+    uint16_t seq;           // of the next frame published
+} notify_sched_channel_t;
+
+typedef struct {
+    notify_sched_channel_t ch[NOTIFY_CH_COUNT];
+    uint16_t pending;       // frames, all channels
+    uint8_t urgent;         // bit per channel with an IMMEDIATE frame pending
+
+    uint32_t published;
+    uint32_t coalesced;     // replaced by a newer frame before it was sent
+    uint32_t dropped;       // QUEUE full
+    uint32_t sent;          // frames in notifications the stack took
+} notify_sched_t;
+
+void notify_sched_init(notify_sched_t *sched);
+
+// Publishes value on a channel under policy; true when it is to be sent now
+// (NOTIFY_POLICY_IMMEDIATE). Every frame takes the next sequence of the
+// channel, also the ones coalesced or dropped, so the client sees the gap.
+bool notify_sched_publish(notify_sched_t *sched, notify_channel_t ch, notify_policy_t policy
+    , uint16_t value, uint32_t timestamp_ms);
+
+static inline bool notify_sched_pending(const notify_sched_t *sched)
+{
+    return sched->pending > 0;
+}
+
+// An IMMEDIATE frame is pending: not to wait for the tick.
+static inline bool notify_sched_urgent(const notify_sched_t *sched)
+{
+    return sched->urgent != 0;
+}
+
+// Encodes as many pending frames as fit into cap bytes, oldest first in
+// channel order, and returns their length; nothing is removed yet.
+uint16_t notify_sched_pack(const notify_sched_t *sched, uint8_t *buf, uint16_t cap);
+
+// Removes the frames of a pack of len bytes the stack accepted.
+void notify_sched_commit(notify_sched_t *sched, uint16_t len);
+
+// Drops what a channel has pending ( its policy went OFF ).
+void notify_sched_clear(notify_sched_t *sched, notify_channel_t ch);
+
+// FRAME_TYPE_* of a channel's frames.
+uint8_t notify_sched_frame_type(notify_channel_t ch);
+
+const char *notify_policy_str(notify_policy_t policy);
@@ -0,0 +1,118 @@
+#include <stddef.h>
+
+#include "sample_buf.h"
+
+enum {
+    SAMPLE_BLOCK_FREE = 0,
+    SAMPLE_BLOCK_FILLING,
+    SAMPLE_BLOCK_READY,
+    SAMPLE_BLOCK_READING,
+};
+
+static bool block_claim(sample_buf_t *buf, int i, uint8_t from, uint8_t to)
+{
+    uint8_t expected = from;
+    return atomic_compare_exchange_strong_explicit(&buf->state[i], &expected, to,
+        memory_order_acquire, memory_order_relaxed);
+}
+
+static void block_set(sample_buf_t *buf, int i, uint8_t to)
+{
+    atomic_store_explicit(&buf->state[i], to, memory_order_release);
+}
+
+static int block_index(const sample_buf_t *buf, const sample_block_t *block)
+{
+    return (int)(block - buf->blocks);
+}
+
+static void counter_add(_Atomic uint32_t *counter, uint32_t n)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Index of the oldest READY block, -1 when there is none. A READY
+// block does not change under its owner, so reading seq before the claim is safe.
+static int oldest_ready(sample_buf_t *buf)
+{
+    int found = -1;
+    for (int i = 0; i < SAMPLE_BUF_BLOCKS; i++) {
+        if (atomic_load_explicit(&buf->state[i], memory_order_acquire) != SAMPLE_BLOCK_READY) {
+            continue;
+        }
+        if (found < 0 || (int32_t)(buf->blocks[i].seq - buf->blocks[found].seq) < 0) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+bool sample_buf_init(sample_buf_t *buf, uint16_t *storage, uint16_t cap)
+{
+    if (buf == NULL || storage == NULL || cap == 0) {
+        return false;
+    }
+    for (int i = 0; i < SAMPLE_BUF_BLOCKS; i++) {
+        buf->blocks[i] = (sample_block_t){ .samples = storage + (uint32_t)i * cap };
+        atomic_init(&buf->state[i], SAMPLE_BLOCK_FREE);
+    }
+    buf->cap = cap;
+    buf->next_seq = 0;
+    atomic_init(&buf->produced, 0);
+    atomic_init(&buf->overwritten, 0);
+    atomic_init(&buf->consumed, 0);
+    return true;
+}
+
+sample_block_t *sample_buf_write_begin(sample_buf_t *buf, uint16_t *dropped)
+{
+    *dropped = 0;
+    for (int i = 0; i < SAMPLE_BUF_BLOCKS; i++) {
+        if (block_claim(buf, i, SAMPLE_BLOCK_FREE, SAMPLE_BLOCK_FILLING)) {
+            buf->blocks[i].count = 0;
+            return &buf->blocks[i];
+        }
+    }
+    // all taken: reclaim unread data, unless the consumer gets to it first
+    int i = oldest_ready(buf);
+    if (i < 0 || !block_claim(buf, i, SAMPLE_BLOCK_READY, SAMPLE_BLOCK_FILLING)) {
+        return NULL;
+    }
+    *dropped = buf->blocks[i].count;
+    counter_add(&buf->overwritten, *dropped);
+    buf->blocks[i].count = 0;
+    return &buf->blocks[i];
+}
+
+void sample_buf_write_end(sample_buf_t *buf, sample_block_t *block)
+{
+    int i = block_index(buf, block);
+    if (block->count == 0) {
+        block_set(buf, i, SAMPLE_BLOCK_FREE);
+        return;
+    }
+    block->seq = buf->next_seq;
+    buf->next_seq += block->count;
+    counter_add(&buf->produced, block->count);
+    block_set(buf, i, SAMPLE_BLOCK_READY);
+}
+
+const sample_block_t *sample_buf_read_begin(sample_buf_t *buf)
+{
+    // the producer may take the block back between the look and the claim
+    for (;;) {
+        int i = oldest_ready(buf);
+        if (i < 0) {
+            return NULL;
+        }
+        if (block_claim(buf, i, SAMPLE_BLOCK_READY, SAMPLE_BLOCK_READING)) {
+            counter_add(&buf->consumed, 1);
+            return &buf->blocks[i];
+        }
+    }
+}
+
+void sample_buf_read_end(sample_buf_t *buf, const sample_block_t *block)
+{
+    block_set(buf, block_index(buf, block), SAMPLE_BLOCK_FREE);
+}
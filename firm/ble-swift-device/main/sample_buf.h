@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Triple-buffered sample blocks
+//
+// One context (the sample producer) fills a block while another (the notify
+// path) reads one in place: a block changes hands, it is never copied. The
+// third block lets the producer hand over twice between two reads, so a
+// consumer running at the block period absorbs timer phase drift without
+// losing a block. Each block's state is an atomic, and every hand-over is a single
+// compare-and-swap, so neither side takes a lock.
+//
+//   FREE -> FILLING -> READY -> READING -> FREE
+//   producer:  write_begin / write_end     consumer:  read_begin / read_end
+//
+// When the consumer falls behind, the producer takes back the oldest block
+// it has not started reading: the newest samples win and the lost ones are
+// reported to the producer.
+#define SAMPLE_BUF_BLOCKS 3
+
+typedef struct {
+    uint16_t *samples;
+    uint16_t count;
+    uint32_t period_us;     // time between samples
+    uint32_t seq;           // running number of samples[0] (wraps at 2^32)
+    int64_t t0_us;          // sample time of samples[0]
+} sample_block_t;
+
+typedef struct {
+    sample_block_t blocks[SAMPLE_BUF_BLOCKS];
+    _Atomic uint8_t state[SAMPLE_BUF_BLOCKS];
+    uint16_t cap;           // samples per block
+
+    // producer side
+    uint32_t next_seq;
+    _Atomic uint32_t produced;  // samples published
+    _Atomic uint32_t overwritten; // published samples taken back unread
+    // consumer side
+    _Atomic uint32_t consumed;  // blocks read
+} sample_buf_t;
+
+// storage must hold SAMPLE_BUF_BLOCKS * cap samples.
+bool sample_buf_init(sample_buf_t *buf, uint16_t *storage, uint16_t cap);
+
+// Producer: a block to fill, up to buf->cap samples; NULL when the consumer
+// holds every other block. *dropped is set to the samples of an unread block taken back.
+sample_block_t *sample_buf_write_begin(sample_buf_t *buf, uint16_t *dropped);
+
+// Producer: publishes block->count samples; an empty block goes back unpublished.
+void sample_buf_write_end(sample_buf_t *buf, sample_block_t *block);
+
+// Consumer: the oldest published block, or NULL. It stays valid until
+// sample_buf_read_end, so a consumer may hold two blocks while it moves on.
+const sample_block_t *sample_buf_read_begin(sample_buf_t *buf);
+
+// Consumer: hands a block back to the producer.
+void sample_buf_read_end(sample_buf_t *buf, const sample_block_t *block);
@@ -0,0 +1,203 @@
+#include <stddef.h>
+
+#include "sample_codec.h"
+
+static inline uint16_t zigzag(uint16_t prev, uint16_t sample)
+{
+    int16_t delta = (int16_t)(uint16_t)(sample - prev);
+    return (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+}
+
+static inline uint16_t unzigzag(uint16_t prev, uint16_t z)
+{
+    uint16_t delta = (uint16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+    return (uint16_t)(prev + delta);
+}
+
+static inline uint8_t varint_len(uint16_t z)
+{
+    return z < 0x80 ? 1 : z < 0x4000 ? 2 : 3;
+}
+
+static inline uint8_t bit_width(uint16_t z)
+{
+    return z == 0 ? 0 : (uint8_t)(32 - __builtin_clz(z));
+}
+
+//-----------------------------------------------------------------------------
+// Varint
+static uint16_t varint_encode(uint16_t prev, const uint16_t *samples, uint16_t n, uint8_t *out, uint16_t cap, uint16_t *count)
+{
+    uint16_t len = 0;
+    uint16_t i = 0;
+    for (; i < n; i++) {
+        uint16_t z = zigzag(prev, samples[i]);
+        if (len + varint_len(z) > cap) {
+            break;
+        }
+        while (z >= 0x80) {
+            out[len++] = (uint8_t)(z | 0x80);
+            z >>= 7;
+        }
+        out[len++] = (uint8_t)z;
+        prev = samples[i];
+    }
+    *count = i;
+    return len;
+}
+
+static uint16_t varint_decode(uint16_t prev, const uint8_t *in, uint16_t len, uint16_t *samples, uint16_t count)
+{
+    uint16_t pos = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t z = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= len || shift > 14) {
+                return 0;
+            }
+            uint8_t b = in[pos++];
+            z |= (uint32_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                break;
+            }
+        }
+        if (z > UINT16_MAX) {
+            return 0;
+        }
+        prev = unzigzag(prev, (uint16_t)z);
+        samples[i] = prev;
+    }
+    return pos;
+}
+
+//-----------------------------------------------------------------------------
+// Bit packing
+static uint16_t bitpack_encode(uint16_t prev, const uint16_t *samples, uint16_t n, uint8_t *out, uint16_t cap, uint16_t *count)
+{
+    *count = 0;
+    if (cap < 1) {
+        return 0;
+    }
+    // the longest prefix that fits at the width its widest delta needs
+    uint8_t width = 0;
+    uint16_t fit = 0;
+    uint16_t p = prev;
+    for (uint16_t i = 0; i < n; i++) {
+        uint8_t w = bit_width(zigzag(p, samples[i]));
+        if (w < width) {
+            w = width;
+        }
+        if (1 + ((uint32_t)(i + 1) * w + 7) / 8 > cap) {
+            break;
+        }
+        width = w;
+        fit = i + 1;
+        p = samples[i];
+    }
+
+    out[0] = width;
+    uint16_t len = 1;
+    uint32_t acc = 0;
+    uint8_t bits = 0;
+    for (uint16_t i = 0; i < fit; i++) {
+        acc |= (uint32_t)zigzag(prev, samples[i]) << bits;
+        bits += width;
+        while (bits >= 8) {
+            out[len++] = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+        prev = samples[i];
+    }
+    if (bits > 0) {
+        out[len++] = (uint8_t)acc;
+    }
+    *count = fit;
+    return len;
+}
+
+static uint16_t bitpack_decode(uint16_t prev, const uint8_t *in, uint16_t len, uint16_t *samples, uint16_t count)
+{
+    if (len < 1 || in[0] > 16) {
+        return 0;
+    }
+    uint8_t width = in[0];
+    uint32_t need = 1 + ((uint32_t)count * width + 7) / 8;
+    if (need > len) {
+        return 0;
+    }
+    uint16_t pos = 1;
+    uint32_t acc = 0;
+    uint8_t bits = 0;
+    uint32_t mask = (1u << width) - 1;
+    for (uint16_t i = 0; i < count; i++) {
+        while (bits < width) {
+            acc |= (uint32_t)in[pos++] << bits;
+            bits += 8;
+        }
+        prev = unzigzag(prev, (uint16_t)(acc & mask));
+        acc >>= width;
+        bits -= width;
+        samples[i] = prev;
+    }
+    return (uint16_t)need;
+}
+
+uint16_t sample_codec_encode(sample_codec_t codec, uint16_t prev, const uint16_t *samples, uint16_t n,
+                             uint8_t *out, uint16_t cap, uint16_t *count)
+{
+    switch (codec) {
+        case SAMPLE_CODEC_VARINT:
+            return varint_encode(prev, samples, n, out, cap, count);
+        case SAMPLE_CODEC_BITPACK:
+            return bitpack_encode(prev, samples, n, out, cap, count);
+        default:
+            *count = 0;
+            return 0;
+    }
+}
+
+uint16_t sample_codec_decode(sample_codec_t codec, uint16_t prev, const uint8_t *in, uint16_t len,
+                             uint16_t *samples, uint16_t count)
+{
+    if (in == NULL || count == 0) {
+        return 0;
+    }
+    switch (codec) {
+        case SAMPLE_CODEC_VARINT:
+            return varint_decode(prev, in, len, samples, count);
+        case SAMPLE_CODEC_BITPACK:
+            return bitpack_decode(prev, in, len, samples, count);
+        default:
+            return 0;
+    }
+}
+
+const char *sample_codec_str(sample_codec_t codec)
+{
+    switch (codec) {
+        case SAMPLE_CODEC_NONE:     return "none";
+        case SAMPLE_CODEC_VARINT:   return "delta varint";
+        case SAMPLE_CODEC_BITPACK:  return "delta bitpack";
+        default:                    return "?";
+    }
+}
+
+void sample_run_encode_header(const sample_run_t *run, uint8_t *buf)
+{
+    buf[0] = run->codec;
+    buf[1] = run->count;
+    buf[2] = (uint8_t)run->period_us;
+    buf[3] = (uint8_t)(run->period_us >> 8);
+}
+
+bool sample_run_decode_header(const uint8_t *buf, uint16_t len, sample_run_t *run)
+{
+    if (len < SAMPLE_RUN_HEADER_LEN || buf[0] == SAMPLE_CODEC_NONE || buf[0] >= SAMPLE_CODEC_MAX) {
+        return false;
+    }
+    run->codec = buf[0];
+    run->count = buf[1];
+    run->period_us = (uint16_t)(buf[2] | (buf[3] << 8));
+    return true;
+}
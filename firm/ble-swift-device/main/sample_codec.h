@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Sample codec
+//
+// Sends a run of 16-bit samples as deltas from the sample before: a slowly
+// changing signal has small deltas, a byte or a few bits each instead of a
+// 10-byte frame per sample. Deltas wrap at 16 bits and are zigzag mapped
+// (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), so every delta fits in 16 bits.
+//
+//   SAMPLE_CODEC_VARINT   each zigzag delta as LEB128: 7 bits per byte, low
+//                         bits first, high bit set on all but the last byte
+//   SAMPLE_CODEC_BITPACK  u8 width w (0..16), then every zigzag delta in w
+//                         bits, LSB first; the last byte is zero padded
+typedef enum {
+    SAMPLE_CODEC_NONE = 0,          // one sample per 10-byte frame
+    SAMPLE_CODEC_VARINT,
+    SAMPLE_CODEC_BITPACK,
+    SAMPLE_CODEC_MAX,
+} sample_codec_t;
+
+// Encodes samples[0..n), the first as a delta from prev, into at most cap
+// bytes. *count gets how many of the samples fit; returns the bytes written.
+uint16_t sample_codec_encode(sample_codec_t codec, uint16_t prev, const uint16_t *samples, uint16_t n,
+                             uint8_t *out, uint16_t cap, uint16_t *count);
+
+// Decodes count samples encoded from prev; returns the bytes read, 0 when in
+// is too short or malformed (or count is 0).
+uint16_t sample_codec_decode(sample_codec_t codec, uint16_t prev, const uint8_t *in, uint16_t len,
+                             uint16_t *samples, uint16_t count);
+
+const char *sample_codec_str(sample_codec_t codec);
+
+//-----------------------------------------------------------------------------
+// Sample run notification ( frame type FRAME_TYPE_SAMPLE_RUN, see frame.h )
+//
+//   [0..9]   frame: seq and time of the first sample, the sample as payload
+//   [10]     u8  codec (SAMPLE_CODEC_VARINT or SAMPLE_CODEC_BITPACK)
+//   [11]     u8  samples that follow, delta coded from the first
+//   [12..13] u16 sample period in us, little endian
+//   [14..]   the codec's bytes
+//
+// Sample i of the run (0: the frame's) has sequence seq + i and time
+// timestamp + i * period; the next run continues the sequence.
+#define SAMPLE_RUN_HEADER_LEN   4
+#define SAMPLE_RUN_COUNT_MAX    255
+
+typedef struct {
+    uint8_t codec;
+    uint8_t count;
+    uint16_t period_us;
+} sample_run_t;
+
+void sample_run_encode_header(const sample_run_t *run, uint8_t *buf);
+
+// false for short buffers and unknown codecs.
+bool sample_run_decode_header(const uint8_t *buf, uint16_t len, sample_run_t *run);
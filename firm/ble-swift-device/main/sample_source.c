@@ -0,0 +1,127 @@
+#include <stddef.h>
+
+#include "sample_source.h"
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Claims the samples due by now_us, up to cap; returns how many and the time
+// of the first. A backlog beyond SAMPLE_SOURCE_BACKLOG reads is skipped.
+static uint16_t take_due(sample_source_t *src, uint16_t cap, int64_t now_us, int64_t *first_us)
+{
+    if (now_us < src->next_us || cap == 0) {
+        return 0;
+    }
+    uint64_t due = (uint64_t)(now_us - src->next_us) / src->period_us + 1;
+    uint64_t keep = (uint64_t)cap * SAMPLE_SOURCE_BACKLOG;
+    if (due > keep) {
+        uint64_t lost = due - keep;
+        src->next_us += (int64_t)(lost * src->period_us);
+        src->pos += (uint32_t)lost;
+        src->dropped += (uint32_t)lost;
+        due = keep;
+    }
+    uint16_t n = due < cap ? (uint16_t)due : cap;
+    *first_us = src->next_us;
+    src->next_us += (int64_t)n * src->period_us;
+    return n;
+}
+
+static uint32_t period_us(uint32_t rate_hz)
+{
+    uint32_t period = rate_hz > 0 ? 1000000u / rate_hz : 0;
+    return period > 0 ? period : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Synthetic
+static uint16_t synthetic_read(sample_source_t *src, uint16_t *out, uint16_t cap, int64_t now_us, int64_t *first_us)
+{
+    uint16_t n = take_due(src, cap, now_us, first_us);
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = (uint16_t)((src->pos + i) & SAMPLE_SYNTH_MASK);
+    }
+    src->pos += n;
+    return n;
+}
+
+void sample_source_synthetic_init(sample_source_t *src, uint32_t rate_hz, int64_t now_us)
+{
+    *src = (sample_source_t){
+        .name = "synthetic",
+        .read = synthetic_read,
+        .period_us = period_us(rate_hz),
+    };
+    src->next_us = now_us + src->period_us;
+}
+
+//-----------------------------------------------------------------------------
+// Replay
+static uint16_t replay_read(sample_source_t *src, uint16_t *out, uint16_t cap, int64_t now_us, int64_t *first_us)
+{
+    uint16_t n = take_due(src, cap, now_us, first_us);
+    if (src->data_len == 0) {
+        // silence: the due samples are gone, as for a muted input
+        src->pos = 0;
+        return 0;
+    }
+    uint32_t pos = src->pos % src->data_len;
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = src->data[pos];
+        if (++pos == src->data_len) {
+            pos = 0;
+        }
+    }
+    src->pos = pos;
+    return n;
+}
+
+void sample_source_replay_init(sample_source_t *src, uint32_t rate_hz, uint16_t *data, uint32_t cap, int64_t now_us)
+{
+    *src = (sample_source_t){
+        .name = "replay",
+        .read = replay_read,
+        .period_us = period_us(rate_hz),
+        .data = data,
+        .data_cap = cap,
+    };
+    src->next_us = now_us + src->period_us;
+}
+
+int32_t sample_replay_count(const uint8_t *record, uint32_t len)
+{
+    if (record == NULL || len < SAMPLE_REPLAY_HEADER_LEN || record[0] != SAMPLE_REPLAY_RECORD_TYPE) {
+        return -1;
+    }
+    uint16_t count = get_u16(record + 2);
+    if (len < SAMPLE_REPLAY_HEADER_LEN + 2u * count) {
+        return -1;
+    }
+    return count;
+}
+
+bool sample_source_replay_load(sample_source_t *src, const uint8_t *record, uint32_t len)
+{
+    int32_t count = sample_replay_count(record, len);
+    if (count < 0 || (uint32_t)count > src->data_cap) {
+        return false;
+    }
+    // the one copy: little endian bytes from the upload into native samples
+    const uint8_t *p = record + SAMPLE_REPLAY_HEADER_LEN;
+    for (int32_t i = 0; i < count; i++) {
+        src->data[i] = get_u16(p + 2 * i);
+    }
+    src->data_len = (uint32_t)count;
+    src->pos = 0;
+    return true;
+}
+
+void sample_replay_encode_header(uint16_t count, uint8_t *buf)
+{
+    buf[0] = SAMPLE_REPLAY_RECORD_TYPE;
+    buf[1] = 0;
+    buf[2] = (uint8_t)count;
+    buf[3] = (uint8_t)(count >> 8);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Sample sources
+//
+// A source produces 16-bit samples at a fixed rate; the sample producer reads
+// what is due straight into a block of sample_buf.h. The synthetic and replay
+// sources are plain code and run anywhere, the host benches included; the
+// ADC source (sample_source_adc.c) needs ESP-IDF.
+//
+//   synthetic  12-bit sawtooth, one step per sample: sample n is n & 0xFFF
+//   replay     loops over a buffer of recorded samples (see the record below)
+//   ADC        one channel in ADC continuous mode, filled by DMA
+//
+// Synthetic and replay samples are due by the clock: whatever a read leaves
+// behind is read next time, and a backlog of more than SAMPLE_SOURCE_BACKLOG
+// reads is dropped, oldest first.
+#define SAMPLE_SYNTH_MASK       0x0FFF
+#define SAMPLE_SOURCE_BACKLOG   2
+
+typedef struct sample_source sample_source_t;
+
+// Writes up to cap of the samples due by now_us into out, oldest first, and
+// the time of the first one into *first_us; returns how many.
+typedef uint16_t (*sample_source_read_fn)(sample_source_t *src, uint16_t *out, uint16_t cap,
+                                          int64_t now_us, int64_t *first_us);
+
+struct sample_source {
+    const char *name;
+    sample_source_read_fn read;
+    uint32_t period_us;     // time between samples
+
+    int64_t next_us;        // time of the next sample due
+    uint32_t pos;           // synthetic: next sample number; replay: next index
+    uint16_t *data;         // replay buffer
+    uint32_t data_cap;
+    uint32_t data_len;
+    void *driver;           // ADC continuous handle
+    uint32_t dropped;       // samples lost to the backlog limit or a full DMA pool
+};
+
+// Samples start one period after now_us.
+void sample_source_synthetic_init(sample_source_t *src, uint32_t rate_hz, int64_t now_us);
+
+// data holds up to cap samples and starts empty: the source is silent until
+// sample_source_replay_load.
+void sample_source_replay_init(sample_source_t *src, uint32_t rate_hz, uint16_t *data, uint32_t cap, int64_t now_us);
+
+// ESP-IDF only: starts ADC continuous conversion on one ADC1 channel, with a
+// DMA frame of frame_len samples. false when the driver refused.
+bool sample_source_adc_init(sample_source_t *src, uint32_t rate_hz, int channel, uint16_t frame_len);
+
+static inline uint16_t sample_source_read(sample_source_t *src, uint16_t *out, uint16_t cap,
+                                          int64_t now_us, int64_t *first_us)
+{
+    return src->read(src, out, cap, now_us, first_us);
+}
+
+//-----------------------------------------------------------------------------
+// Replay record ( uploaded as a blob, see blob_rx.h )
+//
+//   [0]    u8  SAMPLE_REPLAY_RECORD_TYPE
+//   [1]    u8  reserved, 0
+//   [2..3] u16 sample count, little endian (0: silence)
+//   [4..]  samples, u16 little endian each
+#define SAMPLE_REPLAY_RECORD_TYPE   0x02
+#define SAMPLE_REPLAY_HEADER_LEN    4
+
+// Sample count of a record, once its header and length check out; -1 otherwise.
+int32_t sample_replay_count(const uint8_t *record, uint32_t len);
+
+// Replaces the replay buffer with the record's samples and restarts from the
+// first; false (buffer untouched) when the record is malformed or too long.
+bool sample_source_replay_load(sample_source_t *src, const uint8_t *record, uint32_t len);
+
+// Writes a record header; count little-endian samples follow.
+void sample_replay_encode_header(uint16_t count, uint8_t *buf);
@@ -0,0 +1,139 @@
+// ADC continuous-mode sample source ( ESP-IDF only; see sample_source.h )
+//
+// The ADC's DMA fills the driver's pool in frames of frame_len conversions
+// while the CPU does nothing. A read takes what the pool holds, without
+// waiting, and unpacks each conversion's data bits into the caller's block:
+// the raw results carry the channel next to the data, so this is the one
+// pass over the samples before they go out in notifications.
+#include "sdkconfig.h"
+
+#if CONFIG_SWIFT_SAMPLE_SOURCE_ADC
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_adc/adc_continuous.h"
+
+#include "sample_source.h"
+
+#define ADC_TAG "SAMPLE_ADC"
+#define ADC_POOL_FRAMES 4 // DMA frames the driver buffers between reads
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_DATA(p) ((p)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_DATA(p) ((p)->type2.data)
+#endif
+
+typedef struct {
+    adc_continuous_handle_t handle;
+    uint8_t *raw;           // one DMA frame of results
+    uint32_t raw_len;
+    uint16_t frame_len;
+    volatile uint32_t pool_overflows;
+} adc_source_t;
+
+static adc_source_t s_adc;
+
+static bool IRAM_ATTR adc_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    adc_source_t *adc = user_data;
+    adc->pool_overflows++;
+    return false;
+}
+
+static uint16_t adc_read(sample_source_t *src, uint16_t *out, uint16_t cap, int64_t now_us, int64_t *first_us)
+{
+    adc_source_t *adc = src->driver;
+    uint32_t want = (uint32_t)cap * SOC_ADC_DIGI_RESULT_BYTES;
+    if (want > adc->raw_len) {
+        want = adc->raw_len;
+    }
+    uint32_t got = 0;
+    if (adc_continuous_read(adc->handle, adc->raw, want, &got, 0) != ESP_OK) {
+        got = 0; // ESP_ERR_TIMEOUT: nothing converted since the last read
+    }
+
+    uint16_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&adc->raw[i];
+        out[n++] = (uint16_t)ADC_GET_DATA(p);
+    }
+    // a full pool discards whole frames
+    uint32_t overflows = adc->pool_overflows;
+    adc->pool_overflows = 0;
+    src->dropped += overflows * adc->frame_len;
+
+    // the newest conversion finished about now
+    *first_us = now_us - (int64_t)n * src->period_us;
+    return n;
+}
+
+bool sample_source_adc_init(sample_source_t *src, uint32_t rate_hz, int channel, uint16_t frame_len)
+{
+    *src = (sample_source_t){
+        .name = "adc",
+        .read = adc_read,
+        .period_us = rate_hz > 0 ? 1000000u / rate_hz : 1,
+        .driver = &s_adc,
+    };
+    // ADC1 has 10 channels on the S3, 8 on the ESP32 and fewer on the C-series
+    if (channel < 0 || channel >= SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)) {
+        ESP_LOGE(ADC_TAG, "No ADC1 channel %d on this target ( %d channels )", channel, SOC_ADC_CHANNEL_NUM(ADC_UNIT_1));
+        return false;
+    }
+    s_adc.frame_len = frame_len;
+    s_adc.raw_len = (uint32_t)frame_len * SOC_ADC_DIGI_RESULT_BYTES;
+    s_adc.raw = malloc(s_adc.raw_len);
+    if (s_adc.raw == NULL) {
+        return false;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = s_adc.raw_len * ADC_POOL_FRAMES,
+        .conv_frame_size = s_adc.raw_len,
+    };
+    esp_err_t ret = adc_continuous_new_handle(&handle_cfg, &s_adc.handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(ADC_TAG, "New handle failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = (uint8_t)channel,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = rate_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_OUTPUT_TYPE,
+    };
+    ret = adc_continuous_config(s_adc.handle, &dig_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(ADC_TAG, "Config failed ( %" PRIu32 " Hz, channel %d ): %s", rate_hz, channel, esp_err_to_name(ret));
+        return false;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_pool_ovf = adc_pool_ovf,
+    };
+    ret = adc_continuous_register_event_callbacks(s_adc.handle, &cbs, &s_adc);
+    if (ret == ESP_OK) {
+        ret = adc_continuous_start(s_adc.handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(ADC_TAG, "Start failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+#endif // CONFIG_SWIFT_SAMPLE_SOURCE_ADC
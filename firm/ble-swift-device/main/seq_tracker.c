@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include "seq_tracker.h"
+
+void seq_tracker_init(seq_tracker_t *tracker)
+{
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+static void restart(seq_tracker_t *tracker, uint16_t seq)
+{
+    tracker->started = true;
+    tracker->highest = seq;
+    tracker->window = 1;
+    tracker->has_transit = false;
+}
+
+static void update_jitter(seq_tracker_t *tracker, uint32_t timestamp_ms, uint32_t now_ms)
+{
+    if (timestamp_ms == 0) {
+        return;
+    }
+    // the clocks are unrelated; only changes in transit time count
+    int32_t transit = (int32_t)(now_ms - timestamp_ms);
+    if (tracker->has_transit) {
+        int32_t d = transit - tracker->last_transit_ms;
+        uint32_t abs_d = (uint32_t)(d < 0 ? -d : d);
+        // J += (|D| - J) / 16, kept scaled by 16
+        tracker->jitter_x16_ms = tracker->jitter_x16_ms + abs_d - (tracker->jitter_x16_ms + 8) / 16;
+    }
+    tracker->last_transit_ms = transit;
+    tracker->has_transit = true;
+}
+
+seq_result_t seq_tracker_on_frame(seq_tracker_t *tracker, uint16_t seq, uint32_t timestamp_ms, uint32_t now_ms)
+{
+    if (!tracker->started) {
+        restart(tracker, seq);
+        tracker->received++;
+        update_jitter(tracker, timestamp_ms, now_ms);
+        return SEQ_NEW;
+    }
+
+    int16_t delta = (int16_t)(uint16_t)(seq - tracker->highest);
+    if (delta > SEQ_TRACKER_RESYNC || delta < -SEQ_TRACKER_RESYNC) {
+        restart(tracker, seq);
+        tracker->received++;
+        tracker->resyncs++;
+        update_jitter(tracker, timestamp_ms, now_ms);
+        return SEQ_RESYNC;
+    }
+
+    if (delta > 0) {
+        tracker->window = delta >= SEQ_TRACKER_WINDOW ? 1 : (tracker->window << delta) | 1;
+        tracker->highest = seq;
+        tracker->gaps += (uint32_t)(delta - 1);
+        tracker->received++;
+        update_jitter(tracker, timestamp_ms, now_ms);
+        return SEQ_NEW;
+    }
+
+    uint32_t age = (uint32_t)(-delta);
+    if (age >= SEQ_TRACKER_WINDOW) {
+        tracker->stale++;
+        return SEQ_STALE;
+    }
+    uint64_t bit = (uint64_t)1 << age;
+    if (tracker->window & bit) {
+        tracker->duplicates++;
+        return SEQ_DUPLICATE;
+    }
+    // arrived after a later frame: fills a counted gap
+    tracker->window |= bit;
+    tracker->reordered++;
+    tracker->received++;
+    return SEQ_LATE;
+}
+
+uint32_t seq_tracker_loss_permille(const seq_tracker_t *tracker)
+{
+    uint32_t lost = seq_tracker_lost(tracker);
+    uint64_t total = (uint64_t)tracker->received + lost;
+    if (total == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)lost * 1000 / total);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Received-sequence tracking for a 16-bit wrapping frame sequence
+//
+// Remembers which of the last SEQ_TRACKER_WINDOW sequences arrived, so a
+// frame is classified as new, a duplicate, or a late (reordered) arrival
+// that fills an earlier gap. Every counter only grows; frames still missing
+// are gaps - reordered (seq_tracker_lost). A jump of more than SEQ_TRACKER_RESYNC
+// either way is taken as the sender restarting, not as loss.
+//
+// Jitter is the RFC 3550 interarrival estimate over the sender timestamps
+// (ms), when the sender provides them.
+#define SEQ_TRACKER_WINDOW  64
+#define SEQ_TRACKER_RESYNC  1024
+
+typedef enum {
+    SEQ_NEW = 0,        // highest sequence so far
+    SEQ_LATE,           // filled an earlier gap
+    SEQ_DUPLICATE,
+    SEQ_STALE,          // older than the window; counted, not classified
+    SEQ_RESYNC,         // sender restart; tracking starts over here
+} seq_result_t;
+
+typedef struct {
+    bool started;
+    uint16_t highest;
+    uint64_t window;        // bit i: highest - i arrived
+
+    uint32_t received;      // distinct frames
+    uint32_t gaps;          // sequences skipped when a later one arrived
+    uint32_t duplicates;
+    uint32_t reordered;
+    uint32_t stale;
+    uint32_t resyncs;
+
+    bool has_transit;
+    int32_t last_transit_ms;
+    uint32_t jitter_x16_ms; // jitter estimate, scaled by 16
+} seq_tracker_t;
+
+void seq_tracker_init(seq_tracker_t *tracker);
+
+// timestamp_ms 0: the sender did not stamp the frame.
+seq_result_t seq_tracker_on_frame(seq_tracker_t *tracker, uint16_t seq, uint32_t timestamp_ms, uint32_t now_ms);
+
+static inline uint32_t seq_tracker_lost(const seq_tracker_t *tracker)
+{
+    return tracker->gaps > tracker->reordered ? tracker->gaps - tracker->reordered : 0;
+}
+
+// lost / (received + lost), in 1/1000.
+uint32_t seq_tracker_loss_permille(const seq_tracker_t *tracker);
+
+static inline uint32_t seq_tracker_jitter_ms(const seq_tracker_t *tracker)
+{
+    return tracker->jitter_x16_ms / 16;
+}
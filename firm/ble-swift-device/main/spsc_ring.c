@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "spsc_ring.h"
+
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t item_size, uint32_t capacity)
+{
+    if (ring == NULL || storage == NULL || item_size == 0
+        || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    ring->storage = storage;
+    ring->item_size = item_size;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->pushed, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->high_water, 0);
+    atomic_init(&ring->popped, 0);
+    return true;
+}
+
+bool spsc_ring_push(spsc_ring_t *ring, const void *item)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+    if (used > ring->mask) {
+        atomic_store_explicit(&ring->dropped,
+            atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+        return false;
+    }
+
+    memcpy(ring->storage + (head & ring->mask) * ring->item_size, item, ring->item_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    atomic_store_explicit(&ring->pushed,
+        atomic_load_explicit(&ring->pushed, memory_order_relaxed) + 1, memory_order_relaxed);
+    if (used + 1 > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, used + 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+bool spsc_ring_pop(spsc_ring_t *ring, void *item)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    memcpy(item, ring->storage + (tail & ring->mask) * ring->item_size, ring->item_size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    atomic_store_explicit(&ring->popped,
+        atomic_load_explicit(&ring->popped, memory_order_relaxed) + 1, memory_order_relaxed);
+    return true;
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t spsc_ring_capacity(const spsc_ring_t *ring)
+{
+    return ring->mask + 1;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Lock-free single-producer / single-consumer ring of fixed-size items
+//
+// One context (e.g. the GATTS callback) pushes, one context (e.g. the write
+// consumer) pops; neither takes a lock. head is written only by the producer
+// and tail only by the consumer, published with release/acquire ordering.
+// Capacity must be a power of two.
+typedef struct {
+    uint8_t *storage;
+    uint32_t item_size;
+    uint32_t mask;              // capacity - 1
+
+    _Atomic uint32_t head;      // next slot to write (producer)
+    _Atomic uint32_t tail;      // next slot to read (consumer)
+
+    // producer-side counters
+    _Atomic uint32_t pushed;
+    _Atomic uint32_t dropped;   // push attempts that found the ring full
+    _Atomic uint32_t high_water;
+    // consumer-side counters
+    _Atomic uint32_t popped;
+} spsc_ring_t;
+
+// storage must hold capacity * item_size bytes.
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t item_size, uint32_t capacity);
+
+// Producer: copies one item in; false (and dropped++) when full.
+bool spsc_ring_push(spsc_ring_t *ring, const void *item);
+
+// Consumer: copies the oldest item out; false when empty.
+bool spsc_ring_pop(spsc_ring_t *ring, void *item);
+
+// Items currently queued (exact from either side, approximate from elsewhere).
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+
+uint32_t spsc_ring_capacity(const spsc_ring_t *ring);
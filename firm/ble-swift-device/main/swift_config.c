@@ -0,0 +1,284 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "swift_config.h"
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t value_len(uint8_t type)
+{
+    switch (type) {
+        case SWIFT_CONFIG_NOTIFY_PERIOD: return 2;
+        case SWIFT_CONFIG_PAYLOAD_LEN:   return 2;
+        case SWIFT_CONFIG_CONN_INTERVAL: return 4;
+        case SWIFT_CONFIG_CONN_LATENCY:  return 4;
+        case SWIFT_CONFIG_PHY:           return 1;
+        case SWIFT_CONFIG_SAMPLE_CODEC:  return 1;
+        case SWIFT_CONFIG_NOTIFY_POLICY: return NOTIFY_CH_COUNT;
+        case SWIFT_CONFIG_PROFILE:       return 1;
+        case SWIFT_CONFIG_PROFILE_SAVE:  return 1;
+        case SWIFT_CONFIG_LINK_STATUS:   return 10;
+        default:                         return 0;
+    }
+}
+
+bool swift_config_validate(const swift_config_t *cfg)
+{
+    if (cfg->notify_period_ms < SWIFT_CONFIG_NOTIFY_PERIOD_MIN || cfg->notify_period_ms > SWIFT_CONFIG_NOTIFY_PERIOD_MAX) {
+        return false;
+    }
+    if (cfg->payload_len != 0
+        && (cfg->payload_len < SWIFT_CONFIG_PAYLOAD_LEN_MIN || cfg->payload_len > SWIFT_CONFIG_PAYLOAD_LEN_MAX)) {
+        return false;
+    }
+    if (cfg->conn_int_min < SWIFT_CONFIG_CONN_INTERVAL_MIN || cfg->conn_int_max > SWIFT_CONFIG_CONN_INTERVAL_MAX
+        || cfg->conn_int_min > cfg->conn_int_max) {
+        return false;
+    }
+    if (cfg->conn_latency > SWIFT_CONFIG_CONN_LATENCY_MAX
+        || cfg->conn_timeout < SWIFT_CONFIG_CONN_TIMEOUT_MIN || cfg->conn_timeout > SWIFT_CONFIG_CONN_TIMEOUT_MAX) {
+        return false;
+    }
+    // Core spec: supervision timeout > (1 + latency) * interval_max * 2
+    // (timeout in 10ms units, interval in 1.25ms units: compare in 1.25ms units)
+    if ((uint32_t)cfg->conn_timeout * 8 <= (uint32_t)(1 + cfg->conn_latency) * cfg->conn_int_max * 2) {
+        return false;
+    }
+    if (cfg->sample_codec >= SAMPLE_CODEC_MAX) {
+        return false;
+    }
+    for (int i = 0; i < NOTIFY_CH_COUNT; i++) {
+        if (cfg->notify_policy[i] >= NOTIFY_POLICY_MAX) {
+            return false;
+        }
+    }
+    if (cfg->profile >= SWIFT_PROFILE_MAX) {
+        return false;
+    }
+    return (cfg->phy_mask & ~SWIFT_CONFIG_PHY_MASK_ALL) == 0;
+}
+
+void swift_config_defaults(swift_config_t *cfg)
+{
+    cfg->notify_period_ms = 30;
+#if CONFIG_SWIFT_NOTIFY_BULK
+    cfg->payload_len = 0;
+#else
+    cfg->payload_len = 10;
+#endif
+    cfg->conn_int_min = 0x06;   // 7.5ms
+    cfg->conn_int_max = 0x0C;   // 15ms
+    cfg->conn_latency = 0;
+    cfg->conn_timeout = 400;    // 4s
+#if CONFIG_SWIFT_PREFER_2M_PHY
+    cfg->phy_mask = 0x02;       // 2M
+#else
+    cfg->phy_mask = 0;
+#endif
+    cfg->sample_codec = SAMPLE_CODEC_NONE;
+    for (int i = 0; i < NOTIFY_CH_COUNT; i++) {
+        cfg->notify_policy[i] = NOTIFY_POLICY_OFF;
+    }
+    cfg->profile = SWIFT_PROFILE_DEFAULT;
+}
+
+// SWIFT_CONFIG_CHANGED() bits of the records whose values differ.
+static uint32_t records_changed(const swift_config_t *a, const swift_config_t *b)
+{
+    uint32_t changed = 0;
+    if (a->notify_period_ms != b->notify_period_ms) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_PERIOD);
+    }
+    if (a->payload_len != b->payload_len) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PAYLOAD_LEN);
+    }
+    if (a->conn_int_min != b->conn_int_min || a->conn_int_max != b->conn_int_max) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_CONN_INTERVAL);
+    }
+    if (a->conn_latency != b->conn_latency || a->conn_timeout != b->conn_timeout) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_CONN_LATENCY);
+    }
+    if (a->phy_mask != b->phy_mask) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PHY);
+    }
+    if (a->sample_codec != b->sample_codec) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_SAMPLE_CODEC);
+    }
+    if (memcmp(a->notify_policy, b->notify_policy, sizeof(a->notify_policy)) != 0) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_POLICY);
+    }
+    if (a->profile != b->profile) {
+        changed |= SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE);
+    }
+    return changed;
+}
+
+swift_config_status_t swift_config_parse(const uint8_t *data, uint16_t len, swift_config_t *cfg, uint32_t *changed)
+{
+    swift_config_t next = *cfg;
+    uint32_t seen = 0;
+    uint16_t pos = 0;
+
+    while (pos < len) {
+        if (len - pos < 2) {
+            return SWIFT_CONFIG_ERR_TRUNCATED;
+        }
+        uint8_t type = data[pos];
+        uint8_t vlen = data[pos + 1];
+        const uint8_t *v = &data[pos + 2];
+        if (len - pos - 2 < vlen) {
+            return SWIFT_CONFIG_ERR_TRUNCATED;
+        }
+        uint8_t expected = value_len(type);
+        if (expected == 0) {
+            return SWIFT_CONFIG_ERR_UNKNOWN_TYPE;
+        }
+        if (vlen != expected) {
+            return SWIFT_CONFIG_ERR_LENGTH;
+        }
+
+        switch (type) {
+            case SWIFT_CONFIG_NOTIFY_PERIOD:
+                next.notify_period_ms = get_u16(v);
+                break;
+            case SWIFT_CONFIG_PAYLOAD_LEN:
+                next.payload_len = get_u16(v);
+                break;
+            case SWIFT_CONFIG_CONN_INTERVAL:
+                next.conn_int_min = get_u16(v);
+                next.conn_int_max = get_u16(v + 2);
+                break;
+            case SWIFT_CONFIG_CONN_LATENCY:
+                next.conn_latency = get_u16(v);
+                next.conn_timeout = get_u16(v + 2);
+                break;
+            case SWIFT_CONFIG_PHY:
+                next.phy_mask = v[0];
+                break;
+            case SWIFT_CONFIG_SAMPLE_CODEC:
+                next.sample_codec = v[0];
+                break;
+            case SWIFT_CONFIG_NOTIFY_POLICY:
+                for (int i = 0; i < NOTIFY_CH_COUNT; i++) {
+                    next.notify_policy[i] = v[i];
+                }
+                break;
+            case SWIFT_CONFIG_PROFILE:
+            case SWIFT_CONFIG_PROFILE_SAVE:
+                // select and save in one write name the same profile
+                if ((seen & (SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE) | SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE_SAVE)))
+                    && next.profile != v[0]) {
+                    return SWIFT_CONFIG_ERR_RANGE;
+                }
+                next.profile = v[0];
+                break;
+            case SWIFT_CONFIG_LINK_STATUS:
+                // read only: a read-modify-write may carry it back
+                pos += 2 + vlen;
+                continue;
+        }
+        seen |= SWIFT_CONFIG_CHANGED(type);
+        pos += 2 + vlen;
+    }
+
+    if (!swift_config_validate(&next)) {
+        return SWIFT_CONFIG_ERR_RANGE;
+    }
+    if (changed != NULL) {
+        // a record written back with the value it had, as a read-modify-write
+        // does with all but one, changes nothing; a save is always an action
+        *changed = records_changed(&next, cfg) | (seen & SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_PROFILE_SAVE));
+    }
+    *cfg = next;
+    return SWIFT_CONFIG_OK;
+}
+
+uint16_t swift_config_encode(const swift_config_t *cfg, uint8_t *buf, uint16_t buf_len)
+{
+    if (buf_len < SWIFT_CONFIG_ENCODED_LEN) {
+        return 0;
+    }
+    uint8_t *p = buf;
+    *p++ = SWIFT_CONFIG_NOTIFY_PERIOD; *p++ = 2;
+    p = put_u16(p, cfg->notify_period_ms);
+    *p++ = SWIFT_CONFIG_PAYLOAD_LEN; *p++ = 2;
+    p = put_u16(p, cfg->payload_len);
+    *p++ = SWIFT_CONFIG_CONN_INTERVAL; *p++ = 4;
+    p = put_u16(p, cfg->conn_int_min);
+    p = put_u16(p, cfg->conn_int_max);
+    *p++ = SWIFT_CONFIG_CONN_LATENCY; *p++ = 4;
+    p = put_u16(p, cfg->conn_latency);
+    p = put_u16(p, cfg->conn_timeout);
+    *p++ = SWIFT_CONFIG_PHY; *p++ = 1;
+    *p++ = cfg->phy_mask;
+    *p++ = SWIFT_CONFIG_SAMPLE_CODEC; *p++ = 1;
+    *p++ = cfg->sample_codec;
+    *p++ = SWIFT_CONFIG_NOTIFY_POLICY; *p++ = NOTIFY_CH_COUNT;
+    for (int i = 0; i < NOTIFY_CH_COUNT; i++) {
+        *p++ = cfg->notify_policy[i];
+    }
+    *p++ = SWIFT_CONFIG_PROFILE; *p++ = 1;
+    *p++ = cfg->profile;
+    return (uint16_t)(p - buf);
+}
+
+uint16_t swift_config_encode_diff(const swift_config_t *cfg, const swift_config_t *base, uint8_t *buf, uint16_t buf_len)
+{
+    uint8_t mine[SWIFT_CONFIG_ENCODED_LEN], theirs[SWIFT_CONFIG_ENCODED_LEN];
+    uint16_t len = swift_config_encode(cfg, mine, sizeof(mine));
+    swift_config_encode(base, theirs, sizeof(theirs));
+
+    // both encodings carry the same records in the same order
+    uint16_t out = 0;
+    for (uint16_t pos = 0; pos < len; pos += 2 + mine[pos + 1]) {
+        uint16_t rec_len = 2 + mine[pos + 1];
+        if (memcmp(&mine[pos], &theirs[pos], rec_len) == 0) {
+            continue;
+        }
+        if (buf_len - out < rec_len) {
+            return 0;
+        }
+        memcpy(&buf[out], &mine[pos], rec_len);
+        out += rec_len;
+    }
+    return out;
+}
+
+uint16_t swift_config_encode_link_status(const swift_link_status_t *link, uint8_t *buf, uint16_t buf_len)
+{
+    if (buf_len < SWIFT_CONFIG_LINK_STATUS_LEN) {
+        return 0;
+    }
+    uint8_t *p = buf;
+    *p++ = SWIFT_CONFIG_LINK_STATUS; *p++ = 10;
+    *p++ = link->tx_phy;
+    *p++ = link->rx_phy;
+    p = put_u16(p, link->tx_octets);
+    p = put_u16(p, link->rx_octets);
+    p = put_u16(p, link->mtu);
+    p = put_u16(p, link->conn_interval);
+    return (uint16_t)(p - buf);
+}
+
+const char *swift_config_status_str(swift_config_status_t status)
+{
+    switch (status) {
+        case SWIFT_CONFIG_OK:               return "ok";
+        case SWIFT_CONFIG_ERR_TRUNCATED:    return "truncated record";
+        case SWIFT_CONFIG_ERR_UNKNOWN_TYPE: return "unknown record type";
+        case SWIFT_CONFIG_ERR_LENGTH:       return "bad record length";
+        case SWIFT_CONFIG_ERR_RANGE:        return "value out of range";
+        default:                            return "?";
+    }
+}
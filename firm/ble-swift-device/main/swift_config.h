@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "notify_sched.h"
+#include "sample_codec.h"
+
+//-----------------------------------------------------------------------------
+// Runtime configuration (config characteristic)
+//
+// Wire format: a sequence of records [type:1][len:1][value:len], values little
+// endian. A write may carry any subset of records, in any order; it is applied
+// only if every record is known, has the expected length and the resulting
+// configuration is consistent. A read returns every record, followed by the
+// read-only link status of the reading connection (ignored when written back).
+//
+// PROFILE selects a tuning profile (tuning_profile.h). Naming the active
+// profile changes nothing, so a read written back unchanged is no switch.
+// On a switch the profile's settings replace the current ones, and a
+// settings record in the same write takes precedence over the profile only
+// where its value differs from the current configuration: a read-modify-write
+// that changes just the profile loads that profile's settings, one that also
+// changes a record keeps that change on top of them. PROFILE_SAVE stores the
+// resulting configuration as the profile's settings. A switch or a save makes
+// the profile the one loaded at boot; a write may carry both, for the same
+// profile. A read returns the active profile.
+typedef enum {
+    SWIFT_CONFIG_NOTIFY_PERIOD = 0x01, // u16: notify tick, ms
+    SWIFT_CONFIG_PAYLOAD_LEN   = 0x02, // u16: max notification payload, bytes (0: fill the MTU)
+    SWIFT_CONFIG_CONN_INTERVAL = 0x03, // u16 min, u16 max: preferred interval, 1.25ms units
+    SWIFT_CONFIG_CONN_LATENCY  = 0x04, // u16 latency (events), u16 supervision timeout (10ms units)
+    SWIFT_CONFIG_PHY           = 0x05, // u8: preferred PHYs, bit0 1M / bit1 2M / bit2 Coded (0: no preference)
+    SWIFT_CONFIG_SAMPLE_CODEC  = 0x06, // u8: sample_codec_t the client decodes (0: one sample per frame)
+    SWIFT_CONFIG_NOTIFY_POLICY = 0x07, // u8 per notify_channel_t: notify_policy_t of its events (0: off)
+    SWIFT_CONFIG_PROFILE       = 0x08, // u8: swift_profile_t to select
+    SWIFT_CONFIG_PROFILE_SAVE  = 0x09, // u8: swift_profile_t to store the configuration as (write only)
+    SWIFT_CONFIG_LINK_STATUS   = 0x10, // read only: u8 tx PHY, u8 rx PHY, u16 tx octets, u16 rx octets, u16 MTU, u16 interval
+} swift_config_type_t;
+
+// Tuning profiles, by id
+typedef enum {
+    SWIFT_PROFILE_DEFAULT = 0,      // the compile-time defaults
+    SWIFT_PROFILE_LOW_LATENCY,
+    SWIFT_PROFILE_MAX_THROUGHPUT,
+    SWIFT_PROFILE_LOW_POWER,
+    SWIFT_PROFILE_MAX,
+} swift_profile_t;
+
+// Bit (1u << type) is set in the `changed` mask for every record a write changed.
+#define SWIFT_CONFIG_CHANGED(type) (1u << (type))
+// Every settings record (NOTIFY_PERIOD..NOTIFY_POLICY): what a profile switch may change.
+#define SWIFT_CONFIG_CHANGED_SETTINGS (SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_POLICY + 1) - SWIFT_CONFIG_CHANGED(SWIFT_CONFIG_NOTIFY_PERIOD))
+
+#define SWIFT_CONFIG_NOTIFY_PERIOD_MIN  2
+#define SWIFT_CONFIG_NOTIFY_PERIOD_MAX  10000
+#define SWIFT_CONFIG_PAYLOAD_LEN_MIN    10  // one frame
+#define SWIFT_CONFIG_PAYLOAD_LEN_MAX    512
+#define SWIFT_CONFIG_CONN_INTERVAL_MIN  0x0006
+#define SWIFT_CONFIG_CONN_INTERVAL_MAX  0x0C80
+#define SWIFT_CONFIG_CONN_LATENCY_MAX   499
+#define SWIFT_CONFIG_CONN_TIMEOUT_MIN   10
+#define SWIFT_CONFIG_CONN_TIMEOUT_MAX   3200
+#define SWIFT_CONFIG_PHY_MASK_ALL       0x07
+
+// Longest encoding swift_config_encode produces.
+#define SWIFT_CONFIG_ENCODED_LEN (4 + 4 + 6 + 6 + 3 + 3 + 2 + NOTIFY_CH_COUNT + 3)
+#define SWIFT_CONFIG_LINK_STATUS_LEN (2 + 10)
+
+typedef struct {
+    uint16_t notify_period_ms;
+    uint16_t payload_len;
+    uint16_t conn_int_min;
+    uint16_t conn_int_max;
+    uint16_t conn_latency;
+    uint16_t conn_timeout;
+    uint8_t phy_mask;
+    uint8_t sample_codec;
+    uint8_t notify_policy[NOTIFY_CH_COUNT];
+    uint8_t profile;        // swift_profile_t the settings came from
+} swift_config_t;
+
+// Negotiated link parameters reported to the client
+typedef struct {
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    uint16_t tx_octets;
+    uint16_t rx_octets;
+    uint16_t mtu;
+    uint16_t conn_interval; // 1.25ms units
+} swift_link_status_t;
+
+typedef enum {
+    SWIFT_CONFIG_OK = 0,
+    SWIFT_CONFIG_ERR_TRUNCATED,     // a record runs past the end of the write
+    SWIFT_CONFIG_ERR_UNKNOWN_TYPE,
+    SWIFT_CONFIG_ERR_LENGTH,        // known type, wrong value length
+    SWIFT_CONFIG_ERR_RANGE,         // value out of range or inconsistent with the rest
+} swift_config_status_t;
+
+// Compile-time defaults (30ms tick, 7.5-15ms interval, ...).
+void swift_config_defaults(swift_config_t *cfg);
+
+// Whether every field is in range and the connection parameters are
+// consistent; swift_config_parse() accepts nothing else.
+bool swift_config_validate(const swift_config_t *cfg);
+
+// Applies the records in data on top of *cfg. On error *cfg is left untouched.
+// changed (optional) receives SWIFT_CONFIG_CHANGED() bits for the records whose
+// values the write changed, and PROFILE_SAVE when it carried one. The profile
+// switch itself is the caller's (see above and swift_config_encode_diff).
+swift_config_status_t swift_config_parse(const uint8_t *data, uint16_t len, swift_config_t *cfg, uint32_t *changed);
+
+// Encodes every field; returns the length, or 0 when buf_len is too small.
+uint16_t swift_config_encode(const swift_config_t *cfg, uint8_t *buf, uint16_t buf_len);
+
+// Encodes the records of *cfg whose values differ from *base, in encode order:
+// what a write changed, to apply again on top of other settings. Returns the
+// length (0 for none), or 0 when buf_len is too small.
+uint16_t swift_config_encode_diff(const swift_config_t *cfg, const swift_config_t *base, uint8_t *buf, uint16_t buf_len);
+
+// Encodes the SWIFT_CONFIG_LINK_STATUS record; 0 when buf_len is too small.
+uint16_t swift_config_encode_link_status(const swift_link_status_t *link, uint8_t *buf, uint16_t buf_len);
+
+const char *swift_config_status_str(swift_config_status_t status);
@@ -0,0 +1,94 @@
+#include "telemetry.h"
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint32_t load(const _Atomic uint32_t *v)
+{
+    return atomic_load_explicit((_Atomic uint32_t *)v, memory_order_relaxed);
+}
+
+void telemetry_hist_since(const telemetry_t *tel, telemetry_hist_id_t id, telemetry_hist_mark_t *mark, uint32_t max_us, latency_hist_t *out)
+{
+    const telemetry_hist_t *hist = &tel->hists[id];
+    latency_hist_reset(out);
+    out->max_us = max_us;
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        uint32_t now = load(&hist->buckets[i]);
+        // the last bucket's samples lie between its start and max_us: out's bucket of max_us holds them all
+        int to = i < TELEMETRY_HIST_BUCKETS - 1 ? i : latency_hist_bucket(max_us, LATENCY_HIST_BUCKETS);
+        if (to < i) {
+            to = i;
+        }
+        out->buckets[to] += now - mark->buckets[i];
+        mark->buckets[i] = now;
+    }
+    uint32_t count = load(&hist->count);
+    uint32_t sum_us = load(&hist->sum_us);
+    out->count = count - mark->count;
+    out->sum_us = sum_us - mark->sum_us;
+    mark->count = count;
+    mark->sum_us = sum_us;
+}
+
+void telemetry_reset(telemetry_t *tel)
+{
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        atomic_init(&tel->counters[i], 0);
+    }
+    for (int h = 0; h < TELEMETRY_HIST_MAX; h++) {
+        telemetry_hist_t *hist = &tel->hists[h];
+        for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+            atomic_init(&hist->buckets[i], 0);
+        }
+        atomic_init(&hist->count, 0);
+        atomic_init(&hist->sum_us, 0);
+        atomic_init(&hist->max_us, 0);
+    }
+}
+
+void telemetry_hist_add(telemetry_t *tel, telemetry_hist_id_t id, uint32_t us)
+{
+    telemetry_hist_t *hist = &tel->hists[id];
+    atomic_fetch_add_explicit(&hist->buckets[latency_hist_bucket(us, TELEMETRY_HIST_BUCKETS)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us, us, memory_order_relaxed);
+
+    // raise the max; another task may be raising it at the same time
+    uint32_t max = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    while (us > max
+        && !atomic_compare_exchange_weak_explicit(&hist->max_us, &max, us, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+uint16_t telemetry_encode(const telemetry_t *tel, uint32_t uptime_ms, uint8_t *buf, uint16_t buf_len)
+{
+    if (buf_len < TELEMETRY_ENCODED_LEN) {
+        return 0;
+    }
+    uint8_t *p = buf;
+    *p++ = TELEMETRY_VERSION;
+    *p++ = TELEMETRY_COUNTER_MAX;
+    *p++ = TELEMETRY_HIST_MAX;
+    *p++ = TELEMETRY_HIST_BUCKETS;
+    p = put_u32(p, uptime_ms);
+    for (int i = 0; i < TELEMETRY_COUNTER_MAX; i++) {
+        p = put_u32(p, load(&tel->counters[i]));
+    }
+    for (int h = 0; h < TELEMETRY_HIST_MAX; h++) {
+        const telemetry_hist_t *hist = &tel->hists[h];
+        p = put_u32(p, load(&hist->count));
+        p = put_u32(p, load(&hist->sum_us));
+        p = put_u32(p, load(&hist->max_us));
+        for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+            p = put_u32(p, load(&hist->buckets[i]));
+        }
+    }
+    return (uint16_t)(p - buf);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "latency_hist.h"
+
+//-----------------------------------------------------------------------------
+// Device-side telemetry
+//
+// Event counters and handler-time histograms that any task may update with
+// relaxed atomics (no lock, a few instructions per sample). Counters and sums
+// only grow and wrap at 2^32; a client compares two reads to get rates.
+typedef enum {
+    TELEMETRY_NOTIFY_SENT = 0,      // accepted by esp_ble_gatts_send_indicate
+    TELEMETRY_NOTIFY_BYTES,
+    TELEMETRY_NOTIFY_REFUSED,       // esp_ble_gatts_send_indicate failed
+    TELEMETRY_NOTIFY_CONFIRMED,     // ESP_GATTS_CONF_EVT, ok
+    TELEMETRY_NOTIFY_FAILED,        // ESP_GATTS_CONF_EVT, error
+    TELEMETRY_CONGEST_EVENTS,
+    TELEMETRY_WRITES_RECEIVED,
+    TELEMETRY_WRITE_BYTES,
+    TELEMETRY_WRITES_DROPPED,       // no free write buffer
+    TELEMETRY_WRITES_APPLIED,
+    TELEMETRY_CONNECTS,
+    TELEMETRY_DISCONNECTS,
+    TELEMETRY_WRITE_SEQ_GAPS,       // write sequences skipped; still lost = gaps - reordered
+    TELEMETRY_WRITES_REORDERED,     // frames that arrived after a later sequence
+    TELEMETRY_WRITES_DUPLICATE,     // repeated frames
+    TELEMETRY_WRITES_INVALID,       // writes that are not whole frames, and frames with no valid header
+    TELEMETRY_BLOBS_COMPLETED,
+    TELEMETRY_BLOB_BYTES,           // in completed blobs
+    TELEMETRY_BLOB_REJECTED,        // blob pieces refused (offset, size, busy, malformed)
+    TELEMETRY_LED_PATTERNS_LOADED,
+    TELEMETRY_LED_PATTERNS_REJECTED, // pattern blobs that did not compile
+    TELEMETRY_NOTIFY_TICKS_DROPPED, // notify ticks lost while the notify task was behind
+    TELEMETRY_SAMPLES_PRODUCED,     // read from the sample source
+    TELEMETRY_SAMPLES_DROPPED,      // lost before that: source backlog, full DMA pool, block overwritten unread
+    TELEMETRY_SAMPLES_SKIPPED,      // left unsent to a client that fell behind, summed over clients
+    TELEMETRY_SAMPLE_BLOCKS_OVERWRITTEN, // handed-over blocks taken back before the notify path read them
+    TELEMETRY_COUNTER_MAX,
+} telemetry_counter_t;
+
+typedef enum {
+    TELEMETRY_HIST_GATTS = 0,       // gatts_event_handler run time
+    TELEMETRY_HIST_GAP,             // gap_event_handler run time
+    TELEMETRY_HIST_NOTIFY_TIMER,    // notify fan-out run time (notify task, or timer callback)
+    TELEMETRY_HIST_WRITE_LATENCY,   // write received -> LED updated
+    TELEMETRY_HIST_NOTIFY_LAG,      // notify tick -> notify task picks it up
+    TELEMETRY_HIST_MAX,
+} telemetry_hist_id_t;
+
+// Bucket 0 counts 0us, bucket i (i >= 1) counts [2^(i-1), 2^i) us, and the last
+// bucket also takes everything above (same scheme as latency_hist.h).
+#define TELEMETRY_HIST_BUCKETS 16 // last bucket starts at 2^14 us (~16 ms)
+_Static_assert(TELEMETRY_HIST_BUCKETS <= LATENCY_HIST_BUCKETS, "telemetry_hist_since folds into a latency_hist_t");
+
+typedef struct {
+    _Atomic uint32_t buckets[TELEMETRY_HIST_BUCKETS];
+    _Atomic uint32_t count;
+    _Atomic uint32_t sum_us;
+    _Atomic uint32_t max_us;
+} telemetry_hist_t;
+
+typedef struct {
+    _Atomic uint32_t counters[TELEMETRY_COUNTER_MAX];
+    telemetry_hist_t hists[TELEMETRY_HIST_MAX];
+} telemetry_t;
+
+//-----------------------------------------------------------------------------
+// Binary layout of the telemetry characteristic (little endian), version 1:
+//
+//   u8  version
+//   u8  counter count (N)
+//   u8  histogram count (H)
+//   u8  buckets per histogram (B)
+//   u32 uptime in ms
+//   N x u32 counters, in telemetry_counter_t order
+//   H x { u32 count, u32 sum_us, u32 max_us, B x u32 buckets }, in telemetry_hist_id_t order
+//
+// Clients must use the counts from the header, so later versions can append
+// counters or histograms without breaking them.
+#define TELEMETRY_VERSION       1
+#define TELEMETRY_HEADER_LEN    8
+#define TELEMETRY_HIST_LEN      (4 * (3 + TELEMETRY_HIST_BUCKETS))
+#define TELEMETRY_ENCODED_LEN   (TELEMETRY_HEADER_LEN + 4 * TELEMETRY_COUNTER_MAX + TELEMETRY_HIST_MAX * TELEMETRY_HIST_LEN)
+// The snapshot is read as one attribute value, which ATT caps at 512 bytes.
+_Static_assert(TELEMETRY_ENCODED_LEN <= 512, "telemetry snapshot exceeds the 512-byte ATT value limit");
+
+void telemetry_reset(telemetry_t *tel);
+
+static inline void telemetry_count(telemetry_t *tel, telemetry_counter_t counter, uint32_t n)
+{
+    atomic_fetch_add_explicit(&tel->counters[counter], n, memory_order_relaxed);
+}
+
+void telemetry_hist_add(telemetry_t *tel, telemetry_hist_id_t hist, uint32_t us);
+
+// A histogram as of an earlier telemetry_hist_since call; zero for "since reset".
+typedef struct {
+    uint32_t buckets[TELEMETRY_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t sum_us;
+} telemetry_hist_mark_t;
+
+// What a histogram gained since *mark, as a latency_hist_t for its percentiles
+// and log line, then moves *mark up to now. The histogram keeps no per-window
+// max, so the caller passes it (max_us); the samples of the open-ended last
+// bucket go to out's bucket of max_us, which bounds them. One caller per mark.
+void telemetry_hist_since(const telemetry_t *tel, telemetry_hist_id_t id, telemetry_hist_mark_t *mark, uint32_t max_us, latency_hist_t *out);
+
+// Snapshot of every counter and histogram; 0 when buf_len is too small.
+// Each value is read atomically, but the set is not one instant: values
+// updated during the copy may be a sample apart.
+uint16_t telemetry_encode(const telemetry_t *tel, uint32_t uptime_ms, uint8_t *buf, uint16_t buf_len);
@@ -0,0 +1,164 @@
+#include <string.h>
+
+#include "nvs.h"
+
+#include "tuning_profile.h"
+
+const char *tuning_profile_name(swift_profile_t profile)
+{
+    switch (profile) {
+        case SWIFT_PROFILE_DEFAULT:         return "default";
+        case SWIFT_PROFILE_LOW_LATENCY:     return "low-latency";
+        case SWIFT_PROFILE_MAX_THROUGHPUT:  return "max-throughput";
+        case SWIFT_PROFILE_LOW_POWER:       return "low-power";
+        default:                            return "?";
+    }
+}
+
+void tuning_profile_builtin(swift_profile_t profile, swift_config_t *cfg)
+{
+    swift_config_defaults(cfg);
+    switch (profile) {
+        case SWIFT_PROFILE_LOW_LATENCY:
+            // a frame every 10ms, sent at the next 7.5ms connection event
+            cfg->notify_period_ms = 10;
+            cfg->payload_len = SWIFT_CONFIG_PAYLOAD_LEN_MIN;
+            cfg->conn_int_min = 0x06;
+            cfg->conn_int_max = 0x06;
+            cfg->conn_timeout = 200;
+            cfg->phy_mask = 0x02;
+            break;
+        case SWIFT_PROFILE_MAX_THROUGHPUT:
+            // MTU-sized notifications, 15ms events long enough for a full burst
+            cfg->notify_period_ms = 10;
+            cfg->payload_len = 0;
+            cfg->conn_int_min = 0x0C;
+            cfg->conn_int_max = 0x0C;
+            cfg->phy_mask = 0x02;
+            break;
+        case SWIFT_PROFILE_LOW_POWER:
+            // radio up every 100-125ms, and may skip four events when idle
+            cfg->notify_period_ms = 100;
+            cfg->payload_len = 0;
+            cfg->conn_int_min = 0x50;
+            cfg->conn_int_max = 0x64;
+            cfg->conn_latency = 4;
+            cfg->conn_timeout = 600;
+            cfg->phy_mask = 0x01;
+            break;
+        default:
+            profile = SWIFT_PROFILE_DEFAULT;
+            break;
+    }
+    cfg->profile = (uint8_t)profile;
+}
+
+uint16_t tuning_profile_serialize(const swift_config_t *cfg, uint8_t *buf, uint16_t cap)
+{
+    swift_config_t builtin;
+    tuning_profile_builtin((swift_profile_t)cfg->profile, &builtin);
+    if (cap < 1) {
+        return 0;
+    }
+    uint8_t records[SWIFT_CONFIG_ENCODED_LEN];
+    uint16_t len = swift_config_encode_diff(cfg, &builtin, records, sizeof(records));
+    if (cap - 1 < len) {
+        return 0;
+    }
+    buf[0] = TUNING_PROFILE_VERSION;
+    memcpy(&buf[1], records, len);
+    return (uint16_t)(1 + len);
+}
+
+esp_err_t tuning_profile_deserialize(swift_profile_t profile, const uint8_t *buf, uint16_t len, swift_config_t *cfg)
+{
+    if (len < 1 || buf[0] != TUNING_PROFILE_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    swift_config_t next;
+    tuning_profile_builtin(profile, &next);
+    if (swift_config_parse(buf + 1, len - 1, &next, NULL) != SWIFT_CONFIG_OK || next.profile != profile) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *cfg = next;
+    return ESP_OK;
+}
+
+static esp_err_t read_settings(nvs_handle_t nvs, swift_profile_t profile, swift_config_t *cfg)
+{
+    tuning_profile_builtin(profile, cfg);
+    uint8_t blob[TUNING_PROFILE_BLOB_MAX];
+    size_t len = sizeof(blob);
+    esp_err_t err = nvs_get_blob(nvs, tuning_profile_name(profile), blob, &len);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    return tuning_profile_deserialize(profile, blob, (uint16_t)len, cfg);
+}
+
+esp_err_t tuning_profile_get(swift_profile_t profile, swift_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(TUNING_PROFILE_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        tuning_profile_builtin(profile, cfg);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    err = read_settings(nvs, profile, cfg);
+    nvs_close(nvs);
+    return err;
+}
+
+esp_err_t tuning_profile_load_active(swift_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(TUNING_PROFILE_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        tuning_profile_builtin(SWIFT_PROFILE_DEFAULT, cfg);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    uint8_t active = SWIFT_PROFILE_DEFAULT;
+    err = nvs_get_u8(nvs, TUNING_PROFILE_KEY_ACTIVE, &active);
+    if (err == ESP_OK && active >= SWIFT_PROFILE_MAX) {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    if (err != ESP_OK) {
+        tuning_profile_builtin(SWIFT_PROFILE_DEFAULT, cfg);
+        nvs_close(nvs);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    err = read_settings(nvs, (swift_profile_t)active, cfg);
+    nvs_close(nvs);
+    return err;
+}
+
+esp_err_t tuning_profile_store(const swift_config_t *cfg, bool save)
+{
+    if (cfg->profile >= SWIFT_PROFILE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(TUNING_PROFILE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_u8(nvs, TUNING_PROFILE_KEY_ACTIVE, cfg->profile);
+    if (err == ESP_OK && save) {
+        uint8_t blob[TUNING_PROFILE_BLOB_MAX];
+        uint16_t len = tuning_profile_serialize(cfg, blob, sizeof(blob));
+        const char *key = tuning_profile_name((swift_profile_t)cfg->profile);
+        // nothing but the version byte: the built-in settings, nothing to keep
+        err = len > 1 ? nvs_set_blob(nvs, key, blob, len) : nvs_erase_key(nvs, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "swift_config.h"
+
+//-----------------------------------------------------------------------------
+// Tuning profiles
+//
+// A profile is a named configuration: built-in settings, unless a client
+// saved its own over them (SWIFT_CONFIG_PROFILE_SAVE). Saved settings are
+// kept in NVS under the profile's name as a version byte followed by the
+// config records that differ from the built-in ones: an untouched profile
+// takes no flash, a tweaked one a few bytes. The active profile's id is kept
+// under TUNING_PROFILE_KEY_ACTIVE; app_main loads that profile right after
+// nvs_flash_init, so the controller, the notify tick and the first
+// advertising already run with it.
+#define TUNING_PROFILE_NAMESPACE    "swift"
+#define TUNING_PROFILE_KEY_ACTIVE   "profile"
+#define TUNING_PROFILE_VERSION      1
+#define TUNING_PROFILE_BLOB_MAX     (1 + SWIFT_CONFIG_ENCODED_LEN)
+
+// "default", "low-latency", ...: the NVS key of the profile's settings.
+const char *tuning_profile_name(swift_profile_t profile);
+
+// swift_config_defaults() with the profile's changes; DEFAULT for an unknown profile.
+void tuning_profile_builtin(swift_profile_t profile, swift_config_t *cfg);
+
+// Stored form of cfg as the settings of cfg->profile; returns the length,
+// 0 when cap is too small.
+uint16_t tuning_profile_serialize(const swift_config_t *cfg, uint8_t *buf, uint16_t cap);
+
+// Settings of a profile from their stored form. ESP_ERR_INVALID_VERSION or
+// ESP_ERR_INVALID_STATE (records that do not parse, or name another
+// profile) leave *cfg untouched.
+esp_err_t tuning_profile_deserialize(swift_profile_t profile, const uint8_t *buf, uint16_t len, swift_config_t *cfg);
+
+// A profile's settings: saved ones, else built-in. A stored record that
+// cannot be used returns its error, with the built-in settings in *cfg.
+esp_err_t tuning_profile_get(swift_profile_t profile, swift_config_t *cfg);
+
+// The active profile's settings (DEFAULT's while none was selected), as
+// tuning_profile_get. An erased flash is not an error.
+esp_err_t tuning_profile_load_active(swift_config_t *cfg);
+
+// Makes cfg->profile the active profile and, with save, stores cfg as its
+// settings; one commit.
+esp_err_t tuning_profile_store(const swift_config_t *cfg, bool save);
@@ -0,0 +1,54 @@
+#include "write_pool.h"
+
+bool write_pool_init(write_pool_t *pool, void *storage, uint16_t data_cap, write_buf_handle_t *free_storage, uint16_t count)
+{
+    if (pool == NULL || storage == NULL || ((uintptr_t)storage & 7) != 0 || count >= WRITE_BUF_NONE
+        || !spsc_ring_init(&pool->free_ring, free_storage, sizeof(write_buf_handle_t), count)) {
+        return false;
+    }
+    pool->storage = storage;
+    pool->slot_size = (uint32_t)WRITE_POOL_SLOT_SIZE(data_cap);
+    pool->data_cap = data_cap;
+    pool->count = count;
+    atomic_init(&pool->claimed, 0);
+    atomic_init(&pool->exhausted, 0);
+    atomic_init(&pool->high_water, 0);
+
+    // every buffer starts out free
+    for (write_buf_handle_t handle = 0; handle < count; handle++) {
+        spsc_ring_push(&pool->free_ring, &handle);
+    }
+    return true;
+}
+
+write_buf_handle_t write_pool_claim(write_pool_t *pool)
+{
+    write_buf_handle_t handle;
+    if (!spsc_ring_pop(&pool->free_ring, &handle)) {
+        atomic_store_explicit(&pool->exhausted,
+            atomic_load_explicit(&pool->exhausted, memory_order_relaxed) + 1, memory_order_relaxed);
+        return WRITE_BUF_NONE;
+    }
+
+    atomic_store_explicit(&pool->claimed,
+        atomic_load_explicit(&pool->claimed, memory_order_relaxed) + 1, memory_order_relaxed);
+    uint32_t in_use = write_pool_in_use(pool);
+    if (in_use > atomic_load_explicit(&pool->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&pool->high_water, in_use, memory_order_relaxed);
+    }
+    return handle;
+}
+
+bool write_pool_release(write_pool_t *pool, write_buf_handle_t handle)
+{
+    if (handle >= pool->count) {
+        return false;
+    }
+    // full only when every buffer is already free: it has room for every handle
+    return spsc_ring_push(&pool->free_ring, &handle);
+}
+
+uint32_t write_pool_in_use(const write_pool_t *pool)
+{
+    return pool->count - spsc_ring_count(&pool->free_ring);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc_ring.h"
+
+//-----------------------------------------------------------------------------
+// Fixed-size buffer pool for incoming writes
+//
+// The GATTS callback (producer) claims a buffer, copies the write value into
+// it once, and hands the buffer's handle to the consumer. The consumer works
+// on the buffer in place and releases it when done. Released handles go back
+// through a lock-free SPSC ring, so claim and release take no lock. The ring
+// runs from the consumer back to the producer.
+//
+// When every buffer is claimed, the write is dropped and counted in exhausted.
+typedef uint16_t write_buf_handle_t;
+
+#define WRITE_BUF_NONE 0xFFFF
+
+typedef struct {
+    int64_t rx_time_us;     // esp_timer_get_time() when the GATTS callback received it
+    uint16_t conn_id;
+    uint16_t len;           // bytes valid in data
+    uint8_t data[];         // data_cap bytes
+} write_buf_t;
+
+// Bytes of storage per buffer, rounded up to keep every buffer 8-byte aligned.
+#define WRITE_POOL_SLOT_SIZE(data_cap) ((sizeof(write_buf_t) + (size_t)(data_cap) + 7) & ~(size_t)7)
+
+typedef struct {
+    uint8_t *storage;
+    uint32_t slot_size;
+    uint16_t data_cap;
+    uint16_t count;
+
+    spsc_ring_t free_ring;  // released handles, consumer -> producer
+
+    // producer-side counters
+    _Atomic uint32_t claimed;
+    _Atomic uint32_t exhausted; // claims that found no free buffer
+    _Atomic uint32_t high_water;
+} write_pool_t;
+
+// storage: count * WRITE_POOL_SLOT_SIZE(data_cap) bytes, 8-byte aligned.
+// free_storage: count handles. count must be a power of two below WRITE_BUF_NONE.
+bool write_pool_init(write_pool_t *pool, void *storage, uint16_t data_cap, write_buf_handle_t *free_storage, uint16_t count);
+
+// Producer: WRITE_BUF_NONE (and exhausted++) when every buffer is claimed.
+write_buf_handle_t write_pool_claim(write_pool_t *pool);
+
+// Consumer: gives a claimed buffer back. false (and nothing released) for
+// handles outside the pool, WRITE_BUF_NONE included, and when every buffer
+// is already free. Releasing one buffer twice while others are claimed is
+// not detected.
+bool write_pool_release(write_pool_t *pool, write_buf_handle_t handle);
+
+static inline write_buf_t *write_pool_buf(const write_pool_t *pool, write_buf_handle_t handle)
+{
+    return (write_buf_t *)(pool->storage + (size_t)handle * pool->slot_size);
+}
+
+// Buffers currently claimed (exact from the producer, approximate from elsewhere).
+uint32_t write_pool_in_use(const write_pool_t *pool);